@@ -3438,6 +3438,7 @@ vector<Dict> RT3DTreeAligner::xform_align_nbest(EMData * this_img, EMData * to,
 	float sigmato = params.set_default("sigmato",0.01f);
 	int verbose = params.set_default("verbose",0);
 	float maxres = params.set_default("maxres",-1.0f);
+	int nthreads = params.set_default("threads",1);
 
 	if (base_this->get_xsize()!=base_this->get_ysize()+2 || base_this->get_ysize()!=base_this->get_zsize()
 		|| base_to->get_xsize()!=base_to->get_ysize()+2 || base_to->get_ysize()!=base_to->get_zsize()) throw InvalidCallException("ERROR (RT3DTreeAligner): requires cubic images with even numbered box sizes");
@@ -3462,7 +3463,11 @@ vector<Dict> RT3DTreeAligner::xform_align_nbest(EMData * this_img, EMData * to,
 	
 	
 	
+	// testort() is called from several threads, so every parameter it needs is read here, once
 	float maxang=params.set_default("maxang",-1.0);
+	bool randphi=params.set_default("randphi",false);
+	bool rand180=params.set_default("rand180",false);
+	int boxsize=params.has_key("initxform")?ny:0;
 	Transform initxf;
 	
 //	int downsample=floor(ny/20);		// Minimum shrunken box size is 20^3
@@ -3521,6 +3526,11 @@ vector<Dict> RT3DTreeAligner::xform_align_nbest(EMData * this_img, EMData * to,
 			small_to->process_inplace("filter.lowpass.gauss",Dict("cutoff_abs",0.33f));
 		}
 
+		// small_this and small_to are shared between threads below. Reading the header would compute the
+		// statistics on first use, so do it now while we are still single threaded
+		small_this->get_attr_dict();
+		small_to->get_attr_dict();
+
 		// these are cached for speed in the comparator
 		vector<float>sigmathisv=small_this->calc_radial_dist(ss/2,0,1,4);
 		vector<float>sigmatov=small_to->calc_radial_dist(ss/2,0,1,4);
@@ -3560,80 +3570,95 @@ vector<Dict> RT3DTreeAligner::xform_align_nbest(EMData * this_img, EMData * to,
 			if (transforms.size()<30) continue; // for very high symmetries we will go up to 32 instead of 24
 
 			// We iterate over all orientations in an asym triangle (alt & az) then deal with phi ourselves
-//			for (std::vector<Transform>::iterator t = transforms.begin(); t!=transforms.end(); ++t) {    // iterator form was causing all sorts of problems
-			for (unsigned int it=0; it<transforms.size(); it++) {
-				
-				if (verbose>2) {
+			vector<float> phis;
+			for (float phi=0; phi<360.0; phi+=astep) phis.push_back(phi);
+			int nphi=phis.size();
+
+			// Each orientation is scored independently, possibly in parallel. The list of best solutions is then
+			// updated serially in the original order, so the result doesn't depend on the number of threads
+			int ntest=transforms.size()*nphi;
+			vector<Transform> t_xform(ntest);
+			vector<float> t_score(ntest);
+			vector<float> t_coverage(ntest);
+			Util::parallel_for(ntest,Util::get_thread_count(nthreads,ntest),[&](int j,int) {
+				unsigned int it=j/nphi;
+				if (verbose>2 && j%nphi==0) {
 					printf("  %d/%lu \r",it,transforms.size());
 					fflush(stdout);
 				}
-				for (float phi=0; phi<360.0; phi+=astep) {
-					Transform t = transforms[it];
-					Dict aap=t.get_params("eman");
-					aap["phi"]=phi;
-					aap["tx"]=0;
-					aap["ty"]=0;
-					aap["tz"]=0;
-					t.set_params(aap);
-					t.invert();
-					aap=t.get_params("eman");
+				Transform t = transforms[it];
+				Dict aap=t.get_params("eman");
+				aap["phi"]=phis[j%nphi];
+				aap["tx"]=0;
+				aap["ty"]=0;
+				aap["tz"]=0;
+				t.set_params(aap);
+				t.invert();
+				aap=t.get_params("eman");
 
-					// somewhat strangely, rotations are actually much more expensive than FFTs, so we use a CCF for translation
-					EMData *stt=small_this->process("xform",Dict("transform",EMObject(&t),"zerocorners",1));
-					EMData *ccf=small_to->calc_ccf(stt);
-					IntPoint ml=ccf->calc_max_location_wrap();
+				// somewhat strangely, rotations are actually much more expensive than FFTs, so we use a CCF for translation
+				EMData *stt=small_this->process("xform",Dict("transform",EMObject(&t),"zerocorners",1));
+				EMData *ccf=small_to->calc_ccf(stt);
+				IntPoint ml=ccf->calc_max_location_wrap();
 
-					aap["tx"]=(int)ml[0];
-					aap["ty"]=(int)ml[1];
-					aap["tz"]=(int)ml[2];
-					t.set_params(aap);
-					delete stt;
-					delete ccf;
-					stt=small_this->process("xform",Dict("transform",EMObject(&t),"zerocorners",1));	// we have to do 1 slow transform here now that we have the translation
+				aap["tx"]=(int)ml[0];
+				aap["ty"]=(int)ml[1];
+				aap["tz"]=(int)ml[2];
+				t.set_params(aap);
+				delete stt;
+				delete ccf;
+				stt=small_this->process("xform",Dict("transform",EMObject(&t),"zerocorners",1));	// we have to do 1 slow transform here now that we have the translation
 
-//					float sim=stt->cmp("ccc.tomo.thresh",small_to,Dict("sigmaimg",sigmathis,"sigmawith",sigmato));
-					float sim=stt->cmp("ccc.tomo.thresh",small_to);
-					
-//					float sim=stt->cmp("fsc.tomo.auto",small_to,Dict("sigmaimg",sigmathisv,"sigmawith",sigmatov));
-//					float sim=stt->cmp("fsc.tomo.auto",small_to);
+//				float sim=stt->cmp("ccc.tomo.thresh",small_to,Dict("sigmaimg",sigmathis,"sigmawith",sigmato));
+				t_score[j]=stt->cmp("ccc.tomo.thresh",small_to);
 
-					// We want to make sure our starting points are somewhat separated from each other, so we replace any angles too close to an existing angle
-					// If we find an existing 'best' angle within range, then we either replace it or skip
-					int worst=-1;
-					float worstv=1.0e20;
-					for (int i=0; i<nsoln; i++) {
-						if (s_coverage[i]==0.0) continue;	// hasn't been set yet
-						Transform tdif=s_xform[i].inverse();
-						tdif=tdif*t;
-						float adif=tdif.get_rotation("spin")["omega"];
-						if (adif<astep*2.5) {
-							worst=i;
-//							printf("= %1.3f\n",adif);
-						}
-					}
+//				float sim=stt->cmp("fsc.tomo.auto",small_to,Dict("sigmaimg",sigmathisv,"sigmawith",sigmatov));
+//				float sim=stt->cmp("fsc.tomo.auto",small_to);
 
-					// if we weren't close to an existing angle, then we find the lowest current score and use that
-					if (worst==-1) {
-						// First we find the worst solution in the list of possible best solutions, or the first
-						// solution which is currently "empty"
-						for (int i=0; i<nsoln; i++) {
-							if (s_coverage[i]==0.0) { worst=i; break; }
-							if (s_score[i]<worstv) {worst=i; worstv=s_score[i];}
-						}
+				t_coverage[j]=stt->get_attr("fft_overlap");
+				t_xform[j]=t;
+				delete stt;
+			});
+			if (verbose>2) printf("\n");
+
+			for (int j=0; j<ntest; j++) {
+				const Transform &t=t_xform[j];
+				float sim=t_score[j];
+
+				// We want to make sure our starting points are somewhat separated from each other, so we replace any angles too close to an existing angle
+				// If we find an existing 'best' angle within range, then we either replace it or skip
+				int worst=-1;
+				float worstv=1.0e20;
+				for (int i=0; i<nsoln; i++) {
+					if (s_coverage[i]==0.0) continue;	// hasn't been set yet
+					Transform tdif=s_xform[i].inverse();
+					tdif=tdif*t;
+					float adif=tdif.get_rotation("spin")["omega"];
+					if (adif<astep*2.5) {
+						worst=i;
+//						printf("= %1.3f\n",adif);
 					}
+				}
 
-					// If the current solution is better than the 'worst' of the previous solutions, then we
-					// displace it. Note that there is no sorting performed here
-					if (sim<s_score[worst]) {
-						s_score[worst]=sim;
-						s_coverage[worst]=stt->get_attr("fft_overlap");
-						s_xform[worst]=t;
-						//printf("%f\t%f\t%d\n",s_score[worst],s_coverage[worst],worst);
+				// if we weren't close to an existing angle, then we find the lowest current score and use that
+				if (worst==-1) {
+					// First we find the worst solution in the list of possible best solutions, or the first
+					// solution which is currently "empty"
+					for (int i=0; i<nsoln; i++) {
+						if (s_coverage[i]==0.0) { worst=i; break; }
+						if (s_score[i]<worstv) {worst=i; worstv=s_score[i];}
 					}
-					delete stt;
+				}
+
+				// If the current solution is better than the 'worst' of the previous solutions, then we
+				// displace it. Note that there is no sorting performed here
+				if (sim<s_score[worst]) {
+					s_score[worst]=sim;
+					s_coverage[worst]=t_coverage[j];
+					s_xform[worst]=t;
+					//printf("%f\t%f\t%d\n",s_score[worst],s_coverage[worst],worst);
 				}
 			}
-			if (verbose>2) printf("\n");
 // 			for (int i=0; i<nsoln; i++) {
 // 				Dict d=s_xform[i].get_params("eman");
 // 				printf("%d, %f, %f, %f, %f\n",i,(float)d["alt"], (float)d["az"], (float)d["phi"], s_score[i]);
@@ -3651,7 +3676,8 @@ vector<Dict> RT3DTreeAligner::xform_align_nbest(EMData * this_img, EMData * to,
 				nsoln+=1;
 			}
 			
-			for (int i=0; i<nsoln; i++) {
+			// The solutions are refined independently of each other, so they may be spread over threads
+			Util::parallel_for(nsoln,Util::get_thread_count(nthreads,nsoln),[&](int i,int) {
 
 				if (verbose>2) {
 					printf("  %d\t%d\r",i,nsoln);
@@ -3660,7 +3686,7 @@ vector<Dict> RT3DTreeAligner::xform_align_nbest(EMData * this_img, EMData * to,
 				// We work an axis at a time until we get where we want to be. Somewhat like a simplex
 				int changed=1;
 				Dict upd;
-				testort(small_this,small_to,sigmathisv,sigmatov,s_score,s_coverage,s_xform,i,upd, initxf, maxshift);
+				testort(small_this,small_to,sigmathisv,sigmatov,s_score,s_coverage,s_xform,i,upd, initxf, maxshift, maxang, randphi, rand180, boxsize);
 				while (changed) {
 					changed=0;
 					for (int axis=0; axis<3; axis++) {
@@ -3670,7 +3696,7 @@ vector<Dict> RT3DTreeAligner::xform_align_nbest(EMData * this_img, EMData * to,
 						// phi continues to move independently. I believe this should produce a more monotonic energy surface
 						if (axis==0) upd[axname[2]]=-s_step[i*3+axis];
 
-						int r=testort(small_this,small_to,sigmathisv,sigmatov,s_score,s_coverage,s_xform,i,upd, initxf, maxshift);
+						int r=testort(small_this,small_to,sigmathisv,sigmatov,s_score,s_coverage,s_xform,i,upd, initxf, maxshift, maxang, randphi, rand180, boxsize);
 
 						// If we fail, we reverse direction with a slightly smaller step and try that
 						// Whether this fails or not, we move on to the next axis
@@ -3678,7 +3704,7 @@ vector<Dict> RT3DTreeAligner::xform_align_nbest(EMData * this_img, EMData * to,
 						else {
 							s_step[i*3+axis]*=-0.75;
 							upd[axname[axis]]=s_step[i*3+axis];
-							r=testort(small_this,small_to,sigmathisv,sigmatov,s_score,s_coverage,s_xform,i,upd, initxf, maxshift);
+							r=testort(small_this,small_to,sigmathisv,sigmatov,s_score,s_coverage,s_xform,i,upd, initxf, maxshift, maxang, randphi, rand180, boxsize);
 							if (r) changed=1;
 						}
 						if (verbose>4) printf("\nX %1.3f\t%1.3f\t%1.3f\t%d\t",s_step[i*3],s_step[i*3+1],s_step[i*3+2],changed);
@@ -3707,7 +3733,7 @@ vector<Dict> RT3DTreeAligner::xform_align_nbest(EMData * this_img, EMData * to,
 // 						}
 // 					}
 // 				}
-			}
+			});
 		}
 		// lazy earlier in defining s_ vectors, so lazy here too and inefficiently sorting
 		// We are sorting inside the outermost loop so we can decrease the number of solutions
@@ -3766,7 +3792,7 @@ vector<Dict> RT3DTreeAligner::xform_align_nbest(EMData * this_img, EMData * to,
 
 // This is just to prevent redundancy. It takes the existing solution vectors as arguments, an a proposed update for
 // vector i. It updates the vectors if the proposal makes an improvement, in which case it returns true
-bool RT3DTreeAligner::testort(EMData *small_this,EMData *small_to,vector<float> &sigmathisv,vector<float> &sigmatov,vector<float> &s_score, vector<float> &s_coverage,vector<Transform> &s_xform,int i,Dict &upd, Transform initxf, int maxshift) const {
+bool RT3DTreeAligner::testort(EMData *small_this,EMData *small_to,vector<float> &sigmathisv,vector<float> &sigmatov,vector<float> &s_score, vector<float> &s_coverage,vector<Transform> &s_xform,int i,Dict &upd, Transform initxf, int maxshift, float maxang, bool randphi, bool rand180, int boxsize) const {
 	Transform t;
 	Dict aap=s_xform[i].get_params("eman");
 	aap["tx"]=0;
@@ -3777,9 +3803,6 @@ bool RT3DTreeAligner::testort(EMData *small_this,EMData *small_to,vector<float>
 	}
 
 	t.set_params(aap);
-	float maxang=params.set_default("maxang",-1.0);
-	bool randphi=params.set_default("randphi",false);
-	bool rand180=params.set_default("rand180",false);
 	
 	if (maxang>0){
 		
@@ -3803,9 +3826,9 @@ bool RT3DTreeAligner::testort(EMData *small_this,EMData *small_to,vector<float>
 	}
 	
 	int ny=small_this->get_ysize();
-	if (params.has_key("initxform")){
+	if (boxsize>0){
 		// when doing refinement, search around the given position
-		t.set_trans(initxf.get_trans()*ny/(float)params["boxsize"]);
+		t.set_trans(initxf.get_trans()*ny/(float)boxsize);
 		aap=t.get_params("eman");
 	}
 
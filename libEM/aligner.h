@@ -1935,6 +1935,7 @@ namespace EMAN
 // 				d.put("initxform", EMObject::TRANSFORM,"The Transform storing the starting position. If unspecified the identity matrix is used");
 				d.put("randphi", EMObject::BOOL,"Ignore phi constraint for refine search");
 				d.put("rand180", EMObject::BOOL,"Ignore 180 rotation for refine search");
+				d.put("threads", EMObject::INT,"Number of threads used to test orientations and refine solutions. <=0 uses all cores. Default=1");
 				d.put("verbose", EMObject::BOOL,"Turn this on to have useful information printed to standard out.");
 				return d;
 			}
@@ -1942,7 +1943,7 @@ namespace EMAN
 			static const string NAME;
 
 		private:
-			bool testort(EMData *small_this, EMData *small_to,vector<float> &sigmathisv,vector<float> &sigmatov, vector<float> &s_score, vector<float> &s_coverage,vector<Transform> &s_xform,int i,Dict &upd, Transform initxf, int maxshift) const;
+			bool testort(EMData *small_this, EMData *small_to,vector<float> &sigmathisv,vector<float> &sigmatov, vector<float> &s_score, vector<float> &s_coverage,vector<Transform> &s_xform,int i,Dict &upd, Transform initxf, int maxshift, float maxang, bool randphi, bool rand180, int boxsize) const;
 
 	};
 
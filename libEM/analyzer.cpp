@@ -169,6 +169,8 @@ void KMeansAnalyzer::set_params(const Dict & new_params)
 	if (params.has_key("verbose"))verbose = params["verbose"];
 	if (params.has_key("calcsigmamean")) calcsigmamean=params["calcsigmamean"];
 	if (params.has_key("outlierclass")) outlierclass=params["outlierclass"];	
+	if (params.has_key("flat")) flat=params["flat"];
+	if (params.has_key("threads")) nthreads=params["threads"];
 }
 
 vector<EMData *> KMeansAnalyzer::analyze()
@@ -230,11 +232,28 @@ if (calcsigmamean) {
 	for (int i=nclstot; i<nclstot*2; i++) centers[i]=new EMData(images[0]->get_xsize(),images[0]->get_ysize(),images[0]->get_zsize());
 }
 
+// flat mode works on a contiguous copy of the images
+if (flat) {
+	nval=images[0]->get_size();
+	for (int i=1; i<nptcl; i++) {
+		if (images[i]->get_size()!=nval) throw ImageDimensionException("kmeans flat mode requires images of the same size");
+	}
+	ptcl_mat.resize(nptcl*nval);
+	Util::parallel_for(nptcl,Util::get_thread_count(nthreads,nptcl),[&](int i,int) {
+		memcpy(&ptcl_mat[i*nval],images[i]->get_const_data(),nval*sizeof(float));
+	});
+	prev_cen_mat.clear();
+	prev_cen_id.clear();
+	ptcl_cen_id.assign(nptcl,-1);
+	ptcl_lower.assign(nptcl,-1.0);
+	ptcl_lscale.assign(nptcl,0.0);
+}
 
 for (int i=0; i<maxiter; i++) {
 	nchanged=0;
 	resort();
-	reclassify();
+	if (flat) reclassify_flat();
+	else reclassify();
 	update_centers();
 	if (verbose) printf("iter %d>  %d (%d)\n",i,nchanged,ncls);
 	if (nchanged<minchange && ncls==nclstot) break;
@@ -249,6 +268,14 @@ for (int i=0; i<maxiter; i++) {
 }
 update_centers(calcsigmamean);
 
+if (flat) {
+	for (int i=0; i<ncls; i++) {
+		if (centers[i] && centers[i]->has_attr("kmeans_center_id")) centers[i]->del_attr("kmeans_center_id");
+	}
+	vector<float>().swap(ptcl_mat);
+	vector<float>().swap(prev_cen_mat);
+}
+
 return centers;
 }
 
@@ -384,16 +411,18 @@ for (i=0; i<ncls; i++) {
 
 }
 
-// a quick MSD between two images, MUCH faster than using sqeuclidean for small images
-float qsqcmp(EMData *a,EMData *b) {
-	size_t n = a->get_size();
-	float *d1=a->get_data();
-	float *d2=b->get_data();
-
+// a quick MSD between two arrays. reclassify() and reclassify_flat() both use this one loop, so they
+// see identical distances and resolve ties the same way
+static double qsqdist(const float *d1,const float *d2,size_t n) {
 	double ret=0.0;
 	for (size_t i=0; i<n; i++) ret+=pow(d1[i]-d2[i],2);
 
-	return (float)ret;
+	return ret;
+}
+
+// a quick MSD between two images, MUCH faster than using sqeuclidean for small images
+float qsqcmp(EMData *a,EMData *b) {
+	return (float)qsqdist(a->get_data(),b->get_data(),a->get_size());
 }
 
 // Tries to generate a reasonable similarity path through the centers to put more similar centers closer to each other
@@ -449,6 +478,133 @@ for (int i=0; i<nptcl; i++) {
 //delete c;
 }
 
+// Same result as reclassify(), but the distances come from the contiguous ptcl_mat, the particles are
+// split among threads, and Hamerly's bounds skip particles which provably can't change class. For
+// each particle we keep a lower bound on the distance to every center except its own, reduced each
+// iteration by the largest center movement. If the exact distance to its own center is still below
+// that bound (or below half the distance from its center to the nearest other center), no other center
+// can be closer and the remaining distances aren't computed. Comparisons carry a small relative margin
+// so rounding can never cause a skip the exhaustive search would disagree with, and a skip requires a
+// strictly closer center, so ties are resolved by the full scan exactly as in reclassify().
+void KMeansAnalyzer::reclassify_flat() {
+int nptcl=images.size();
+int lim=ncls;
+if (outlierclass) lim=ncls-1;	// particles don't join the outliers based on distance
+
+// centers in their current order, and how far each has moved since the last call
+vector<float> cen_mat((size_t)ncls*nval);
+vector<int> cen_id(ncls);
+vector<double> drift(ncls);
+map<int,int> prev_row;
+for (size_t j=0; j<prev_cen_id.size(); j++) prev_row[prev_cen_id[j]]=j;
+
+double maxdrift=0;
+for (int j=0; j<ncls; j++) {
+	memcpy(&cen_mat[j*nval],centers[j]->get_const_data(),nval*sizeof(float));
+	if (!centers[j]->has_attr("kmeans_center_id")) centers[j]->set_attr("kmeans_center_id",next_center_id++);
+	cen_id[j]=centers[j]->get_attr("kmeans_center_id");
+	map<int,int>::const_iterator it=prev_row.find(cen_id[j]);
+	if (it==prev_row.end()) drift[j]=-1.0;		// a new center, nothing is known about it
+	else drift[j]=sqrt(qsqdist(&cen_mat[j*nval],&prev_cen_mat[it->second*nval],nval));
+	if (j<lim) maxdrift=drift[j]<0 || maxdrift<0 ? -1.0 : Util::get_max(maxdrift,drift[j]);
+}
+
+int nthr=Util::get_thread_count(nthreads,lim);
+
+// half the distance from each center to its nearest neighbor
+vector<double> halfsep(ncls,0.0);
+Util::parallel_for(lim,nthr,[&](int j,int) {
+	double best=-1.0;
+	for (int k=0; k<lim; k++) {
+		if (k==j) continue;
+		double d=qsqdist(&cen_mat[j*nval],&cen_mat[k*nval],nval);
+		if (best<0 || d<best) best=d;
+	}
+	halfsep[j]=best<0 ? 0.0 : sqrt(best)/2.0;
+});
+
+// the current class of each particle, read before threading since attributes aren't thread-safe
+vector<int> oldcls(nptcl);
+for (int i=0; i<nptcl; i++) oldcls[i]=images[i]->get_attr_default("class_id",0);
+
+vector<int> row_of_id;
+for (int j=0; j<lim; j++) {
+	if (cen_id[j]>=(int)row_of_id.size()) row_of_id.resize(cen_id[j]+1,-1);
+	row_of_id[cen_id[j]]=j;
+}
+
+vector<float> bestd(nptcl);
+vector<int> bestn(nptcl);
+vector<char> skip_ptcl(nptcl,0);
+
+// Particles are handled in blocks, and the blocks sweep the centers in tiles, so each center row is
+// reused from cache for the whole block rather than reloaded for each particle
+const int pblock=16, ctile=8;
+int nblock=(nptcl+pblock-1)/pblock;
+Util::parallel_for(nblock,Util::get_thread_count(nthreads,nblock),[&](int b,int) {
+	int i0=b*pblock;
+	int i1=Util::get_min(i0+pblock,nptcl);
+	int todo[pblock];
+	int ntodo=0;
+	double best[pblock],second[pblock];
+
+	for (int i=i0; i<i1; i++) {
+		if (outlierclass && oldcls[i]==nclstot-1) { skip_ptcl[i]=1; continue; }	// outliers are forever
+
+		int id=ptcl_cen_id[i];
+		int a=(id>=0 && id<(int)row_of_id.size()) ? row_of_id[id] : -1;
+		if (a>=0 && ptcl_lower[i]>=0 && maxdrift>=0) {
+			double lower=ptcl_lower[i]-maxdrift;
+			double da=qsqdist(&ptcl_mat[i*nval],&cen_mat[a*nval],nval);
+			double u=sqrt(da);
+			double bound=Util::get_max(lower,halfsep[a]);
+			double margin=1.0e-5*(u+ptcl_lscale[i]+halfsep[a]);
+			if (u+margin<bound) {
+				bestd[i]=(float)da;
+				bestn[i]=a;
+				ptcl_lower[i]=lower;
+				ptcl_lscale[i]+=maxdrift;
+				continue;
+			}
+		}
+		best[ntodo]=1.0e38f;
+		second[ntodo]=1.0e38f;
+		bestn[i]=0;
+		todo[ntodo++]=i;
+	}
+
+	for (int j0=0; j0<lim; j0+=ctile) {
+		int j1=Util::get_min(j0+ctile,lim);
+		for (int t=0; t<ntodo; t++) {
+			const float *p=&ptcl_mat[todo[t]*nval];
+			for (int j=j0; j<j1; j++) {
+				float d=(float)qsqdist(p,&cen_mat[j*nval],nval);
+				if (d<best[t]) { second[t]=best[t]; best[t]=d; bestn[todo[t]]=j; }
+				else if (d<second[t]) second[t]=d;
+			}
+		}
+	}
+
+	for (int t=0; t<ntodo; t++) {
+		int i=todo[t];
+		bestd[i]=(float)best[t];
+		ptcl_lower[i]=lim>1 ? sqrt(second[t]) : 1.0e19;
+		ptcl_lscale[i]=ptcl_lower[i];
+	}
+});
+
+for (int i=0; i<nptcl; i++) {
+	if (skip_ptcl[i]) continue;
+	if (oldcls[i]!=bestn[i]) nchanged++;
+	images[i]->set_attr("class_id",bestn[i]);
+	images[i]->set_attr("class_cendist",bestd[i]);		// store this for reseeding
+	ptcl_cen_id[i]=cen_id[bestn[i]];
+}
+
+prev_cen_mat.swap(cen_mat);
+prev_cen_id=cen_id;
+}
+
 #define covmat(i,j) covmat[ ((j)-1)*nx + (i)-1 ]
 #define imgdata(i)  imgdata[ (i)-1 ]
 int PCAsmall::insert_image(EMData * image)
@@ -236,7 +236,7 @@ namespace EMAN
 	class KMeansAnalyzer:public Analyzer
 	{
 	  public:
-		KMeansAnalyzer() : ncls(0),verbose(0),minchange(0),maxiter(100),mininclass(2),slowseed(0) {}
+		KMeansAnalyzer() : ncls(0),verbose(0),minchange(0),maxiter(100),mininclass(2),slowseed(0),calcsigmamean(0),outlierclass(0),flat(0),nthreads(0),nval(0),next_center_id(0) {}
 
 		virtual int insert_image(EMData *image) {
 			images.push_back(image);
@@ -274,6 +274,8 @@ namespace EMAN
 			d.put("slowseed",EMObject::INT, "Instead of seeding all classes at once, it will gradually increase the number of classes by adding new seeds in groups with large standard deviations");
 			d.put("outlierclass",EMObject::INT, "The last class will be reserved for outliers. Any class containing fewer than n particles will be permanently moved to the outlier group. default = disabled");
 			d.put("calcsigmamean",EMObject::INT, "Computes standard deviation of the mean image for each class-average (center), and returns them at the end of the list of centers");
+			d.put("flat",EMObject::INT, "Copy the images into one contiguous matrix and classify them in parallel, skipping distances which can't change a particle's class (Hamerly bounds). Gives the same classes as the default mode, except where distances tie to within rounding. default=0");
+			d.put("threads",EMObject::INT, "Number of threads to use with flat=1, 0 for one per core. default=0");
 			return d;
 		}
 
@@ -282,6 +284,7 @@ namespace EMAN
 	  protected:
 		void update_centers(int sigmas=0);
 		void reclassify();
+		void reclassify_flat();
 		void reseed();
 		void resort();
 
@@ -296,6 +299,19 @@ namespace EMAN
 		int slowseed;
 		int calcsigmamean;
 		int outlierclass;
+		int flat;
+		int nthreads;
+
+		// state for flat=1. Each center is tagged with a "kmeans_center_id" attribute so it can be
+		// followed through resort() and reseed(), which reorder and replace the EMData objects
+		size_t nval;					// values per image
+		vector<float> ptcl_mat;			// nptcl x nval copy of the images
+		vector<float> prev_cen_mat;		// centers as of the previous reclassify_flat(), one row per id in prev_cen_id
+		vector<int> prev_cen_id;
+		vector<int> ptcl_cen_id;		// id of the center each particle was assigned to
+		vector<double> ptcl_lower;		// lower bound on the distance to any other center, <0 if unknown
+		vector<double> ptcl_lscale;		// magnitude of the values ptcl_lower was computed from, for the rounding margin
+		int next_center_id;
 
 	};
 
@@ -34,6 +34,7 @@
 #include "xydata.h"
 #include "ctf.h"
 #include <cstring>
+#include <algorithm>
 #include "plugins/averager_template.h"
 
 using namespace EMAN;
@@ -341,8 +342,19 @@ EMData * ImageAverager::finish()
 
 
 
+// Runs func(begin,end) over [0,n) in blocks of pixels, using up to nthreads threads
+static void for_pixel_blocks(size_t n, int nthreads, const std::function<void (size_t, size_t)> & func)
+{
+	const size_t block = 16384;
+	int nblock = (int)((n + block - 1) / block);
+	Util::parallel_for(nblock, Util::get_thread_count(nthreads, nblock), [&](int b, int) {
+		size_t begin = b * block;
+		func(begin, std::min(begin + block, n));
+	});
+}
+
 SigmaAverager::SigmaAverager()
-	: mean_image(0), ignore0(0), normimage(0), freenorm(0), nimg(0)
+	: mean_image(0), ignore0(0), normimage(0), freenorm(0), nimg(0), welford(0), nthreads(1)
 {
 
 }
@@ -377,6 +389,32 @@ void SigmaAverager::add_image(EMData * image)
 		normimage = params.set_default("normimage", (EMData*)0);
 		if (ignore0 && normimage==0) { normimage=new EMData(nx,ny,nz); freenorm=1; }
 		if (normimage) normimage->to_zero();
+
+		welford = params.set_default("welford", 0);
+		nthreads = params.set_default("threads", 1);
+		if (welford) {
+			w_mean.assign(image_size, 0.0);
+			w_m2.assign(image_size, 0.0);
+			if (ignore0) w_count.assign(image_size, 0);
+		}
+	}
+
+	if (welford) {
+		const float *image_data = image->get_const_data();
+		for_pixel_blocks(image_size, nthreads, [&](size_t begin, size_t end) {
+			for (size_t j = begin; j < end; ++j) {
+				float f = image_data[j];
+				unsigned int n = nimg;
+				if (ignore0) {
+					if (f == 0) continue;
+					n = ++w_count[j];
+				}
+				double delta = f - w_mean[j];
+				w_mean[j] += delta / n;
+				w_m2[j] += delta * (f - w_mean[j]);
+			}
+		});
+		return;
 	}
 
 	float *mean_image_data = mean_image->get_data();
@@ -411,7 +449,24 @@ EMData * SigmaAverager::finish()
 	if (mean_image && nimg > 1) {
 		size_t image_size = (size_t)mean_image->get_xsize() * mean_image->get_ysize() * mean_image->get_zsize();
 		float * mean_image_data = mean_image->get_data();
-		if (!ignore0) {
+		if (welford) {
+			float * result_data = result->get_data();
+			float * norm_data = ignore0 && normimage ? normimage->get_data() : 0;
+			for_pixel_blocks(image_size, nthreads, [&](size_t begin, size_t end) {
+				for (size_t j = begin; j < end; ++j) {
+					unsigned int n = ignore0 ? w_count[j] : nimg;
+					mean_image_data[j] = (float)w_mean[j];
+					result_data[j] = n > 0 ? (float)sqrt(w_m2[j] / n) : 0.0f;
+					if (norm_data) norm_data[j] = (float)n;
+				}
+			});
+			if (norm_data) normimage->update();
+			result->update();
+			std::vector<double>().swap(w_mean);
+			std::vector<double>().swap(w_m2);
+			std::vector<unsigned int>().swap(w_count);
+		}
+		else if (!ignore0) {
 			for (size_t j = 0; j < image_size; ++j) {
 				mean_image_data[j] /= nimg;
 			}
@@ -905,6 +960,7 @@ EMData *MinMaxAverager::finish()
 }
 
 MedianAverager::MedianAverager()
+	: nimg(0), nbins(0), nthreads(1), head(0)
 {
 	
 }
@@ -915,15 +971,157 @@ void MedianAverager::add_image(EMData * image)
 		return;
 	}
 
-	if (!imgs.empty() && !EMUtil::is_same_size(image, imgs[0])) {
+	if (head ? !EMUtil::is_same_size(image, head) : (!imgs.empty() && !EMUtil::is_same_size(image, imgs[0]))) {
 		LOGERR("MedianAverager can only process images of the same size");
 		return;
 	}
 
+	nimg++;
+	int approx = params.set_default("approx", 0);
+	if (!approx) {
+		imgs.push_back(image->copy());
+		return;
+	}
+
+	if (head) {
+		add_to_histogram(image->get_const_data());
+		return;
+	}
+
+	if (imgs.empty()) {
+		float maxerr = params.set_default("maxerr", 0.05f);
+		if (maxerr <= 0) throw InvalidValueException(maxerr, "maxerr must be positive");
+		// always even, so pairs of bins can be merged when a histogram has to grow
+		nbins = 2 * (int)std::min(32768.0, std::max(4.0, ceil(4.0 / maxerr)));
+	}
+
+	// until there is one image per bin, keeping the images takes no more memory than the histograms would
 	imgs.push_back(image->copy());
+	if ((int)imgs.size() >= std::max((int)params.set_default("buffer", 0), nbins)) init_histogram();
+}
+
+// Sets up the per-pixel histograms from the buffered images, then adds them and frees the buffer.
+// Each histogram starts out spanning mean +- 4 sigma of the buffered values for that pixel.
+void MedianAverager::init_histogram()
+{
+	nthreads = params.set_default("threads", 1);
+
+	size_t size = imgs[0]->get_size();
+	int nbuf = imgs.size();
+	hist.assign(size * nbins, 0);
+	bin_lo.resize(size);
+	bin_width.resize(size);
+
+	vector<const float *> data(nbuf);
+	for (int i = 0; i < nbuf; i++) data[i] = imgs[i]->get_const_data();
+
+	for_pixel_blocks(size, nthreads, [&](size_t begin, size_t end) {
+		for (size_t j = begin; j < end; ++j) {
+			double sum = 0, sum2 = 0;
+			for (int i = 0; i < nbuf; i++) {
+				float v = data[i][j];
+				sum += v;
+				sum2 += v * (double)v;
+			}
+			double mean = sum / nbuf;
+			double sigma = sqrt(std::max(0.0, sum2 / nbuf - mean * mean));
+			if (sigma <= 0) sigma = std::max(1.0e-6, fabs(mean) * 1.0e-4);	// constant so far, any small range will do
+			bin_lo[j] = (float)(mean - 4.0 * sigma);
+			bin_width[j] = (float)(8.0 * sigma / nbins);
+		}
+	});
+
+	head = imgs[0]->copy_head();
+	for (int i = 0; i < nbuf; i++) {
+		add_to_histogram(data[i]);
+		delete imgs[i];
+	}
+	imgs.clear();
+}
+
+void MedianAverager::add_to_histogram(const float *data)
+{
+	for_pixel_blocks(bin_lo.size(), nthreads, [&](size_t begin, size_t end) {
+		for (size_t j = begin; j < end; ++j) {
+			float v = data[j];
+			float b = (v - bin_lo[j]) / bin_width[j];
+			if (!(b >= 0 && b < nbins)) b = widen_histogram(j, v);
+			hist[j * nbins + std::min((int)b, nbins - 1)]++;
+		}
+	});
+}
+
+// Doubles the bin width of pixel j, merging pairs of bins, until v falls within its histogram. The
+// edge away from v stays put. Returns v's position in bins from the new low edge.
+float MedianAverager::widen_histogram(size_t j, float v)
+{
+	if (!std::isfinite(v)) return v > 0 ? nbins - 1.0f : 0.0f;	// no range holds these, NaN counts as low
+
+	unsigned int *h = &hist[j * nbins];
+	int half = nbins / 2;
+	while (true) {
+		double lo = bin_lo[j], w = bin_width[j];
+		double b = (v - lo) / w;
+		if (b >= 0 && b < nbins) return (float)b;
+
+		if (b >= nbins) {
+			for (int k = 0; k < half; k++) h[k] = h[2 * k] + h[2 * k + 1];
+			std::fill(h + half, h + nbins, 0u);
+		}
+		else {
+			for (int k = nbins - 1; k >= half; k--) h[k] = h[2 * k - nbins] + h[2 * k - nbins + 1];
+			std::fill(h, h + half, 0u);
+			bin_lo[j] = (float)(lo - w * nbins);
+		}
+		bin_width[j] = (float)(2.0 * w);
+	}
+}
+
+// The median of each pixel from its histogram, assuming values are spread evenly within a bin.
+EMData *MedianAverager::finish_histogram()
+{
+	EMData *ret = head;
+	ret->set_size(head->get_xsize(), head->get_ysize(), head->get_zsize());
+	float *out = ret->get_data();
+
+	for_pixel_blocks(bin_lo.size(), nthreads, [&](size_t begin, size_t end) {
+		for (size_t j = begin; j < end; ++j) {
+			const unsigned int *h = &hist[j * nbins];
+			double lo = bin_lo[j], w = bin_width[j];
+
+			// estimated value of the rank'th smallest value
+			auto value_at = [&](int rank) -> double {
+				double cum = 0;
+				for (int k = 0; k < nbins; k++) {
+					if (rank < cum + h[k]) return lo + (k + (rank - cum + 0.5) / h[k]) * w;
+					cum += h[k];
+				}
+				return lo + w * nbins;
+			};
+
+			if (nimg & 1) out[j] = (float)value_at(nimg / 2);
+			else out[j] = (float)((value_at(nimg / 2 - 1) + value_at(nimg / 2)) / 2.0);
+		}
+	});
+	ret->update();
+	ret->set_attr("ptcl_repr", nimg);
+
+	head = 0;
+	nimg = 0;
+	std::vector<unsigned int>().swap(hist);
+	std::vector<float>().swap(bin_lo);
+	std::vector<float>().swap(bin_width);
+	return ret;
 }
 
 EMData *MedianAverager::finish()
+{
+	if (head) return finish_histogram();
+	nimg = 0;
+	return finish_exact();
+}
+
+EMData *MedianAverager::finish_exact()
 {
 	if (imgs.size()==0) return 0;
 	EMData *ret=0;
@@ -979,24 +1177,24 @@ EMData *MedianAverager::finish()
 	}
 
 	ret=imgs[0]->copy();
-	std::vector<float> vals(imgs.size(),0.0f);
-	
-	
-	for (int z=0; z<nz; z++) {
-		for (int y=0; y<ny; y++) {
-			for (int x=0; x<nx; x++) {
-				int i=0;
-				for (std::vector<EMData *>::iterator it = imgs.begin() ; it != imgs.end(); ++it,++i) {
-					vals[i]=(*it)->get_value_at(x,y,z);
-				}
-					
-				std::sort(vals.begin(),vals.end());
-				//printf("%d %d %d    %d\n",x,y,z,vals.size());
-				if (vals.size()&1) ret->set_value_at(x,y,z,vals[vals.size()/2]);		// for even sizes, not quite right, and should include possibility of local average
-				else ret->set_value_at(x,y,z,(vals[vals.size()/2]+vals[vals.size()/2-1])/2.0f);
-			}
+	float *out=ret->get_data();
+	size_t nimgs=imgs.size();
+	vector<const float *> data(nimgs);
+	for (size_t i=0; i<nimgs; i++) data[i]=imgs[i]->get_const_data();
+
+	nthreads=params.set_default("threads",1);
+	for_pixel_blocks((size_t)nx*ny*nz,nthreads,[&](size_t begin, size_t end) {
+		std::vector<float> vals(nimgs,0.0f);
+		for (size_t j=begin; j<end; j++) {
+			for (size_t i=0; i<nimgs; i++) vals[i]=data[i][j];
+
+			// only the middle one or two values need to be in place, the rest of the order doesn't matter
+			std::nth_element(vals.begin(),vals.begin()+nimgs/2,vals.end());
+			if (nimgs&1) out[j]=vals[nimgs/2];		// for even sizes, not quite right, and should include possibility of local average
+			else out[j]=(vals[nimgs/2]+*std::max_element(vals.begin(),vals.begin()+nimgs/2))/2.0f;
 		}
-	}
+	});
+	ret->update();
 
 	if (!imgs.empty()) {
 		for (std::vector<EMData *>::iterator it = imgs.begin() ; it != imgs.end(); ++it) if (*it) delete *it;
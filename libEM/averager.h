@@ -465,14 +465,32 @@ namespace EMAN
 		{
 			TypeDict d;
 			//d.put("min", EMObject::INT, "If set, will average to minimum absolute value, by default average to max");
+			d.put("approx", EMObject::INT, "If set, compute an approximate median in memory which doesn't grow with the number of images. The first 'buffer' images are kept to find the range of each pixel, after which each pixel accumulates a histogram. default=0");
+			d.put("maxerr", EMObject::FLOAT, "With approx, the largest error of the median as a fraction of each pixel's standard deviation. Each pixel uses about 8/maxerr counters, and the error grows if a pixel's later values fall outside mean +- 4 sigma of the buffered ones. default=0.05");
+			d.put("buffer", EMObject::INT, "With approx, the number of images kept to set up the histograms, never fewer than one per counter, which takes no more memory than the histograms. With no more images than this the median is exact. default=0");
+			d.put("threads", EMObject::INT, "Number of threads for the per-pixel work, 0 for one per core. default=1");
 			return d;
 		}
 
 		static const string NAME;
 
 	private:
+		EMData *finish_exact();
+		EMData *finish_histogram();
+		void init_histogram();
+		void add_to_histogram(const float *data);
+		float widen_histogram(size_t j, float v);
+
 		std::vector<EMData*> imgs;
-		
+
+		// approx mode. Pixel j has nbins bins of width bin_width[j] starting at bin_lo[j]. A value
+		// outside them doubles the width until it fits, so every value is in some bin
+		int nimg;
+		int nbins;
+		int nthreads;
+		EMData *head;
+		std::vector<unsigned int> hist;
+		std::vector<float> bin_lo, bin_width;
 	};
 
 
@@ -667,6 +685,8 @@ namespace EMAN
 			//d.put("sigma", EMObject::EMDATA, "sigma value");
 			d.put("normimage", EMObject::EMDATA, "In conjunction with ignore0, the number of non zero values for each pixel will be stored in this image.");
 			d.put("ignore0", EMObject::INT, "if set, ignore zero value pixels");
+			d.put("welford", EMObject::INT, "If set, accumulate the mean and variance in double precision with Welford's single-pass update, which avoids the loss of precision of sum and sum of squares when the standard deviation is small compared to the mean. default=0");
+			d.put("threads", EMObject::INT, "With welford, number of threads for the per-pixel work, 0 for one per core. default=1");
 			return d;
 		}
 
@@ -679,6 +699,10 @@ namespace EMAN
 		int ignore0;
 		int nimg;
 		int freenorm;
+		int welford;
+		int nthreads;
+		std::vector<double> w_mean, w_m2;		// welford: running mean and sum of squared deviations
+		std::vector<unsigned int> w_count;		// welford: number of values accumulated per pixel
 	};
 
 
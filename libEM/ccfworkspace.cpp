@@ -0,0 +1,297 @@
+/*
+ * Copyright (c) 2000- Baylor College of Medicine
+ * 
+ * This software is issued under a joint BSD/GNU license. You may use the
+ * source code in this file under either license. However, note that the
+ * complete EMAN2 and SPARX software packages have some GPL dependencies,
+ * so you are responsible for compliance with the licenses of these packages
+ * if you opt to use BSD licensing. The warranty disclaimer below holds
+ * in either instance.
+ * 
+ * This complete copyright notice must be included in any revised version of the
+ * source code. Additional authorship citations may be added, but existing
+ * author citations must be preserved.
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ * 
+ * */
+
+#include "ccfworkspace.h"
+#include "emdata.h"
+#include "emfft.h"
+
+using namespace EMAN;
+
+namespace {
+	// fftw_malloc alignment lets the cached plans use SIMD
+	float *alloc_fft(size_t n)
+	{
+#ifdef USE_FFTW3
+		float *buf = (float *)fftwf_malloc(n * sizeof(float));
+#else
+		float *buf = (float *)EMUtil::em_malloc(n * sizeof(float));
+#endif	//USE_FFTW3
+		if (!buf) throw BadAllocException("CCFWorkspace: unable to allocate FFT buffer");
+		return buf;
+	}
+
+	void free_fft(float *buf)
+	{
+		if (!buf) return;
+#ifdef USE_FFTW3
+		fftwf_free(buf);
+#else
+		EMUtil::em_free(buf);
+#endif	//USE_FFTW3
+	}
+
+	// floats allocated by a workspace with batch 1 and no references
+	size_t workspace_floats(int nx, int ny, int nz)
+	{
+		return 2 * (size_t)(nx + 2 - nx%2) * ny * nz;
+	}
+
+	// the calling thread's workspaces for CCFWorkspace::thread_ccf(), most recently used first
+	struct ThreadWorkspaces
+	{
+		vector<CCFWorkspace *> list;
+
+		~ThreadWorkspaces() { clear(); }
+
+		void clear()
+		{
+			for (size_t i = 0; i < list.size(); i++) delete list[i];
+			list.clear();
+		}
+	};
+
+	thread_local ThreadWorkspaces thread_workspaces;
+}
+
+CCFWorkspace::CCFWorkspace(int nx, int ny, int nz, int batch) :
+		nx(nx), ny(ny), nz(nz), nx2(nx + 2 - nx%2), csize(0), batch(batch),
+		fimage(0), fbatch(0), frefs(0), nref(0)
+{
+	if (nx < 1 || ny < 1 || nz < 1) throw InvalidValueException(nx, "CCFWorkspace: image sizes must be positive");
+	if (batch < 1) throw InvalidValueException(batch, "CCFWorkspace: batch must be positive");
+
+	csize = (size_t)nx2 * ny * nz;
+	fimage = alloc_fft(csize);
+	try {
+		fbatch = alloc_fft(csize * batch);
+	}
+	catch (...) {
+		free_fft(fimage);
+		throw;
+	}
+
+	// Run the transforms once so their plans are made now rather than on the first correlation
+	std::fill(fimage, fimage + csize, 0.0f);
+	EMfft::real_to_complex_nd(fimage, fimage, nx, ny, nz);
+	EMfft::complex_to_real_nd(fimage, fimage, nx, ny, nz);
+#ifdef USE_FFTW3
+	if (batch > 1) {
+		std::fill(fbatch, fbatch + csize * batch, 0.0f);
+		EMfft::complex_to_real_nd_many(fbatch, nx, ny, nz, batch);
+	}
+#endif	//USE_FFTW3
+}
+
+CCFWorkspace::~CCFWorkspace()
+{
+	free_fft(fimage);
+	free_fft(fbatch);
+	free_fft(frefs);
+}
+
+void CCFWorkspace::check_image(const EMData * image) const
+{
+	if (!image) throw NullPointerException("CCFWorkspace: NULL image");
+	if (image->is_complex()) throw ImageFormatException("CCFWorkspace: real image expected");
+	if (image->get_xsize() != nx || image->get_ysize() != ny || image->get_zsize() != nz) {
+		LOGERR("image size (%d,%d,%d) != workspace size (%d,%d,%d)",
+			   image->get_xsize(), image->get_ysize(), image->get_zsize(), nx, ny, nz);
+		throw ImageDimensionException("CCFWorkspace: image is not the workspace size");
+	}
+}
+
+void CCFWorkspace::forward(const EMData * image, float *buf) const
+{
+	const float *src = image->get_const_data();
+	const size_t nrows = (size_t)ny * nz;
+	for (size_t r = 0; r < nrows; r++) {
+		memcpy(buf + r * nx2, src + r * nx, nx * sizeof(float));
+	}
+	EMfft::real_to_complex_nd(buf, buf, nx, ny, nz);
+}
+
+void CCFWorkspace::unpack(const float *buf, float *out, bool center) const
+{
+#ifdef USE_FFTW3
+	// the FFTW inverse is not normalized, as in EMData::do_ift_inplace
+	const float scale = 1.0f / ((size_t)nx * ny * nz);
+#else
+	const float scale = 1.0f;
+#endif	//USE_FFTW3
+
+	// centering moves the origin from (0,0,0) to (nx/2,ny/2,nz/2), circularly
+	const int sx = center ? nx - nx/2 : 0;
+	const int sy = center ? ny - ny/2 : 0;
+	const int sz = center ? nz - nz/2 : 0;
+	for (int k = 0; k < nz; k++) {
+		const int kk = (k + sz) % nz;
+		for (int j = 0; j < ny; j++) {
+			const int jj = (j + sy) % ny;
+			const float *src = buf + ((size_t)kk * ny + jj) * nx2;
+			float *dst = out + ((size_t)k * ny + j) * nx;
+			const int n1 = nx - sx;
+			for (int i = 0; i < n1; i++) dst[i] = src[i + sx] * scale;
+			for (int i = n1; i < nx; i++) dst[i] = src[i + sx - nx] * scale;
+		}
+	}
+}
+
+void CCFWorkspace::ccf(const EMData * image, const EMData * with, float *out, bool center)
+{
+	check_image(image);
+	check_image(with);
+	if (!out) throw NullPointerException("CCFWorkspace: NULL output");
+
+	forward(image, fimage);
+	forward(with, fbatch);
+	Util::array_mult_complex(fimage, fbatch, csize / 2, true);
+	EMfft::complex_to_real_nd(fimage, fimage, nx, ny, nz);
+	unpack(fimage, out, center);
+}
+
+void CCFWorkspace::ccf(const EMData * image, const EMData * with, EMData * out, bool center)
+{
+	if (!out) throw NullPointerException("CCFWorkspace: NULL output");
+	if (out->get_xsize() != nx || out->get_ysize() != ny || out->get_zsize() != nz) out->set_size(nx, ny, nz);
+	out->set_complex(false);
+	out->set_ri(false);
+	ccf(image, with, out->get_data(), center);
+	out->update();
+}
+
+void CCFWorkspace::set_references(const vector<EMData *> & refs)
+{
+	for (size_t i = 0; i < refs.size(); i++) check_image(refs[i]);
+
+	free_fft(frefs);
+	frefs = 0;
+	nref = 0;
+	if (refs.empty()) return;
+
+	frefs = alloc_fft(csize * refs.size());
+	for (size_t i = 0; i < refs.size(); i++) forward(refs[i], frefs + i * csize);
+	nref = (int)refs.size();
+}
+
+void CCFWorkspace::batch_ccf(int start, int count)
+{
+	for (int k = 0; k < count; k++) {
+		float *prod = fbatch + k * csize;
+		memcpy(prod, fimage, csize * sizeof(float));
+		Util::array_mult_complex(prod, frefs + (start + k) * csize, csize / 2, true);
+	}
+#ifdef USE_FFTW3
+	EMfft::complex_to_real_nd_many(fbatch, nx, ny, nz, count);
+#else
+	for (int k = 0; k < count; k++) EMfft::complex_to_real_nd(fbatch + k * csize, fbatch + k * csize, nx, ny, nz);
+#endif	//USE_FFTW3
+}
+
+void CCFWorkspace::ccf_references(const EMData * image, float *out, bool center)
+{
+	check_image(image);
+	if (!out) throw NullPointerException("CCFWorkspace: NULL output");
+	if (nref == 0) throw InvalidCallException("CCFWorkspace: set_references() must be called before ccf_references()");
+
+	forward(image, fimage);
+	const size_t nxyz = (size_t)nx * ny * nz;
+	for (int start = 0; start < nref; start += batch) {
+		const int count = std::min(batch, nref - start);
+		batch_ccf(start, count);
+		for (int k = 0; k < count; k++) unpack(fbatch + k * csize, out + (start + k) * nxyz, center);
+	}
+}
+
+void CCFWorkspace::ccf_references(const EMData * image, const vector<EMData *> & out, bool center)
+{
+	if ((int)out.size() != nref) throw InvalidValueException((int)out.size(), "CCFWorkspace: need one output image per reference");
+	check_image(image);
+	if (nref == 0) throw InvalidCallException("CCFWorkspace: set_references() must be called before ccf_references()");
+
+	forward(image, fimage);
+	for (int start = 0; start < nref; start += batch) {
+		const int count = std::min(batch, nref - start);
+		batch_ccf(start, count);
+		for (int k = 0; k < count; k++) {
+			EMData *o = out[start + k];
+			if (!o) throw NullPointerException("CCFWorkspace: NULL output");
+			if (o->get_xsize() != nx || o->get_ysize() != ny || o->get_zsize() != nz) o->set_size(nx, ny, nz);
+			o->set_complex(false);
+			o->set_ri(false);
+			unpack(fbatch + k * csize, o->get_data(), center);
+			o->update();
+		}
+	}
+}
+
+void CCFWorkspace::thread_ccf(const EMData * image, const EMData * with, float *out, bool center)
+{
+	if (!image) throw NullPointerException("CCFWorkspace: NULL image");
+	const int nx = image->get_xsize();
+	const int ny = image->get_ysize();
+	const int nz = image->get_zsize();
+	const size_t floats = workspace_floats(nx, ny, nz);
+
+	if (floats > CCFWORKSPACE_THREAD_CACHE_FLOATS) {
+		CCFWorkspace ws(nx, ny, nz, 1);
+		ws.ccf(image, with, out, center);
+		return;
+	}
+
+	vector<CCFWorkspace *> & list = thread_workspaces.list;
+	size_t i = 0;
+	while (i < list.size() && (list[i]->nx != nx || list[i]->ny != ny || list[i]->nz != nz)) i++;
+
+	CCFWorkspace *ws;
+	if (i < list.size()) {
+		ws = list[i];
+		list.erase(list.begin() + i);
+	}
+	else {
+		ws = new CCFWorkspace(nx, ny, nz, 1);
+
+		size_t total = floats;
+		for (i = 0; i < list.size(); i++) total += workspace_floats(list[i]->nx, list[i]->ny, list[i]->nz);
+		while (!list.empty() && (list.size() >= CCFWORKSPACE_THREAD_CACHE_SIZE || total > CCFWORKSPACE_THREAD_CACHE_FLOATS)) {
+			CCFWorkspace *old = list.back();
+			total -= workspace_floats(old->nx, old->ny, old->nz);
+			delete old;
+			list.pop_back();
+		}
+	}
+	list.insert(list.begin(), ws);
+
+	ws->ccf(image, with, out, center);
+}
+
+void CCFWorkspace::clear_thread_cache()
+{
+	thread_workspaces.clear();
+}
@@ -0,0 +1,148 @@
+/*
+ * Copyright (c) 2000- Baylor College of Medicine
+ * 
+ * This software is issued under a joint BSD/GNU license. You may use the
+ * source code in this file under either license. However, note that the
+ * complete EMAN2 and SPARX software packages have some GPL dependencies,
+ * so you are responsible for compliance with the licenses of these packages
+ * if you opt to use BSD licensing. The warranty disclaimer below holds
+ * in either instance.
+ * 
+ * This complete copyright notice must be included in any revised version of the
+ * source code. Additional authorship citations may be added, but existing
+ * author citations must be preserved.
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ * 
+ * */
+
+#ifndef eman__ccfworkspace_h__
+#define eman__ccfworkspace_h__ 1
+
+#include <cstddef>
+#include <vector>
+
+using std::vector;
+
+/** Most workspaces each thread keeps for CCFWorkspace::thread_ccf() */
+#define CCFWORKSPACE_THREAD_CACHE_SIZE 4
+/** Most floats of buffers each thread keeps for CCFWorkspace::thread_ccf(), 16 MB */
+#define CCFWORKSPACE_THREAD_CACHE_FLOATS (4 << 20)
+
+namespace EMAN
+{
+	class EMData;
+
+	/** Reusable buffers for computing many circulant cross-correlations of real images of one
+	 * size. The results match EMData::calc_ccf(with) (CIRCULANT, no padding), but are written
+	 * into caller-provided storage, and once the workspace exists a correlation performs no heap
+	 * allocation. References which are correlated against repeatedly can be transformed once with
+	 * set_references(), after which each image is transformed once and correlated against all of
+	 * them, with the inverse transforms done in batches.
+	 *
+	 * A workspace is not safe to share between threads; use one per thread.
+	 *
+	 @code
+	 *    CCFWorkspace ws(nx, ny);
+	 *    ws.set_references(refs);
+	 *    vector<float> ccfs((size_t)nx*ny*refs.size());
+	 *    for (...) ws.ccf_references(img, &ccfs[0]);
+	 @endcode
+	 */
+	class CCFWorkspace
+	{
+	  public:
+		/**
+		 * @param nx x size of the real images to be correlated
+		 * @param ny y size
+		 * @param nz z size
+		 * @param batch Number of references inverse transformed together by ccf_references()
+		 * @exception InvalidValueException if a size or batch is less than 1
+		 */
+		CCFWorkspace(int nx, int ny = 1, int nz = 1, int batch = 8);
+		~CCFWorkspace();
+
+		int get_xsize() const { return nx; }
+		int get_ysize() const { return ny; }
+		int get_zsize() const { return nz; }
+
+		/** Correlation of image with with, as image->calc_ccf(with).
+		 * @param image Real image of the workspace size
+		 * @param with Real image of the workspace size
+		 * @param out Storage for nx*ny*nz floats
+		 * @param center If true the origin of the result is at the center, as for calc_ccf
+		 */
+		void ccf(const EMData * image, const EMData * with, float *out, bool center = false);
+
+		/** As above, writing into an existing image, which is resized only if needed */
+		void ccf(const EMData * image, const EMData * with, EMData * out, bool center = false);
+
+		/** Transform and keep a set of references for ccf_references(). Replaces any previous set.
+		 * @param refs Real images of the workspace size
+		 */
+		void set_references(const vector<EMData *> & refs);
+
+		/** @return The number of references kept by set_references() */
+		int get_nref() const { return nref; }
+
+		/** Correlation of image with each reference, as image->calc_ccf(ref). The forward
+		 * transform of image is done once for all the references.
+		 * @param image Real image of the workspace size
+		 * @param out Storage for get_nref()*nx*ny*nz floats, one result after another in reference order
+		 * @param center If true the origin of each result is at the center, as for calc_ccf
+		 */
+		void ccf_references(const EMData * image, float *out, bool center = false);
+
+		/** As above, writing into one existing image per reference */
+		void ccf_references(const EMData * image, const vector<EMData *> & out, bool center = false);
+
+		/** ccf() in a workspace kept by the calling thread, for EMData::calc_ccf(). Each thread
+		 * keeps up to CCFWORKSPACE_THREAD_CACHE_SIZE workspaces of different sizes, dropping the
+		 * least recently used, and no more than CCFWORKSPACE_THREAD_CACHE_FLOATS of buffers.
+		 * Images too large for that get a workspace which is freed on return.
+		 * @param image Real image
+		 * @param with Real image the size of image
+		 * @param out Storage for the size of image floats
+		 * @param center If true the origin of the result is at the center, as for calc_ccf
+		 */
+		static void thread_ccf(const EMData * image, const EMData * with, float *out, bool center = false);
+
+		/** Free the workspaces kept by thread_ccf() for the calling thread */
+		static void clear_thread_cache();
+
+	  private:
+		CCFWorkspace(const CCFWorkspace &);
+		CCFWorkspace & operator=(const CCFWorkspace &);
+
+		void check_image(const EMData * image) const;
+		/** Copy a real image into the padded layout and transform it in place */
+		void forward(const EMData * image, float *buf) const;
+		/** Scale, depad and optionally center an inverse transformed buffer */
+		void unpack(const float *buf, float *out, bool center) const;
+		/** Inverse transforms of the image transform times references start..start+count-1, into fbatch */
+		void batch_ccf(int start, int count);
+
+		int nx, ny, nz;
+		int nx2;			// padded x size of the transforms, in floats
+		size_t csize;		// floats in one transform
+		int batch;
+		float *fimage;		// transform of the image
+		float *fbatch;		// batch of products being inverse transformed
+		float *frefs;		// transforms kept by set_references()
+		int nref;
+	};
+}
+
+#endif	//eman__ccfworkspace_h__
@@ -123,6 +123,7 @@ float CccCmp::cmp(EMData * image, EMData *with) const
 
 	float negative = (float)params.set_default("negative", 1);
 	if (negative) negative=-1.0; else negative=1.0;
+	int cacheref = params.set_default("cacheref", 1);
 
 	double avg1 = 0.0, var1 = 0.0, avg2 = 0.0, var2 = 0.0, ccc = 0.0;
 	long n = 0;
@@ -160,6 +161,15 @@ float CccCmp::cmp(EMData * image, EMData *with) const
 				n++;
 			}
 		}
+	} else if (cacheref) {
+		// 'with' is usually a reference compared against many images, so its sums are reused
+		with->get_sums_cached(avg2, var2);
+		for (size_t i = 0; i < totsize; ++i) {
+			avg1 += double(d1[i]);
+			var1 += d1[i]*double(d1[i]);
+			ccc += d1[i]*double(d2[i]);
+		}
+		n = totsize;
 	} else {
 		for (size_t i = 0; i < totsize; ++i) {
 			avg1 += double(d1[i]);
@@ -618,8 +628,7 @@ float DotCmp::cmp(EMData* image, EMData* with) const
 				}
 			}
 		} else {
-			// this little bit of manual loop unrolling makes the dot product as fast as sqeuclidean with -O2
-			for (size_t i=0; i<totsize; i++) result += x_data[i]*y_data[i];
+			result = Util::array_dot(x_data, y_data, totsize);
 
 			if (normalize) {
 				square_sum1 = image->get_attr("square_sum");
@@ -1227,6 +1236,7 @@ float PhaseCmp::cmp(EMData * image, EMData *with) const
 	int snrfn = params.set_default("snrfn",0);
 	int ampweight = params.set_default("ampweight",0);
 	int zeromask = params.set_default("zeromask",0);
+	int cacheref = params.set_default("cacheref",1);
 	float minres = params.set_default("minres",500.0f);
 	float maxres = params.set_default("maxres",10.0f);
 
@@ -1234,6 +1244,7 @@ float PhaseCmp::cmp(EMData * image, EMData *with) const
 
 	EMData *image_fft = NULL;
 	EMData *with_fft = NULL;
+	std::shared_ptr<const EMData> with_cached;	// keeps a cached FFT alive while it is used
 
 	int ny = image->get_ysize();
 //	int np = (int) ceil(Ctf::CTFOS * sqrt(2.0f) * ny / 2) + 2;
@@ -1324,6 +1335,10 @@ float PhaseCmp::cmp(EMData * image, EMData *with) const
 		}
 		
 		if (with->is_complex()) with_fft=with;
+		else if (cacheref) {
+			with_cached=with->get_fft_cached();
+			with_fft=const_cast<EMData *>(with_cached.get());	// shared with the cache, only read here
+		}
 		else {
 			with_fft=with->do_fft();
 			with_fft->set_attr("free_me",1);
@@ -1424,11 +1439,14 @@ float FRCCmp::cmp(EMData * image, EMData * with) const
 	int sweight = params.set_default("sweight", 1);
 	int nweight = params.set_default("nweight", 0);
 	int zeromask = params.set_default("zeromask",0);
+	int cacheref = params.set_default("cacheref",1);
 	float minres = params.set_default("minres",200.0f);
 	float maxres = params.set_default("maxres",8.0f);
 
 	vector < float >fsc;
 	bool use_cpu = true;
+	EMData *with_in = with;		// header values are read from here, 'with' may become a cached FFT
+	std::shared_ptr<const EMData> with_cached;	// keeps a cached FFT alive while it is used
 
 	if (use_cpu) {
 		if (zeromask) {
@@ -1456,9 +1474,15 @@ float FRCCmp::cmp(EMData * image, EMData * with) const
 			image=image->do_fft(); 
 			image->set_attr("free_me",1); 
 		}
-		if (!with->is_complex()) { 
-			with=with->do_fft(); 
-			with->set_attr("free_me",1); 
+		if (!with->is_complex()) {
+			if (cacheref) {
+				with_cached=with->get_fft_cached();
+				with=const_cast<EMData *>(with_cached.get());	// shared with the cache, only read here
+			}
+			else {
+				with=with->do_fft();
+				with->set_attr("free_me",1);
+			}
 		}
 
 		fsc = image->calc_fourier_shell_correlation(with,1);
@@ -1504,8 +1528,8 @@ float FRCCmp::cmp(EMData * image, EMData * with) const
 	if (snrweight) {
 		Ctf *ctf = NULL;
 		if (!image->has_attr("ctf")) {
-			if (!with->has_attr("ctf")) throw InvalidCallException("SNR weight with no CTF parameters");
-			ctf=with->get_attr("ctf");
+			if (!with_in->has_attr("ctf")) throw InvalidCallException("SNR weight with no CTF parameters");
+			ctf=with_in->get_attr("ctf");
 		}
 		else ctf=image->get_attr("ctf");
 
@@ -1553,9 +1577,9 @@ float FRCCmp::cmp(EMData * image, EMData * with) const
 
 	// This performs a weighting that tries to normalize FRC by correcting from the number of particles represented by the average
 	sum/=norm;
-	if (nweight && with->get_attr_default("ptcl_repr",0) && sum>=0 && sum<1.0) {
+	if (nweight && with_in->get_attr_default("ptcl_repr",0) && sum>=0 && sum<1.0) {
 		sum=sum/(1.0-sum);							// convert to SNR
-		sum/=(float)with->get_attr_default("ptcl_repr",0);	// divide by ptcl represented
+		sum/=(float)with_in->get_attr_default("ptcl_repr",0);	// divide by ptcl represented
 		sum=sum/(1.0+sum);							// convert back to correlation
 	}
 
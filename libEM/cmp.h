@@ -175,6 +175,7 @@ namespace EMAN
 			TypeDict d;
 			d.put("negative", EMObject::INT, "If set, returns -1 * ccc product. Set by default so smaller is better");
 			d.put("mask", EMObject::EMDATA, "image mask");
+			d.put("cacheref", EMObject::INT, "If set, sums over 'with' are cached on it and reused until it changes. As for its mean and sigma, changes made directly to the data must be followed by update(). (default=1)");
 			return d;
 		}
 
@@ -660,6 +661,7 @@ to be missing values. If not provided, these values will be computed automatical
 			d.put("snrfn", EMObject::INT, "If nonzero, an empirical function will be used as a radial weight rather than the true SNR. (1 - exp decay)'. (default=0)");
 			d.put("ampweight", EMObject::INT, "If set, the amplitude of 'with' will be used as a weight in the averaging'. (default=0)");
 			d.put("zeromask", EMObject::INT, "Treat regions in either image that are zero as a mask");
+			d.put("cacheref", EMObject::INT, "If set, the FFT of 'with' is cached on it and reused until it changes. As for its mean and sigma, changes made directly to the data must be followed by update(). (default=1)");
 			d.put("minres", EMObject::FLOAT, "Lowest resolution to use in comparison (soft cutoff). Requires accurate A/pix in image. <0 disables. Default=500");
 			d.put("maxres", EMObject::FLOAT, "Highest resolution to use in comparison (soft cutoff). Requires accurate A/pix in image. <0 disables.  Default=10");
 			return d;
@@ -706,6 +708,7 @@ to be missing values. If not provided, these values will be computed automatical
 			d.put("sweight", EMObject::INT, "If set, weight the (1-D) average by the number of pixels in each ring (default=1)");
 			d.put("nweight", EMObject::INT, "Downweight similarity based on number of particles in reference (default=0)");
 			d.put("zeromask", EMObject::INT, "Treat regions in either image that are zero as a mask (default=0)");
+			d.put("cacheref", EMObject::INT, "If set, the FFT of 'with' is cached on it and reused until it changes. As for its mean and sigma, changes made directly to the data must be followed by update(). (default=1)");
 			d.put("minres", EMObject::FLOAT, "Lowest resolution to use in comparison (soft cutoff). Requires accurate A/pix in image. <0 disables. Default=500");
 			d.put("maxres", EMObject::FLOAT, "Highest resolution to use in comparison (soft cutoff). Requires accurate A/pix in image. <0 disables.  Default=10");
 			d.put("pmin", EMObject::FLOAT, "The minimum resolution in pixels.");
@@ -36,6 +36,7 @@
 #include "aligner.h"
 #include "cmp.h"
 #include "emfft.h"
+#include "ccfworkspace.h"
 #include "projector.h"
 #include "geometry.h"
 #include <math.h>
@@ -75,7 +76,7 @@ EMData::EMData() :
 	fftcache(0),
 #endif //FFT_CACHING
 		attr_dict(), rdata(0), supp(0), flags(0), changecount(0), nx(0), ny(0), nz(0), nxy(0), nxyz(0), xoff(0), yoff(0),
-		zoff(0), all_translation(),	path(""), pathnum(0), rot_fp(0)
+		zoff(0), all_translation(),	path(""), pathnum(0), rot_fp(0), cmpcache(0)
 
 {
 	ENTERFUNC;
@@ -106,7 +107,7 @@ EMData::EMData(const string& filename, int image_index) :
 	fftcache(0),
 #endif //FFT_CACHING
 		attr_dict(), rdata(0), supp(0), flags(0), changecount(0), nx(0), ny(0), nz(0), nxy(0), nxyz(0), xoff(0), yoff(0), zoff(0),
-		all_translation(),	path(filename), pathnum(image_index), rot_fp(0)
+		all_translation(),	path(filename), pathnum(image_index), rot_fp(0), cmpcache(0)
 {
 	ENTERFUNC;
 
@@ -140,7 +141,7 @@ EMData::EMData(const EMData& that) :
 #endif //FFT_CACHING
 		attr_dict(that.attr_dict), rdata(0), supp(0), flags(that.flags), changecount(that.changecount), nx(that.nx), ny(that.ny), nz(that.nz),
 		nxy(that.nx*that.ny), nxyz((size_t)that.nx*that.ny*that.nz), xoff(that.xoff), yoff(that.yoff), zoff(that.zoff),all_translation(that.all_translation),	path(that.path),
-		pathnum(that.pathnum), rot_fp(0)
+		pathnum(that.pathnum), rot_fp(0), cmpcache(0)
 {
 	ENTERFUNC;
 	
@@ -210,6 +211,8 @@ EMData& EMData::operator=(const EMData& that)
 #endif //EMAN2_USING_CUDA
 
 		changecount = that.changecount;
+		// the old cache could match the copied changecount
+		clear_cmp_cache();
 
 		if (that.rot_fp != 0) rot_fp = new EMData(*(that.rot_fp));
 		else rot_fp = 0;
@@ -226,7 +229,7 @@ EMData::EMData(int nx, int ny, int nz, bool is_real) :
 	fftcache(0),
 #endif //FFT_CACHING
 		attr_dict(), rdata(0), supp(0), flags(0), changecount(0), nx(0), ny(0), nz(0), nxy(0), nxyz(0), xoff(0), yoff(0), zoff(0),
-		all_translation(),	path(""), pathnum(0), rot_fp(0)
+		all_translation(),	path(""), pathnum(0), rot_fp(0), cmpcache(0)
 {
 	ENTERFUNC;
 
@@ -281,7 +284,7 @@ EMData::EMData(float* data, const int x, const int y, const int z, const Dict& a
 	fftcache(0),
 #endif //FFT_CACHING
 		attr_dict(attr_dict), rdata(data), supp(0), flags(0), changecount(0), nx(x), ny(y), nz(z), nxy(x*y), nxyz((size_t)x*y*z), xoff(0),
-		yoff(0), zoff(0), all_translation(), path(""), pathnum(0), rot_fp(0)
+		yoff(0), zoff(0), all_translation(), path(""), pathnum(0), rot_fp(0), cmpcache(0)
 {
 	ENTERFUNC;
 	// used to replace cube 'pixel'
@@ -306,7 +309,7 @@ EMData::EMData(float* data, float* cudadata, const int x, const int y, const int
 	fftcache(0),
 #endif //FFT_CACHING
 		attr_dict(attr_dict), rdata(data), supp(0), flags(0), changecount(0), nx(x), ny(y), nz(z), nxy(x*y), nxyz((size_t)x*y*z), xoff(0),
-		yoff(0), zoff(0), all_translation(), path(""), pathnum(0), rot_fp(0)
+		yoff(0), zoff(0), all_translation(), path(""), pathnum(0), rot_fp(0), cmpcache(0)
 {
 	ENTERFUNC;
 
@@ -334,6 +337,7 @@ EMData::~EMData()
 #ifdef FFT_CACHING
 	if (fftcache!=0) { delete fftcache; fftcache=0;}
 #endif //FFT_CACHING
+	clear_cmp_cache();
 	free_memory();
 
 #ifdef EMAN2_USING_CUDA
@@ -1574,6 +1578,22 @@ EMData *EMData::calc_ccf(EMData * with, fp_flag fpflag,bool center)
 			return corr;
 		}
 #endif
+
+		// Two real images of the same size, the common case in alignment, are correlated in a
+		// per-thread workspace instead of through the padded temporaries of correlation()
+		if (fpflag == CIRCULANT && !is_complex() && !with->is_complex() && EMUtil::is_same_size(this, with)) {
+			EMData *cor = copy_head();
+			try {
+				CCFWorkspace::thread_ccf(this, with, cor->get_data(), center);
+			}
+			catch (...) {
+				delete cor;
+				throw;
+			}
+			cor->update();
+			EXITFUNC;
+			return cor;
+		}
 		
 		// If the argument EMData pointer is not the same size we automatically resize it
 		bool undoresize = false;
@@ -3083,24 +3103,17 @@ void EMData::update_stat() const
 		step = 2;
 	}
 
-	int n_nonzero = 0;
+	size_t nonzero = 0;
 
 	size_t size = (size_t)nx*ny*nz;
 
-	for (size_t i = 0; i < size; i += step) {
-		float v = data[i];
-		max = Util::get_max(max, v);
-		min = Util::get_min(min, v);
-		sum += v;
-		square_sum += v * (double)(v);
-		if (v != 0) n_nonzero++;
-	}
+	Util::array_stats(data, size, step, min, max, sum, square_sum, nonzero);
 
 	size_t n     = size / step;
 	double mean  = sum  / n;
 	double var   = (square_sum - sum*sum / n) / (n-1);
 	double sigma = var >= 0.0 ? std::sqrt(var) : 0.0;
-	n_nonzero    = Util::get_max(1, n_nonzero);
+	int n_nonzero = Util::get_max(1, (int)nonzero);
 	double varn  = (square_sum - sum*sum / n_nonzero) / (n_nonzero-1);
 	double sigma_nonzero = varn >= 0.0 ? std::sqrt(varn) : 0.0;
 	double mean_nonzero  = sum / n_nonzero; // previous version overcounted! G2
@@ -56,6 +56,8 @@ using std::ostream;
 #include <utility>
 using std::pair;
 
+#include <memory>
+
 namespace EMAN
 {
 	class ImageIO;
@@ -849,6 +851,11 @@ namespace EMAN
 		/** This is a cached rotational footprint, can save much time */
 		mutable EMData* rot_fp;
 
+		/** Products cached for comparators when this image is used as a reference,
+		 * see get_fft_cached(). Only valid while changecount is unchanged */
+		struct CmpCache;
+		mutable CmpCache* cmpcache;
+
 #ifdef FFT_CACHING
 		mutable EMData *fftcache;
 #endif
@@ -343,9 +343,7 @@ void EMData::add(float f,int keepzero)
 				}
 			}
 			else {
-				for (size_t i = 0; i < size; i++) {
-					data[i] += f;
-				}
+				Util::array_add(data, f, size);
 			}
 			update();
 		}
@@ -398,9 +396,7 @@ void EMData::add(const EMData & image)
 		size_t size = nxyz;
 		float* data = get_data();
 
-		for (size_t i = 0; i < size; i++) {
-			data[i] += src_data[i];
-		}
+		Util::array_add(data, src_data, size);
 		update();
 	}
 	EXITFUNC;
@@ -423,9 +419,7 @@ void EMData::addsquare(const EMData & image)
 		size_t size = nxyz;
 		float* data = get_data();
 
-		for (size_t i = 0; i < size; i++) {
-			data[i] += src_data[i]*src_data[i];
-		}
+		Util::array_addsquare(data, src_data, size);
 		update();
 	}
 	EXITFUNC;
@@ -448,9 +442,7 @@ void EMData::subsquare(const EMData & image)
 		size_t size = nxyz;
 		float* data = get_data();
 
-		for (size_t i = 0; i < size; i++) {
-			data[i] -= src_data[i]*src_data[i];
-		}
+		Util::array_subsquare(data, src_data, size);
 		update();
 	}
 	EXITFUNC;
@@ -475,10 +467,7 @@ void EMData::sub(float f)
 	if( is_real() )
 	{
 		if (f != 0) {
-			size_t size = nxyz;
-			for (size_t i = 0; i < size; i++) {
-				data[i] -= f;
-			}
+			Util::array_add(data, -f, nxyz);
 		}
 		update();
 	}
@@ -520,9 +509,7 @@ void EMData::sub(const EMData & em)
 		size_t size = nxyz;
 		float* data = get_data();
 
-		for (size_t i = 0; i < size; i++) {
-			data[i] -= src_data[i];
-		}
+		Util::array_sub(data, src_data, size);
 		update();
 	}
 	EXITFUNC;
@@ -546,11 +533,7 @@ void EMData::mult(float f)
 			return;
 		}
 #endif // EMAN2_USING_CUDA
-		float* data = get_data();
-		size_t size = nxyz;
-		for (size_t i = 0; i < size; i++) {
-			data[i] *= f;
-		}
+		Util::array_mult(get_data(), f, nxyz);
 		update();
 	}
 	EXITFUNC;
@@ -575,9 +558,7 @@ void EMData::mult(const EMData & em, bool prevent_complex_multiplication)
 		float* data = get_data();
 		if( is_real() || prevent_complex_multiplication )
 		{
-			for (size_t i = 0; i < size; i++) {
-				data[i] *= src_data[i];
-			}
+			Util::array_mult(data, src_data, size);
 		}
 		else mult_ri(em);
 		update();
@@ -589,17 +570,7 @@ void EMData::mult(const EMData & em, bool prevent_complex_multiplication)
 // This implements complex RI multiplication, but does no checking of data types for efficiency
 // calling is_ri can be very expensive.
 void EMData::mult_ri(const EMData &em) {
-	typedef std::complex<float> comp;
-	const float *src_data = em.get_data();
-	float* data = get_data();
-	for( size_t i = 0; i < nxyz; i+=2 )
-	{
-		comp c_src( src_data[i], src_data[i+1] );
-		comp c_rdat( data[i], data[i+1] );
-		comp c_result = c_src * c_rdat;
-		data[i] = c_result.real();
-		data[i+1] = c_result.imag();
-	}
+	Util::array_mult_complex(get_data(), em.get_data(), nxyz/2);
 	update();
 }
 
@@ -681,27 +652,13 @@ void EMData::div(const EMData & em)
 
 		if( is_real() )
 		{
-			for (size_t i = 0; i < size; i++) {
-				if(src_data[i] != 0) {
-					data[i] /= src_data[i];
-				}
-				else {
-					if (data[i]==0) continue;
-					throw InvalidValueException(src_data[i], "divide by zero");
-				}
-			}
+			// 0/0 is left as 0, anything else over 0 is an error
+			size_t i = Util::array_div(data, src_data, size);
+			if (i < size) throw InvalidValueException(src_data[i], "divide by zero");
 		}
 		else
 		{
-			typedef std::complex<float> comp;
-			for( size_t i = 0; i < size; i+=2 )
-			{
-				comp c_src( src_data[i], src_data[i+1] );
-				comp c_rdat( data[i], data[i+1] );
-				comp c_result = c_rdat / c_src;
-				data[i] = c_result.real();
-				data[i+1] = c_result.imag();
-			}
+			Util::array_div_complex(data, src_data, size/2);
 		}
 		update();
 	}
@@ -388,6 +388,41 @@ vector<shared_ptr<EMData>> EMData::read_images(const string & filename, vector<i
 	size_t n = (num_img == 0 ? total_img : num_img);
 	ImageIO *imageio = EMUtil::get_imageio(filename, ImageIO::READ_ONLY, imgtype);
 
+#ifdef USE_HDF5
+	// HDF5 stack layout files are read in runs of consecutive images, decompressing in parallel
+	HdfIO2 *hdfio = header_only ? 0 : dynamic_cast<HdfIO2 *>(imageio);
+	if (hdfio && hdfio->is_stack()) {
+		vector<shared_ptr<EMData>> v(n);
+		for (size_t j = 0; j < n; j++) {
+			v[j].reset(new EMData());
+			v[j]->_read_image(imageio, (int)(num_img == 0 ? j : img_indices[j]), true);
+			v[j]->set_size(v[j]->get_xsize(), v[j]->get_ysize(), v[j]->get_zsize());
+		}
+
+		size_t imgsize = n ? v[0]->get_size() : 0;
+		size_t maxrun = std::max((size_t)1, ((size_t)256 << 20) / (imgsize * sizeof(float) + 1));
+		vector<float> buf;
+		for (size_t j0 = 0; j0 < n; ) {
+			int first = (num_img == 0 ? (int)j0 : img_indices[j0]);
+			size_t run = 1;
+			while (j0 + run < n && run < maxrun && (num_img == 0 || img_indices[j0 + run] == first + (int)run)) run++;
+
+			if (run == 1) hdfio->read_stack_images(first, 1, v[j0]->get_data());
+			else {
+				buf.resize(run * imgsize);
+				hdfio->read_stack_images(first, (int)run, &buf[0]);
+				for (size_t j = 0; j < run; j++) memcpy(v[j0 + j]->get_data(), &buf[j * imgsize], imgsize * sizeof(float));
+			}
+			for (size_t j = 0; j < run; j++) v[j0 + j]->update();
+			j0 += run;
+		}
+
+		EMUtil::close_imageio(filename, imageio);
+		EXITFUNC;
+		return v;
+	}
+#endif	//USE_HDF5
+
 	vector<shared_ptr<EMData>> v;
 	for (size_t j = 0; j < n; j++) {
 		shared_ptr<EMData> d(new EMData());
@@ -412,6 +447,70 @@ vector<shared_ptr<EMData>> EMData::read_images(const string & filename, vector<i
 	return v;
 }
 
+vector<std::shared_ptr<EMData>> EMData::read_eer_fractions(const string & filename, int frames_per_sum,
+									  int binning, EMUtil::ImageType imgtype, int nthreads)
+{
+	ENTERFUNC;
+
+	if (imgtype != EMUtil::IMAGE_EER && imgtype != EMUtil::IMAGE_EER2X && imgtype != EMUtil::IMAGE_EER4X) {
+		throw ImageFormatException("read_eer_fractions requires an EER image type");
+	}
+	if (frames_per_sum < 1) {
+		throw InvalidValueException(frames_per_sum, "frames_per_sum must be >0");
+	}
+	if (binning < 1 || (binning & (binning - 1)) != 0) {
+		throw InvalidValueException(binning, "EER binning must be a power of 2");
+	}
+
+	ImageIO *imageio = EMUtil::get_imageio(filename, ImageIO::READ_ONLY, imgtype);
+	EerIO *eerio = dynamic_cast<EerIO *>(imageio);
+	if (!eerio) {
+		EMUtil::close_imageio(filename, imageio);
+		throw ImageFormatException("cannot open EER file");
+	}
+
+	int nframes = eerio->get_nimg();
+	int nsums = (nframes + frames_per_sum - 1) / frames_per_sum;
+	int n = eerio->get_num_pix() / binning;
+
+	// headers and allocation are serial, only decoding is spread over threads
+	vector<std::shared_ptr<EMData>> sums(nsums);
+	try {
+		for (int i = 0; i < nsums; i++) {
+			int first = i * frames_per_sum;
+			Dict hdr;
+			eerio->read_header(hdr, first, 0, false);
+			hdr.erase("nx");
+			hdr.erase("ny");
+			hdr.erase("nz");
+
+			sums[i].reset(new EMData(n, n));
+			sums[i]->to_zero();
+			sums[i]->set_attr_dict(hdr);
+			sums[i]->set_attr("source_path", filename);
+			sums[i]->set_attr("source_n", first);
+			sums[i]->set_attr("EER.frames_summed", Util::get_min(frames_per_sum, nframes - first));
+			sums[i]->set_attr("EER.binning", binning);
+		}
+
+		Util::parallel_for(nsums, Util::get_thread_count(nthreads, nsums), [&](int i, int) {
+			int first = i * frames_per_sum;
+			eerio->sum_frames(sums[i]->get_data(), first, Util::get_min(frames_per_sum, nframes - first), binning);
+			sums[i]->update();
+		});
+	}
+	catch (...) {
+		EMUtil::close_imageio(filename, imageio);
+		throw;
+	}
+
+	EMUtil::close_imageio(filename, imageio);
+	imageio = 0;
+
+	EXITFUNC;
+	return sums;
+}
+
 bool EMData::write_images(const string & filename, vector<std::shared_ptr<EMData>> imgs,
 						  EMUtil::ImageType imgtype,
 						  bool header_only,
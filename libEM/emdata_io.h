@@ -159,6 +159,24 @@ static vector<std::shared_ptr<EMData>> read_images(const string & filename,
 									  EMUtil::ImageType imgtype = EMUtil::IMAGE_UNKNOWN,
 									  bool header_only = false);
 
+
+/** Read an EER movie as a set of sums of consecutive frames ("fractions") in one pass.
+ * Frames are decoded straight into the sums, binned on the fly, and the fractions are
+ * decoded in parallel.
+ * @param filename The EER file name.
+ * @param frames_per_sum Number of consecutive frames in each sum. Frames left over at
+ *     the end go into a final, smaller fraction.
+ * @param binning Bin the decoded grid by this power of 2.
+ * @param imgtype IMAGE_EER, IMAGE_EER2X or IMAGE_EER4X to decode on the 4k, 8k or 16k grid.
+ * @param nthreads Number of threads, <=0 means one per hardware thread.
+ * @exception ImageFormatException if the file is not an EER file
+ * @return The fractions in order.
+ */
+static vector<std::shared_ptr<EMData>> read_eer_fractions(const string & filename, int frames_per_sum,
+									  int binning = 1,
+									  EMUtil::ImageType imgtype = EMUtil::IMAGE_EER,
+									  int nthreads = 0);
+
 /** Write a set of images to file specified by 'filename'.
  * Which images are written is set by 'imgs'.
  * @param filename The image file name.
@@ -869,7 +869,7 @@ void EMData::set_size(int x, int y, int z, bool noalloc)
 	}
 	
 	if (rdata != 0) {
-		rdata = (float*)EMUtil::em_realloc(rdata,size);
+		rdata = (float*)EMUtil::em_realloc(rdata,size,nxyz*sizeof(float));
 	} else {
 		// Just pass on this for a while....see what happens
 		rdata = (float*)EMUtil::em_malloc(size);
@@ -35,12 +35,14 @@
 #include "aligner.h"
 #include "projector.h"
 #include "analyzer.h"
+#include "profiler.h"
 
 using namespace EMAN;
 
 void EMData::process_inplace(const string & processorname, const Dict & params)
 {
 	ENTERFUNC;
+	PluginProfiler::Scope prof("processor", processorname, this);
 	Processor *f = Factory < Processor >::get(processorname, params);
 	if (f) {
 		f->process_inplace(this);
@@ -57,6 +59,7 @@ void EMData::process_inplace(Processor * p)
 {
 	ENTERFUNC;
 	if(p) {
+		PluginProfiler::Scope prof("processor", p, this);
 		p->process_inplace(this);
 	}
 	EXITFUNC;
@@ -65,6 +68,7 @@ void EMData::process_inplace(Processor * p)
 EMData* EMData::process(const string & processorname, const Dict & params) const
 {
 	ENTERFUNC;
+	PluginProfiler::Scope prof("processor", processorname, this);
 	Processor *f = Factory < Processor >::get(processorname, params);
 	EMData * result = 0;
 	if (f) {
@@ -84,6 +88,7 @@ EMData * EMData::process(Processor * p) const
 	ENTERFUNC;
 	EMData * result = 0;
 	if(p) {
+		PluginProfiler::Scope prof("processor", p, this);
 		result = p->process(this);
 	}
 	return result;
@@ -93,6 +98,7 @@ EMData * EMData::process(Processor * p) const
 float EMData::cmp(const string & cmpname, EMData * with, const Dict & params)
 {
 	ENTERFUNC;
+	PluginProfiler::Scope prof("cmp", cmpname, this);
 	float result = 0;
 	Cmp *c = Factory < Cmp >::get(cmpname, params);
 	if (c) {
@@ -113,6 +119,7 @@ EMData *EMData::align(const string & aligner_name, EMData * to_img,
 					  const Dict & params, const string & cmp_name, const Dict& cmp_params)
 {
 	ENTERFUNC;
+	PluginProfiler::Scope prof("aligner", aligner_name, this);
 	EMData *result = 0;
 	Aligner *a = Factory < Aligner >::get(aligner_name, params);
 	if (a) {
@@ -138,6 +145,7 @@ vector<Dict> EMData::xform_align_nbest(const string & aligner_name, EMData * to_
 										const Dict& cmp_params)
 {
 	ENTERFUNC;
+	PluginProfiler::Scope prof("aligner", aligner_name, this);
 	Aligner *a = Factory < Aligner >::get(aligner_name, params);
 	vector<Dict> result;
 	if (a) {
@@ -150,6 +158,7 @@ vector<Dict> EMData::xform_align_nbest(const string & aligner_name, EMData * to_
 EMData *EMData::project(const string & projector_name, const Dict & params)
 {
 	ENTERFUNC;
+	PluginProfiler::Scope prof("projector", projector_name, this);
 	EMData *result = 0;
 	Projector *p = Factory < Projector >::get(projector_name, params);
 	if (p) {
@@ -169,6 +178,7 @@ EMData *EMData::project(const string & projector_name, const Dict & params)
 EMData *EMData::project(const string & projector_name, const Transform & t3d)
 {
 	ENTERFUNC;
+	PluginProfiler::Scope prof("projector", projector_name, this);
 	EMData *result = 0;
 	Dict params;
 	params["transform"] = (Transform*) &t3d;
@@ -189,6 +199,7 @@ EMData *EMData::project(const string & projector_name, const Transform & t3d)
 EMData *EMData::backproject(const string & projector_name, const Dict & params)
 {
 	ENTERFUNC;
+	PluginProfiler::Scope prof("projector", projector_name, this);
 	EMData *result = 0;
 	Projector *p = Factory < Projector >::get(projector_name, params);
 	if (p) {
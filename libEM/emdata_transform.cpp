@@ -42,6 +42,7 @@
 #include <vector>
 #include <utility>
 #include <cmath>
+#include <mutex>
 #include "util.h"
 
 //#ifdef EMAN2_USING_CUDA
@@ -115,6 +116,108 @@ EMData *EMData::do_fft() const
 	}
 }
 
+namespace {
+	// Only guards creating an image's CmpCache, the cache contents have a lock of their own
+	std::mutex cmpcache_create_mutex;
+}
+
+struct EMData::CmpCache
+{
+	CmpCache() : changecount(0), data(0), nx(0), ny(0), nz(0), has_sums(false), sum(0), sumsq(0) {}
+
+	// Held while the cache of this one image is checked or filled, including the FFT itself
+	std::mutex mutex;
+
+	// identify the image contents the cache was made from
+	int changecount;
+	const float *data;
+	int nx, ny, nz;
+
+	// shared, so a comparator still using an FFT is not affected when the image changes
+	std::shared_ptr<const EMData> fft;
+	bool has_sums;
+	double sum, sumsq;
+
+	/** Return the cache of image, creating it if needed. The cache itself lives as long
+	 * as the image, only its contents are dropped when they go stale */
+	static CmpCache *get(const EMData *image)
+	{
+		std::lock_guard<std::mutex> lock(cmpcache_create_mutex);
+		if (image->cmpcache == 0) image->cmpcache = new CmpCache();
+		return image->cmpcache;
+	}
+
+	/** Drop the contents if they no longer match the image. Call with mutex held */
+	void validate(const EMData *image)
+	{
+		const float *idata = image->get_const_data();
+		if (changecount == image->changecount && data == idata &&
+				nx == image->nx && ny == image->ny && nz == image->nz) return;
+
+		fft.reset();
+		has_sums = false;
+		changecount = image->changecount;
+		data = idata;
+		nx = image->nx;
+		ny = image->ny;
+		nz = image->nz;
+	}
+};
+
+std::shared_ptr<const EMData> EMData::get_fft_cached() const
+{
+	ENTERFUNC;
+	// not owned, the caller's reference to the image keeps it alive
+	if (is_complex()) return std::shared_ptr<const EMData>(this, [](const EMData *) {});
+
+	CmpCache *cache = CmpCache::get(this);
+	std::lock_guard<std::mutex> lock(cache->mutex);
+
+	cache->validate(this);
+	if (!cache->fft) {
+		EMData *fft = do_fft();
+		// comparators delete anything marked this way, which must never happen to the cache
+		if (fft->has_attr("free_me")) fft->del_attr("free_me");
+		cache->fft.reset(fft);
+	}
+
+	EXITFUNC;
+	return cache->fft;
+}
+
+void EMData::get_sums_cached(double & sum, double & sumsq) const
+{
+	ENTERFUNC;
+	CmpCache *cmpcache = CmpCache::get(this);
+	std::lock_guard<std::mutex> lock(cmpcache->mutex);
+
+	const float *data = get_const_data();
+	cmpcache->validate(this);
+	if (!cmpcache->has_sums) {
+		double s = 0.0, s2 = 0.0;
+		size_t n = (size_t)nx*ny*nz;
+		for (size_t i = 0; i < n; ++i) {
+			s += double(data[i]);
+			s2 += data[i]*double(data[i]);
+		}
+		cmpcache->sum = s;
+		cmpcache->sumsq = s2;
+		cmpcache->has_sums = true;
+	}
+	sum = cmpcache->sum;
+	sumsq = cmpcache->sumsq;
+
+	EXITFUNC;
+}
+
+void EMData::clear_cmp_cache() const
+{
+	// Only called while no other thread can be using this image
+	if (cmpcache == 0) return;
+	delete cmpcache;
+	cmpcache = 0;
+}
+
 void EMData::do_fft_inplace()
 {
 	ENTERFUNC;
@@ -423,6 +526,217 @@ void EMData::do_ift_inplace()
 	EXITFUNC;
 //	return this;
 }
+
+namespace {
+	// Largest number of images transformed by one batched plan. Larger groups do not vectorize
+	// any better and only cost more scratch memory per thread
+	const int FFT_BATCH_GROUP = 32;
+	// Upper bound on the per-thread packing buffer, in floats, so large volumes fall back to small groups
+	const size_t FFT_BATCH_SCRATCH = 1 << 26;
+
+	int fft_batch_group_size(int n, int nthreads, size_t image_size)
+	{
+		int group = (n + nthreads - 1) / nthreads;
+		if (group > FFT_BATCH_GROUP) group = FFT_BATCH_GROUP;
+		size_t maxgroup = FFT_BATCH_SCRATCH / image_size;
+		if ((size_t)group > maxgroup) group = maxgroup < 1 ? 1 : (int)maxgroup;
+		return group;
+	}
+}
+
+vector< std::shared_ptr<EMData> > EMData::do_fft_batch(const vector<EMData*> & images, int nthreads)
+{
+	ENTERFUNC;
+
+	vector<EMData*> ret;
+	if (images.empty()) return vector< std::shared_ptr<EMData> >();
+
+	const EMData * first = images[0];
+	if (first == 0) throw NullPointerException("NULL image in do_fft_batch");
+	const int nx = first->get_xsize();
+	const int ny = first->get_ysize();
+	const int nz = first->get_zsize();
+
+	for (size_t i = 0; i < images.size(); i++) {
+		if (images[i] == 0) throw NullPointerException("NULL image in do_fft_batch");
+		if (images[i]->is_complex()) throw ImageFormatException("real image expected. Input image is complex image.");
+		if (images[i]->get_xsize() != nx || images[i]->get_ysize() != ny || images[i]->get_zsize() != nz) {
+			throw ImageFormatException("do_fft_batch requires all images to be the same size");
+		}
+	}
+
+#ifdef USE_FFTW3
+	const int n = (int)images.size();
+	const int offset = 2 - nx%2;
+	const int nx2 = nx + offset;
+	const size_t image_size = (size_t)nx2 * ny * nz;
+	const size_t nrows = (size_t)ny * nz;
+
+	// Allocate and flag the results up front so the threads below only move data
+	vector<float*> outdata(n);
+	ret.resize(n);
+	for (int i = 0; i < n; i++) {
+		EMData * dat = images[i]->copy_head();
+		dat->set_size(nx2, ny, nz);
+		dat->set_fftodd(offset == 1);
+		dat->set_fftpad(true);
+		dat->set_complex(true);
+		dat->set_attr("is_intensity",false);
+		if (ny==1 && nz==1) dat->set_complex_x(true);
+		dat->set_ri(true);
+		outdata[i] = dat->get_data();
+		ret[i] = dat;
+	}
+
+	nthreads = Util::get_thread_count(nthreads, n);
+	const int group = fft_batch_group_size(n, nthreads, image_size);
+	const int ngroups = (n + group - 1) / group;
+
+	vector<float*> scratch(nthreads, (float*)0);
+	try {
+		Util::parallel_for(ngroups, nthreads, [&](int g, int tid) {
+			if (scratch[tid] == 0) scratch[tid] = (float*)fftwf_malloc(image_size * group * sizeof(float));
+			float * buf = scratch[tid];
+
+			const int start = g * group;
+			const int count = std::min(group, n - start);
+
+			// Pack with each row padded to the complex row length, as for do_fft_inplace
+			for (int k = 0; k < count; k++) {
+				const float * src = images[start + k]->get_const_data();
+				float * dst = buf + k * image_size;
+				for (size_t r = 0; r < nrows; r++) {
+					memcpy(dst + r * nx2, src + r * nx, nx * sizeof(float));
+				}
+			}
+
+			EMfft::real_to_complex_nd_many(buf, nx, ny, nz, count);
+
+			for (int k = 0; k < count; k++) {
+				memcpy(outdata[start + k], buf + k * image_size, image_size * sizeof(float));
+			}
+		});
+	}
+	catch (...) {
+		for (int t = 0; t < nthreads; t++) if (scratch[t]) fftwf_free(scratch[t]);
+		for (int i = 0; i < n; i++) delete ret[i];
+		throw;
+	}
+	for (int t = 0; t < nthreads; t++) if (scratch[t]) fftwf_free(scratch[t]);
+
+	for (int i = 0; i < n; i++) ret[i]->update();
+#else
+	ret.reserve(images.size());
+	for (size_t i = 0; i < images.size(); i++) ret.push_back(images[i]->do_fft());
+#endif	//USE_FFTW3
+
+	vector< std::shared_ptr<EMData> > out(ret.size());
+	for (size_t i = 0; i < ret.size(); i++) out[i].reset(ret[i]);
+
+	EXITFUNC;
+	return out;
+}
+
+vector< std::shared_ptr<EMData> > EMData::do_ift_batch(const vector<EMData*> & images, int nthreads)
+{
+	ENTERFUNC;
+
+	vector<EMData*> ret;
+	if (images.empty()) return vector< std::shared_ptr<EMData> >();
+
+	if (images[0] == 0) throw NullPointerException("NULL image in do_ift_batch");
+	const int nx = images[0]->get_xsize();
+	const int ny = images[0]->get_ysize();
+	const int nz = images[0]->get_zsize();
+	const bool fftodd = images[0]->is_fftodd();
+
+	for (size_t i = 0; i < images.size(); i++) {
+		EMData * img = images[i];
+		if (img == 0) throw NullPointerException("NULL image in do_ift_batch");
+		if (!img->is_complex()) throw ImageFormatException("complex image expected. Input image is real image.");
+		if (img->get_xsize() != nx || img->get_ysize() != ny || img->get_zsize() != nz || img->is_fftodd() != fftodd) {
+			throw ImageFormatException("do_ift_batch requires all images to be the same size");
+		}
+	}
+
+#ifdef USE_FFTW3
+	const int n = (int)images.size();
+	const int offset = fftodd ? 1 : 2;
+	const int nxreal = nx - offset;
+	const size_t image_size = (size_t)nx * ny * nz;
+	const size_t nrows = (size_t)ny * nz;
+	const float scale = 1.0f / ((size_t)nxreal * ny * nz);
+
+	vector<float*> outdata(n);
+	ret.resize(n);
+	for (int i = 0; i < n; i++) {
+		EMData * img = images[i];
+		if (!img->is_ri()) {
+			LOGWARN("run IFT on AP data, only RI should be used. Converting.");
+			img->ap2ri();
+		}
+
+		EMData * dat = img->copy_head();
+		dat->set_size(nxreal, ny, nz);
+		dat->set_fftodd(false);
+		dat->set_fftpad(false);
+		dat->set_complex(false);
+		if (ny==1 && nz==1) dat->set_complex_x(false);
+		dat->set_ri(false);
+		dat->set_attr("is_intensity",false);
+		outdata[i] = dat->get_data();
+		ret[i] = dat;
+	}
+
+	nthreads = Util::get_thread_count(nthreads, n);
+	const int group = fft_batch_group_size(n, nthreads, image_size);
+	const int ngroups = (n + group - 1) / group;
+
+	vector<float*> scratch(nthreads, (float*)0);
+	try {
+		Util::parallel_for(ngroups, nthreads, [&](int g, int tid) {
+			if (scratch[tid] == 0) scratch[tid] = (float*)fftwf_malloc(image_size * group * sizeof(float));
+			float * buf = scratch[tid];
+
+			const int start = g * group;
+			const int count = std::min(group, n - start);
+
+			// the complex to real transform destroys its input, so always work on the packed copy
+			for (int k = 0; k < count; k++) {
+				memcpy(buf + k * image_size, images[start + k]->get_const_data(), image_size * sizeof(float));
+			}
+
+			EMfft::complex_to_real_nd_many(buf, nxreal, ny, nz, count);
+
+			// Remove the row padding and normalize
+			for (int k = 0; k < count; k++) {
+				const float * src = buf + k * image_size;
+				float * dst = outdata[start + k];
+				for (size_t r = 0; r < nrows; r++) {
+					for (int x = 0; x < nxreal; x++) dst[r * nxreal + x] = src[r * nx + x] * scale;
+				}
+			}
+		});
+	}
+	catch (...) {
+		for (int t = 0; t < nthreads; t++) if (scratch[t]) fftwf_free(scratch[t]);
+		for (int i = 0; i < n; i++) delete ret[i];
+		throw;
+	}
+	for (int t = 0; t < nthreads; t++) if (scratch[t]) fftwf_free(scratch[t]);
+
+	for (int i = 0; i < n; i++) ret[i]->update();
+#else
+	ret.reserve(images.size());
+	for (size_t i = 0; i < images.size(); i++) ret.push_back(images[i]->do_ift());
+#endif	//USE_FFTW3
+
+	vector< std::shared_ptr<EMData> > out(ret.size());
+	for (size_t i = 0; i < ret.size(); i++) out[i].reset(ret[i]);
+
+	EXITFUNC;
+	return out;
+}
 #undef rdata
 
 
@@ -46,6 +46,29 @@ public:
 EMData *do_fft() const;
 
 
+/** Return the FFT of this image, cached on the image so that repeated comparisons
+ * against the same reference only transform it once. The cache is dropped as soon as
+ * the image changes, which as for the image statistics relies on update() being called
+ * after the data is modified directly. If the image is already complex it is returned,
+ * without taking ownership. The FFT is computed once even if several threads ask at the
+ * same time, and stays valid for as long as the returned pointer is held.
+ * @return The FFT of the current image in real/imaginary format, which must not be modified.
+ */
+std::shared_ptr<const EMData> get_fft_cached() const;
+
+
+/** Double precision sum and sum of squares of all pixel values, cached until the
+ * image next changes in the same way as get_fft_cached().
+ * @param[out] sum the sum of all pixel values
+ * @param[out] sumsq the sum of the squares of all pixel values
+ */
+void get_sums_cached(double & sum, double & sumsq) const;
+
+
+/** Free anything cached by get_fft_cached() and get_sums_cached() */
+void clear_cmp_cache() const;
+
+
 #ifdef EMAN2_USING_CUDA
 /** return the fast fourier transform (FFT) image of the current
  * image. the current image is not changed. The result is in
@@ -105,6 +128,29 @@ EMData *do_ift();
 void do_ift_inplace();
 
 
+/** Fourier transform a set of real images of the same size. The images are packed
+ * into contiguous buffers and transformed in groups with a single FFTW plan, which
+ * avoids the per-image plan lookup and lets FFTW vectorize across images.
+ * The input images are not changed.
+ * @param images the real images to transform, all the same size
+ * @param nthreads the number of threads to spread the groups over, <= 0 for all cores
+ * @exception ImageFormatException if an image is complex or the sizes differ
+ * @return The FFTs in real/imaginary format, in the same order.
+ */
+static vector< std::shared_ptr<EMData> > do_fft_batch(const vector<EMData*> & images, int nthreads = 1);
+
+
+/** Inverse Fourier transform a set of complex images of the same size in groups with
+ * a single FFTW plan, the batched counterpart of do_ift(). As with do_ift(), images
+ * in amplitude/phase format are converted to real/imaginary in place.
+ * @param images the complex images to transform, all the same size
+ * @param nthreads the number of threads to spread the groups over, <= 0 for all cores
+ * @exception ImageFormatException if an image is real or the sizes differ
+ * @return The real space images, in the same order.
+ */
+static vector< std::shared_ptr<EMData> > do_ift_batch(const vector<EMData*> & images, int nthreads = 1);
+
+
 /** Render the image into an 8-bit image. 2D images only.
  * flags provide a way to do unusual things with this function, such
  * as calculating a histogram of the rendered area.
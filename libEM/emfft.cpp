@@ -36,8 +36,11 @@
 #include "log.h"
 
 #include <iostream>
+#include <algorithm>
+#include <cstdlib>
 using std::cout;
 using std::endl;
+using std::string;
 
 #include "util.h"
 
@@ -81,55 +84,128 @@ const int EMfft::EMAN2_COMPLEX_2_COMPLEX = 3;
 
 
 #ifdef USE_FFTW3
+namespace {
+	// Planner flags accepted through EMAN2_FFTW_RIGOR / EMfft::set_plan_rigor
+	bool parse_rigor(const string & name, unsigned int & rigor)
+	{
+		if (name == "estimate") rigor = FFTW_ESTIMATE;
+		else if (name == "measure") rigor = FFTW_MEASURE;
+		else if (name == "patient") rigor = FFTW_PATIENT;
+		else if (name == "exhaustive") rigor = FFTW_EXHAUSTIVE;
+		else return false;
+		return true;
+	}
+}
+
+bool EMfft::EMfftw3_cache::PlanKey::operator==(const PlanKey & that) const
+{
+	return rank == that.rank && dims[0] == that.dims[0] && dims[1] == that.dims[1] && dims[2] == that.dims[2] &&
+		r2c == that.r2c && ip == that.ip && real_align == that.real_align && complex_align == that.complex_align &&
+		howmany == that.howmany;
+}
+
+bool EMfft::EMfftw3_cache::PlanKey::operator<(const PlanKey & that) const
+{
+	const int a[9] = { rank, dims[0], dims[1], dims[2], r2c, ip, real_align, complex_align, howmany };
+	const int b[9] = { that.rank, that.dims[0], that.dims[1], that.dims[2], that.r2c, that.ip, that.real_align, that.complex_align, that.howmany };
+	return std::lexicographical_compare(a, a + 9, b, b + 9);
+}
+
 EMfft::EMfftw3_cache::EMfftw3_cache() :
-		num_plans(0)
+		use_clock(0), generation(1), plan_rigor(FFTW_ESTIMATE), wisdom_changed(false)
 {
 	// NOTE 2018/11/13 Toshio Moriya: 
 	// Modified for Pawel
 	clear_plans();
-	
-	/*
-	for(int i = 0; i < EMFFTW3_CACHE_SIZE; ++i)
-	{
-		rank[i] = 0;
-		plan_dims[i][0] = 0; plan_dims[i][1] = 0; plan_dims[i][2] = 0;
-		r2c[i] = -1;
-		ip[i] = -1;
-		fftwplans[i] = NULL;
+
+	const char * rigor_env = getenv("EMAN2_FFTW_RIGOR");
+	if (rigor_env != NULL && !parse_rigor(rigor_env, plan_rigor)) {
+		LOGWARN("Unknown EMAN2_FFTW_RIGOR '%s', using estimate", rigor_env);
+	}
+
+	const char * wisdom_env = getenv("EMAN2_FFTW_WISDOM");
+	if (wisdom_env != NULL) {
+		wisdom_file = wisdom_env;
+		// A missing file is normal on the first run
+		if (Util::is_file_exist(wisdom_file)) load_wisdom(wisdom_file);
 	}
-	*/
 }
 
 void EMfft::EMfftw3_cache::debug_plans()
 {
-	for(int i = 0; i < EMFFTW3_CACHE_SIZE; ++i)
+	int i = 0;
+	for (std::map<PlanKey, PlanEntry *>::const_iterator it = plans.begin(); it != plans.end(); ++it, ++i)
 	{
-		cout << "Plan " << i << " has dims " << plan_dims[i][0] << " " 
-				<< plan_dims[i][1] << " " << 
-				plan_dims[i][2] << ", rank " <<
-				rank[i] << ", rc flag " 
-				<< r2c[i] << ", ip flag " << ip[i] << endl;
+		const PlanKey & key = it->first;
+		cout << "Plan " << i << " has dims " << key.dims[0] << " " 
+				<< key.dims[1] << " " << 
+				key.dims[2] << ", rank " <<
+				key.rank << ", rc flag " 
+				<< key.r2c << ", ip flag " << key.ip << ", alignment " 
+				<< key.real_align << " " << key.complex_align << ", howmany " << key.howmany
+				<< ", used by " << it->second->refs << " threads" << endl;
 	}
+	cout << retired.size() << " retired plans still in use" << endl;
 }
 
 EMfft::EMfftw3_cache::~EMfftw3_cache()
 {
-	// NOTE 2018/11/13 Toshio Moriya: 
-	// Modified for Pawel
-	destroy_plans();
-	
-	/*
-	for(int i = 0; i < EMFFTW3_CACHE_SIZE; ++i)
+	if (wisdom_changed && !wisdom_file.empty()) save_wisdom(wisdom_file);
+
+	// Threads still running at exit never give their references back, so everything goes now
+	int mrt = Util::MUTEX_LOCK(&fft_mutex);
+	for (std::map<PlanKey, PlanEntry *>::iterator it = plans.begin(); it != plans.end(); ++it)
 	{
-		if (fftwplans[i] != NULL)
-		{
-			int mrt = Util::MUTEX_LOCK(&fft_mutex);
-			fftwf_destroy_plan(fftwplans[i]);
-			mrt = Util::MUTEX_UNLOCK(&fft_mutex);
-			fftwplans[i] = NULL;
-		}
+		if (it->second->plan != NULL) fftwf_destroy_plan(it->second->plan);
+		delete it->second;
+	}
+	plans.clear();
+	for (size_t i = 0; i < retired.size(); i++)
+	{
+		if (retired[i]->plan != NULL) fftwf_destroy_plan(retired[i]->plan);
+		delete retired[i];
+	}
+	retired.clear();
+	generation++;
+	mrt = Util::MUTEX_UNLOCK(&fft_mutex);
+}
+
+EMfft::EMfftw3_cache::ThreadCache::~ThreadCache()
+{
+	if (owner == 0) return;
+
+	int mrt = Util::MUTEX_LOCK(&fft_mutex);
+	// After the cache itself was torn down at exit every entry is gone already
+	if (generation == owner->generation.load()) owner->release_all(*this);
+	num_plans = 0;
+	mrt = Util::MUTEX_UNLOCK(&fft_mutex);
+}
+
+void EMfft::EMfftw3_cache::retire(PlanEntry * entry)
+{
+	if (entry->refs == 0) {
+		if (entry->plan != NULL) fftwf_destroy_plan(entry->plan);
+		delete entry;
+	}
+	else {
+		entry->retired = true;
+		retired.push_back(entry);
 	}
-	*/
+}
+
+void EMfft::EMfftw3_cache::release(PlanEntry * entry)
+{
+	if (--entry->refs > 0 || !entry->retired) return;
+
+	retired.erase(std::find(retired.begin(), retired.end(), entry));
+	if (entry->plan != NULL) fftwf_destroy_plan(entry->plan);
+	delete entry;
+}
+
+void EMfft::EMfftw3_cache::release_all(ThreadCache & local)
+{
+	for (int i = 0; i < local.num_plans; i++) release(local.entries[i]);
+	local.num_plans = 0;
 }
 
 // NOTE 2018/11/13 Toshio Moriya: 
@@ -140,14 +216,16 @@ void EMfft::EMfftw3_cache::clear_plans()
 	// Debug output to make sure of EMfft::initialize_plan_cache is working
 	//cout << "MRK_DEBUG: EMfft::clear_plans is executed\n";
 	
-	for(int i = 0; i < EMFFTW3_CACHE_SIZE; ++i)
+	// Plans still held by some thread's list are destroyed when that thread next misses or exits
+	int mrt = Util::MUTEX_LOCK(&fft_mutex);
+	for (std::map<PlanKey, PlanEntry *>::iterator it = plans.begin(); it != plans.end(); ++it)
 	{
-		rank[i] = 0;
-		plan_dims[i][0] = 0; plan_dims[i][1] = 0; plan_dims[i][2] = 0;
-		r2c[i] = -1;
-		ip[i] = -1;
-		fftwplans[i] = NULL;
+		retire(it->second);
 	}
+	plans.clear();
+	// invalidates every thread's private list
+	generation++;
+	mrt = Util::MUTEX_UNLOCK(&fft_mutex);
 }
 
 // NOTE 2018/11/13 Toshio Moriya: 
@@ -158,114 +236,211 @@ void EMfft::EMfftw3_cache::destroy_plans()
 	// Debug output to make sure of EMfft::initialize_plan_cache is working
 	//cout << "MRK_DEBUG: EMfft::EMfftw3_cache destroy_plans is executed\n";
 	
-	for(int i = 0; i < EMFFTW3_CACHE_SIZE; ++i)
-	{
-		if (fftwplans[i] != NULL)
-		{
-			int mrt = Util::MUTEX_LOCK(&fft_mutex);
-			fftwf_destroy_plan(fftwplans[i]);
-			mrt = Util::MUTEX_UNLOCK(&fft_mutex);
-			fftwplans[i] = NULL;
-		}
+	// Another thread may be executing one of these plans right now, so destroying them has to wait
+	// for the thread lists just as in clear_plans()
+	clear_plans();
+}
+
+void EMfft::EMfftw3_cache::set_rigor(unsigned int rigor)
+{
+	int mrt = Util::MUTEX_LOCK(&fft_mutex);
+	plan_rigor = rigor;
+	mrt = Util::MUTEX_UNLOCK(&fft_mutex);
+}
+
+bool EMfft::EMfftw3_cache::load_wisdom(const string & filename)
+{
+	int mrt = Util::MUTEX_LOCK(&fft_mutex);
+	int ret = fftwf_import_wisdom_from_filename(filename.c_str());
+	mrt = Util::MUTEX_UNLOCK(&fft_mutex);
+
+	if (!ret) {
+		LOGWARN("Unable to import FFTW wisdom from '%s'", filename.c_str());
 	}
+	return ret != 0;
 }
 
-fftwf_plan EMfft::EMfftw3_cache::get_plan(const int rank_in, const int x, const int y, const int z, const int r2c_flag, const int ip_flag, fftwf_complex* complex_data, float* real_data )
+bool EMfft::EMfftw3_cache::save_wisdom(const string & filename)
 {
+	int mrt = Util::MUTEX_LOCK(&fft_mutex);
+	int ret = fftwf_export_wisdom_to_filename(filename.c_str());
+	if (ret) wisdom_changed = false;
+	mrt = Util::MUTEX_UNLOCK(&fft_mutex);
+
+	if (!ret) {
+		LOGWARN("Unable to export FFTW wisdom to '%s'", filename.c_str());
+	}
+	return ret != 0;
+}
+
+fftwf_plan EMfft::EMfftw3_cache::make_plan(const PlanKey & key)
+{
+	const int x = key.dims[0];
+	const int y = key.dims[1];
+	const int z = key.dims[2];
+	const int rank_in = key.rank;
 
-	if ( rank_in > 3 || rank_in < 1 ) throw InvalidValueException(rank_in, "Error, can not get an FFTW plan using rank out of the range [1,3]");
-	if ( r2c_flag != EMAN2_REAL_2_COMPLEX && r2c_flag != EMAN2_COMPLEX_2_REAL && r2c_flag != EMAN2_COMPLEX_2_COMPLEX ) throw InvalidValueException(r2c_flag, "The selected real to complex flag is not supported");
-	
-// 	static int num_added = 0;
-// 	cout << "Was asked for " << rank_in << " " << x << " " << y << " " << z << " " << r2c_flag << endl;
-	
 	int dims[3];
 	dims[0] = z;
 	dims[1] = y;
 	dims[2] = x;
-	
-	int mrt = Util::MUTEX_LOCK(&fft_mutex);
-	
-	// First check to see if we already have the plan
-	int i;
-	for (i=0; i<num_plans; i++) {
-		if (plan_dims[i][0]==x && plan_dims[i][1]==y && plan_dims[i][2]==z && rank[i]==rank_in && r2c[i]==r2c_flag && ip[i]==ip_flag) {
-			mrt = Util::MUTEX_UNLOCK(&fft_mutex);
-			return fftwplans[i];
-		}
+
+	// FFTW_MEASURE and up overwrite the arrays while planning, so plans are never made on the
+	// caller's data. The scratch arrays are offset to reproduce the alignment of the caller's arrays,
+	// which the plan is then restricted to. fftwf_malloc aligns to FFTW's SIMD alignment, which is
+	// up to 64 bytes with AVX-512, so the offset (fftwf_alignment_of) can be up to 60 bytes.
+	const size_t pad = 64 / sizeof(float);
+	size_t complex_size, real_size;
+	if (key.r2c == EMAN2_COMPLEX_2_COMPLEX) {
+		complex_size = (size_t)x * 2 * y * z;
+		real_size = 0;
 	}
-	
+	else {
+		complex_size = (size_t)(x / 2 + 1) * 2 * y * z * key.howmany;
+		real_size = key.ip ? 0 : (size_t)x * y * z;
+	}
+
+	float * complex_buf = (float *)fftwf_malloc((complex_size + pad) * sizeof(float));
+	float * real_buf = real_size ? (float *)fftwf_malloc((real_size + pad) * sizeof(float)) : NULL;
+	fftwf_complex * complex_data = (fftwf_complex *)(complex_buf + key.complex_align / sizeof(float));
+	float * real_data = real_buf ? real_buf + key.real_align / sizeof(float) : (float *)complex_data;
+
 	fftwf_plan plan;
 	// Create the plan
-	if ( y == 1 && z == 1 )
+	if ( key.howmany > 1 )
 	{
-		if ( r2c_flag == EMAN2_REAL_2_COMPLEX )
-			plan = fftwf_plan_dft_r2c_1d(x, real_data, complex_data, FFTW_ESTIMATE);
-		else if ( r2c_flag == EMAN2_COMPLEX_2_REAL )
-			plan = fftwf_plan_dft_c2r_1d(x, complex_data, real_data, FFTW_ESTIMATE);
-		else {
+		// Packed in-place images, the real layout is padded in x to the complex row length
+		int nembed_real[3], nembed_complex[3];
+		nembed_real[0] = nembed_complex[0] = z;
+		nembed_real[1] = nembed_complex[1] = y;
+		nembed_complex[2] = x / 2 + 1;
+		nembed_real[2] = 2 * nembed_complex[2];
+		const int off = 3 - rank_in;
+		const int dist_complex = nembed_complex[2] * y * z;
+		const int dist_real = 2 * dist_complex;
+
+		if ( key.r2c == EMAN2_REAL_2_COMPLEX )
+			plan = fftwf_plan_many_dft_r2c(rank_in, dims + off, key.howmany, real_data, nembed_real + off, 1, dist_real,
+					complex_data, nembed_complex + off, 1, dist_complex, plan_rigor);
+		else
+			plan = fftwf_plan_many_dft_c2r(rank_in, dims + off, key.howmany, complex_data, nembed_complex + off, 1, dist_complex,
+					real_data, nembed_real + off, 1, dist_real, plan_rigor);
+	}
+	else if ( y == 1 && z == 1 )
+	{
+		if ( key.r2c == EMAN2_REAL_2_COMPLEX )
+			plan = fftwf_plan_dft_r2c_1d(x, real_data, complex_data, plan_rigor);
+		else if ( key.r2c == EMAN2_COMPLEX_2_REAL )
+			plan = fftwf_plan_dft_c2r_1d(x, complex_data, real_data, plan_rigor);
+		else
 			// This ONLY makes plans for inplace 1D C->C Forward
-			float *tmp=(float *)malloc(sizeof(float)*x*2);
-			memcpy(tmp,complex_data,sizeof(float)*x*2);
-			// technically FFTW_ESTIMATE isn't supposed to mess with the input data, but the manual advises playing it safe
-			plan = fftwf_plan_dft_1d(x,complex_data,complex_data,FFTW_FORWARD,FFTW_ESTIMATE);
-			memcpy(complex_data,tmp,sizeof(float)*x*2);
-			free(tmp);
-		}
+			plan = fftwf_plan_dft_1d(x, complex_data, complex_data, FFTW_FORWARD, plan_rigor);
 	}
 	else
 	{
-		if ( r2c_flag == EMAN2_REAL_2_COMPLEX )
-			plan = fftwf_plan_dft_r2c(rank_in, dims + (3 - rank_in), real_data, complex_data, FFTW_ESTIMATE);
-		else if ( r2c_flag == EMAN2_COMPLEX_2_REAL) 
-			plan = fftwf_plan_dft_c2r(rank_in, dims + (3 - rank_in), complex_data, real_data, FFTW_ESTIMATE);
-		else {
+		if ( key.r2c == EMAN2_REAL_2_COMPLEX )
+			plan = fftwf_plan_dft_r2c(rank_in, dims + (3 - rank_in), real_data, complex_data, plan_rigor);
+		else if ( key.r2c == EMAN2_COMPLEX_2_REAL) 
+			plan = fftwf_plan_dft_c2r(rank_in, dims + (3 - rank_in), complex_data, real_data, plan_rigor);
+		else
 			// This ONLY makes plans for inplace 2D/3D C->C Forward
-			float *tmp=(float *)malloc(sizeof(float)*x*2*y*z);
-			memcpy(tmp,complex_data,sizeof(float)*x*2*y*z);
-			// technically FFTW_ESTIMATE isn't supposed to mess with the input data, but the manual advises playing it safe
-			plan = fftwf_plan_dft(rank_in, dims + (3 - rank_in), complex_data, complex_data, FFTW_FORWARD, FFTW_ESTIMATE);  // in place!
-			memcpy(complex_data,tmp,sizeof(float)*x*2*y*z);
-			free(tmp);
+			plan = fftwf_plan_dft(rank_in, dims + (3 - rank_in), complex_data, complex_data, FFTW_FORWARD, plan_rigor);  // in place!
+	}
+
+	fftwf_free(complex_buf);
+	if (real_buf) fftwf_free(real_buf);
+
+	if (plan_rigor != FFTW_ESTIMATE) wisdom_changed = true;
+
+	return plan;
+}
+
+fftwf_plan EMfft::EMfftw3_cache::get_plan(const int rank_in, const int x, const int y, const int z, const int r2c_flag, const int ip_flag, fftwf_complex* complex_data, float* real_data, const int howmany )
+{
+
+	if ( rank_in > 3 || rank_in < 1 ) throw InvalidValueException(rank_in, "Error, can not get an FFTW plan using rank out of the range [1,3]");
+	if ( r2c_flag != EMAN2_REAL_2_COMPLEX && r2c_flag != EMAN2_COMPLEX_2_REAL && r2c_flag != EMAN2_COMPLEX_2_COMPLEX ) throw InvalidValueException(r2c_flag, "The selected real to complex flag is not supported");
+	if ( howmany > 1 && ( !ip_flag || r2c_flag == EMAN2_COMPLEX_2_COMPLEX ) ) throw InvalidValueException(howmany, "Batched plans are only supported for in-place real/complex transforms");
+
+	PlanKey key;
+	key.rank = rank_in;
+	key.dims[0] = x;
+	key.dims[1] = y;
+	key.dims[2] = z;
+	key.r2c = r2c_flag;
+	key.ip = ip_flag ? 1 : 0;
+	key.complex_align = fftwf_alignment_of((float *)complex_data);
+	key.real_align = (real_data == NULL || key.ip) ? key.complex_align : fftwf_alignment_of(real_data);
+	key.howmany = howmany < 1 ? 1 : howmany;
+
+	// Each thread looks in its own list first, no locking needed. The plan returned stays referenced
+	// by this list at least until the thread's next call, so it can't be destroyed while in use
+	static thread_local ThreadCache local;
+	local.owner = this;
+
+	int i = local.num_plans;
+	if (local.generation == generation.load()) {
+		for (i=0; i<local.num_plans; i++) {
+			if (local.keys[i] == key) break;
+		}
+	}
+
+	PlanEntry * entry;
+	if (i < local.num_plans) {
+		entry = local.entries[i];
+	}
+	else {
+		int mrt = Util::MUTEX_LOCK(&fft_mutex);
+		if (local.generation != generation.load()) {
+			release_all(local);
+			local.generation = generation.load();
+		}
 
+		std::map<PlanKey, PlanEntry *>::iterator it = plans.find(key);
+		if (it != plans.end()) {
+			entry = it->second;
 		}
+		else {
+			entry = new PlanEntry;
+			entry->plan = make_plan(key);
+			entry->refs = 0;
+			entry->retired = false;
+			plans[key] = entry;
+
+			// Drop the least recently planned entry, preferring one no thread is holding
+			if (plans.size() > EMFFTW3_SHARED_CACHE_SIZE) {
+				std::map<PlanKey, PlanEntry *>::iterator victim = plans.end();
+				for (it = plans.begin(); it != plans.end(); ++it) {
+					if (it->second == entry) continue;
+					if (victim == plans.end() || (it->second->refs == 0) > (victim->second->refs == 0) ||
+							((it->second->refs == 0) == (victim->second->refs == 0) && it->second->last_use < victim->second->last_use)) {
+						victim = it;
+					}
+				}
+				retire(victim->second);
+				plans.erase(victim);
+			}
 		}
+		entry->refs++;
+		entry->last_use = ++use_clock;
 
-	if (fftwplans[EMFFTW3_CACHE_SIZE-1] != NULL )
-	{
-		fftwf_destroy_plan(fftwplans[EMFFTW3_CACHE_SIZE-1]);
-		fftwplans[EMFFTW3_CACHE_SIZE-1] = NULL;
+		// The least recently used entry falls off the end of the thread's list
+		if (local.num_plans < EMFFTW3_CACHE_SIZE) local.num_plans++;
+		else release(local.entries[EMFFTW3_CACHE_SIZE - 1]);
+		mrt = Util::MUTEX_UNLOCK(&fft_mutex);
+
+		i = local.num_plans - 1;
 	}
-					
-	int upper_limit = num_plans;
-	if ( upper_limit == EMFFTW3_CACHE_SIZE ) upper_limit -= 1;
-	for (int i=upper_limit-1; i>0; i--)
-	{
-		fftwplans[i]=fftwplans[i-1];
-		rank[i]=rank[i-1];
-		r2c[i]=r2c[i-1];
-		ip[i]=ip[i-1];
-		plan_dims[i][0]=plan_dims[i-1][0];
-		plan_dims[i][1]=plan_dims[i-1][1];
-		plan_dims[i][2]=plan_dims[i-1][2];
+
+	// Move to the front of the list
+	for (; i > 0; i--) {
+		local.keys[i] = local.keys[i-1];
+		local.entries[i] = local.entries[i-1];
 	}
-		//dimplan[0]=-1;
-
-	plan_dims[0][0]=x;
-	plan_dims[0][1]=y;
-	plan_dims[0][2]=z;
-	r2c[0]=r2c_flag;
-	ip[0]=ip_flag;
-	fftwplans[0] = plan;
-	rank[0]=rank_in;
-	if (num_plans<EMFFTW3_CACHE_SIZE) num_plans++;
-// 			debug_plans();
-// 			cout << "Created plan 0" << endl;
-// 	++num_added;
-// 	cout << "I have created " << num_added << " plans" << endl;
-	mrt = Util::MUTEX_UNLOCK(&fft_mutex);
-	return fftwplans[0];
+	local.keys[0] = key;
+	local.entries[0] = entry;
 
+	return entry->plan;
 }
 
 // Static init
@@ -552,6 +727,64 @@ int EMfft::complex_to_real_nd(float *complex_data, float *real_data, int nx, int
 }
 
 
+int EMfft::real_to_complex_nd_many(float *data, int nx, int ny, int nz, int howmany)
+{
+	if (howmany < 1) return 0;
+	const int rank = get_rank(ny, nz);
+
+#ifdef FFTW_PLAN_CACHING
+	fftwf_plan plan = plan_cache.get_plan(rank,nx,ny,nz,EMAN2_REAL_2_COMPLEX,1,(fftwf_complex *) data, data, howmany);
+	fftwf_execute_dft_r2c(plan, data, (fftwf_complex *) data);
+#else
+	int dims[3] = { nz, ny, nx };
+	int nembed_real[3] = { nz, ny, 2 * (nx / 2 + 1) };
+	int nembed_complex[3] = { nz, ny, nx / 2 + 1 };
+	const int off = 3 - rank;
+	const int dist_complex = (nx / 2 + 1) * ny * nz;
+
+	int mrt = Util::MUTEX_LOCK(&fft_mutex);
+	fftwf_plan plan = fftwf_plan_many_dft_r2c(rank, dims + off, howmany, data, nembed_real + off, 1, 2 * dist_complex,
+			(fftwf_complex *) data, nembed_complex + off, 1, dist_complex, FFTW_ESTIMATE);
+	mrt = Util::MUTEX_UNLOCK(&fft_mutex);
+
+	fftwf_execute(plan);
+
+	mrt = Util::MUTEX_LOCK(&fft_mutex);
+	fftwf_destroy_plan(plan);
+	mrt = Util::MUTEX_UNLOCK(&fft_mutex);
+#endif // FFTW_PLAN_CACHING
+	return 0;
+}
+
+int EMfft::complex_to_real_nd_many(float *data, int nx, int ny, int nz, int howmany)
+{
+	if (howmany < 1) return 0;
+	const int rank = get_rank(ny, nz);
+
+#ifdef FFTW_PLAN_CACHING
+	fftwf_plan plan = plan_cache.get_plan(rank,nx,ny,nz,EMAN2_COMPLEX_2_REAL,1,(fftwf_complex *) data, data, howmany);
+	fftwf_execute_dft_c2r(plan, (fftwf_complex *) data, data);
+#else
+	int dims[3] = { nz, ny, nx };
+	int nembed_real[3] = { nz, ny, 2 * (nx / 2 + 1) };
+	int nembed_complex[3] = { nz, ny, nx / 2 + 1 };
+	const int off = 3 - rank;
+	const int dist_complex = (nx / 2 + 1) * ny * nz;
+
+	int mrt = Util::MUTEX_LOCK(&fft_mutex);
+	fftwf_plan plan = fftwf_plan_many_dft_c2r(rank, dims + off, howmany, (fftwf_complex *) data, nembed_complex + off, 1, dist_complex,
+			data, nembed_real + off, 1, 2 * dist_complex, FFTW_ESTIMATE);
+	mrt = Util::MUTEX_UNLOCK(&fft_mutex);
+
+	fftwf_execute(plan);
+
+	mrt = Util::MUTEX_LOCK(&fft_mutex);
+	fftwf_destroy_plan(plan);
+	mrt = Util::MUTEX_UNLOCK(&fft_mutex);
+#endif // FFTW_PLAN_CACHING
+	return 0;
+}
+
 // NOTE 2018/11/13 Toshio Moriya: 
 // Added for Pawel so that he re-initialize EMfftw3_cache plan_cache through this function
 // This function is available only when USE_FFTW3 is defined. 
@@ -562,6 +795,25 @@ int EMfft::initialize_plan_cache()
 	return 0;
 }
 
+#ifdef FFTW_PLAN_CACHING
+void EMfft::set_plan_rigor(const string & rigor)
+{
+	unsigned int flag;
+	if (!parse_rigor(rigor, flag)) throw InvalidParameterException("FFTW plan rigor must be one of estimate, measure, patient or exhaustive");
+	plan_cache.set_rigor(flag);
+}
+
+bool EMfft::load_wisdom(const string & filename)
+{
+	return plan_cache.load_wisdom(filename);
+}
+
+bool EMfft::save_wisdom(const string & filename)
+{
+	return plan_cache.save_wisdom(filename);
+}
+#endif
+
 #endif	//USE_FFTW3
 
 #ifdef NATIVE_FFT
@@ -793,8 +1045,11 @@ int EMfft::complex_to_real_nd(float *complex_data, float *real_data, int nx, int
 
 #ifdef 	USE_ACML
 #include <iostream>
+#include <algorithm>
+#include <cstdlib>
 using std::cout;
 using std::endl;
+using std::string;
 
 int EMfft::real_to_complex_1d(float *real_data, float *complex_data, int n)
 {
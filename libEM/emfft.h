@@ -36,6 +36,13 @@
 
 #include <fftw3.h>
 #include<complex>
+#include <string>
+
+#ifdef FFTW_PLAN_CACHING
+#include <atomic>
+#include <map>
+#include <vector>
+#endif
  
 namespace EMAN
 {
@@ -55,6 +62,22 @@ namespace EMAN
 		static int complex_to_real_nd(float *complex_data, float *real_data, int nx, int ny,
 									  int nz);
 		static int complex_to_complex_nd(float *complex_data_in, float *complex_data_out, int nx,int ny,int nz);// ming add
+
+		/** In-place real to complex transform of howmany images of the same size with a single FFTW plan.
+		 * The images are stored back to back, each laid out as do_fft_inplace() leaves it, i.e.
+		 * padded in x to 2*(nx/2+1) floats.
+		 * @param data the packed images
+		 * @param nx the unpadded x size
+		 * @param ny the y size
+		 * @param nz the z size
+		 * @param howmany the number of images in data
+		 */
+		static int real_to_complex_nd_many(float *data, int nx, int ny, int nz, int howmany);
+
+		/** In-place complex to real inverse of real_to_complex_nd_many(). Like complex_to_real_nd()
+		 * the result is not normalized.
+		 */
+		static int complex_to_real_nd_many(float *data, int nx, int ny, int nz, int howmany);
 		static inline float *fftmalloc(int n) { return (float*)fftw_malloc(n*sizeof(float)); }
 		static inline void fftfree(float *mem) { fftw_free(mem); }
 		
@@ -62,23 +85,59 @@ namespace EMAN
 		// Added for Pawel so that he can access to EMfft::EMfftw3_cache::EMfftw3_cache() through this function
 		// This function is available only when USE_FFTW3 is defined. 
 		static int initialize_plan_cache();
+
+#ifdef FFTW_PLAN_CACHING
+		/** Set how hard FFTW works to find a fast plan for transforms of sizes not seen before.
+		 * Slower planning pays off when the same sizes are transformed many times, and when
+		 * combined with load_wisdom()/save_wisdom() the cost is only paid once.
+		 * @param rigor "estimate", "measure", "patient" or "exhaustive"
+		 * @exception InvalidParameterException if rigor is not recognized
+		 */
+		static void set_plan_rigor(const std::string & rigor);
+
+		/** Import FFTW wisdom, typically saved by save_wisdom() in an earlier run
+		 * @return true on success
+		 */
+		static bool load_wisdom(const std::string & filename);
+
+		/** Export FFTW wisdom accumulated by measured plans in this run
+		 * @return true on success
+		 */
+		static bool save_wisdom(const std::string & filename);
+#endif
 		
 	  private:
 #ifdef FFTW_PLAN_CACHING
 #define EMFFTW3_CACHE_SIZE 32
+#define EMFFTW3_SHARED_CACHE_SIZE 256
 		static const int EMAN2_REAL_2_COMPLEX;
 		static const int EMAN2_COMPLEX_2_REAL;
 		static const int EMAN2_COMPLEX_2_COMPLEX;		// inplace only
 		/** EMfftw3_cache
-		 * An ecapsulation of FFTW3 plan caching. Keeps an array of plans and records of important details.
+		 * An ecapsulation of FFTW3 plan caching.
 		 * Main interface is get_plan(...)
 		 * If asked for a plan that is not currently stored this class will create the plan and then return
 		 * it. If asked for a plan that IS stored than the pre-existing plan is returned.
-		 * The number of plans that can be cached is determined by the compile time flag EMFFTW3_CACHE_SIZE.
 		 * Although FFTW3 documentation states that plan caching is performed internally, tests on Fedora Core
 		 * 6 using rpms indicated that the costs of an associated MD5 algorithm in FFTW3 were prohibitive. 
 		 * Hence this implementation. Using FFTW plan caching usually results in a dramatic performance boost.
 		 * Supports inplace transforms
+		 *
+		 * Plans are owned by a shared table keyed on (rank, dims, direction, in-place, data alignment). Each
+		 * thread keeps its own most-recently-used list of EMFFTW3_CACHE_SIZE plans on top of the shared table,
+		 * so a cache hit takes no lock. Only a miss in the thread's list takes fft_mutex, since the FFTW planner
+		 * itself is not thread safe. Executing one plan from several threads at once through the new-array
+		 * execute functions is safe.
+		 *
+		 * The shared table holds at most EMFFTW3_SHARED_CACHE_SIZE plans, dropping the least recently planned
+		 * ones first. Each plan counts the thread lists referring to it, and a plan dropped from the table (or
+		 * by clear_plans/destroy_plans) is only destroyed once the last of those lists has let go of it.
+		 *
+		 * Plans are always made on scratch arrays with the same alignment as the caller's data, so the planning
+		 * rigor may be raised to FFTW_MEASURE or FFTW_PATIENT without touching the data being transformed.
+		 * The rigor is taken from the EMAN2_FFTW_RIGOR environment variable (estimate, measure, patient or
+		 * exhaustive) and defaults to estimate. If EMAN2_FFTW_WISDOM names a file, wisdom is imported from it
+		 * at startup and any newly measured plans are exported back to it at exit.
 		 */
 		class EMfftw3_cache
 		{
@@ -100,28 +159,102 @@ namespace EMAN
 			 * @param ip_flag the in-place flag, should be either EMAN2_FFTW2_INPLACE or EMAN2_FFTW2_OUT_OF_PLACE
 			 * @param complex_data the complex data, in fftw_complex format
 			 * @param real_data the real_data
+			 * @param howmany the number of transforms done by one execution, > 1 only for packed in-place real/complex data
 			 * @exception InvalidValueException when the rank is not 1,2 or 3
 			 * @exception InvalidValueException when the r2c_flag is unrecognized
 			 * @return and fftwf_plan corresponding to the input arguments
 			 */
-			fftwf_plan get_plan(const int rank, const int x, const int y, const int z, const int r2c_flag,const int ip_flag, fftwf_complex* complex_data, float* real_data);
+			fftwf_plan get_plan(const int rank, const int x, const int y, const int z, const int r2c_flag,const int ip_flag, fftwf_complex* complex_data, float* real_data, const int howmany=1);
+
+			/** Set the FFTW planner flag used for plans created from now on
+			 * @param rigor one of FFTW_ESTIMATE, FFTW_MEASURE, FFTW_PATIENT or FFTW_EXHAUSTIVE
+			 */
+			void set_rigor(unsigned int rigor);
+			unsigned int get_rigor() const { return plan_rigor; }
+
+			/** Import FFTW wisdom from a file
+			 * @return true if the file was read successfully
+			 */
+			bool load_wisdom(const std::string & filename);
+
+			/** Export all accumulated FFTW wisdom to a file
+			 * @return true if the file was written successfully
+			 */
+			bool save_wisdom(const std::string & filename);
 		private:
+			/** Everything that makes one plan different from another. Plans may only be re-executed on
+			 * arrays with the same alignment as the arrays they were made for, hence the alignment fields.
+			 */
+			struct PlanKey
+			{
+				int rank;
+				int dims[3];
+				int r2c;
+				int ip;
+				int real_align;
+				int complex_align;
+				int howmany;
+
+				bool operator==(const PlanKey & that) const;
+				bool operator<(const PlanKey & that) const;
+			};
+
+			/** One plan and the number of per-thread lists holding it. refs and last_use are only
+			 * touched with fft_mutex held.
+			 */
+			struct PlanEntry
+			{
+				fftwf_plan plan;
+				int refs;
+				unsigned long long last_use;
+				bool retired;
+			};
+
+			/** The per-thread most-recently-used list. generation is compared against the shared table's
+			 * generation so that plans dropped through clear_plans() are never handed out again. The
+			 * list's references are given back when the thread exits.
+			 */
+			struct ThreadCache
+			{
+				ThreadCache() : owner(0), num_plans(0), generation(0) {}
+				~ThreadCache();
+
+				EMfftw3_cache * owner;
+				int num_plans;
+				unsigned int generation;
+				PlanKey keys[EMFFTW3_CACHE_SIZE];
+				PlanEntry * entries[EMFFTW3_CACHE_SIZE];
+			};
+
+			// Make a new plan on scratch arrays. Must be called with fft_mutex held
+			fftwf_plan make_plan(const PlanKey & key);
+
+			// Drop a plan from the shared table, destroying it if no thread list refers to it. fft_mutex held
+			void retire(PlanEntry * entry);
+
+			// Give back one thread list reference, destroying a retired plan on the last one. fft_mutex held
+			void release(PlanEntry * entry);
+
+			// Give back all of a thread list's references. fft_mutex held
+			void release_all(ThreadCache & local);
+
 			// Prints useful debug information to standard out
 			void debug_plans();
-			
-			// Store the number of plans currently contained in this EMfftw3_cache object
-			int num_plans;
-
-			// Store the rank of the plan
-			int rank[EMFFTW3_CACHE_SIZE];
-			// Store the dimensions of the plan (always in 3D, if dimensions are "unused" they are taken to be 1)
-			int plan_dims[EMFFTW3_CACHE_SIZE][3];
-			// store whether the plan was real to complex or vice versa
-			int r2c[EMFFTW3_CACHE_SIZE];
-			// Store the plans themselves
-			fftwf_plan fftwplans[EMFFTW3_CACHE_SIZE];
-			// Store whether or not the plan was inplace
-			int ip[EMFFTW3_CACHE_SIZE];
+
+			// The shared table which owns every live plan, protected by fft_mutex
+			std::map<PlanKey, PlanEntry *> plans;
+			// Plans dropped from the table but still held by some thread's list, protected by fft_mutex
+			std::vector<PlanEntry *> retired;
+			// Counts plan lookups that missed a thread's list, for least recently used eviction
+			unsigned long long use_clock;
+			// Incremented every time the shared table is emptied
+			std::atomic<unsigned int> generation;
+			// FFTW planner flag used for new plans
+			unsigned int plan_rigor;
+			// Set when a plan was made with a rigor that produces new wisdom
+			bool wisdom_changed;
+			// Wisdom file from EMAN2_FFTW_WISDOM, empty if unset
+			std::string wisdom_file;
 		};
 
 		static EMfftw3_cache plan_cache;
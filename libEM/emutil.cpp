@@ -36,11 +36,16 @@
 #include <sys/param.h>
 #endif	// WIN32
 
+#include <sys/stat.h>
+#include <algorithm>
+#include <limits>
 #include <utility>
 
 #include "io/all_imageio.h"
 #include "portable_fileio.h"
 #include "emcache.h"
+#include "io/hdf_filecache.h"
+#include "io/lstrefpool.h"
 #include "emdata.h"
 #include "ctf.h"
 #include "emassert.h"
@@ -567,6 +572,11 @@ ImageIO *EMUtil::get_imageio(const string & filename, int rw,
 		   rw == ImageIO::READ_WRITE ||
 		   rw == ImageIO::WRITE_ONLY);
 
+	// lists keep the files they reference open for reading, close them before writing
+	if (rw != ImageIO::READ_ONLY) {
+		LstRefPool::instance().forget(filename);
+	}
+
 	ImageIO *imageio = 0;
    int persist = 0;
 
@@ -627,6 +637,18 @@ ImageIO *EMUtil::get_imageio(const string & filename, int rw,
 #endif
 #ifdef USE_HDF5
 	case IMAGE_HDF:
+#ifdef HDFIO_CACHE
+		// read only files stay open in HDFCache. HDF5 can't open a file for writing
+		// while it is open read only, so a cached copy is closed first
+		if (rw_mode == ImageIO::READ_ONLY) {
+			FileItem * item = HDFCache::instance()->get_file(filename);
+			if (item) {
+				EXITFUNC;
+				return item->get_imgio();
+			}
+		}
+		else HDFCache::instance()->close_file(filename);
+#endif	//HDFIO_CACHE
         persist = 30;
         if (rw_mode != ImageIO::READ_ONLY) {
             persist = 3;
@@ -636,6 +658,17 @@ ImageIO *EMUtil::get_imageio(const string & filename, int rw,
 			delete imageio;
 			imageio = new HdfIO(filename, rw_mode);
 		}
+#ifdef HDFIO_CACHE
+		if (rw_mode == ImageIO::READ_ONLY) {
+			persist = 0;
+			FileItem * item = new FileItem(filename, imageio, time(0), true);
+			if (HDFCache::instance()->add_file(item) < 0) {
+				// another thread cached the file first, this copy is closed normally
+				item->set_imgio(0);
+				delete item;
+			}
+		}
+#endif	//HDFIO_CACHE
 		break;
 #endif	//USE_HDF5
 	case IMAGE_LST:
@@ -720,6 +753,9 @@ ImageIO *EMUtil::get_imageio(const string & filename, int rw,
 void EMUtil::close_imageio(const string & filename, const ImageIO * io)
 {
     //printf("EMUtil::close_imageio\n");
+#ifdef HDFIO_CACHE
+	if (HDFCache::instance()->unpin_imageio(filename, io)) return;
+#endif	//HDFIO_CACHE
     #ifdef IMAGEIO_CACHE
     if (GlobalCache::instance()->contains(filename)) {
         GlobalCache::instance()->close_imageio(filename);
@@ -1671,19 +1707,323 @@ vector<string> EMUtil::get_euler_names(const string & euler_type)
     return v;
 }
 
-vector<EMObject> EMUtil::get_all_attributes(const string & file_name, const string & attr_name)
+// Reads header values through ImageIO::read_header_columns, adding the attributes
+// EMData::read_image sets itself
+static void read_header_columns(const string & file_name, const vector<string> & keys,
+								int first, int n, vector< vector<EMObject> > & values)
+{
+	ImageIO *imageio = EMUtil::get_imageio(file_name, ImageIO::READ_ONLY);
+	if (!imageio) {
+		throw ImageFormatException("invalid image type");
+	}
+
+	try {
+		imageio->read_header_columns(keys, first, n, values);
+	}
+	catch (...) {
+		EMUtil::close_imageio(file_name, imageio);
+		throw;
+	}
+
+	bool is_lst = dynamic_cast<LstIO *>(imageio) != 0;
+	EMUtil::close_imageio(file_name, imageio);
+
+	for (size_t k = 0; k < keys.size(); k++) {
+		if (keys[k] == "source_n") {
+			for (int i = 0; i < n; i++) values[k][i] = first + i;
+		}
+		else if (keys[k] == "source_path" && !is_lst) {
+			values[k].assign(n, EMObject(file_name));
+		}
+	}
+}
+
+// Converts the values of one key to a typed column, see get_attribute_columns
+static EMObject make_column(const vector<EMObject> & values)
+{
+	bool numeric = true, xform = true;
+	for (size_t i = 0; i < values.size(); i++) {
+		switch (values[i].get_type()) {
+		case EMObject::UNKNOWN:
+			break;
+		case EMObject::BOOL:
+		case EMObject::SHORT:
+		case EMObject::UNSIGNEDINT:
+		case EMObject::INT:
+		case EMObject::FLOAT:
+		case EMObject::DOUBLE:
+			xform = false;
+			break;
+		case EMObject::TRANSFORM:
+			numeric = false;
+			break;
+		default:
+			numeric = xform = false;
+		}
+	}
+
+	if (numeric) {
+		vector<float> col(values.size(), std::numeric_limits<float>::quiet_NaN());
+		for (size_t i = 0; i < values.size(); i++) {
+			if (!values[i].is_null()) col[i] = (float)values[i];
+		}
+		return EMObject(col);
+	}
+
+	if (xform) {
+		vector<Transform> col(values.size());
+		for (size_t i = 0; i < values.size(); i++) {
+			if (values[i].is_null()) continue;
+			Transform *t = values[i];
+			col[i] = *t;
+			delete t;
+		}
+		return EMObject(col);
+	}
+
+	vector<string> col(values.size());
+	for (size_t i = 0; i < values.size(); i++) {
+		EMObject::ObjectType t = values[i].get_type();
+		if (t == EMObject::UNKNOWN) continue;
+		if (t == EMObject::STRING || t == EMObject::CTF) col[i] = (const char *)values[i];
+		else col[i] = values[i].to_str();
+	}
+	return EMObject(col);
+}
+
+static EMObject slice_column(const EMObject & column, int first, int n)
+{
+	if (column.get_type() == EMObject::FLOATARRAY) {
+		vector<float> v = column;
+		return EMObject(vector<float>(v.begin() + first, v.begin() + first + n));
+	}
+	if (column.get_type() == EMObject::TRANSFORMARRAY) {
+		vector<Transform> v = column;
+		return EMObject(vector<Transform>(v.begin() + first, v.begin() + first + n));
+	}
+	vector<string> v = column;
+	return EMObject(vector<string>(v.begin() + first, v.begin() + first + n));
+}
+
+/* Header column sidecar files hold whole columns, in host byte order:
+ *   "EMHDRCOL", int64 mtime, int64 size, int32 nimg, int32 ncol
+ * then for each column:
+ *   int32 key length, key, int32 EMObject type, nimg values
+ * Strings are stored as int32 length + characters, Transforms as 12 floats.
+ */
+static const char HDRCOL_MAGIC[8] = { 'E', 'M', 'H', 'D', 'R', 'C', 'O', 'L' };
+
+static string header_cache_name(const string & file_name)
 {
-	vector<EMObject> v;
+	size_t p = file_name.find_last_of("/\\");
+	if (p == string::npos) return "." + file_name + ".hdrcol";
+	return file_name.substr(0, p + 1) + "." + file_name.substr(p + 1) + ".hdrcol";
+}
 
+static bool header_cache_stamp(const string & file_name, int64_t & mtime, int64_t & size)
+{
+	struct stat st;
+	if (stat(file_name.c_str(), &st) != 0) return false;
+	// modification time in ns, so a rewrite within the same second is still noticed
+	mtime = (int64_t)st.st_mtime*1000000000;
+#if defined(__APPLE__)
+	mtime += st.st_mtimespec.tv_nsec;
+#elif defined(__linux__) || defined(_POSIX_C_SOURCE) && _POSIX_C_SOURCE >= 200809L
+	mtime += st.st_mtim.tv_nsec;
+#endif
+	size = (int64_t)st.st_size;
+	return true;
+}
+
+// Reads the columns from a sidecar file, returns an empty Dict if it is missing or stale
+static Dict read_header_cache(const string & file_name, int nimg)
+{
+	Dict columns;
+	int64_t mtime, size;
+	if (!header_cache_stamp(file_name, mtime, size)) return columns;
+
+	FILE *in = fopen(header_cache_name(file_name).c_str(), "rb");
+	if (!in) return columns;
+
+	char magic[8];
+	int64_t cmtime, csize;
+	int32_t cnimg, ncol;
+	if (fread(magic, sizeof(magic), 1, in) != 1 || memcmp(magic, HDRCOL_MAGIC, sizeof(magic)) != 0 ||
+		fread(&cmtime, sizeof(cmtime), 1, in) != 1 || fread(&csize, sizeof(csize), 1, in) != 1 ||
+		fread(&cnimg, sizeof(cnimg), 1, in) != 1 || fread(&ncol, sizeof(ncol), 1, in) != 1 ||
+		cmtime != mtime || csize != size || cnimg != nimg) {
+		fclose(in);
+		return columns;
+	}
+
+	bool ok = true;
+	for (int c = 0; c < ncol && ok; c++) {
+		int32_t len, type;
+		ok = fread(&len, sizeof(len), 1, in) == 1 && len > 0 && len < 65536;
+		if (!ok) break;
+		string key(len, ' ');
+		ok = fread(&key[0], len, 1, in) == 1 && fread(&type, sizeof(type), 1, in) == 1;
+		if (!ok) break;
+
+		if (type == EMObject::FLOATARRAY) {
+			vector<float> v(nimg);
+			ok = nimg == 0 || fread(&v[0], sizeof(float), nimg, in) == (size_t)nimg;
+			columns[key] = EMObject(v);
+		}
+		else if (type == EMObject::TRANSFORMARRAY) {
+			vector<float> m((size_t)nimg * 12);
+			ok = nimg == 0 || fread(&m[0], sizeof(float), m.size(), in) == m.size();
+			vector<Transform> v(nimg);
+			for (int i = 0; i < nimg && ok; i++) v[i] = Transform(&m[i * 12]);
+			columns[key] = EMObject(v);
+		}
+		else if (type == EMObject::STRINGARRAY) {
+			vector<string> v(nimg);
+			for (int i = 0; i < nimg && ok; i++) {
+				int32_t slen;
+				ok = fread(&slen, sizeof(slen), 1, in) == 1 && slen >= 0;
+				if (ok && slen > 0) {
+					v[i].resize(slen);
+					ok = fread(&v[i][0], slen, 1, in) == 1;
+				}
+			}
+			columns[key] = EMObject(v);
+		}
+		else {
+			ok = false;
+		}
+	}
+	fclose(in);
+
+	if (!ok) {
+		LOGWARN("Ignoring damaged header cache for '%s'", file_name.c_str());
+		columns.clear();
+	}
+	return columns;
+}
+
+// Writes the columns to a sidecar file. Failure isn't an error, the cache is just not kept.
+static void write_header_cache(const string & file_name, int nimg, const Dict & columns)
+{
+	int64_t mtime, size;
+	if (!header_cache_stamp(file_name, mtime, size)) return;
+
+	string cache_name = header_cache_name(file_name);
+	string tmp_name = cache_name + ".tmp";
+	FILE *out = fopen(tmp_name.c_str(), "wb");
+	if (!out) {
+		LOGWARN("Unable to write header cache '%s'", cache_name.c_str());
+		return;
+	}
+
+	int32_t cnimg = nimg, ncol = columns.size();
+	fwrite(HDRCOL_MAGIC, sizeof(HDRCOL_MAGIC), 1, out);
+	fwrite(&mtime, sizeof(mtime), 1, out);
+	fwrite(&size, sizeof(size), 1, out);
+	fwrite(&cnimg, sizeof(cnimg), 1, out);
+	fwrite(&ncol, sizeof(ncol), 1, out);
+
+	for (Dict::const_iterator it = columns.begin(); it != columns.end(); ++it) {
+		int32_t len = it->first.size();
+		int32_t type = it->second.get_type();
+		fwrite(&len, sizeof(len), 1, out);
+		fwrite(it->first.c_str(), len, 1, out);
+		fwrite(&type, sizeof(type), 1, out);
+
+		if (type == EMObject::FLOATARRAY) {
+			vector<float> v = it->second;
+			if (!v.empty()) fwrite(&v[0], sizeof(float), v.size(), out);
+		}
+		else if (type == EMObject::TRANSFORMARRAY) {
+			vector<Transform> v = it->second;
+			for (size_t i = 0; i < v.size(); i++) {
+				vector<float> m = v[i].get_matrix();
+				fwrite(&m[0], sizeof(float), 12, out);
+			}
+		}
+		else {
+			vector<string> v = it->second;
+			for (size_t i = 0; i < v.size(); i++) {
+				int32_t slen = v[i].size();
+				fwrite(&slen, sizeof(slen), 1, out);
+				if (slen) fwrite(v[i].c_str(), slen, 1, out);
+			}
+		}
+	}
+
+	bool ok = !ferror(out);
+	ok = (fclose(out) == 0) && ok;
+	if (ok && rename(tmp_name.c_str(), cache_name.c_str()) != 0) {
+		// rename doesn't replace an existing file on Windows
+		remove(cache_name.c_str());
+		ok = rename(tmp_name.c_str(), cache_name.c_str()) == 0;
+	}
+	if (!ok) {
+		remove(tmp_name.c_str());
+		LOGWARN("Unable to write header cache '%s'", cache_name.c_str());
+	}
+}
+
+vector<EMObject> EMUtil::get_all_attributes(const string & file_name, const string & attr_name)
+{
 	Assert(file_name != "");
 	Assert(attr_name != "");
 
-	auto vpImg = EMData::read_images(file_name, vector<int>(), EMUtil::IMAGE_UNKNOWN, true);
+	int nimg = get_image_count(file_name);
 
-	for (auto iter = vpImg.begin(); iter!=vpImg.end(); ++iter)
-		v.push_back((*iter)->get_attr_default(attr_name));
+	vector< vector<EMObject> > values;
+	read_header_columns(file_name, vector<string>(1, attr_name), 0, nimg, values);
 
-	return v;
+	return values[0];
+}
+
+Dict EMUtil::get_attribute_columns(const string & file_name, const vector<string> & keys,
+								   int first, int n, bool use_cache)
+{
+	ENTERFUNC;
+
+	int nimg = get_image_count(file_name);
+	if (n < 0) n = nimg - first;
+	if (first < 0 || first > nimg) throw OutofRangeException(0, nimg, first, "first image index");
+	if (first + n > nimg) throw OutofRangeException(0, nimg, first + n, "last image index");
+
+	// the values in a list come from the files it references, which the sidecar's stamp doesn't cover
+	if (use_cache) {
+		ImageType image_type = get_image_type(file_name);
+		if (image_type == IMAGE_LST || image_type == IMAGE_LSTFAST) use_cache = false;
+	}
+
+	Dict columns;
+	vector< vector<EMObject> > values;
+
+	if (!use_cache) {
+		read_header_columns(file_name, keys, first, n, values);
+		for (size_t k = 0; k < keys.size(); k++) columns[keys[k]] = make_column(values[k]);
+		EXITFUNC;
+		return columns;
+	}
+
+	Dict cached = read_header_cache(file_name, nimg);
+
+	vector<string> missing;
+	for (size_t k = 0; k < keys.size(); k++) {
+		if (!cached.has_key(keys[k]) && std::find(missing.begin(), missing.end(), keys[k]) == missing.end()) {
+			missing.push_back(keys[k]);
+		}
+	}
+
+	if (!missing.empty()) {
+		read_header_columns(file_name, missing, 0, nimg, values);
+		for (size_t k = 0; k < missing.size(); k++) cached[missing[k]] = make_column(values[k]);
+		write_header_cache(file_name, nimg, cached);
+	}
+
+	for (size_t k = 0; k < keys.size(); k++) {
+		columns[keys[k]] = (first == 0 && n == nimg) ? cached[keys[k]] : slice_column(cached[keys[k]], first, n);
+	}
+
+	EXITFUNC;
+	return columns;
 }
 
 void EMUtil::getRenderLimits(const Dict & dict, float & rendermin, float & rendermax, int & renderbits)
@@ -1856,9 +2196,20 @@ EMObject EMUtil::read_hdf_attribute(const string & filename, const string & key,
 		throw ImageFormatException("This function only applies to HDF5 file.");
 	}
 
+	// the H5 calls below are made directly on the file, outside of HdfIO2
+	std::lock_guard<std::recursive_mutex> lock(HdfIO2::hdf_mutex());
 	HdfIO2* imageio = new HdfIO2(filename, ImageIO::READ_ONLY);
 	imageio->init();
 
+	// stack layout files keep all headers in one table
+	if (imageio->is_stack()) {
+		Dict dict;
+		imageio->read_header(dict, image_index, 0, false);
+		delete imageio;
+		if (!dict.has_key(key)) throw _NotExistingObjectException(key);
+		return dict[key];
+	}
+
 	// Each image is in a group for later expansion. Open the group
 	hid_t file = imageio->get_fileid();
 
@@ -1891,9 +2242,25 @@ int EMUtil::write_hdf_attribute(const string & filename, const string & key, EMO
 		throw ImageFormatException("This function only applies to HDF5 file.");
 	}
 
+	LstRefPool::instance().forget(filename);
+
+	// the H5 calls below are made directly on the file, outside of HdfIO2
+	std::lock_guard<std::recursive_mutex> lock(HdfIO2::hdf_mutex());
+#ifdef HDFIO_CACHE
+	HDFCache::instance()->close_file(filename);
+#endif	//HDFIO_CACHE
 	HdfIO2* imageio = new HdfIO2(filename, ImageIO::WRITE_ONLY);
 	imageio->init();
 
+	if (imageio->is_stack()) {
+		Dict dict;
+		imageio->read_header(dict, image_index, 0, false);
+		dict[key] = value;
+		imageio->write_header(dict, image_index, 0, EMUtil::EM_FLOAT, false);
+		delete imageio;
+		return 0;
+	}
+
 	// Each image is in a group for later expansion. Open the group
 
 	hid_t file = imageio->get_fileid();
@@ -1925,9 +2292,26 @@ int EMUtil::delete_hdf_attribute(const string & filename, const string & key, in
 		throw ImageFormatException("This function only applies to HDF5 file.");
 	}
 
+	LstRefPool::instance().forget(filename);
+
+	// the H5 calls below are made directly on the file, outside of HdfIO2
+	std::lock_guard<std::recursive_mutex> lock(HdfIO2::hdf_mutex());
+#ifdef HDFIO_CACHE
+	HDFCache::instance()->close_file(filename);
+#endif	//HDFIO_CACHE
 	HdfIO2* imageio = new HdfIO2(filename, ImageIO::READ_WRITE);
 	imageio->init();
 
+	if (imageio->is_stack()) {
+		Dict dict;
+		imageio->read_header(dict, image_index, 0, false);
+		int ret = dict.has_key(key) ? 0 : -1;
+		dict.erase(key);
+		imageio->write_header(dict, image_index, 0, EMUtil::EM_FLOAT, false);
+		delete imageio;
+		return ret;
+	}
+
 	// Each image is in a group for later expansion. Open the group
 
 	hid_t file = imageio->get_fileid();
@@ -35,6 +35,7 @@
 #include <cstring>
 #include "emobject.h"
 #include "emassert.h"
+#include "profiler.h"
 
 using std::string;
 using std::vector;
@@ -299,6 +300,29 @@ namespace EMAN
 		 * @exception InvalidCallException when call this function for a non-stack image */
 		static vector<EMObject> get_all_attributes(const string & file_name, const string & attr_name);
 
+		/** Read several header attributes from a range of images in a stack as typed
+		 * columns. Only the requested keys are read from the file, no EMData or full
+		 * header is built for each image.
+		 *
+		 * Numeric attributes are returned as a FLOATARRAY with NaN where an image lacks
+		 * the key, Transforms as a TRANSFORMARRAY (identity where missing) and anything
+		 * else as a STRINGARRAY ("" where missing).
+		 *
+		 * With use_cache, whole columns are kept in a sidecar file (.<name>.hdrcol next to
+		 * the image file), which is reused until the image file's size or modification
+		 * time changes. Keys not in the sidecar are read for all images and added to it.
+		 * LST/LSX files are never cached, since their values come from the referenced files.
+		 *
+		 * @param file_name the image file name
+		 * @param keys the header attribute names
+		 * @param first index of the first image
+		 * @param n number of images, <0 for all images from first to the end of the file
+		 * @param use_cache read and update the sidecar cache
+		 * @return a Dict with one column per key
+		 * @exception OutofRangeException if the range is outside the file */
+		static Dict get_attribute_columns(const string & file_name, const vector<string> & keys,
+										  int first = 0, int n = -1, bool use_cache = false);
+
 		/** Get the min and max pixel value accepted for image nomalization
 		 * from image attribute dictionary, or return zeroes if not present
 		 *
@@ -364,14 +388,17 @@ namespace EMAN
 		}
 
 		inline static void* em_malloc(const size_t size) {
+			PluginProfiler::count_alloc(size);
 			return malloc(size);
 		}
 
 		inline static void* em_calloc(const size_t nmemb,const size_t size) {
+			PluginProfiler::count_alloc(nmemb*size);
 			return calloc(nmemb,size);
 		}
 
-		inline static void* em_realloc(void* data,const size_t new_size) {
+		inline static void* em_realloc(void* data,const size_t new_size,const size_t old_size) {
+			if (new_size > old_size) PluginProfiler::count_alloc(new_size-old_size);
 			return realloc(data, new_size);
 		}
 		inline static void em_memset(void* data, const int value, const size_t size) {
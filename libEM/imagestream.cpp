@@ -0,0 +1,166 @@
+/*
+ * Copyright (c) 2000- Baylor College of Medicine
+ * 
+ * This software is issued under a joint BSD/GNU license. You may use the
+ * source code in this file under either license. However, note that the
+ * complete EMAN2 and SPARX software packages have some GPL dependencies,
+ * so you are responsible for compliance with the licenses of these packages
+ * if you opt to use BSD licensing. The warranty disclaimer below holds
+ * in either instance.
+ * 
+ * This complete copyright notice must be included in any revised version of the
+ * source code. Additional authorship citations may be added, but existing
+ * author citations must be preserved.
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ * 
+ * */
+
+#include "imagestream.h"
+#include "emdata.h"
+#include "emutil.h"
+#include "util.h"
+
+using namespace EMAN;
+
+ImageStream::ImageStream(const string & fname, const vector<int> & img_indices,
+						 bool hdr_only, int nthreads, int qsize)
+:	filename(fname), indices(img_indices), header_only(hdr_only),
+	queue_size(qsize > 0 ? qsize : 1), next_read(0), next_out(0), stopping(false)
+{
+	ENTERFUNC;
+
+	int total_img = EMUtil::get_image_count(filename);
+
+	if (indices.empty()) {
+		indices.resize(total_img);
+		for (int i = 0; i < total_img; i++) indices[i] = i;
+	}
+	else {
+		for (size_t i = 0; i < indices.size(); i++) {
+			if (indices[i] < 0 || indices[i] >= total_img)
+				throw OutofRangeException(0, total_img, indices[i], "image index");
+		}
+	}
+
+	slots.resize(queue_size, (EMData *)0);
+	errors.resize(queue_size);
+	slot_holds.resize(queue_size, -1);
+	slot_free_for.resize(queue_size);
+	for (int i = 0; i < queue_size; i++) slot_free_for[i] = i;
+
+	// these formats share one cached ImageIO between all readers of a file
+	EMUtil::ImageType type = EMUtil::get_image_type(filename);
+	if (type == EMUtil::IMAGE_HDF || type == EMUtil::IMAGE_LST || type == EMUtil::IMAGE_LSTFAST) {
+		nthreads = 1;
+	}
+
+	nthreads = Util::get_thread_count(nthreads, Util::get_min(size(), queue_size));
+	for (int i = 0; i < nthreads && size() > 0; i++) {
+		threads.push_back(std::thread(&ImageStream::reader, this));
+	}
+
+	EXITFUNC;
+}
+
+ImageStream::~ImageStream()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	read_cond.notify_all();
+
+	for (size_t i = 0; i < threads.size(); i++) threads[i].join();
+
+	for (size_t i = 0; i < slots.size(); i++) {
+		if (slots[i]) {
+			delete slots[i];
+			slots[i] = 0;
+		}
+	}
+}
+
+void ImageStream::reader()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+
+	while (true) {
+		if (stopping || next_read >= size()) return;
+
+		// claim the next position, then wait until its slot has been emptied
+		int n = next_read++;
+		int slot = n % queue_size;
+		read_cond.wait(lock, [this, n, slot] { return stopping || slot_free_for[slot] == n; });
+		if (stopping) return;
+		lock.unlock();
+
+		EMData *img = 0;
+		std::exception_ptr err;
+		try {
+			img = new EMData();
+			img->read_image(filename, indices[n], header_only);
+		}
+		catch (...) {
+			err = std::current_exception();
+			if (img) {
+				delete img;
+				img = 0;
+			}
+		}
+
+		lock.lock();
+		slots[slot] = img;
+		errors[slot] = err;
+		slot_holds[slot] = n;
+		out_cond.notify_all();
+	}
+}
+
+EMData *ImageStream::next()
+{
+	int n;
+	return next(n);
+}
+
+EMData *ImageStream::next(int & n)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+
+	if (next_out >= size()) {
+		n = size();
+		return 0;
+	}
+
+	n = next_out++;
+	int slot = n % queue_size;
+
+	// the slot may still hold an earlier image another caller hasn't taken yet
+	out_cond.wait(lock, [this, n, slot] { return slot_holds[slot] == n; });
+
+	EMData *img = slots[slot];
+	std::exception_ptr err = errors[slot];
+	slots[slot] = 0;
+	errors[slot] = std::exception_ptr();
+	slot_holds[slot] = -1;
+	slot_free_for[slot] = n + queue_size;
+
+	lock.unlock();
+	read_cond.notify_all();
+
+	if (err) std::rethrow_exception(err);
+
+	return img;
+}
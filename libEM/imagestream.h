@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2000- Baylor College of Medicine
+ * 
+ * This software is issued under a joint BSD/GNU license. You may use the
+ * source code in this file under either license. However, note that the
+ * complete EMAN2 and SPARX software packages have some GPL dependencies,
+ * so you are responsible for compliance with the licenses of these packages
+ * if you opt to use BSD licensing. The warranty disclaimer below holds
+ * in either instance.
+ * 
+ * This complete copyright notice must be included in any revised version of the
+ * source code. Additional authorship citations may be added, but existing
+ * author citations must be preserved.
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ * 
+ * */
+
+#ifndef eman__imagestream_h__
+#define eman__imagestream_h__ 1
+
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+namespace EMAN
+{
+	class EMData;
+
+	/** ImageStream reads a list of images from one file on background threads, so that
+	 * the caller can start working on the first images while later ones are still being
+	 * read. Images are returned by next() in the order requested. At most queue_size images
+	 * are read ahead of the caller, which bounds the memory used.
+	 *
+	 * Formats which open a new ImageIO for every read (MRC, SPIDER, IMAGIC, ...) are read
+	 * with several threads in parallel. HDF and LST files share one cached ImageIO, so they
+	 * are read by a single background thread. Other threads may keep reading and writing
+	 * HDF files meanwhile, since HdfIO2 serializes all HDF5 calls behind one lock.
+	 *
+	 * next() may be called from several compute threads at once, each call returning a
+	 * different image:
+	 * @code
+	 * ImageStream stream("particles.hdf");
+	 * while (EMData *img = stream.next()) {
+	 *     ...
+	 *     delete img;
+	 * }
+	 * @endcode
+	 */
+	class ImageStream
+	{
+	  public:
+		/** Start reading images in the background
+		 * @param filename the file to read
+		 * @param img_indices the images to read, in the order they will be returned. Empty reads all images
+		 * @param header_only read only the image headers
+		 * @param nthreads number of reader threads. <=0 means one per hardware thread
+		 * @param queue_size maximum number of images read ahead of the caller
+		 * @exception OutofRangeException if an index is not in the file
+		 */
+		explicit ImageStream(const string & filename, const vector<int> & img_indices = vector<int>(),
+							 bool header_only = false, int nthreads = 2, int queue_size = 16);
+
+		/** Stops the reader threads and frees any images not returned by next() */
+		~ImageStream();
+
+		/** Get the next image, waiting for it to be read if necessary. If reading
+		 * this image failed, the exception from the reader is thrown here.
+		 * @return the next image, which the caller owns, or 0 after the last image
+		 */
+		EMData *next();
+
+		/** Like next(), but also says which entry of the index list was returned
+		 * @param[out] n the position in the index list of the image returned
+		 * @return the next image, or 0 after the last image
+		 */
+		EMData *next(int & n);
+
+		/** @return the total number of images this stream will return */
+		int size() const
+		{
+			return (int)indices.size();
+		}
+
+	  private:
+		ImageStream(const ImageStream &);
+		ImageStream & operator=(const ImageStream &);
+
+		void reader();
+
+		string filename;
+		vector<int> indices;
+		bool header_only;
+		int queue_size;
+
+		/** ring of queue_size slots, image n goes in slot n%queue_size */
+		vector<EMData *> slots;
+		vector<std::exception_ptr> errors;
+		vector<int> slot_holds;		// position whose image is in each slot, -1 if none
+		vector<int> slot_free_for;	// position allowed to fill each slot next
+
+		int next_read;		// next position a reader will claim
+		int next_out;		// next position next() will return
+		bool stopping;
+
+		std::mutex mutex;
+		std::condition_variable read_cond;		// readers wait for room in the ring
+		std::condition_variable out_cond;		// next() waits for its slot to fill
+		vector<std::thread> threads;
+	};
+}
+
+#endif	//eman__imagestream_h__
@@ -31,6 +31,7 @@
 
 #include "interp.h"
 #include "util.h"
+#include <mutex>
 
 using namespace EMAN;
 
@@ -1708,6 +1709,13 @@ float Interp::HYPERGEOM[] = {
 
 float *Interp::gimx = 0;
 
+float *Interp::get_gimx()
+{
+	static std::once_flag gimx_once;
+	std::call_once(gimx_once, init_gimx);
+	return gimx;
+}
+
 void Interp::init_gimx()
 {
 	const int size = 100;
@@ -59,13 +59,8 @@ namespace EMAN
 			return (float)(-(HYPERGEOM[a] * (1.0 - r) + HYPERGEOM[a + 1] * r));
 		}
 
-		static float *get_gimx()
-		{
-			if (!gimx) {
-				init_gimx();
-			}
-			return gimx;
-		}
+		/** The table is built on the first call, which may come from several threads at once */
+		static float *get_gimx();
 
 	  private:
 		static void init_gimx();
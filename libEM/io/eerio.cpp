@@ -42,27 +42,47 @@ auto Decoder::operator()(unsigned int count, unsigned int sub_pix) const {
 	return std::make_pair(x(count, sub_pix), y(count, sub_pix));
 }
 
-typedef vector<pair<int, int>> COORDS;
+// Decodes one frame, adding 1 for every electron into out, which is num_pix>>shift square.
+// The pixel position is computed inline for decoder level I (4k<<I), avoiding any intermediate
+// list of coordinates and the virtual calls through Decoder
+template <unsigned int I>
+void decode_eer_data(EerWord *data, float *out, unsigned int shift) {
+	const unsigned int camera_size = DecoderIx<I>().camera_size;
+	const unsigned int out_nx = (camera_size << I) >> shift;
+	const DecoderIx<I> decoder;
 
-auto decode_eer_data(EerWord *data, Decoder &decoder) {
 	EerStream is((data));
 	EerRle    rle;
 	EerSubPix sub_pix;
 
 	is >> rle >> sub_pix;
-	int count = rle;
+	unsigned int count = rle;
 
-	COORDS coords;
-
-	while (count < decoder.camera_size * decoder.camera_size) {
-		coords.push_back(decoder(count, sub_pix));
+	while (count < camera_size * camera_size) {
+		unsigned int x = decoder.DecoderIx<I>::x(count, sub_pix) >> shift;
+		unsigned int y = decoder.DecoderIx<I>::y(count, sub_pix) >> shift;
+		out[x + (size_t)y * out_nx] += 1;
 
 		is >> rle >> sub_pix;
 
 		count += rle+1;
 	}
+}
 
-	return coords;
+void decode_eer_data(EerWord *data, const Decoder &decoder, float *out, unsigned int shift) {
+	switch (decoder.num_pix() / decoder.camera_size) {
+	case 1:
+		decode_eer_data<0>(data, out, shift);
+		break;
+	case 2:
+		decode_eer_data<1>(data, out, shift);
+		break;
+	case 4:
+		decode_eer_data<2>(data, out, shift);
+		break;
+	default:
+		throw InvalidValueException(decoder.num_pix(), "unsupported EER decoder size");
+	}
 }
 
 void TIFFOutputWarning(const char* module, const char* fmt, va_list ap)
@@ -225,19 +245,54 @@ int EerIO::read_data(float *rdata, int image_index, const Region * area, bool)
 {
 	ENTERFUNC;
 
-	TIFFSetDirectory(tiff_file, image_index);
-	
-	auto data = read_raw_data(tiff_file);
+	std::vector<unsigned char> data;
+	{
+		std::lock_guard<std::mutex> lock(tiff_mutex);
+		TIFFSetDirectory(tiff_file, image_index);
+		data = read_raw_data(tiff_file);
+	}
 
-	auto coords = decode_eer_data((EerWord *) data.data(), decoder);
-	for(auto &c : coords)
-		rdata[c.first + c.second * decoder.num_pix()] += 1;
+	decode_eer_data((EerWord *) data.data(), decoder, rdata, 0);
 
 	EXITFUNC;
 
 	return 0;
 }
 
+void EerIO::sum_frames(float *rdata, int first_frame, int nframes, int binning)
+{
+	ENTERFUNC;
+
+	if (first_frame < 0 || nframes < 0 || first_frame + nframes > (int)num_frames) {
+		throw OutofRangeException(0, num_frames, first_frame + nframes, "EER frame");
+	}
+
+	unsigned int shift = 0;
+	while ((1 << shift) < binning) shift++;
+	if (binning < 1 || (1 << shift) != binning || binning > (int)decoder.num_pix()) {
+		throw InvalidValueException(binning, "EER binning must be a power of 2");
+	}
+
+	for (int i = 0; i < nframes; i++) {
+		std::vector<unsigned char> data;
+		{
+			std::lock_guard<std::mutex> lock(tiff_mutex);
+			// stepping to the next directory is much cheaper than seeking to it from the start
+			if (i == 0 || (int)TIFFCurrentDirectory(tiff_file) != first_frame + i - 1) {
+				TIFFSetDirectory(tiff_file, first_frame + i);
+			}
+			else {
+				TIFFReadDirectory(tiff_file);
+			}
+			data = read_raw_data(tiff_file);
+		}
+
+		decode_eer_data((EerWord *) data.data(), decoder, rdata, shift);
+	}
+
+	EXITFUNC;
+}
+
 int EerIO::write_data(float *data, int image_index, const Region* area,
 					  EMUtil::EMDataType, bool use_host_endian)
 {
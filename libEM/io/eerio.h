@@ -36,6 +36,7 @@
 
 #include <tiffio.h>
 #include <bitset>
+#include <mutex>
 
 
 namespace EMAN
@@ -186,6 +187,25 @@ namespace EMAN
 		int get_nimg();
 		bool is_single_image_format() const override;
 
+		/** Decode nframes consecutive frames and add their sum into rdata, binned on the
+		 * fly. rdata must hold (num_pix/binning)^2 floats for the decoder in use. May be
+		 * called from several threads at once, only reading the raw frames from the TIFF
+		 * file is serialized.
+		 * @param rdata the image to add into
+		 * @param first_frame the first frame to sum
+		 * @param nframes the number of frames to sum
+		 * @param binning output pixels are binning x binning decoded pixels, a power of 2
+		 * @exception InvalidValueException if binning is not a power of 2 or is too large
+		 * @exception OutofRangeException if the frames are not in the file
+		 */
+		void sum_frames(float *rdata, int first_frame, int nframes, int binning = 1);
+
+		/** @return the number of pixels along each axis of a decoded frame */
+		int get_num_pix() const
+		{
+			return decoder.num_pix();
+		}
+
 
 		DEFINE_IMAGEIO_FUNC;
 
@@ -196,6 +216,7 @@ namespace EMAN
 		Dict acquisition_data_dict;
 		
 		Decoder &decoder;
+		std::mutex tiff_mutex;
 	};
 }
 
@@ -33,6 +33,7 @@
 
 #include <list>
 #include "hdf_filecache.h"
+#include "log.h"
 #include <sys/time.h>
 #include <sys/resource.h>
 
@@ -101,120 +102,198 @@ bool FileItem::get_readonly() const
 
 HDFCache * HDFCache::_instance = 0;
 
-HDFCache::HDFCache()
+HDFCache::HDFCache() :
+		hits(0), misses(0), evictions(0)
 {
-	_thread = boost::thread(&HDFCache::cache_routine, this);
-
 	struct rlimit rl;
 	getrlimit(RLIMIT_NOFILE, &rl);
 	CACHESIZE = rl.rlim_cur/2;
 //	std::cout << "CACHESIZE = " << CACHESIZE << std::endl;
 }
 
+HDFCache::~HDFCache()
+{
+	clear();
+}
+
 HDFCache * HDFCache::instance()
 {
-	if(!_instance) {
-		_instance = new HDFCache();
-	}
+	static std::once_flag once;
+	std::call_once(once, []() { _instance = new HDFCache(); });
 
 	return _instance;
 }
 
-void HDFCache::cache_routine()
+FileItem * HDFCache::get_file(const string& filename)
 {
-	boost::posix_time::seconds intervalTime(CHECK_INTERVAL);
+	std::lock_guard<std::mutex> l(m_mutex);
 
-	while(true) {
-		try {
-			force_clean();
-			purge_file();
-			boost::this_thread::sleep(intervalTime);
-		}
-		catch (std::exception& exc) {
-			std::cerr << "Very Bad Thing Happen in HDFCache routine: " << exc.what() << std::endl;
+	MyHashtable::iterator it = file_pool.find(filename);
+	if(it == file_pool.end()) {
+		++misses;
+		return 0;
+	}
+
+	++hits;
+	Entry & e = it->second;
+	if(e.pins++ == 0) {
+		unpinned.erase(e.lru);
+	}
+	e.item->set_timestamp(time(0));
+
+	return e.item;
+}
+
+int HDFCache::add_file(FileItem * newfile)
+{
+	list<FileItem *> closing;
+	{
+		std::lock_guard<std::mutex> l(m_mutex);
+
+		if(file_pool.find(newfile->get_path()) != file_pool.end()) {
+			return -1;
 		}
+
+		Entry e;
+		e.item = newfile;
+		e.pins = 1;
+		file_pool[newfile->get_path()] = e;
+		newfile->set_timestamp(time(0));
+
+		evict(closing);
+	}
+
+	//files are closed without holding the lock
+	for(list<FileItem *>::iterator it = closing.begin(); it != closing.end(); ++it) {
+		delete *it;
 	}
+
+	return 0;
 }
 
-FileItem * HDFCache::get_file(const string& filename)
+void HDFCache::unpin_file(FileItem * file)
 {
-	boost::mutex::scoped_lock l(m_mutex);
+	std::lock_guard<std::mutex> l(m_mutex);
 
-	if(file_pool.find(filename) != file_pool.end()) {
-		FileItem * hdf_item = file_pool[filename];
-		hdf_item->set_timestamp(time(0));
-		return hdf_item;
+	MyHashtable::iterator it = file_pool.find(file->get_path());
+	if(it == file_pool.end() || it->second.item != file || it->second.pins <= 0) {
+		LOGERR("HDFCache: unpin of a file which isn't pinned: %s", file->get_path().c_str());
+		return;
 	}
-	else {
-		return 0;
+
+	Entry & e = it->second;
+	if(--e.pins == 0) {
+		unpinned.push_front(file);
+		e.lru = unpinned.begin();
 	}
 }
 
-int HDFCache::add_file(FileItem * newfile)
+bool HDFCache::unpin_imageio(const string& filename, const ImageIO * io)
 {
-	if(file_pool.size() >= CACHESIZE) {
-		force_clean();
+	std::lock_guard<std::mutex> l(m_mutex);
+
+	MyHashtable::iterator it = file_pool.find(filename);
+	if(it == file_pool.end() || it->second.item->get_imgio() != io) {
+		return false;
 	}
 
-	boost::mutex::scoped_lock l(m_mutex);
-	file_pool[newfile->get_path()] = newfile;
-	file_pool2.push_back(newfile);
+	Entry & e = it->second;
+	if(e.pins <= 0) {
+		LOGERR("HDFCache: unpin of a file which isn't pinned: %s", filename.c_str());
+	}
+	else if(--e.pins == 0) {
+		unpinned.push_front(e.item);
+		e.lru = unpinned.begin();
+	}
 
-	return 0;
+	return true;
 }
 
-/**I don't put lock in this function to avoid race condition.
- * the lock is in upper level function purge_file() and force_clean()*/
 int HDFCache::close_file(const string& filename)
 {
-	FileItem * hdfitem = file_pool[filename];
+	FileItem * hdfitem = 0;
+	{
+		std::lock_guard<std::mutex> l(m_mutex);
 
-	ImageIO * hdfio = hdfitem->get_imgio();
-	delete hdfio;
-	file_pool[filename]->set_imgio(0);
-	file_pool.erase(filename);
+		MyHashtable::iterator it = file_pool.find(filename);
+		if(it == file_pool.end() || it->second.pins > 0) {
+			return -1;
+		}
 
-	vector<FileItem *>::iterator it = find(file_pool2.begin(), file_pool2.end(), hdfitem);
-	file_pool2.erase(it);
+		hdfitem = it->second.item;
+		unpinned.erase(it->second.lru);
+		file_pool.erase(it);
+	}
+
+	delete hdfitem;
 
 	return 0;
 }
 
-int HDFCache::purge_file()
+void HDFCache::clear()
 {
-	boost::mutex::scoped_lock l(m_mutex);
-
-	//close those files have access time over the threshold
-	sort(file_pool2.begin(), file_pool2.end(), least_access());
+	list<FileItem *> closing;
+	{
+		std::lock_guard<std::mutex> l(m_mutex);
 
-	vector<FileItem *>::iterator it2 = lower_bound(file_pool2.begin(), file_pool2.end(), ACCESS_TIME_THRESHOLD, access_time_cmp());
-
-	if(it2 != file_pool2.begin()) {
-		list<FileItem *> expired_file;
-		copy(file_pool2.begin(), it2, back_inserter(expired_file));
-		list<FileItem *>::const_iterator lit;
-		for(lit = expired_file.begin(); lit!=expired_file.end(); ++lit) {
-			string filename = (*lit)->get_path();
-			close_file(filename);
+		closing.swap(unpinned);
+		for(list<FileItem *>::iterator it = closing.begin(); it != closing.end(); ++it) {
+			file_pool.erase((*it)->get_path());
 		}
 	}
 
-	return 0;
+	for(list<FileItem *>::iterator it = closing.begin(); it != closing.end(); ++it) {
+		delete *it;
+	}
 }
 
-int HDFCache::force_clean()
+void HDFCache::set_capacity(size_t capacity)
 {
-	boost::mutex::scoped_lock l(m_mutex);
+	list<FileItem *> closing;
+	{
+		std::lock_guard<std::mutex> l(m_mutex);
 
-	//close 1/10 oldest files when cache size reach limit
-	if(file_pool2.size() >= CACHESIZE) {
-		sort(file_pool2.begin(), file_pool2.end(), least_access());
-		for(size_t i=0; i<=CACHESIZE/10; ++i) {
-			close_file(file_pool2.front()->get_path());
-		}
+		CACHESIZE = capacity;
+		evict(closing);
 	}
 
-	return 0;
+	for(list<FileItem *>::iterator it = closing.begin(); it != closing.end(); ++it) {
+		delete *it;
+	}
+}
+
+size_t HDFCache::get_capacity() const
+{
+	std::lock_guard<std::mutex> l(m_mutex);
+
+	return CACHESIZE;
+}
+
+size_t HDFCache::get_size()
+{
+	std::lock_guard<std::mutex> l(m_mutex);
+
+	return file_pool.size();
+}
+
+void HDFCache::reset_stats()
+{
+	hits = 0;
+	misses = 0;
+	evictions = 0;
+}
+
+/**The caller must hold the lock. If every file is pinned the cache is
+ * allowed to grow past its limit until some are released*/
+void HDFCache::evict(list<FileItem *> & closing)
+{
+	while(file_pool.size() > CACHESIZE && !unpinned.empty()) {
+		FileItem * hdfitem = unpinned.back();
+		unpinned.pop_back();
+		file_pool.erase(hdfitem->get_path());
+		closing.push_back(hdfitem);
+		++evictions;
+	}
 }
 
 #endif	//HDFIO_CACHE
@@ -37,16 +37,14 @@
 #include <string>
 #include <cstdio>
 #include <ctime>
-#include <functional>
+#include <list>
+#include <mutex>
+#include <atomic>
+#include <unordered_map>
 
 #include "imageio.h"
 
 using std::string;
-using std::binary_function;
-
-const static int CHECK_INTERVAL = 5;	//seconds for thread to check if the opened file need been closed
-const static int ACCESS_TIME_THRESHOLD = 30;	//seconds since the last access to close HDF image file
-const static int ACCESS_WRITE_TIME_THRESHOLD = 5;	//seconds since the last access to close HDF image file
 
 namespace EMAN
 {
@@ -81,17 +79,58 @@ private:
 	bool		_readonly;	//Is the file is opened in read only mode
 };
 
-/**A file cache for HDF5 I/O object. A background thread will routinely check the file
- * cache to close those files have expired.*/
+/**A least recently used cache of open HDF5 I/O objects.
+ *
+ * Files are reference counted. get_file() and add_file() pin the file, and each
+ * of them must be matched by a call to unpin_file() when the caller is done with it.
+ * A pinned file is never closed by the cache. Files are only closed when a new file
+ * is added and the cache is over its size limit, in which case the least recently
+ * used unpinned files are closed. There is no background thread, so a file can't be
+ * closed behind the back of a running job.
+ *
+ * The lock only protects a hash lookup and a few list pointer updates. Files are
+ * never opened or closed while it is held.*/
 class HDFCache {
 public:
 	static HDFCache *instance();
 
-	//file name is a full path name
+	/**Find an open file and pin it
+	 * @param filename full path name of the file
+	 * @return the cached file, or 0 if it isn't in the cache */
 	FileItem * get_file(const string& filename);
 
+	/**Add a newly opened file to the cache, pinned. The cache takes ownership of newfile.
+	 * @return 0 on success, -1 if the file is already in the cache (newfile is not added) */
 	int add_file(FileItem * newfile);
 
+	/**Release a file obtained from get_file() or add_file(). Once a file is
+	 * unpinned as many times as it was pinned it may be closed by the cache */
+	void unpin_file(FileItem * file);
+
+	/**Unpin the cached file whose ImageIO is io
+	 * @return true if io belongs to the cache, false if it doesn't and the caller still owns it */
+	bool unpin_imageio(const string& filename, const ImageIO * io);
+
+	/**Close a file immediately, if it isn't pinned
+	 * @return 0 if the file was closed, -1 if it is pinned or not in the cache */
+	int close_file(const string& filename);
+
+	/**Close all unpinned files */
+	void clear();
+
+	/**Set the maximum number of open files. By default this is half of the
+	 * file descriptor limit of the process */
+	void set_capacity(size_t capacity);
+	size_t get_capacity() const;
+
+	/**The number of files currently in the cache, pinned or not */
+	size_t get_size();
+
+	size_t get_hits() const { return hits; }
+	size_t get_misses() const { return misses; }
+	size_t get_evictions() const { return evictions; }
+	void reset_stats();
+
 private:
 	HDFCache();
 	HDFCache(const HDFCache&);
@@ -99,37 +138,29 @@ private:
 
 	static HDFCache * _instance;
 
-	//Primary file handle container for fast accessing by file name
-	typedef boost::unordered_map<string, FileItem *> MyHashtable;
-	MyHashtable file_pool;
+	struct Entry {
+		FileItem * item;
+		int pins;
+		std::list<FileItem *>::iterator lru;	//position in unpinned, valid when pins==0
+	};
 
-	//Secondary file handle container for fast sorting to close those files expired
-	vector<FileItem *> file_pool2;
+	//all cached files, by full path name
+	typedef std::unordered_map<string, Entry> MyHashtable;
+	MyHashtable file_pool;
 
-	boost::thread	_thread;
-	boost::mutex 	m_mutex;
+	//unpinned files, most recently used first. Eviction takes from the back
+	std::list<FileItem *> unpinned;
 
-	size_t CACHESIZE;		//size limit for the HDF file cache, half of the file descriptor limit per process
+	mutable std::mutex m_mutex;
 
-	//These functions are running in the thread
-	int purge_file();		//purge the file has last access time >= threshold
-	int force_clean();		//close some files when the cache reach it's size limit
-	void cache_routine();	//function for background thread
-	int close_file(const string& filename);
+	size_t CACHESIZE;		//size limit for the HDF file cache
 
-	//functor for sorting file pointer by access time
-	struct least_access : public binary_function<FileItem *, FileItem *, bool>{
-		bool operator()(FileItem * x, FileItem * y) const {
-			return x->get_timestamp() < y->get_timestamp();
-		}
-	};
+	std::atomic<size_t> hits;
+	std::atomic<size_t> misses;
+	std::atomic<size_t> evictions;
 
-	//functor for finding those files have access time over the threshold
-	struct access_time_cmp : public binary_function<FileItem *, int, bool>{
-		bool operator()(FileItem * f, int interval) const {
-			return f->get_timestamp() < time(0)-ACCESS_TIME_THRESHOLD;
-		}
-	};
+	//removes least recently used unpinned files until the cache fits, returns them to be closed
+	void evict(std::list<FileItem *> & closing);
 };
 
 }
@@ -39,10 +39,15 @@
 #include "emassert.h"
 #include "transform.h"
 #include "ctf.h"
+#include "util.h"
 
 #include <iostream>
 #include <cstring>
+#include <cmath>
+#include <limits>
+#include <algorithm>
 #include <inttypes.h>
+#include <zlib.h>
 
 #ifndef WIN32
 	#include <sys/param.h>
@@ -67,11 +72,23 @@ using namespace EMAN;
 
 static const int ATTR_NAME_LEN = 128;
 
+static const int STACK_HEADER_BLOCK = 4096;	// rows per header chunk and per read cache block
+static const int STACK_PENDING_MAX = 1024;	// buffered header rows before a write to the file
+static const size_t STACK_CHUNK_BYTES = 2*1024*1024;	// target size of one data chunk
+
+std::recursive_mutex & HdfIO2::hdf_mutex()
+{
+	static std::recursive_mutex m;
+	return m;
+}
+
 HdfIO2::HdfIO2(const string & fname, IOMode rw)
 :	ImageIO(fname, rw), nx(1), ny(1), nz(1), is_exist(false),
 	file(-1), group(-1),
-	rendermin(0.0), rendermax(0.0), renderbits(16), renderlevel(1)
+	rendermin(0.0), rendermax(0.0), renderbits(16), renderlevel(1),
+	stack_group(-1), stack_data(-1), stack_n(0)
 {
+	std::lock_guard<std::recursive_mutex> lock(hdf_mutex());
 	H5dont_atexit();
 	accprop=H5Pcreate(H5P_FILE_ACCESS);
 
@@ -95,6 +112,22 @@ HdfIO2::HdfIO2(const string & fname, IOMode rw)
 
 HdfIO2::~HdfIO2()
 {
+	std::lock_guard<std::recursive_mutex> lock(hdf_mutex());
+	if (stack_data >= 0) {
+		try {
+			stack_flush_headers();
+		}
+		catch (...) {
+			LOGERR("HDF5 stack: error writing headers to %s", filename.c_str());
+		}
+		for (map<string, StackColumn>::iterator it=stack_cols.begin(); it!=stack_cols.end(); ++it) {
+			H5Dclose(it->second.ds);
+			if (it->second.types >= 0) H5Dclose(it->second.types);
+		}
+		H5Dclose(stack_data);
+	}
+	if (stack_group >= 0) H5Gclose(stack_group);
+
 	H5Sclose(simple_space);
 	H5Pclose(accprop);
    if (group >= 0) {
@@ -114,6 +147,7 @@ HdfIO2::~HdfIO2()
 // This reads an already opened attribute and returns the results as an EMObject
 // The attribute is not closed
 	EMObject HdfIO2::read_attr(hid_t attr) {
+	std::lock_guard<std::recursive_mutex> lock(hdf_mutex());
 	hid_t type = H5Aget_type(attr);
 	hid_t spc = H5Aget_space(attr);
 	H5T_class_t cls = H5Tget_class(type);
@@ -246,6 +280,7 @@ HdfIO2::~HdfIO2()
 // This writes an attribute with specified name to a given open object
 // The attribute is opened and closed. returns 0 on success
 int HdfIO2::write_attr(hid_t loc,const char *name,EMObject obj) {
+	std::lock_guard<std::recursive_mutex> lock(hdf_mutex());
 	hid_t type=0;
 	hid_t spc=0;
 	hsize_t dims=1;
@@ -447,6 +482,7 @@ int HdfIO2::write_attr(hid_t loc,const char *name,EMObject obj) {
 // future. At the moment, there is only a single dataset in each group.
 void HdfIO2::init()
 {
+	std::lock_guard<std::recursive_mutex> lock(hdf_mutex());
 	ENTERFUNC;
 
 	if (initialized) {
@@ -510,6 +546,8 @@ void HdfIO2::init()
 		}
 
 	}
+
+	stack_init();
 	initialized = true;
 	EXITFUNC;
 }
@@ -517,6 +555,7 @@ void HdfIO2::init()
 // If this version of init() returns -1, then we have an old-style HDF5 file
 int HdfIO2::init_test()
 {
+	std::lock_guard<std::recursive_mutex> lock(hdf_mutex());
 	ENTERFUNC;
 
 	if (initialized) {
@@ -592,9 +631,36 @@ herr_t h5_iter_attr_del( hid_t igrp, const char *attr_name, const H5A_info_t *ai
 }
 
 
+// Adjusts the size and origin in a header for reading a region of the image
+static void region_header(Dict & dict, const Region * area)
+{
+	dict["nx"] = area->get_width();
+	dict["ny"] = area->get_height();
+	dict["nz"] = area->get_depth();
+
+	if (dict.has_key("apix_x") && dict.has_key("apix_y") && dict.has_key("apix_z"))
+	{
+		if (dict.has_key("origin_x") && dict.has_key("origin_y") && dict.has_key("origin_z"))
+		{
+			float xorigin = dict["origin_x"];
+			float yorigin = dict["origin_y"];
+			float zorigin = dict["origin_z"];
+
+			float apix_x = dict["apix_x"];
+			float apix_y = dict["apix_y"];
+			float apix_z = dict["apix_z"];
+
+			dict["origin_x"] = xorigin + apix_x * area->origin[0];
+			dict["origin_y"] = yorigin + apix_y * area->origin[1];
+			dict["origin_z"] = zorigin + apix_z * area->origin[2];
+		}
+	}
+}
+
 // Reads all of the attributes from the /MDF/images/<imgno> group
 int HdfIO2::read_header(Dict & dict, int image_index, const Region * area, bool)
 {
+	std::lock_guard<std::recursive_mutex> lock(hdf_mutex());
 	ENTERFUNC;
 	init();
 
@@ -611,6 +677,16 @@ int HdfIO2::read_header(Dict & dict, int image_index, const Region * area, bool)
 	printf("HDF: read_head %d\n", image_index);
 #endif
 
+	if (stack_data >= 0) {
+		stack_read_header(dict, image_index);
+		if (area) {
+			check_region(area, IntSize(dict["nx"], dict["ny"], dict["nz"]), false, false);
+			region_header(dict, area);
+		}
+		EXITFUNC;
+		return 0;
+	}
+
 	int i;
 
 	// Each image is in a group for later expansion. Open the group
@@ -675,61 +751,134 @@ int HdfIO2::read_header(Dict & dict, int image_index, const Region * area, bool)
 
 	if (area) {
 		check_region(area, IntSize(dict["nx"], dict["ny"], dict["nz"]), false, false);
-
-		dict["nx"] = area->get_width();
-		dict["ny"] = area->get_height();
-		dict["nz"] = area->get_depth();
-
-		if (dict.has_key("apix_x") && dict.has_key("apix_y") && dict.has_key("apix_z"))
-		{
-			if (dict.has_key("origin_x") && dict.has_key("origin_y") && dict.has_key("origin_z"))
-			{
-				float xorigin = dict["origin_x"];
-				float yorigin = dict["origin_y"];
-				float zorigin = dict["origin_z"];
-
-				float apix_x = dict["apix_x"];
-				float apix_y = dict["apix_y"];
-				float apix_z = dict["apix_z"];
-
-				dict["origin_x"] = xorigin + apix_x * area->origin[0];
-				dict["origin_y"] = yorigin + apix_y * area->origin[1];
-				dict["origin_z"] = zorigin + apix_z * area->origin[2];
-			}
-		}
+		region_header(dict, area);
 	}
 
 	H5Gclose(igrp);
 
 	//Get the data type from data set, HDF5 file header attribute 'datatype' may be wrong
+	int datatype = image_datatype(image_index);
+	if (datatype >= 0) dict["datatype"] = datatype;
+
+	EXITFUNC;
+	return 0;
+}
+
+int HdfIO2::image_datatype(int image_index)
+{
+	char ipath[50];
 	sprintf(ipath,"/MDF/images/%d/image",image_index);
 	hid_t ds=H5Dopen(file,ipath);
 
 	// FIXME - This isn't valid any more, since we support signed and unsigned, and have compression
+	int datatype = -1;
 	if (ds > 0) {	// ds > 0 means successfully opened the dataset
 		hid_t dt = H5Dget_type(ds);
+		size_t size = H5Tget_size(dt);
+		H5Tclose(dt);
 
-		switch(H5Tget_size(dt)) {
+		switch(size) {
 		case 4:
-			dict["datatype"] = (int)EMUtil::EM_FLOAT;
+			datatype = (int)EMUtil::EM_FLOAT;
 			break;
 		case 2:
-			dict["datatype"] = (int)EMUtil::EM_USHORT;
+			datatype = (int)EMUtil::EM_USHORT;
 			break;
 		case 1:
-			dict["datatype"] = (int)EMUtil::EM_UCHAR;
+			datatype = (int)EMUtil::EM_UCHAR;
 			break;
 		default:
+			H5Dclose(ds);
 			throw ImageReadException(filename, "EMAN does not support this data type.");
 		}
-
-		H5Tclose(dt);
 	}
 
 	H5Dclose(ds);
 
+	return datatype;
+}
+
+void HdfIO2::read_header_columns(const vector<string> & keys, int first, int n,
+								 vector< vector<EMObject> > & values)
+{
+	std::lock_guard<std::recursive_mutex> lock(hdf_mutex());
+	ENTERFUNC;
+	init();
+
+	values.assign(keys.size(), vector<EMObject>(n));
+	if (n <= 0) return;
+
+	if (stack_data >= 0) {
+		if (first < 0 || first+n > stack_n) throw ImageReadException(filename, "Image range does not exist");
+		stack_flush_headers();
+
+		for (size_t k=0; k<keys.size(); k++) {
+			const string & key = keys[k];
+			map<string, StackColumn>::iterator ci = stack_cols.find(key);
+
+			// same precedence as stack_read_header
+			if (key == "nx" || key == "ny" || key == "nz" || key == "datatype") {
+				int v = key=="nx" ? (int)nx : key=="ny" ? (int)ny : key=="nz" ? (int)nz : (int)EMUtil::EM_FLOAT;
+				values[k].assign(n, EMObject(v));
+			}
+			else if (ci != stack_cols.end()) {
+				for (int i=0; i<n; i++) {
+					if (!stack_header_value(key, ci->second, first+i, values[k][i]) && meta_attr_dict.has_key(key)) {
+						values[k][i] = meta_attr_dict[key];
+					}
+				}
+			}
+			else if (meta_attr_dict.has_key(key)) {
+				values[k].assign(n, meta_attr_dict[key]);
+			}
+		}
+
+		EXITFUNC;
+		return;
+	}
+
+	vector<string> names(keys.size());
+	for (size_t k=0; k<keys.size(); k++) names[k] = "EMAN." + keys[k];
+
+	for (int i=0; i<n; i++) {
+		char ipath[50];
+		sprintf(ipath,"/MDF/images/%d", first+i);
+		hid_t igrp=H5Gopen(file, ipath);
+
+		if (igrp<0) {
+			char msg[40];
+			sprintf(msg,"Image %d does not exist",first+i);
+			throw ImageReadException(filename,msg);
+		}
+
+		for (size_t k=0; k<keys.size(); k++) {
+			if (H5Aexists(igrp, names[k].c_str()) > 0) {
+				hid_t attr=H5Aopen_name(igrp, names[k].c_str());
+				try {
+					values[k][i]=read_attr(attr);
+					if (keys[k] == "ctf") values[k][i].force_CTF();
+				}
+				catch(...) {
+					printf("HDF: Error reading HDF attribute %s\n",keys[k].c_str());
+				}
+				H5Aclose(attr);
+			}
+			else if (meta_attr_dict.has_key(keys[k])) {
+				values[k][i] = meta_attr_dict[keys[k]];
+			}
+		}
+		H5Gclose(igrp);
+
+		// as in read_header, the dataset overrides any stored datatype
+		for (size_t k=0; k<keys.size(); k++) {
+			if (keys[k] == "datatype") {
+				int datatype = image_datatype(first+i);
+				if (datatype >= 0) values[k][i] = datatype;
+			}
+		}
+	}
+
 	EXITFUNC;
-	return 0;
 }
 
 // This erases any existing attributes from the image group
@@ -737,6 +886,7 @@ int HdfIO2::read_header(Dict & dict, int image_index, const Region * area, bool)
 // won't be any, so this should be harmless.
 int HdfIO2::erase_header(int image_index)
 {
+	std::lock_guard<std::recursive_mutex> lock(hdf_mutex());
 	ENTERFUNC;
 
 	if (image_index < 0) return 0; // image_index<0 for appending image, no need for erasing
@@ -784,11 +934,14 @@ int HdfIO2::erase_header(int image_index)
 
 // TODO : incomplete
 int HdfIO2::read_data_8bit(unsigned char *data, int image_index, const Region *area, bool is_3d, float minval, float maxval) {
+	std::lock_guard<std::recursive_mutex> lock(hdf_mutex());
 	ENTERFUNC;
 #ifdef DEBUGHDF
 	printf("HDF: read_data_8bit %d\n",image_index);
 #endif
 
+	if (stack_data >= 0) throw ImageReadException(filename, "8 bit reading is not supported for HDF5 stacks");
+
 	char ipath[50];
 	sprintf(ipath,"/MDF/images/%d/image",image_index);
 	hid_t ds = H5Dopen(file,ipath);
@@ -1028,11 +1181,18 @@ int HdfIO2::read_data_8bit(unsigned char *data, int image_index, const Region *a
 
 int HdfIO2::read_data(float *data, int image_index, const Region *area, bool)
 {
+	std::lock_guard<std::recursive_mutex> lock(hdf_mutex());
 	ENTERFUNC;
 #ifdef DEBUGHDF
 	printf("HDF: read_data %d\n",image_index);
 #endif
 
+	if (stack_data >= 0) {
+		stack_read_data(data, image_index, area);
+		EXITFUNC;
+		return 0;
+	}
+
 	char ipath[50];
 	sprintf(ipath,"/MDF/images/%d/image",image_index);
 	hid_t ds = H5Dopen(file,ipath);
@@ -1281,6 +1441,7 @@ int HdfIO2::read_data(float *data, int image_index, const Region *area, bool)
 int HdfIO2::write_header(const Dict & dict, int image_index, const Region* area,
 						EMUtil::EMDataType dt, bool endian)
 {
+	std::lock_guard<std::recursive_mutex> lock(hdf_mutex());
 #ifdef DEBUGHDF
 	printf("HDF: write_head %d\n",image_index);
 #endif
@@ -1289,6 +1450,28 @@ int HdfIO2::write_header(const Dict & dict, int image_index, const Region* area,
 
 	init();
 
+	// A new file may be written in the stack layout, see hdfio2.h
+	if (stack_data < 0 && dict.has_key("hdf_stack") && (int)dict["hdf_stack"] && get_nimg() == 0) {
+		nx = (int)dict["nx"];
+		ny = (int)dict["ny"];
+		nz = (int)dict["nz"];
+		if (dict.has_key("render_compress_level")) renderlevel=(int)dict["render_compress_level"];
+		stack_create();
+	}
+
+	if (stack_data >= 0) {
+		if (area) throw ImageWriteException(filename, "Region writing is not supported for HDF5 stacks");
+		if ((int)dict["nx"] != (int)nx || (int)dict["ny"] != (int)ny || (int)dict["nz"] != (int)nz) {
+			throw ImageDimensionException("All images in an HDF5 stack must be the same size");
+		}
+		if (image_index < 0) image_index = stack_n;
+		if (image_index >= stack_n) stack_n = image_index+1;
+		stack_pending[image_index] = dict;
+		if ((int)stack_pending.size() >= STACK_PENDING_MAX) stack_flush_headers();
+		EXITFUNC;
+		return 0;
+	}
+
 	nx = (int)dict["nx"];
 	ny = (int)dict["ny"];
 	nz = (int)dict["nz"];
@@ -1405,12 +1588,22 @@ int HdfIO2::write_header(const Dict & dict, int image_index, const Region* area,
 int HdfIO2::write_data(float *data, int image_index, const Region* area,
 					  EMUtil::EMDataType dt, bool)
 {
+	std::lock_guard<std::recursive_mutex> lock(hdf_mutex());
 	ENTERFUNC;
 
 #ifdef DEBUGHDF
 	printf("HDF: write_data %d\n",image_index);
 #endif
 
+	// stacks are always stored as float, compressed losslessly
+	if (stack_data >= 0) {
+		if (area) throw ImageWriteException(filename, "Region writing is not supported for HDF5 stacks");
+		if (image_index < 0) image_index = stack_n-1;
+		stack_write_data(data, image_index);
+		EXITFUNC;
+		return 0;
+	}
+
 	if (image_index < 0) {
 		hid_t attr=H5Aopen_name(group,"imageid_max");
 		image_index = read_attr(attr);
@@ -1965,7 +2158,10 @@ int HdfIO2::write_data(float *data, int image_index, const Region* area,
 
 int HdfIO2::get_nimg()
 {
+	std::lock_guard<std::recursive_mutex> lock(hdf_mutex());
 	init();
+	if (stack_data >= 0) return stack_n;
+
 	hid_t attr=H5Aopen_name(group,"imageid_max");
 	int n = read_attr(attr);
 	H5Aclose(attr);
@@ -1973,6 +2169,746 @@ int HdfIO2::get_nimg()
 	return n+1;
 }
 
+/*********************** Stack layout ***********************/
+// In the stack layout all images share a single chunked dataset, /MDF/stack/data (N,nz,ny,nx),
+// and each header key is a dataset with one row per image under /MDF/stack/header.
+// Numbers are stored as doubles, with the EMObject type of each one in a matching dataset under
+// /MDF/stack/header_type, where 0 (UNKNOWN) marks an absent value, so a column may mix types.
+// Other absent values are stored as the fill value of the column (a NULL string, NaN
+// transform or an empty array).
+
+// storage classes for header columns
+enum { STACK_NUM=0, STACK_STR=1, STACK_XFORM=2, STACK_ARRAY=3 };
+
+
+static int stack_kind(int emtype)
+{
+	switch (emtype) {
+	case EMObject::BOOL:
+	case EMObject::SHORT:
+	case EMObject::UNSIGNEDINT:
+	case EMObject::INT:
+	case EMObject::FLOAT:
+	case EMObject::DOUBLE:
+		return STACK_NUM;
+	case EMObject::STRING:
+	case EMObject::CTF:
+		return STACK_STR;
+	case EMObject::TRANSFORM:
+		return STACK_XFORM;
+	case EMObject::FLOATARRAY:
+	case EMObject::INTARRAY:
+		return STACK_ARRAY;
+	default:
+		return -1;
+	}
+}
+
+// keys which must never be copied to a new header, see write_header()
+static bool is_render_key(const string & key)
+{
+	return key=="stored_rendermin" || key=="stored_rendermax" || key=="stored_renderbits" ||
+		key=="render_min" || key=="render_max" || key=="render_bits";
+}
+
+// access properties for the data dataset. The chunk cache holds several chunks so sequential
+// reads decompress each chunk only once
+static hid_t stack_access_plist(size_t chunkbytes)
+{
+	hid_t dapl = H5Pcreate(H5P_DATASET_ACCESS);
+	size_t nbytes = 64*1024*1024;
+	if (nbytes < 4*chunkbytes) nbytes = 4*chunkbytes;
+	H5Pset_chunk_cache(dapl, 12421, nbytes, 1.0);
+	return dapl;
+}
+
+static hid_t stack_file_type(int kind)
+{
+	hid_t type;
+	switch (kind) {
+	case STACK_NUM:
+		return H5Tcopy(H5T_NATIVE_DOUBLE);
+	case STACK_STR:
+		type = H5Tcopy(H5T_C_S1);
+		H5Tset_size(type, H5T_VARIABLE);
+		return type;
+	case STACK_XFORM:
+		return H5Tcopy(H5T_NATIVE_FLOAT);
+	default:
+		return H5Tvlen_create(H5T_NATIVE_DOUBLE);
+	}
+}
+
+// the type used for the column in memory
+static hid_t stack_mem_type(int kind)
+{
+	return stack_file_type(kind);
+}
+
+// Selects rows [first,first+n) of a column in the file, returns the matching memory dataspace
+static hid_t stack_select_rows(hid_t fspc, int kind, int first, int n)
+{
+	hsize_t start[2] = { (hsize_t)first, 0 };
+	hsize_t count[2] = { (hsize_t)n, 12 };
+	int rank = (kind==STACK_XFORM ? 2 : 1);
+	H5Sselect_hyperslab(fspc, H5S_SELECT_SET, start, NULL, count, NULL);
+	return H5Screate_simple(rank, count, NULL);
+}
+
+bool HdfIO2::is_stack()
+{
+	std::lock_guard<std::recursive_mutex> lock(hdf_mutex());
+	init();
+	return stack_data >= 0;
+}
+
+// Opens the stack layout, if present. Called from init()
+void HdfIO2::stack_init()
+{
+	stack_group = H5Gopen2(file, "/MDF/stack", H5P_DEFAULT);
+	if (stack_group < 0) return;
+
+	hid_t ds = H5Dopen2(stack_group, "data", H5P_DEFAULT);
+	if (ds < 0) throw ImageReadException(filename, "HDF5 stack has no data (/MDF/stack/data)");
+	hid_t cpl = H5Dget_create_plist(ds);
+	hsize_t chunk[4] = { 1, 1, 1, 1 };
+	H5Pget_chunk(cpl, 4, chunk);
+	H5Pclose(cpl);
+	H5Dclose(ds);
+
+	hid_t dapl = stack_access_plist(chunk[0]*chunk[1]*chunk[2]*chunk[3]*sizeof(float));
+	stack_data = H5Dopen2(stack_group, "data", dapl);
+	H5Pclose(dapl);
+
+	hsize_t dims[4];
+	hid_t spc = H5Dget_space(stack_data);
+	H5Sget_simple_extent_dims(spc, dims, NULL);
+	H5Sclose(spc);
+	stack_n = (int)dims[0];
+	nz = dims[1];
+	ny = dims[2];
+	nx = dims[3];
+
+	// open all of the header columns
+	hid_t hgrp = H5Gopen2(stack_group, "header", H5P_DEFAULT);
+	if (hgrp < 0) return;
+	hid_t tgrp = -1;
+	if (H5Lexists(stack_group, "header_type", H5P_DEFAULT) > 0) tgrp = H5Gopen2(stack_group, "header_type", H5P_DEFAULT);
+	hsize_t ncol = 0;
+	H5Gget_num_objs(hgrp, &ncol);
+	char name[ATTR_NAME_LEN];
+	for (hsize_t i=0; i<ncol; i++) {
+		H5Gget_objname_by_idx(hgrp, i, name, ATTR_NAME_LEN);
+		StackColumn col;
+		col.ds = H5Dopen2(hgrp, name, H5P_DEFAULT);
+		col.types = -1;
+		if (col.ds < 0) continue;
+		hid_t attr = H5Aopen_name(col.ds, "emtype");
+		col.emtype = EMObject::UNKNOWN;
+		if (attr >= 0) {
+			col.emtype = (int)read_attr(attr);
+			H5Aclose(attr);
+		}
+		col.kind = stack_kind(col.emtype);
+		col.cache_first = -1;
+		if (col.kind < 0) {
+			H5Dclose(col.ds);
+			continue;
+		}
+		if (col.kind == STACK_NUM && tgrp >= 0 && H5Lexists(tgrp, name, H5P_DEFAULT) > 0) {
+			col.types = H5Dopen2(tgrp, name, H5P_DEFAULT);
+		}
+		stack_cols[name] = col;
+	}
+	if (tgrp >= 0) H5Gclose(tgrp);
+	H5Gclose(hgrp);
+}
+
+// Creates the stack layout in an empty file. nx, ny, nz and renderlevel must already be set from
+// the first header
+void HdfIO2::stack_create()
+{
+	stack_group = H5Gcreate2(file, "/MDF/stack", H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+	if (stack_group < 0) throw ImageWriteException(filename, "Unable to add /MDF/stack to HDF5 file");
+	hid_t hgrp = H5Gcreate2(stack_group, "header", H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+	if (hgrp < 0) throw ImageWriteException(filename, "Unable to add /MDF/stack/header to HDF5 file");
+	H5Gclose(hgrp);
+	hgrp = H5Gcreate2(stack_group, "header_type", H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+	if (hgrp < 0) throw ImageWriteException(filename, "Unable to add /MDF/stack/header_type to HDF5 file");
+	H5Gclose(hgrp);
+
+	// Chunks hold a whole number of images, ~2 MB each. Large images/volumes are split along z
+	hsize_t dims[4] = { 0, nz, ny, nx };
+	hsize_t maxdims[4] = { H5S_UNLIMITED, nz, ny, nx };
+	hsize_t chunk[4] = { 1, nz, ny, nx };
+	size_t imgbytes = (size_t)nx*ny*nz*sizeof(float);
+	if (imgbytes <= STACK_CHUNK_BYTES) {
+		chunk[0] = STACK_CHUNK_BYTES/imgbytes;
+		if (chunk[0] > 256) chunk[0] = 256;
+	}
+	else {
+		chunk[1] = STACK_CHUNK_BYTES/((size_t)nx*ny*sizeof(float));
+		if (chunk[1] < 1) chunk[1] = 1;
+	}
+
+	hid_t dcpl = H5Pcreate(H5P_DATASET_CREATE);
+	H5Pset_chunk(dcpl, 4, chunk);
+	if (renderlevel > 0) {
+		H5Pset_shuffle(dcpl);
+		H5Pset_deflate(dcpl, renderlevel);
+	}
+	hid_t dapl = stack_access_plist(chunk[0]*chunk[1]*chunk[2]*chunk[3]*sizeof(float));
+	hid_t spc = H5Screate_simple(4, dims, maxdims);
+	stack_data = H5Dcreate2(stack_group, "data", H5T_NATIVE_FLOAT, spc, H5P_DEFAULT, dcpl, dapl);
+	H5Sclose(spc);
+	H5Pclose(dapl);
+	H5Pclose(dcpl);
+	if (stack_data < 0) throw ImageWriteException(filename, "Unable to create /MDF/stack/data in HDF5 file");
+	stack_n = 0;
+}
+
+void HdfIO2::stack_set_extent(int n)
+{
+	hsize_t dims[4] = { (hsize_t)n, nz, ny, nx };
+	if (H5Dset_extent(stack_data, dims) < 0) throw ImageWriteException(filename, "Unable to extend HDF5 stack");
+}
+
+// Returns the column for key, creating it if necessary. Returns 0 if obj can't be stored in the column
+HdfIO2::StackColumn * HdfIO2::stack_column(const string & key, const EMObject & obj)
+{
+	int kind = stack_kind(obj.get_type());
+	if (kind < 0) return 0;
+
+	map<string, StackColumn>::iterator it = stack_cols.find(key);
+	if (it != stack_cols.end()) {
+		if (it->second.kind != kind) {
+			LOGWARN("HDF5 stack: '%s' has a different type than earlier images, not stored", key.c_str());
+			return 0;
+		}
+		return &it->second;
+	}
+
+	if (key.find('/') != string::npos || key == ".") {
+		LOGWARN("HDF5 stack: '%s' is not a valid header key, not stored", key.c_str());
+		return 0;
+	}
+
+	StackColumn col;
+	col.kind = kind;
+	col.emtype = obj.get_type();
+	col.cache_first = -1;
+	col.types = -1;
+
+	int rank = (kind==STACK_XFORM ? 2 : 1);
+	hsize_t dims[2] = { 0, 12 };
+	hsize_t maxdims[2] = { H5S_UNLIMITED, 12 };
+	hsize_t chunk[2] = { (hsize_t)STACK_HEADER_BLOCK, 12 };
+	hid_t ftype = stack_file_type(kind);
+	hid_t dcpl = H5Pcreate(H5P_DATASET_CREATE);
+	H5Pset_chunk(dcpl, rank, chunk);
+	if (kind == STACK_NUM || kind == STACK_XFORM) {
+		double nan = std::numeric_limits<double>::quiet_NaN();
+		H5Pset_fill_value(dcpl, H5T_NATIVE_DOUBLE, &nan);
+		if (renderlevel > 0) {
+			H5Pset_shuffle(dcpl);
+			H5Pset_deflate(dcpl, renderlevel);
+		}
+	}
+	hid_t spc = H5Screate_simple(rank, dims, maxdims);
+	string path = "header/" + key;
+	col.ds = H5Dcreate2(stack_group, path.c_str(), ftype, spc, H5P_DEFAULT, dcpl, H5P_DEFAULT);
+	H5Pclose(dcpl);
+	H5Tclose(ftype);
+	if (col.ds < 0) {
+		H5Sclose(spc);
+		throw ImageWriteException(filename, "Unable to create HDF5 stack header " + key);
+	}
+	write_attr(col.ds, "emtype", EMObject(col.emtype));
+
+	// stacks written before header_type existed keep one type per column
+	if (kind == STACK_NUM && H5Lexists(stack_group, "header_type", H5P_DEFAULT) > 0) {
+		signed char unknown = EMObject::UNKNOWN;
+		dcpl = H5Pcreate(H5P_DATASET_CREATE);
+		H5Pset_chunk(dcpl, 1, chunk);
+		H5Pset_fill_value(dcpl, H5T_NATIVE_SCHAR, &unknown);
+		if (renderlevel > 0) H5Pset_deflate(dcpl, renderlevel);
+		path = "header_type/" + key;
+		col.types = H5Dcreate2(stack_group, path.c_str(), H5T_NATIVE_SCHAR, spc, H5P_DEFAULT, dcpl, H5P_DEFAULT);
+		H5Pclose(dcpl);
+		if (col.types < 0) {
+			H5Sclose(spc);
+			H5Dclose(col.ds);
+			throw ImageWriteException(filename, "Unable to create HDF5 stack header type " + key);
+		}
+	}
+	H5Sclose(spc);
+
+	return &(stack_cols[key] = col);
+}
+
+// Writes the buffered headers to the file, one block of contiguous rows per column at a time
+void HdfIO2::stack_flush_headers()
+{
+	if (stack_pending.empty()) return;
+
+	map<int, Dict>::iterator it;
+	for (it=stack_pending.begin(); it!=stack_pending.end(); ++it) {
+		vector<string> keys = it->second.keys();
+		for (size_t k=0; k<keys.size(); k++) {
+			if (!is_render_key(keys[k])) stack_column(keys[k], it->second[keys[k]]);
+		}
+	}
+
+	map<string, StackColumn>::iterator ci;
+	for (ci=stack_cols.begin(); ci!=stack_cols.end(); ++ci) {
+		StackColumn & col = ci->second;
+		col.cache_first = -1;
+		hsize_t dims[2] = { (hsize_t)stack_n, 12 };
+		H5Dset_extent(col.ds, dims);
+		if (col.types >= 0) H5Dset_extent(col.types, dims);
+
+		hid_t mtype = stack_mem_type(col.kind);
+		hid_t fspc = H5Dget_space(col.ds);
+		const string & key = ci->first;
+
+		it = stack_pending.begin();
+		while (it != stack_pending.end()) {
+			// find a run of consecutive images
+			int first = it->first;
+			vector<const Dict *> rows;
+			while (it != stack_pending.end() && it->first == first+(int)rows.size()) {
+				rows.push_back(&it->second);
+				++it;
+			}
+			int n = rows.size();
+
+			vector<double> num;
+			vector<signed char> type;
+			vector<float> xf;
+			vector<string> str;
+			vector<const char *> strp;
+			vector< vector<double> > arr;
+			vector<hvl_t> arrp;
+			void *buf = 0;
+
+			switch (col.kind) {
+			case STACK_NUM:
+				num.assign(n, std::numeric_limits<double>::quiet_NaN());
+				type.assign(n, (signed char)EMObject::UNKNOWN);
+				for (int i=0; i<n; i++) {
+					if (rows[i]->has_key(key) && stack_kind((*rows[i])[key].get_type()) == STACK_NUM) {
+						num[i] = (double)(*rows[i])[key];
+						type[i] = (signed char)(*rows[i])[key].get_type();
+					}
+				}
+				buf = &num[0];
+				break;
+			case STACK_STR:
+				str.resize(n);
+				strp.assign(n, (const char *)0);
+				for (int i=0; i<n; i++) {
+					if (rows[i]->has_key(key) && stack_kind((*rows[i])[key].get_type()) == STACK_STR) {
+						str[i] = (const char *)(*rows[i])[key];
+						strp[i] = str[i].c_str();
+					}
+				}
+				buf = &strp[0];
+				break;
+			case STACK_XFORM:
+				xf.assign((size_t)n*12, std::numeric_limits<float>::quiet_NaN());
+				for (int i=0; i<n; i++) {
+					if (rows[i]->has_key(key) && (*rows[i])[key].get_type() == EMObject::TRANSFORM) {
+						Transform *t = (*rows[i])[key];
+						for (int r=0; r<3; r++) {
+							for (int c=0; c<4; c++) xf[i*12+r*4+c] = t->at(r,c);
+						}
+						delete t;
+					}
+				}
+				buf = &xf[0];
+				break;
+			case STACK_ARRAY:
+				arr.resize(n);
+				arrp.resize(n);
+				for (int i=0; i<n; i++) {
+					if (rows[i]->has_key(key)) {
+						EMObject obj = (*rows[i])[key];
+						if (obj.get_type() == EMObject::FLOATARRAY) {
+							vector<float> v = obj;
+							arr[i].assign(v.begin(), v.end());
+						}
+						else if (obj.get_type() == EMObject::INTARRAY) {
+							vector<int> v = obj;
+							arr[i].assign(v.begin(), v.end());
+						}
+					}
+					arrp[i].len = arr[i].size();
+					arrp[i].p = arr[i].empty() ? 0 : &arr[i][0];
+				}
+				buf = &arrp[0];
+				break;
+			}
+
+			hid_t mspc = stack_select_rows(fspc, col.kind, first, n);
+			if (H5Dwrite(col.ds, mtype, mspc, fspc, H5P_DEFAULT, buf) < 0) {
+				LOGERR("HDF5 stack: error writing header '%s'", key.c_str());
+			}
+			if (col.types >= 0) {
+				hid_t tspc = H5Dget_space(col.types);
+				H5Sclose(stack_select_rows(tspc, STACK_NUM, first, n));
+				if (H5Dwrite(col.types, H5T_NATIVE_SCHAR, mspc, tspc, H5P_DEFAULT, &type[0]) < 0) {
+					LOGERR("HDF5 stack: error writing header '%s'", key.c_str());
+				}
+				H5Sclose(tspc);
+			}
+			H5Sclose(mspc);
+		}
+		H5Sclose(fspc);
+		H5Tclose(mtype);
+	}
+
+	stack_pending.clear();
+}
+
+// Returns the value of one stack header column for one image, reading the block of rows
+// containing it if necessary. Returns false if the image has no value for this key.
+bool HdfIO2::stack_header_value(const string & key, StackColumn & col, int image_index, EMObject & val)
+{
+	// headers are read a block at a time, so reading consecutive images is cheap
+	if (col.cache_first < 0 || image_index < col.cache_first || image_index >= col.cache_first+(int)col.present.size()) {
+		hid_t fspc = H5Dget_space(col.ds);
+		hsize_t dims[2];
+		H5Sget_simple_extent_dims(fspc, dims, NULL);
+		int first = image_index - image_index%STACK_HEADER_BLOCK;
+		int n = std::min((int)dims[0]-first, STACK_HEADER_BLOCK);
+		if (n <= 0) {	// column is shorter than the stack
+			H5Sclose(fspc);
+			return false;
+		}
+
+		hid_t mtype = stack_mem_type(col.kind);
+		hid_t mspc = stack_select_rows(fspc, col.kind, first, n);
+		col.present.assign(n, 0);
+		col.str.clear();
+		col.arr.clear();
+		vector<char *> strp;
+		vector<hvl_t> arrp;
+		herr_t err = 0;
+
+		switch (col.kind) {
+		case STACK_NUM:
+			col.num.resize(n);
+			err = H5Dread(col.ds, mtype, mspc, fspc, H5P_DEFAULT, &col.num[0]);
+			if (col.types >= 0) {
+				col.type.resize(n);
+				hid_t tspc = H5Dget_space(col.types);
+				H5Sclose(stack_select_rows(tspc, STACK_NUM, first, n));
+				if (err >= 0) err = H5Dread(col.types, H5T_NATIVE_SCHAR, mspc, tspc, H5P_DEFAULT, &col.type[0]);
+				H5Sclose(tspc);
+				for (int i=0; i<n; i++) col.present[i] = col.type[i] != EMObject::UNKNOWN;
+			}
+			else {
+				for (int i=0; i<n; i++) col.present[i] = !std::isnan(col.num[i]);
+			}
+			break;
+		case STACK_XFORM:
+			col.xf.resize((size_t)n*12);
+			err = H5Dread(col.ds, mtype, mspc, fspc, H5P_DEFAULT, &col.xf[0]);
+			for (int i=0; i<n; i++) col.present[i] = !std::isnan(col.xf[i*12]);
+			break;
+		case STACK_STR:
+			strp.assign(n, (char *)0);
+			col.str.resize(n);
+			err = H5Dread(col.ds, mtype, mspc, fspc, H5P_DEFAULT, &strp[0]);
+			for (int i=0; i<n; i++) {
+				if (strp[i]) {
+					col.str[i] = strp[i];
+					col.present[i] = 1;
+				}
+			}
+			if (err >= 0) H5Dvlen_reclaim(mtype, mspc, H5P_DEFAULT, &strp[0]);
+			break;
+		case STACK_ARRAY:
+			arrp.resize(n);
+			col.arr.resize(n);
+			err = H5Dread(col.ds, mtype, mspc, fspc, H5P_DEFAULT, &arrp[0]);
+			for (int i=0; i<n && err>=0; i++) {
+				double *p = (double *)arrp[i].p;
+				col.arr[i].assign(p, p+arrp[i].len);
+				col.present[i] = arrp[i].len > 0;
+			}
+			if (err >= 0) H5Dvlen_reclaim(mtype, mspc, H5P_DEFAULT, &arrp[0]);
+			break;
+		}
+		H5Sclose(mspc);
+		H5Sclose(fspc);
+		H5Tclose(mtype);
+
+		if (err < 0) {
+			col.cache_first = -1;
+			throw ImageReadException(filename, "Error reading HDF5 stack header " + key);
+		}
+		col.cache_first = first;
+	}
+
+	int i = image_index - col.cache_first;
+	if (!col.present[i]) return false;
+
+	switch (col.kind) {
+	case STACK_NUM:
+		switch (col.types >= 0 ? (int)col.type[i] : col.emtype) {
+		case EMObject::BOOL: val = EMObject(col.num[i] != 0); break;
+		case EMObject::SHORT:
+		case EMObject::INT: val = EMObject((int)col.num[i]); break;
+		case EMObject::UNSIGNEDINT: val = EMObject((unsigned int)col.num[i]); break;
+		case EMObject::FLOAT: val = EMObject((float)col.num[i]); break;
+		default: val = EMObject(col.num[i]);
+		}
+		break;
+	case STACK_STR:
+		val = EMObject(col.str[i]);
+		if (col.emtype == EMObject::CTF) val.force_CTF();
+		break;
+	case STACK_XFORM:
+	{
+		Transform t(&col.xf[i*12]);
+		val = EMObject(&t);
+		break;
+	}
+	case STACK_ARRAY:
+		if (col.emtype == EMObject::INTARRAY) {
+			vector<int> v(col.arr[i].begin(), col.arr[i].end());
+			val = EMObject(v);
+		}
+		else {
+			vector<float> v(col.arr[i].begin(), col.arr[i].end());
+			val = EMObject(v);
+		}
+		break;
+	}
+
+	return true;
+}
+
+void HdfIO2::stack_read_header(Dict & dict, int image_index)
+{
+	if (image_index < 0 || image_index >= stack_n) {
+		char msg[40];
+		sprintf(msg,"Image %d does not exist",image_index);
+		throw ImageReadException(filename,msg);
+	}
+	stack_flush_headers();
+
+	map<string, StackColumn>::iterator ci;
+	for (ci=stack_cols.begin(); ci!=stack_cols.end(); ++ci) {
+		EMObject val;
+		if (stack_header_value(ci->first, ci->second, image_index, val)) dict[ci->first] = val;
+	}
+
+	// the data dataset is authoritative for the image size
+	dict["nx"] = (int)nx;
+	dict["ny"] = (int)ny;
+	dict["nz"] = (int)nz;
+	dict["datatype"] = (int)EMUtil::EM_FLOAT;
+}
+
+void HdfIO2::stack_read_data(float *data, int image_index, const Region * area)
+{
+	hid_t fspc = H5Dget_space(stack_data);
+	hsize_t dims[4];
+	H5Sget_simple_extent_dims(fspc, dims, NULL);
+	if (image_index < 0 || image_index >= (int)dims[0]) {
+		H5Sclose(fspc);
+		throw ImageReadException(filename, "Image does not exist");
+	}
+
+	hsize_t start[4] = { (hsize_t)image_index, 0, 0, 0 };
+	hsize_t count[4] = { 1, nz, ny, nx };
+	hsize_t mstart[4] = { 0, 0, 0, 0 };
+	hsize_t mdims[4] = { 1, nz, ny, nx };
+
+	if (area) {
+		// clip the region to the image, parts outside the image are zero
+		int org[3] = { (int)area->x_origin(), (int)area->y_origin(), (int)area->z_origin() };
+		int sz[3] = { (int)area->get_width(), (int)area->get_height(), (int)area->get_depth() };
+		const int n[3] = { (int)nx, (int)ny, (int)nz };
+		if (sz[2] < 1) { sz[2] = 1; org[2] = 0; }
+		if (sz[1] < 1) { sz[1] = 1; org[1] = 0; }
+
+		memset(data, 0, (size_t)sz[0]*sz[1]*sz[2]*sizeof(float));
+		for (int d=0; d<3; d++) {
+			int lo = std::max(org[d], 0), hi = std::min(org[d]+sz[d], n[d]);
+			if (hi <= lo) {	// entirely outside the image
+				H5Sclose(fspc);
+				return;
+			}
+			start[3-d] = lo;
+			count[3-d] = hi-lo;
+			mstart[3-d] = lo-org[d];
+			mdims[3-d] = sz[d];
+		}
+	}
+
+	H5Sselect_hyperslab(fspc, H5S_SELECT_SET, start, NULL, count, NULL);
+	hid_t mspc = H5Screate_simple(4, mdims, NULL);
+	H5Sselect_hyperslab(mspc, H5S_SELECT_SET, mstart, NULL, count, NULL);
+	herr_t err = H5Dread(stack_data, H5T_NATIVE_FLOAT, mspc, fspc, H5P_DEFAULT, data);
+	H5Sclose(mspc);
+	H5Sclose(fspc);
+	if (err < 0) throw ImageReadException(filename, "Error reading HDF5 stack data");
+}
+
+void HdfIO2::stack_write_data(float *data, int image_index)
+{
+	hid_t fspc = H5Dget_space(stack_data);
+	hsize_t dims[4];
+	H5Sget_simple_extent_dims(fspc, dims, NULL);
+	if (image_index >= (int)dims[0]) {
+		H5Sclose(fspc);
+		stack_set_extent(image_index+1);
+		fspc = H5Dget_space(stack_data);
+	}
+
+	hsize_t start[4] = { (hsize_t)image_index, 0, 0, 0 };
+	hsize_t count[4] = { 1, nz, ny, nx };
+	H5Sselect_hyperslab(fspc, H5S_SELECT_SET, start, NULL, count, NULL);
+	hid_t mspc = H5Screate_simple(4, count, NULL);
+	herr_t err = H5Dwrite(stack_data, H5T_NATIVE_FLOAT, mspc, fspc, H5P_DEFAULT, data);
+	H5Sclose(mspc);
+	H5Sclose(fspc);
+	if (err < 0) throw ImageWriteException(filename, "Error writing HDF5 stack data");
+}
+
+// Reverses the HDF5 shuffle filter, which stores byte k of every element contiguously
+static void stack_unshuffle(const unsigned char *src, unsigned char *dst, size_t nbytes, size_t esize)
+{
+	size_t nelem = nbytes/esize;
+	for (size_t k=0; k<esize; k++) {
+		const unsigned char *s = src + k*nelem;
+		for (size_t i=0; i<nelem; i++) dst[i*esize+k] = s[i];
+	}
+	memcpy(dst+nelem*esize, src+nelem*esize, nbytes-nelem*esize);	// leftover bytes are not shuffled
+}
+
+int HdfIO2::read_stack_images(int first, int n, float *data, int nthreads)
+{
+	std::lock_guard<std::recursive_mutex> lock(hdf_mutex());
+	ENTERFUNC;
+	init();
+	if (stack_data < 0) throw ImageFormatException("read_stack_images requires an HDF5 file in stack layout");
+	if (first < 0 || n < 0 || first+n > stack_n) throw InvalidValueException(first+n, "Image range is outside of the HDF5 stack");
+	if (n == 0) return 0;
+
+	size_t imgsize = (size_t)nx*ny*nz;
+	hid_t cpl = H5Dget_create_plist(stack_data);
+	hsize_t chunk[4];
+	H5Pget_chunk(cpl, 4, chunk);
+
+	// Decompression is done here only for native float chunks holding whole images, compressed with
+	// some combination of shuffle and deflate. Anything else is left to the HDF5 library
+	bool direct = (chunk[1]==nz && chunk[2]==ny && chunk[3]==nx);
+	hid_t dtype = H5Dget_type(stack_data);
+	if (H5Tequal(dtype, H5T_NATIVE_FLOAT) <= 0) direct = false;
+	H5Tclose(dtype);
+	int nfilt = H5Pget_nfilters(cpl);
+	vector<H5Z_filter_t> filters;
+	for (int i=0; i<nfilt && direct; i++) {
+		unsigned int flags;
+		size_t ncd = 0;
+		H5Z_filter_t f = H5Pget_filter2(cpl, i, &flags, &ncd, NULL, 0, NULL, NULL);
+		if (f != H5Z_FILTER_SHUFFLE && f != H5Z_FILTER_DEFLATE) direct = false;
+		filters.push_back(f);
+	}
+	H5Pclose(cpl);
+
+#if H5_VERSION_GE(1,10,3)
+	if (direct) {
+		int per = (int)chunk[0];
+		size_t chunkbytes = per*imgsize*sizeof(float);
+		int c0 = first/per, c1 = (first+n-1)/per;
+		int nt = Util::get_thread_count(nthreads, c1-c0+1);
+
+		// chunks are read serially, a batch at a time, then decompressed in parallel
+		int batch = nt*4;
+		vector< vector<unsigned char> > raw(batch);
+		vector<uint32_t> mask(batch);
+		vector<int> bad(batch);
+		for (int b0=c0; b0<=c1; b0+=batch) {
+			int nb = std::min(batch, c1-b0+1);
+			for (int b=0; b<nb; b++) {
+				hsize_t off[4] = { (hsize_t)(b0+b)*per, 0, 0, 0 };
+				hsize_t csize = 0;
+				mask[b] = 0;
+				bad[b] = 0;
+				if (H5Dget_chunk_storage_size(stack_data, off, &csize) < 0 || csize == 0) {
+					raw[b].clear();	// chunk never written, reads as zero
+					continue;
+				}
+				raw[b].resize(csize);
+				if (H5Dread_chunk(stack_data, H5P_DEFAULT, off, &mask[b], &raw[b][0]) < 0) {
+					throw ImageReadException(filename, "Error reading HDF5 stack chunk");
+				}
+			}
+
+			Util::parallel_for(nb, nt, [&](int b, int) {
+				int cfirst = (b0+b)*per;
+				int lo = std::max(first, cfirst), hi = std::min(first+n, cfirst+per);
+				float *dst = data + (lo-first)*imgsize;
+				size_t nbytes = (size_t)(hi-lo)*imgsize*sizeof(float);
+				if (raw[b].empty()) {
+					memset(dst, 0, nbytes);
+					return;
+				}
+
+				// undo the filters in reverse order, skipping any the mask says weren't applied
+				vector<unsigned char> buf = raw[b], tmp;
+				for (int i=(int)filters.size()-1; i>=0; i--) {
+					if (mask[b] & (1u<<i)) continue;
+					tmp.resize(chunkbytes);
+					if (filters[i] == H5Z_FILTER_DEFLATE) {
+						uLongf len = chunkbytes;
+						if (uncompress(&tmp[0], &len, &buf[0], buf.size()) != Z_OK) {
+							bad[b] = 1;
+							return;
+						}
+						tmp.resize(len);
+					}
+					else {
+						tmp.resize(buf.size());
+						stack_unshuffle(&buf[0], &tmp[0], buf.size(), sizeof(float));
+					}
+					buf.swap(tmp);
+				}
+				if (buf.size() != chunkbytes) {
+					bad[b] = 1;
+					return;
+				}
+				memcpy(dst, &buf[(lo-cfirst)*imgsize*sizeof(float)], nbytes);
+			});
+
+			for (int b=0; b<nb; b++) {
+				if (bad[b]) throw ImageReadException(filename, "Error decompressing HDF5 stack chunk");
+			}
+		}
+		EXITFUNC;
+		return 0;
+	}
+#endif
+
+	hid_t fspc = H5Dget_space(stack_data);
+	hsize_t start[4] = { (hsize_t)first, 0, 0, 0 };
+	hsize_t count[4] = { (hsize_t)n, nz, ny, nx };
+	H5Sselect_hyperslab(fspc, H5S_SELECT_SET, start, NULL, count, NULL);
+	hid_t mspc = H5Screate_simple(4, count, NULL);
+	herr_t err = H5Dread(stack_data, H5T_NATIVE_FLOAT, mspc, fspc, H5P_DEFAULT, data);
+	H5Sclose(mspc);
+	H5Sclose(fspc);
+	if (err < 0) throw ImageReadException(filename, "Error reading HDF5 stack data");
+
+	EXITFUNC;
+	return 0;
+}
+
 void HdfIO2::flush()
 {
 	return;
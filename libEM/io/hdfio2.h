@@ -47,8 +47,11 @@
 	#define __STDC_CONSTANT_MACROS 1
 #endif
 #include <vector>
+#include <mutex>
+#include <map>
 
 using std::vector;
+using std::map;
 
 namespace EMAN
 {
@@ -63,6 +66,18 @@ namespace EMAN
 	 * by EMAN2 with the h5check program from:
 	 * ftp:://ftp.hdfgroup.org/HDF5/special_tools/h5check/
 	 * to verify the HDF5 file is compliant with the HDF5 File Format Specification.
+	 *
+	 * Large particle stacks may optionally be written in a "stack" layout. If the
+	 * first image written to a new file has a nonzero "hdf_stack" attribute, all of
+	 * the images are stored in a single chunked 4D float dataset, /MDF/stack/data
+	 * (N, nz, ny, nx), compressed with the shuffle and deflate filters
+	 * (render_compress_level sets the deflate level, 0 disables compression).
+	 * The headers are stored as a table, one dataset per key under
+	 * /MDF/stack/header, with one row per image. All images in a stack must be the
+	 * same size. Stack files are read transparently through the normal interface,
+	 * and read_stack_images(), which EMData::read_images() uses, reads many images at
+	 * once, decompressing chunks in parallel. Numeric header values keep their own
+	 * type, so one key may hold ints for some images and floats for others.
 	 */
 	class HdfIO2 : public ImageIO
 	{
@@ -73,6 +88,12 @@ namespace EMAN
 		DEFINE_IMAGEIO_FUNC;
 		static bool is_valid(const void *first_block);
 
+		/** The HDF5 library is not thread safe, so every HdfIO2 method holds this process
+		 * wide lock while it calls into the library. Code that makes its own H5 calls on
+		 * a file opened through HdfIO2 must hold it as well. It is recursive because the
+		 * methods call one another. */
+		static std::recursive_mutex & hdf_mutex();
+
 		bool is_single_image_format() const
 		{
 			return false;
@@ -115,6 +136,25 @@ namespace EMAN
 		 * For single attribute read/write*/
 		hid_t get_fileid() const {return file;}
 
+		/** Return true if this file uses the single-dataset stack layout */
+		bool is_stack();
+
+		/** Read a contiguous range of images from a stack layout file in one call.
+		 * Compressed chunks are read from the file serially, then decompressed in
+		 * parallel directly into the output buffer.
+		 *
+		 * @param first index of the first image to read
+		 * @param n number of images to read
+		 * @param data output buffer, n*nx*ny*nz floats
+		 * @param nthreads number of decompression threads, <=0 for one per core
+		 * @return 0 on success */
+		int read_stack_images(int first, int n, float *data, int nthreads = 0);
+
+		/** Reads only the requested attributes of each image. Stack layout files read
+		 * whole columns, other files open just the named attributes of each image group. */
+		void read_header_columns(const vector<string> & keys, int first, int n,
+								 vector< vector<EMObject> > & values);
+
 	  private:
 		hsize_t nx, ny, nz;
 		bool is_exist;	//boolean to tell if the image (group) already exist(to be overwrite)
@@ -134,11 +174,45 @@ namespace EMAN
 		 * @return 0 for success*/
 		int erase_header(int image_index);
 
+		/* The EMUtil datatype of an image's dataset, -1 if it has none */
+		int image_datatype(int image_index);
+
         // render_min and render_max
 	    float rendermin;
 	    float rendermax;
 		int renderbits;
 		int renderlevel; // compression level
+
+		/* One header key in the stack layout, stored as a dataset with one row per image */
+		struct StackColumn {
+			hid_t ds;
+			hid_t types;	// EMObject type of each row of a numeric column, -1 if not stored
+			int kind;		// storage class, see hdfio2.cpp
+			int emtype;		// EMObject type to restore on read, for columns without types
+			int cache_first;	// first row held in the cache, -1 if empty
+			vector <signed char> type;
+			vector <double> num;
+			vector <float> xf;
+			vector <string> str;
+			vector <char> present;
+			vector < vector<double> > arr;
+		};
+
+		hid_t stack_group;
+		hid_t stack_data;
+		int stack_n;		// number of images in the stack, including pending headers
+		map <string, StackColumn> stack_cols;
+		map <int, Dict> stack_pending;	// headers waiting to be written, flushed in blocks
+
+		void stack_init();
+		void stack_create();
+		void stack_set_extent(int n);
+		StackColumn * stack_column(const string & key, const EMObject & obj);
+		void stack_flush_headers();
+		bool stack_header_value(const string & key, StackColumn & col, int image_index, EMObject & val);
+		void stack_read_header(Dict & dict, int image_index);
+		void stack_read_data(float *data, int image_index, const Region * area);
+		void stack_write_data(float *data, int image_index);
 	};
 }
 
@@ -55,6 +55,24 @@ void ImageIO::write_ctf(const Ctf &, int)
 
 }
 
+void ImageIO::read_header_columns(const vector<string> & keys, int first, int n,
+								  vector< vector<EMObject> > & values)
+{
+	values.assign(keys.size(), vector<EMObject>(n));
+
+	for (int i = 0; i < n; i++) {
+		Dict dict;
+		if (read_header(dict, first + i)) {
+			throw ImageReadException(filename, "imageio read header failed");
+		}
+		for (size_t k = 0; k < keys.size(); k++) {
+			if (dict.has_key(keys[k])) {
+				values[k][i] = dict[keys[k]];
+			}
+		}
+	}
+}
+
 void ImageIO::check_region(const Region * area, const FloatSize & max_size,
 						   bool is_new_file,bool inbounds_only)
 {
@@ -228,6 +228,19 @@ namespace EMAN
 		 */
 		virtual void write_ctf(const Ctf & ctf, int image_index = 0);
 
+		/** Read a few header values from a range of images, without the cost of
+		 * building a complete header for each one. The default implementation reads
+		 * each header in turn; formats which can look up single keys directly override it.
+		 *
+		 * @param keys The header keys to read.
+		 * @param first The index of the first image.
+		 * @param n The number of images.
+		 * @param values Returns n values for each key, values[k][i] is keys[k] of image
+		 *        first+i. Keys missing from an image are left as a null EMObject.
+		 */
+		virtual void read_header_columns(const vector<string> & keys, int first, int n,
+										 vector< vector<EMObject> > & values);
+
 		/** Flush the IO buffer.
 		 */
 		virtual void flush() = 0;
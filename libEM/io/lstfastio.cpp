@@ -54,10 +54,11 @@ LstFastIO::LstFastIO(const string & fname, IOMode rw)
 {
 	is_big_endian = ByteOrder::is_host_big_endian();
 	nimg = 0;
-	imageio = 0;
-	ref_filename = "";
+	line_length = 0;
+	head_length = 0;
 	last_lst_index = -1;
 	last_ref_index = -1;
+	ref_id = -1;
 }
 
 LstFastIO::~LstFastIO()
@@ -66,11 +67,7 @@ LstFastIO::~LstFastIO()
 		fclose(file);
 		file = 0;
 	}
-	ref_filename = "";
-	if(imageio) {
-		delete imageio;
-		imageio = 0;
-	}
+	LstRefPool::instance().release(ref);
 }
 
 void LstFastIO::init()
@@ -85,25 +82,40 @@ void LstFastIO::init()
 	bool is_new_file = false;
 	file = sfopen(filename, rw_mode, &is_new_file);
 
+	if (rw_mode == READ_ONLY) {
+		index = LstIndex::get(filename);
+	}
+	else {
+		LstIndex::forget(filename);
+		index = LstIndex::get_private();
+	}
+
 	if (!is_new_file) {
+		std::lock_guard<std::mutex> lock(index->mutex);
+		if (!index->scanned) {
+			char buf[MAXPATHLEN];
 
-		char buf[MAXPATHLEN];
+			if (!fgets(buf, MAXPATHLEN, file)) {
+				throw ImageReadException(filename, "first block");
+			}
 
-		if (!fgets(buf, MAXPATHLEN, file)) {
-			throw ImageReadException(filename, "first block");
-		}
+			if (!is_valid(&buf)) {
+				throw ImageReadException(filename, "invalid LST file");
+			}
 
-		if (!is_valid(&buf)) {
-			throw ImageReadException(filename, "invalid LST file");
+			fgets(buf,MAXPATHLEN,file);
+			fgets(buf,MAXPATHLEN,file);
+			index->line_length=atoi(buf+1);
+			index->head_length=ftell(file);
+			fseek(file,0L,SEEK_END);
+			long file_size=ftell(file);
+			index->nimg=(file_size-index->head_length)/index->line_length;
+			index->scanned = true;
+			rewind(file);
 		}
-
-		fgets(buf,MAXPATHLEN,file);
-		fgets(buf,MAXPATHLEN,file);
-		line_length=atoi(buf+1);
-		head_length=ftell(file);
-		fseek(file,0L,SEEK_END);
-		nimg=(ftell(file)-head_length)/line_length;
-		rewind(file);
+		line_length = index->line_length;
+		head_length = index->head_length;
+		nimg = index->nimg;
 	}
 	EXITFUNC;
 }
@@ -140,61 +152,37 @@ int LstFastIO::calc_ref_image_index(int image_index)
 	if (image_index == last_lst_index) {
 		return last_ref_index;
 	}
-	else {
-		char buf[MAXPATHLEN];
 
-		fseek(file,head_length+line_length*image_index,SEEK_SET);
-		if (!fgets(buf, MAXPATHLEN, file)) {
-			LOGERR("reach EOF in file '%s' before reading %dth image",
-				   filename.c_str(), image_index);
-			return 1;
-		}
+	int id;
+	string path;
+	{
+		std::lock_guard<std::mutex> lock(index->mutex);
+
+		if (image_index >= (int)index->line_file.size() || index->line_file[image_index] < 0) {
+			// not parsed by any reader yet
+			char buf[MAXPATHLEN];
 
-		int ref_image_index = 0;
-		char ref_image_path[MAXPATHLEN];
-		char unused[256];
-		sscanf(buf, " %d %s %[ .,0-9-]", &ref_image_index, ref_image_path, unused);
+			fseek(file,head_length+(long)line_length*image_index,SEEK_SET);
+			if (!fgets(buf, MAXPATHLEN, file)) {
+				LOGERR("reach EOF in file '%s' before reading %dth image",
+					   filename.c_str(), image_index);
+				return 1;
+			}
+			index->parse_line(image_index, buf);
+		}
 
-		char fullpath[MAXPATHLEN];
+		id = index->line_file[image_index];
+		last_ref_index = index->line_ref[image_index];
+		if (id != ref_id) path = index->paths[id];
+	}
 
-		char sep = '/';
-#ifdef WIN32
-		sep = '\\';
-#endif
-// 		if (ref_image_path[0] == sep) {
-			strcpy(fullpath, ref_image_path);
-// 		}
-// 		else {
-// 			if (strrchr(filename.c_str(), sep)) {
-// 				strcpy(fullpath, filename.c_str());
-// 			}
-// 			else {
-// #ifndef WIN32
-// 				getcwd(fullpath, MAXPATHLEN);
-// #else
-// 				//GetCurrentDirectory(MAXPATHLEN, fullpath);
-// #endif
-// 			}
-// 
-// 			char *p_basename = strrchr(fullpath, sep);
-// 			if (p_basename) {
-// 				//p_basename++;
-// 				//*p_basename = '\0';
-// 				char ssep[2];
-// 				ssep[0] = sep;
-// 				ssep[1] = '\0';
-// 				strcat(fullpath, ssep);
-// 				strcat(fullpath, ref_image_path);
-// 			}
-// 		}
-
-		ref_filename = string(fullpath);
-		if (!Util::is_file_exist(ref_filename)) throw FileAccessException(ref_filename);
-		imageio = EMUtil::get_imageio(ref_filename, rw_mode);
-
-		last_ref_index = ref_image_index;
+	if (id != ref_id) {
+		LstRefPool::instance().release(ref);
+		ref_id = -1;
+		ref = LstRefPool::instance().acquire(path);
+		ref_id = id;
 	}
-//	printf("%d\t%d\t%s\n",image_index,last_ref_index,ref_filename.c_str());
+//	printf("%d\t%d\t%s\n",image_index,last_ref_index,ref.path.c_str());
 
 	last_lst_index = image_index;
 
@@ -207,8 +195,8 @@ int LstFastIO::read_header(Dict & dict, int image_index, const Region * area, bo
 	ENTERFUNC;
 	check_read_access(image_index);
 	int ref_image_index = calc_ref_image_index(image_index);
-	int err = imageio->read_header(dict, ref_image_index, area, is_3d);
-	dict.put("data_source",ref_filename);
+	int err = ref.io->read_header(dict, ref_image_index, area, is_3d);
+	dict.put("data_source",ref.path);
 	dict.put("data_n",ref_image_index);
 	EXITFUNC;
 	return err;
@@ -218,6 +206,7 @@ int LstFastIO::write_header(const Dict &, int, const Region* , EMUtil::EMDataTyp
 {
 	ENTERFUNC;
 	fprintf(file, "%s\n# 80\n", MAGIC);
+	if (line_length == 0) line_length = 80;
 	EXITFUNC;
 	return 0;
 }
@@ -227,7 +216,7 @@ int LstFastIO::read_data(float *data, int image_index, const Region * area, bool
 	ENTERFUNC;
 	check_read_access(image_index, data);
 	int ref_image_index = calc_ref_image_index(image_index);
-	int err = imageio->read_data(data, ref_image_index, area, is_3d);
+	int err = ref.io->read_data(data, ref_image_index, area, is_3d);
 	EXITFUNC;
 	return err;
 }
@@ -237,6 +226,16 @@ int LstFastIO::write_data(float *data, int, const Region* , EMUtil::EMDataType,
 	ENTERFUNC;
 	char *data2=(char*)data;
 	if (strlen(data2)>line_length-1) throw ImageWriteException("", "Comment too long for this LSX file");
+
+	// forget any cached copy of the line being overwritten
+	long pos = ftell(file);
+	if (pos >= (long)head_length) {
+		size_t line = (pos-head_length)/line_length;
+		std::lock_guard<std::mutex> lock(index->mutex);
+		if (line < index->line_file.size()) index->line_file[line] = -1;
+		last_lst_index = -1;
+	}
+
 	fprintf(file, "%s", (char*)data);
 	for (unsigned int i=strlen(data2); i<line_length-1; i++) putc(' ',file);
 	putc('\n',file);
@@ -266,3 +265,32 @@ int LstFastIO::get_nimg()
 	init();
 	return nimg;
 }
+
+void LstFastIO::read_header_columns(const vector<string> & keys, int first, int n,
+							 vector< vector<EMObject> > & values)
+{
+	ENTERFUNC;
+	init();
+
+	vector<int> nums(n);
+	vector<string> paths(n);
+	for (int i = 0; i < n; i++) {
+		check_read_access(first + i);
+		nums[i] = calc_ref_image_index(first + i);
+		if (last_lst_index != first + i) {
+			throw ImageReadException(filename, "invalid line in list file");
+		}
+		paths[i] = ref.path;
+	}
+
+	LstRefPool::instance().read_header_columns(keys, paths, nums, values);
+
+	// values which come from the list itself
+	for (int i = 0; i < n; i++) {
+		for (size_t k = 0; k < keys.size(); k++) {
+			if (keys[k] == "data_source") values[k][i] = paths[i];
+			else if (keys[k] == "data_n") values[k][i] = nums[i];
+		}
+	}
+	EXITFUNC;
+}
@@ -33,6 +33,9 @@
 #define eman__lstiofast_h__ 1
 
 #include "imageio.h"
+#include "lstrefpool.h"
+
+#include <vector>
 
 namespace EMAN
 {
@@ -48,6 +51,11 @@ namespace EMAN
 	 *
 	 * lines have the form:
 	 * reference_image_index  reference-image-filename comments
+	 *
+	 * Each line is parsed only the first time any reader in the process accesses it, and kept
+	 * in a LstIndex shared by all readers of the file. Referenced files are kept open in the
+	 * LstRefPool, so random access to a previously seen line only costs a check of the list's
+	 * modification time when the list is opened.
 	 */
 		
 		
@@ -65,18 +73,24 @@ namespace EMAN
 			return false;
 		}
 		int get_nimg();
+
+		/** Parses the requested lines and reads the values from the referenced files,
+		 * consecutive images in the same file with one call. */
+		void read_header_columns(const vector<string> & keys, int first, int n,
+								 vector< vector<EMObject> > & values);
 	  private:
 		bool is_big_endian;
 		int nimg;
 		unsigned int line_length;
 		unsigned int head_length;
 
-		ImageIO *imageio;
-		string ref_filename;
-
 		int last_lst_index;
 		int last_ref_index;
 
+		std::shared_ptr<LstIndex> index;
+		LstRefPool::Ref ref;	// the file referenced by the last line read
+		int ref_id;		// its id in index, -1 if none
+
 		int calc_ref_image_index(int image_index);
 		static const char *MAGIC;
 	};
@@ -54,10 +54,9 @@ LstIO::LstIO(const string & fname, IOMode rw)
 {
 	is_big_endian = ByteOrder::is_host_big_endian();
 	nimg = 0;
-	imageio = 0;
-	ref_filename = "";
 	last_lst_index = -1;
 	last_ref_index = -1;
+	ref_id = -1;
 }
 
 LstIO::~LstIO()
@@ -66,11 +65,7 @@ LstIO::~LstIO()
 		fclose(file);
 		file = 0;
 	}
-	ref_filename = "";
-	if(imageio) {
-		delete imageio;
-		imageio = 0;
-	}
+	LstRefPool::instance().release(ref);
 }
 
 void LstIO::init()
@@ -85,24 +80,37 @@ void LstIO::init()
 	bool is_new_file = false;
 	file = sfopen(filename, rw_mode, &is_new_file);
 
-	if (!is_new_file) {
+	if (rw_mode == READ_ONLY) {
+		index = LstIndex::get(filename);
+	}
+	else {
+		LstIndex::forget(filename);
+		index = LstIndex::get_private();
+	}
 
-		char buf[MAXPATHLEN];
+	if (!is_new_file) {
+		std::lock_guard<std::mutex> lock(index->mutex);
+		if (!index->scanned) {
+			char buf[MAXPATHLEN];
 
-		if (!fgets(buf, MAXPATHLEN, file)) {
-			throw ImageReadException(filename, "first block");
-		}
+			if (!fgets(buf, MAXPATHLEN, file)) {
+				throw ImageReadException(filename, "first block");
+			}
 
-		if (!is_valid(&buf)) {
-			throw ImageReadException(filename, "invalid LST file");
-		}
+			if (!is_valid(&buf)) {
+				throw ImageReadException(filename, "invalid LST file");
+			}
 
-		for (nimg = 0; fgets(buf, MAXPATHLEN, file) != 0; nimg++) {
-			if (buf[0] == '#') {
-				nimg--;
+			for (long pos = ftell(file); fgets(buf, MAXPATHLEN, file) != 0; pos = ftell(file)) {
+				if (buf[0] != '#') {
+					index->line_offset.push_back(pos);
+				}
 			}
+			index->nimg = index->line_offset.size();
+			index->scanned = true;
+			rewind(file);
 		}
-		rewind(file);
+		nimg = index->nimg;
 	}
 	EXITFUNC;
 }
@@ -128,67 +136,63 @@ int LstIO::calc_ref_image_index(int image_index)
 	if (image_index == last_lst_index) {
 		return last_ref_index;
 	}
-	else {
-		char buf[MAXPATHLEN];
-		int step = image_index - last_lst_index;
 
-		if (step < 0) {
-			rewind(file);
-			step = image_index + 1;
-		}
+	int id;
+	string path;
+	{
+		std::lock_guard<std::mutex> lock(index->mutex);
+		vector<long> & line_offset = index->line_offset;
+
+		if (image_index >= (int)index->line_file.size() || index->line_file[image_index] < 0) {
+			// not parsed by any reader yet
+			char buf[MAXPATHLEN];
+
+			if (image_index >= (int)line_offset.size()) {
+				// continue scanning after the last line we know about
+				if (line_offset.empty()) {
+					rewind(file);
+				}
+				else {
+					fseek(file, line_offset.back(), SEEK_SET);
+					if (!fgets(buf, MAXPATHLEN, file)) {
+						LOGERR("reach EOF in file '%s' before reading %dth image",
+							   filename.c_str(), image_index);
+						return 1;
+					}
+				}
+
+				while ((int)line_offset.size() <= image_index) {
+					long pos = ftell(file);
+					if (!fgets(buf, MAXPATHLEN, file)) {
+						LOGERR("reach EOF in file '%s' before reading %dth image",
+							   filename.c_str(), image_index);
+						return 1;
+					}
+					if (buf[0] != '#') {
+						line_offset.push_back(pos);
+					}
+				}
+			}
 
-		for (int i = 0; i < step; i++) {
+			fseek(file, line_offset[image_index], SEEK_SET);
 			if (!fgets(buf, MAXPATHLEN, file)) {
 				LOGERR("reach EOF in file '%s' before reading %dth image",
 					   filename.c_str(), image_index);
 				return 1;
 			}
-			if (buf[0] == '#') {
-				i--;
-			}
+			index->parse_line(image_index, buf);
 		}
-		int ref_image_index = 0;
-		char ref_image_path[MAXPATHLEN];
-		char unused[256];
-		sscanf(buf, " %d %s %[ .,0-9-]", &ref_image_index, ref_image_path, unused);
 
-		char fullpath[MAXPATHLEN];
+		id = index->line_file[image_index];
+		last_ref_index = index->line_ref[image_index];
+		if (id != ref_id) path = index->paths[id];
+	}
 
-		char sep = '/';
-#ifdef WIN32
-		sep = '\\';
-#endif
-// 		if (ref_image_path[0] == sep) {
-			strcpy(fullpath, ref_image_path);
-// 		}
-// 		else {
-// 			if (strrchr(filename.c_str(), sep)) {
-// 				strcpy(fullpath, filename.c_str());
-// 			}
-// 			else {
-// #ifndef WIN32
-// 				getcwd(fullpath, MAXPATHLEN);
-// #else
-// 				//GetCurrentDirectory(MAXPATHLEN, fullpath);
-// #endif
-// 			}
-// 
-// 			char *p_basename = strrchr(fullpath, sep);
-// 			if (p_basename) {
-// 				//p_basename++;
-// 				//*p_basename = '\0';
-// 				char ssep[2];
-// 				ssep[0] = sep;
-// 				ssep[1] = '\0';
-// 				strcat(fullpath, ssep);
-// 				strcat(fullpath, ref_image_path);
-// 			}
-// 		}
-
-		ref_filename = string(fullpath);
-		imageio = EMUtil::get_imageio(ref_filename, rw_mode);
-
-		last_ref_index = ref_image_index;
+	if (id != ref_id) {
+		LstRefPool::instance().release(ref);
+		ref_id = -1;
+		ref = LstRefPool::instance().acquire(path);
+		ref_id = id;
 	}
 
 	last_lst_index = image_index;
@@ -203,8 +207,8 @@ int LstIO::read_header(Dict & dict, int image_index, const Region * area, bool i
 	init();
 	check_read_access(image_index);
 	int ref_image_index = calc_ref_image_index(image_index);
-	int err = imageio->read_header(dict, ref_image_index, area, is_3d);
-	dict["source_path"] = ref_filename;
+	int err = ref.io->read_header(dict, ref_image_index, area, is_3d);
+	dict["source_path"] = ref.path;
 	EXITFUNC;
 	return err;
 }
@@ -223,7 +227,7 @@ int LstIO::read_data(float *data, int image_index, const Region * area, bool is_
 	ENTERFUNC;
 	check_read_access(image_index, data);
 	int ref_image_index = calc_ref_image_index(image_index);
-	int err = imageio->read_data(data, ref_image_index, area, is_3d);
+	int err = ref.io->read_data(data, ref_image_index, area, is_3d);
 	EXITFUNC;
 	return err;
 }
@@ -257,3 +261,31 @@ int LstIO::get_nimg()
 	init();
 	return nimg;
 }
+
+void LstIO::read_header_columns(const vector<string> & keys, int first, int n,
+							 vector< vector<EMObject> > & values)
+{
+	ENTERFUNC;
+	init();
+
+	vector<int> nums(n);
+	vector<string> paths(n);
+	for (int i = 0; i < n; i++) {
+		check_read_access(first + i);
+		nums[i] = calc_ref_image_index(first + i);
+		if (last_lst_index != first + i) {
+			throw ImageReadException(filename, "invalid line in list file");
+		}
+		paths[i] = ref.path;
+	}
+
+	LstRefPool::instance().read_header_columns(keys, paths, nums, values);
+
+	// values which come from the list itself
+	for (int i = 0; i < n; i++) {
+		for (size_t k = 0; k < keys.size(); k++) {
+			if (keys[k] == "source_path") values[k][i] = paths[i];
+		}
+	}
+	EXITFUNC;
+}
@@ -33,12 +33,20 @@
 #define eman__lstio_h__ 1
 
 #include "imageio.h"
+#include "lstrefpool.h"
+
+#include <vector>
 
 namespace EMAN
 {
 	/** A LST file is an ASCII file that contains a list of image
 	 * file names. Each line of a LST file has the following format:
 	 * reference_image_index  reference-image-filename comments
+	 *
+	 * The offset of each line is remembered when the file is scanned, and each line is
+	 * parsed only once. Both are kept in a LstIndex shared by all readers of the file in the
+	 * process, and referenced files are kept open in the LstRefPool, so reading a line that
+	 * has been read before doesn't touch the list or repeat the open of the referenced file.
 	 */
 		
 		
@@ -56,16 +64,22 @@ namespace EMAN
 			return false;
 		}
 		int get_nimg();
+
+		/** Parses the requested lines and reads the values from the referenced files,
+		 * consecutive images in the same file with one call. */
+		void read_header_columns(const vector<string> & keys, int first, int n,
+								 vector< vector<EMObject> > & values);
 	  private:
 		bool is_big_endian;
 		int nimg;
 
-		ImageIO *imageio;
-		string ref_filename;
-
 		int last_lst_index;
 		int last_ref_index;
 
+		std::shared_ptr<LstIndex> index;
+		LstRefPool::Ref ref;	// the file referenced by the last line read
+		int ref_id;		// its id in index, -1 if none
+
 		int calc_ref_image_index(int image_index);
 		static const char *MAGIC;
 	};
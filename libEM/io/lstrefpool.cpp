@@ -0,0 +1,333 @@
+/*
+ * Copyright (c) 2000- Baylor College of Medicine
+ * 
+ * This software is issued under a joint BSD/GNU license. You may use the
+ * source code in this file under either license. However, note that the
+ * complete EMAN2 and SPARX software packages have some GPL dependencies,
+ * so you are responsible for compliance with the licenses of these packages
+ * if you opt to use BSD licensing. The warranty disclaimer below holds
+ * in either instance.
+ * 
+ * This complete copyright notice must be included in any revised version of the
+ * source code. Additional authorship citations may be added, but existing
+ * author citations must be preserved.
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ * 
+ * */
+
+#ifndef WIN32
+#include <sys/param.h>
+#include <unistd.h>
+#else
+#include <windows.h>
+#define MAXPATHLEN (MAX_PATH*4)
+#endif
+
+#include <sys/stat.h>
+#include <cstdio>
+#include <algorithm>
+
+#include "lstrefpool.h"
+#include "emutil.h"
+#include "util.h"
+
+using namespace EMAN;
+
+// Modification time in ns and size of a file. Returns false if it doesn't exist
+static bool file_stamp(const string & path, int64_t & mtime, int64_t & size)
+{
+	struct stat st;
+	if (stat(path.c_str(), &st) != 0) return false;
+	mtime = (int64_t)st.st_mtime*1000000000;
+#if defined(__APPLE__)
+	mtime += st.st_mtimespec.tv_nsec;
+#elif defined(__linux__) || defined(_POSIX_C_SOURCE) && _POSIX_C_SOURCE >= 200809L
+	mtime += st.st_mtim.tv_nsec;
+#endif
+	size = (int64_t)st.st_size;
+	return true;
+}
+
+// Absolute form of a path, without resolving links, so it names the same file after a chdir
+static string pool_key(const string & path)
+{
+#ifndef WIN32
+	if (path.empty() || path[0] == '/') return path;
+
+	char cwd[MAXPATHLEN];
+	if (!getcwd(cwd, MAXPATHLEN)) return path;
+
+	size_t start = 0;
+	while (path.compare(start, 2, "./") == 0) start += 2;
+	return string(cwd) + "/" + path.substr(start);
+#else
+	return path;
+#endif
+}
+
+namespace {
+	const size_t MAX_INDEXES = 64;	// list files whose index is kept
+
+	struct IndexCache {
+		IndexCache() : uses(0) {}
+
+		std::mutex mutex;
+		std::unordered_map<string, std::shared_ptr<LstIndex> > indexes;
+		size_t uses;
+	};
+
+	IndexCache & index_cache()
+	{
+		static IndexCache *cache = new IndexCache();	// never destroyed, so it remains usable at exit
+		return *cache;
+	}
+}
+
+LstIndex::LstIndex()
+:	scanned(false), nimg(0), line_length(0), head_length(0), mtime(0), size(0), last_used(0)
+{
+}
+
+std::shared_ptr<LstIndex> LstIndex::get(const string & filename)
+{
+	int64_t mtime, size;
+	if (!file_stamp(filename, mtime, size)) return get_private();
+
+	string key = pool_key(filename);
+	IndexCache & cache = index_cache();
+	std::lock_guard<std::mutex> lock(cache.mutex);
+
+	std::unordered_map<string, std::shared_ptr<LstIndex> >::iterator it = cache.indexes.find(key);
+	if (it == cache.indexes.end()) {
+		if (cache.indexes.size() >= MAX_INDEXES) {
+			// readers still using the oldest index keep their copy
+			std::unordered_map<string, std::shared_ptr<LstIndex> >::iterator old = cache.indexes.begin();
+			for (std::unordered_map<string, std::shared_ptr<LstIndex> >::iterator i = old; i != cache.indexes.end(); ++i) {
+				if (i->second->last_used < old->second->last_used) old = i;
+			}
+			cache.indexes.erase(old);
+		}
+		it = cache.indexes.insert(std::make_pair(key, std::shared_ptr<LstIndex>())).first;
+	}
+
+	std::shared_ptr<LstIndex> & index = it->second;
+	if (!index || index->mtime != mtime || index->size != size) {
+		index.reset(new LstIndex());
+		index->mtime = mtime;
+		index->size = size;
+	}
+	index->last_used = ++cache.uses;
+
+	return index;
+}
+
+std::shared_ptr<LstIndex> LstIndex::get_private()
+{
+	return std::shared_ptr<LstIndex>(new LstIndex());
+}
+
+void LstIndex::forget(const string & filename)
+{
+	IndexCache & cache = index_cache();
+	string key = pool_key(filename);
+	std::lock_guard<std::mutex> lock(cache.mutex);
+	cache.indexes.erase(key);
+}
+
+int LstIndex::parse_line(int image_index, const char *line)
+{
+	int ref_image_index = 0;
+	char ref_image_path[MAXPATHLEN];
+	char unused[256];
+	ref_image_path[0] = '\0';
+	sscanf(line, " %d %s %[ .,0-9-]", &ref_image_index, ref_image_path, unused);
+
+	string path(ref_image_path);
+	int id;
+	std::unordered_map<string, int>::iterator it = ids.find(path);
+	if (it != ids.end()) {
+		id = it->second;
+	}
+	else {
+		id = paths.size();
+		paths.push_back(path);
+		ids[path] = id;
+	}
+
+	if (image_index >= (int)line_file.size()) {
+		size_t n = std::max((size_t)image_index+1, line_file.size()*2);
+		if (n > (size_t)nimg && image_index < nimg) n = nimg;
+		line_file.resize(n, -1);
+		line_ref.resize(n, 0);
+	}
+	line_file[image_index] = id;
+	line_ref[image_index] = ref_image_index;
+
+	return ref_image_index;
+}
+
+LstRefPool::LstRefPool(size_t maxopen)
+:	max_open(maxopen > 0 ? maxopen : 1)
+{
+}
+
+LstRefPool & LstRefPool::instance()
+{
+	static LstRefPool *pool = new LstRefPool(64);	// never destroyed, open files are closed by the OS at exit
+	return *pool;
+}
+
+LstRefPool::Ref LstRefPool::acquire(const string & path)
+{
+	string key = pool_key(path);
+	Ref ref;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		PathState & st = files[key];
+		if (st.idle.empty()) {
+			st.nopen++;	// the copy about to be opened
+			ref.gen = st.gen;
+		}
+		else {
+			ref = *st.idle.back();
+			lru.erase(st.idle.back());
+			st.idle.pop_back();
+		}
+	}
+
+	time_t now = time(0);
+	if (ref.io) {
+		ref.path = path;	// the same file may be named differently by different lists
+		if (now - ref.checked < 1) return ref;
+
+		int64_t mtime, size;
+		if (file_stamp(path, mtime, size) && mtime == ref.mtime && size == ref.size) {
+			ref.checked = now;
+			return ref;
+		}
+
+		// changed since it was opened, open it again
+		unsigned int gen = ref.gen;
+		close(ref);
+		std::lock_guard<std::mutex> lock(mutex);
+		files[key].nopen++;
+		ref = Ref();
+		ref.gen = gen;
+	}
+
+	ref.path = path;
+	ref.key = key;
+	ref.checked = now;
+	try {
+		if (!file_stamp(path, ref.mtime, ref.size)) throw FileAccessException(path);
+		ref.io = EMUtil::get_imageio(path, ImageIO::READ_ONLY);
+		if (!ref.io) throw ImageFormatException("invalid image file '" + path + "'");
+	}
+	catch (...) {
+		ref.io = 0;
+		close(ref);
+		throw;
+	}
+
+	return ref;
+}
+
+void LstRefPool::release(Ref & ref)
+{
+	if (!ref.io) return;
+
+	vector<Ref> closing;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		PathState & st = files[ref.key];
+		if (ref.gen != st.gen) {
+			closing.push_back(ref);	// forgotten while in use
+		}
+		else {
+			lru.push_front(ref);
+			st.idle.push_back(lru.begin());
+			while (lru.size() > max_open) {
+				std::list<Ref>::iterator old = --lru.end();
+				std::vector<std::list<Ref>::iterator> & idle = files[old->key].idle;
+				idle.erase(std::find(idle.begin(), idle.end(), old));
+				closing.push_back(*old);
+				lru.erase(old);
+			}
+		}
+	}
+	ref = Ref();
+
+	for (size_t i = 0; i < closing.size(); i++) close(closing[i]);
+}
+
+void LstRefPool::forget(const string & path)
+{
+	string key = pool_key(path);
+	vector<Ref> closing;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		std::unordered_map<string, PathState>::iterator it = files.find(key);
+		if (it == files.end()) return;
+
+		PathState & st = it->second;
+		st.gen++;
+		for (size_t i = 0; i < st.idle.size(); i++) {
+			closing.push_back(*st.idle[i]);
+			lru.erase(st.idle[i]);
+		}
+		st.idle.clear();
+	}
+
+	for (size_t i = 0; i < closing.size(); i++) close(closing[i]);
+}
+
+// Closes a file which is no longer in the pool, must be called without holding the lock
+void LstRefPool::close(Ref & ref)
+{
+	if (ref.io) EMUtil::close_imageio(ref.path, ref.io);
+	ref.io = 0;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	std::unordered_map<string, PathState>::iterator it = files.find(ref.key);
+	if (it != files.end() && --it->second.nopen <= 0 && it->second.idle.empty()) files.erase(it);
+}
+
+void LstRefPool::read_header_columns(const vector<string> & keys, const vector<string> & paths,
+									 const vector<int> & nums, vector< vector<EMObject> > & values)
+{
+	size_t n = paths.size();
+	values.assign(keys.size(), vector<EMObject>(n));
+
+	vector< vector<EMObject> > run;
+	for (size_t i = 0; i < n; ) {
+		size_t j = i + 1;
+		while (j < n && paths[j] == paths[i] && nums[j] == nums[j-1] + 1) j++;
+
+		Ref ref = acquire(paths[i]);
+		try {
+			ref.io->read_header_columns(keys, nums[i], j - i, run);
+		}
+		catch (...) {
+			release(ref);
+			throw;
+		}
+		release(ref);
+		for (size_t k = 0; k < keys.size(); k++) {
+			std::copy(run[k].begin(), run[k].end(), values[k].begin() + i);
+		}
+		i = j;
+	}
+}
@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) 2000- Baylor College of Medicine
+ * 
+ * This software is issued under a joint BSD/GNU license. You may use the
+ * source code in this file under either license. However, note that the
+ * complete EMAN2 and SPARX software packages have some GPL dependencies,
+ * so you are responsible for compliance with the licenses of these packages
+ * if you opt to use BSD licensing. The warranty disclaimer below holds
+ * in either instance.
+ * 
+ * This complete copyright notice must be included in any revised version of the
+ * source code. Additional authorship citations may be added, but existing
+ * author citations must be preserved.
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ * 
+ * */
+
+#ifndef eman__lstrefpool_h__
+#define eman__lstrefpool_h__ 1
+
+#include "imageio.h"
+
+#include <cstdint>
+#include <ctime>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <unordered_map>
+
+namespace EMAN
+{
+	/** The parsed lines of a LST/LSX file, shared by every reader of that file in the process.
+	 * EMData::read_image opens and closes the list for each image, so anything kept by a single
+	 * reader would be lost after one read. Indexes are cached by file name, and reused as long
+	 * as the modification time and size of the file are unchanged. Each line is parsed the first
+	 * time any reader needs it. Referenced file names are interned, so a parsed line is just a
+	 * (file id, image number) pair.
+	 *
+	 * The members may only be used while holding mutex.
+	 */
+	class LstIndex
+	{
+	  public:
+		/** Return the cached index of a list file which is being read, or a new empty one if it isn't
+		 * cached or the file has changed */
+		static std::shared_ptr<LstIndex> get(const string & filename);
+
+		/** Return a new index which isn't shared, for a list which is being written */
+		static std::shared_ptr<LstIndex> get_private();
+
+		/** Drop the cached index of a file. Called when the file is opened for writing */
+		static void forget(const string & filename);
+
+		/** Parse one line of the list and store it as line image_index
+		 * @return the referenced image number */
+		int parse_line(int image_index, const char *line);
+
+		std::mutex mutex;
+		bool scanned;			// the header has been read, and nimg set
+		int nimg;
+		unsigned int line_length;	// LSX only
+		unsigned int head_length;	// LSX only
+		std::vector<long> line_offset;	// LST only, file offset of each image line found so far
+		std::vector<int> line_file;	// referenced file id of each parsed line, -1 if not parsed yet, grown as lines are parsed
+		std::vector<int> line_ref;	// referenced image number of each parsed line
+		std::vector<string> paths;	// referenced file names by id
+
+	  private:
+		LstIndex();
+		LstIndex(const LstIndex &);
+		LstIndex & operator=(const LstIndex &);
+
+		std::unordered_map<string, int> ids;
+		int64_t mtime, size;
+		size_t last_used;
+	};
+
+	/** The image files referenced by LST/LSX files, kept open and shared by all lists in the
+	 * process. A reader takes an open file with acquire() and gives it back with release().
+	 * Released files stay open, so the next read from the same file doesn't repeat the existence
+	 * check, type detection and open. A file is used by one reader at a time, if two readers want
+	 * the same file at once it is opened twice. At most max_open idle files are kept, the least
+	 * recently used ones are closed beyond that. Files are matched by absolute path, so a
+	 * relative name refers to the file in the current directory at the time of the call.
+	 *
+	 * Files opened for writing through EMUtil::get_imageio are closed with forget(). Files changed
+	 * by other processes are noticed by checking their modification time, at most once a second.
+	 */
+	class LstRefPool
+	{
+	  public:
+		/** An open referenced file, handed out by acquire() */
+		struct Ref
+		{
+			Ref() : io(0), mtime(0), size(0), checked(0), gen(0) {}
+
+			ImageIO *io;
+			string path;	// as given to acquire()
+			string key;	// absolute path, the pool is keyed by it
+			int64_t mtime, size;	// of the file when it was opened
+			time_t checked;		// when the file was last checked for changes
+			unsigned int gen;	// forget() count of the path when it was opened
+		};
+
+		static LstRefPool & instance();
+
+		/** Return an open, read only, ImageIO for path, which the caller has to itself until release() */
+		Ref acquire(const string & path);
+
+		/** Give back a file from acquire(), ref is cleared */
+		void release(Ref & ref);
+
+		/** Close the idle copies of a file, and any in use when they are released */
+		void forget(const string & path);
+
+		/** Read header values for a list of referenced images, given as file names and image
+		 * numbers. Runs of consecutive images in the same file are read with one call to
+		 * ImageIO::read_header_columns.
+		 */
+		void read_header_columns(const vector<string> & keys, const vector<string> & paths,
+								 const vector<int> & nums, vector< vector<EMObject> > & values);
+
+	  private:
+		explicit LstRefPool(size_t max_open);
+		LstRefPool(const LstRefPool &);
+		LstRefPool & operator=(const LstRefPool &);
+
+		struct PathState
+		{
+			PathState() : gen(0), nopen(0) {}
+
+			unsigned int gen;
+			int nopen;	// open copies, idle or in use
+			std::vector<std::list<Ref>::iterator> idle;
+		};
+
+		std::mutex mutex;
+		size_t max_open;
+		std::list<Ref> lru;	// idle files, most recently used first
+		std::unordered_map<string, PathState> files;
+
+		void close(Ref & ref);
+	};
+}
+
+#endif	//eman__lstrefpool_h__
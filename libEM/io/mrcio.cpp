@@ -34,6 +34,11 @@
 
 #include <sys/stat.h>
 
+#ifndef _WIN32
+	#include <sys/mman.h>
+	#include <unistd.h>
+#endif	//_WIN32
+
 #include "mrcio.h"
 #include "portable_fileio.h"
 #include "geometry.h"
@@ -51,7 +56,8 @@ MrcIO::MrcIO(const string & fname, IOMode rw)
 		isFEI(false), is_ri(0), is_new_file(false),
 		is_transpose(false), is_stack(false), stack_size(1),
 		is_8_bit_packed(false), use_given_dimensions(true),
-		rendermin(0.0), rendermax(0.0), renderbits(16)
+		rendermin(0.0), rendermax(0.0), renderbits(16),
+		map_addr(NULL), map_len(0), map_tried(false)
 {
 	memset(&mrch, 0, sizeof(MrcHeader));
 	is_big_endian = ByteOrder::is_host_big_endian();
@@ -59,6 +65,13 @@ MrcIO::MrcIO(const string & fname, IOMode rw)
 
 MrcIO::~MrcIO()
 {
+#ifndef _WIN32
+	if (map_addr) {
+		munmap(map_addr, map_len);
+		map_addr = NULL;
+	}
+#endif	//_WIN32
+
 	if (file) {
 		fclose(file);
 		file = NULL;
@@ -220,6 +233,57 @@ void MrcIO::init()
 	EXITFUNC;
 }
 
+bool MrcIO::read_mapped(void * dest, size_t offset, size_t nbytes)
+{
+#ifndef _WIN32
+	if (rw_mode != READ_ONLY) {
+		return false;
+	}
+
+	// the whole file is mapped once, on the first read, and stays mapped until the MrcIO goes away
+	if (! map_tried) {
+		map_tried = true;
+
+		struct stat status;
+
+		if (getenv("EMAN2_MRC_NOMMAP") || fstat(fileno(file), &status) != 0 || status.st_size <= 0) {
+			return false;
+		}
+
+		void * addr = mmap(NULL, (size_t) status.st_size, PROT_READ, MAP_PRIVATE, fileno(file), 0);
+
+		if (addr == MAP_FAILED) {
+			return false;
+		}
+
+		map_addr = (char *) addr;
+		map_len  = (size_t) status.st_size;
+		posix_madvise(map_addr, map_len, POSIX_MADV_RANDOM);
+	}
+
+	if (! map_addr || offset + nbytes > map_len) {
+		return false;
+	}
+
+	// touching pages past the end of a file that was cut short since it was mapped raises SIGBUS
+	struct stat status;
+
+	if (fstat(fileno(file), &status) != 0 || (off_t) (offset + nbytes) > status.st_size) {
+		return false;
+	}
+
+	size_t page  = (size_t) sysconf(_SC_PAGESIZE);
+	size_t start = offset / page * page;
+
+	posix_madvise(map_addr + start, offset + nbytes - start, POSIX_MADV_WILLNEED);
+	memcpy(dest, map_addr + offset, nbytes);
+
+	return true;
+#else
+	return false;
+#endif	//_WIN32
+}
+
 bool MrcIO::is_image_big_endian()
 {
 	init();
@@ -1028,9 +1092,16 @@ int MrcIO::read_data(float *rdata, int image_index, const Region * area, bool)
 			modesize = mode_size;
 		}
 
-		EMUtil::process_region_io(cdata, file, READ_ONLY,
-								  image_index, modesize,
-								  mrch.nx, mrch.ny, mrch.nz, area);
+		size_t image_bytes = (size_t) mrch.nx * mrch.ny * mrch.nz * mode_size;
+		size_t offset      = sizeof(MrcHeader) + mrch.nsymbt + (mrch.nz > 1 ? 0 : image_index * image_bytes);
+
+		// whole images come out of a mapping of just that image in one copy. Regions,
+		// packed 4 bit data, and anything that can't be mapped take the row by row path
+		if (area != 0 || mrch.mode == MRC_UHEX || ! read_mapped(cdata, offset, image_bytes)) {
+			EMUtil::process_region_io(cdata, file, READ_ONLY,
+									  image_index, modesize,
+									  mrch.nx, mrch.ny, mrch.nz, area);
+		}
 
 		EMUtil::get_region_dims(area, mrch.nx, &xlen, mrch.ny, &ylen, mrch.nz, &zlen);
 
@@ -286,6 +286,11 @@ namespace EMAN
 		float rendermin;
 		float rendermax;
 		int renderbits;
+
+		/* read only files are mapped whole on the first image read, see read_mapped() */
+		char * map_addr;
+		size_t map_len;
+		bool map_tried;
 		
 		/** generate the machine stamp used in MRC image format. */
 		static int generate_machine_stamp();
@@ -306,6 +311,13 @@ namespace EMAN
 
 		//utility funciton to tranpose x and y dimension in case the source mrc image is mapc=2,mapr=1
 		int transpose(float *data, int nx, int ny, int nz) const;
+
+		/** Copy nbytes at offset in a file opened read only into dest. The whole file is
+		 * mapped privately on the first call and kept until the MrcIO is destroyed. Returns
+		 * false, having copied nothing, if the range is past the mapped size or the current
+		 * end of the file, if mapping fails, on Windows, or if the environment variable
+		 * EMAN2_MRC_NOMMAP is set. */
+		bool read_mapped(void * dest, size_t offset, size_t nbytes);
 	};
 }
 
@@ -44,11 +44,13 @@
 
 #include <time.h>
 #include <math.h>
+#include <algorithm>
 
 using namespace EMAN;
 #include "transform.h"
 #include "emobject.h"
 #include "vec3.h"
+#include "util.h"
 
 //a2fVertexOffset lists the positions, relative to vertex0, of each of the 8 vertices of a cube
 static const int a2fVertexOffset[8][3] =
@@ -527,11 +529,19 @@ float* ColorRGBGenerator::getRGBColor(int x, int y, int z)
 	return &colormap[0];
 }
 
+// glGetString returns 0 without a current GL context, eg when only the mesh is wanted
+static bool gl_version_above_2()
+{
+	const GLubyte *version = glGetString(GL_VERSION);
+	return version && (int(version[0])-48)>2;
+}
+
 MarchingCubes::MarchingCubes()
-	: _isodl(0), needtobind(1)
+	: _isodl(0), drawing_level(-1), nthreads(0), block_level(-1), blocks_value(0), blocks_level(-1),
+	  blocks_dirty(true), needtobind(1)
 {
 
-if ((int(glGetString(GL_VERSION)[0])-48)>2){
+if (gl_version_above_2()){
 	rgbgenerator = ColorRGBGenerator();
 
 // #ifdef _WIN32
@@ -546,9 +556,10 @@ if ((int(glGetString(GL_VERSION)[0])-48)>2){
 }
 
 MarchingCubes::MarchingCubes(EMData * em)
-	: _isodl(0)
+	: _isodl(0), drawing_level(-1), nthreads(0), block_level(-1), blocks_value(0), blocks_level(-1),
+	  blocks_dirty(true), needtobind(1)
 {
-if ((int(glGetString(GL_VERSION)[0])-48)>2){
+if (gl_version_above_2()){
 	rgbgenerator = ColorRGBGenerator();
 
 // #ifdef _WIN32
@@ -625,7 +636,7 @@ bool MarchingCubes::calculate_min_max_vals()
 MarchingCubes::~MarchingCubes() {
 	clear_min_max_vals();
 
-if ((int(glGetString(GL_VERSION)[0])-48)>2){
+if (gl_version_above_2()){
 // #ifdef _WIN32
 // 	typedef void (APIENTRYP PFNGLDELETEBUFFERSPROC) (GLsizei n, const GLuint *buffers);
 // 	PFNGLDELETEBUFFERSPROC glDeleteBuffers;
@@ -645,6 +656,23 @@ Dict MarchingCubes::get_isosurface()
 	d.put("faces", (unsigned int*)ff.get_data());
 	d.put("normals", (float*)nn.get_data());
 	d.put("size", ff.elem());
+	d.put("npoints", pp.elem()/3);
+	if (getRGBmode()) {
+		color_vertices();
+		d.put("colors", (float*)cc.get_data());
+	}
+	return d;
+}
+
+Dict MarchingCubes::get_mesh()
+{
+	calculate_surface();
+	Dict d;
+	d["points"] = vector<float>(pp.get_data(), pp.get_data() + pp.elem());
+	d["normals"] = vector<float>(nn.get_data(), nn.get_data() + nn.elem());
+	vector<int> faces(ff.elem());
+	for (unsigned int i = 0; i < ff.elem(); ++i ) faces[i] = ff[i] / 3;
+	d["faces"] = faces;
 	return d;
 }
 
@@ -685,6 +713,8 @@ void MarchingCubes::set_data(EMData* data)
 	_emdata = data;
 	calculate_min_max_vals();
 	rgbgenerator.set_data(data);
+	blocks.clear();
+	blocks_dirty = true;
 }
 
 void MarchingCubes::set_surface_value(const float value) {
@@ -700,36 +730,105 @@ void MarchingCubes::calculate_surface() {
 	if ( _emdata == 0 ) throw NullPointerException("Error, attempt to generate isosurface, but the emdata image object has not been set");
 	if ( minvals.size() == 0 || maxvals.size() == 0 ) throw NotExistingObjectException("Vector of EMData pointers", "Error, the min and max val search trees have not been created");
 
-	point_map.clear();
-	pp.clear();
-	nn.clear();
-	ff.clear();
-	vv.clear();
-
 #if MARCHING_CUBES_DEBUG
 	int time0 = clock();
 #endif
 
-	float min = minvals[minvals.size()-1]->get_value_at(0,0,0);
-	float max = maxvals[minvals.size()-1]->get_value_at(0,0,0);
-	if ( min < _surf_value &&  max > _surf_value) draw_cube(0,0,0,minvals.size()-1);
+	// The search tree only depends on the data, so when the surface value changes only the subtrees
+	// spanning the new value are revisited. The blocks are MARCHING_CUBES_BLOCK_LEVELS levels above the
+	// drawing level, which keeps the cubes of a block close together in memory.
+	if ( blocks_dirty || blocks_value != _surf_value || blocks_level != drawing_level ) {
+		int top = minvals.size()-1;
+		block_level = std::min(top, drawing_level + MARCHING_CUBES_BLOCK_LEVELS);
+
+		blocks.clear();
+		float min = minvals[top]->get_value_at(0,0,0);
+		float max = maxvals[top]->get_value_at(0,0,0);
+		if ( min < _surf_value &&  max > _surf_value) draw_cube(0,0,0,top,0);
+
+		int nblocks = blocks.size();
+		Util::parallel_for(nblocks,Util::get_thread_count(nthreads,nblocks),[&](int i,int) {
+			Block& b = blocks[i];
+			draw_cube(b.x,b.y,b.z,block_level,&b);
+			map<unsigned long long, int>().swap(b.point_map);
+		});
+
+		blocks_value = _surf_value;
+		blocks_level = drawing_level;
+		blocks_dirty = false;
+	}
+
+	merge_blocks();
 
 #if MARCHING_CUBES_DEBUG
 	int time1 = clock();
 	cout << "It took " << (time1-time0) << " " << (float)(time1-time0)/CLOCKS_PER_SEC << " to traverse the search tree and generate polygons" << endl;
-	cout << "... using surface value " << _surf_value << endl;
+	cout << "... using surface value " << _surf_value << " in " << blocks.size() << " blocks" << endl;
 #endif
 }
 
-void MarchingCubes::draw_cube(const int x, const int y, const int z, const int cur_level ) {
+void MarchingCubes::merge_blocks()
+{
+	point_map.clear();
+	pp.clear();
+	nn.clear();
+	ff.clear();
+	vv.clear();
+
+	// Only vertices on the faces of a block may be shared with other blocks. Blocks at the upper edges
+	// of the map may include cubes beyond their nominal extent, those are treated as being on a face
+	int bsize = block_level > drawing_level ? 1 << (block_level - drawing_level) : 1;
+	vector<int> remap;
+	for (vector<Block>::iterator b = blocks.begin(); b != blocks.end(); ++b) {
+		int lo[3] = {b->x*bsize, b->y*bsize, b->z*bsize};
+		remap.resize(b->keys.size());
+		for (unsigned int v = 0; v < b->keys.size(); ++v) {
+			unsigned long long key = b->keys[v];
+			int edge = key & 3;
+			int c[3] = {int((key >> 42) & 0xfffff), int((key >> 22) & 0xfffff), int((key >> 2) & 0xfffff)};
+			bool inside = true;
+			for (int k = 0; k < 3; ++k) {
+				if ( c[k] >= lo[k]+bsize || c[k] < lo[k] || (c[k] == lo[k] && k != edge) ) inside = false;
+			}
+
+			if ( !inside ) {
+				map<unsigned long long, int>::iterator it = point_map.find(key);
+				if ( it != point_map.end() ) {
+					int idx = it->second;
+					nn[idx] += b->nn[3*v];
+					nn[idx+1] += b->nn[3*v+1];
+					nn[idx+2] += b->nn[3*v+2];
+					remap[v] = idx;
+					continue;
+				}
+				point_map[key] = pp.elem();
+			}
+			remap[v] = pp.elem();
+			vv.push_back_3(&b->vv[3*v]);
+			pp.push_back_3(&b->pp[3*v]);
+			nn.push_back_3(&b->nn[3*v]);
+		}
+		for (vector<unsigned int>::iterator f = b->ff.begin(); f != b->ff.end(); ++f) ff.push_back(remap[*f]);
+	}
+}
+
+void MarchingCubes::draw_cube(const int x, const int y, const int z, const int cur_level, Block* blk) {
 
-	if ( cur_level == drawing_level )
+	if ( blk == 0 && cur_level == block_level )
+	{
+		Block b;
+		b.x = x;
+		b.y = y;
+		b.z = z;
+		blocks.push_back(b);
+	}
+	else if ( cur_level == drawing_level )
 	{
 		EMData* e;
 		if ( drawing_level == - 1 ) e = _emdata;
 		else e = minvals[drawing_level];
 		if ( x < (e->get_xsize()-1) && y < (e->get_ysize()-1) && z < (e->get_zsize()-1))
-			marching_cube(x,y,z, cur_level);
+			marching_cube(x,y,z, cur_level, *blk);
 	}
 	else
 	{
@@ -750,64 +849,53 @@ void MarchingCubes::draw_cube(const int x, const int y, const int z, const int c
 				float min = minvals[cur_level-1]->get_value_at(xx,yy,zz);
 				float max = maxvals[cur_level-1]->get_value_at(xx,yy,zz);
 				if ( min < _surf_value &&  max > _surf_value)
-					draw_cube(xx,yy,zz,cur_level-1);
+					draw_cube(xx,yy,zz,cur_level-1,blk);
 			}
 		}
 		else {
 			e = _emdata;
 			for(int i=0; i<8; ++i )	{
-					draw_cube(2*x+a2fVertexOffset[i][0],2*y+a2fVertexOffset[i][1],2*z+a2fVertexOffset[i][2],cur_level-1);
+					draw_cube(2*x+a2fVertexOffset[i][0],2*y+a2fVertexOffset[i][1],2*z+a2fVertexOffset[i][2],cur_level-1,blk);
 			}
 		}
 
-		if ( x == (minvals[cur_level]->get_xsize()-1) ) {
-			if ( e->get_xsize() > 2*x ){
-				for(int i=0; i<4; ++i )	{
-					draw_cube(2*x+a2fPosXOffset[i][0],2*y+a2fPosXOffset[i][1],2*z+a2fPosXOffset[i][2],cur_level-1);
-				}
+		// Cells without a parent at the upper edges of the next level down, they are visited only if they exist
+		// so no cell is marched twice
+		bool px = x == (minvals[cur_level]->get_xsize()-1) && e->get_xsize() > 2*x+2;
+		bool py = y == (minvals[cur_level]->get_ysize()-1) && e->get_ysize() > 2*y+2;
+		bool pz = z == (minvals[cur_level]->get_zsize()-1) && e->get_zsize() > 2*z+2;
+
+		if ( px ) {
+			for(int i=0; i<4; ++i )	{
+				draw_cube(2*x+a2fPosXOffset[i][0],2*y+a2fPosXOffset[i][1],2*z+a2fPosXOffset[i][2],cur_level-1,blk);
 			}
-			if ( y == (minvals[cur_level]->get_ysize()-1) ) {
-				if ( e->get_ysize() > 2*y ) {
-					for(int i=0; i<2; ++i )	{
-						draw_cube(2*x+a2fPosXPosYOffset[i][0],2*y+a2fPosXPosYOffset[i][1],2*z+a2fPosXPosYOffset[i][2],cur_level-1);
-					}
-				}
-				if (  z == (minvals[cur_level]->get_zsize()-1) ){
-					if ( e->get_zsize() > 2*z ) {
-						draw_cube(2*x+2,2*y+2,2*z+2,cur_level-1);
-					}
+			if ( py ) {
+				for(int i=0; i<2; ++i )	{
+					draw_cube(2*x+a2fPosXPosYOffset[i][0],2*y+a2fPosXPosYOffset[i][1],2*z+a2fPosXPosYOffset[i][2],cur_level-1,blk);
 				}
+				if ( pz ) draw_cube(2*x+2,2*y+2,2*z+2,cur_level-1,blk);
 			}
-			if ( z == (minvals[cur_level]->get_zsize()-1) ) {
-				if ( e->get_zsize() > 2*z ) {
-					for(int i=0; i<2; ++i )	{
-						draw_cube(2*x+a2fPosXPosZOffset[i][0],2*y+a2fPosXPosZOffset[i][1],2*z+a2fPosXPosZOffset[i][2],cur_level-1);
-					}
+			if ( pz ) {
+				for(int i=0; i<2; ++i )	{
+					draw_cube(2*x+a2fPosXPosZOffset[i][0],2*y+a2fPosXPosZOffset[i][1],2*z+a2fPosXPosZOffset[i][2],cur_level-1,blk);
 				}
 			}
 		}
-		if ( y == (minvals[cur_level]->get_ysize()-1) ) {
-			if ( e->get_ysize() > 2*y ) {
-				for(int i=0; i<4; ++i )	{
-					draw_cube(2*x+a2fPosYOffset[i][0],2*y+a2fPosYOffset[i][1],2*z+a2fPosYOffset[i][2],cur_level-1);
-				}
+		if ( py ) {
+			for(int i=0; i<4; ++i )	{
+				draw_cube(2*x+a2fPosYOffset[i][0],2*y+a2fPosYOffset[i][1],2*z+a2fPosYOffset[i][2],cur_level-1,blk);
 			}
-			if ( z == (minvals[cur_level]->get_ysize()-1) ) {
-				if ( e->get_zsize() > 2*z ) {
-					for(int i=0; i<2; ++i )	{
-						draw_cube(2*x+a2fPosYPosZOffset[i][0],2*y+a2fPosYPosZOffset[i][1],2*z+a2fPosYPosZOffset[i][2],cur_level-1);
-					}
+			if ( pz ) {
+				for(int i=0; i<2; ++i )	{
+					draw_cube(2*x+a2fPosYPosZOffset[i][0],2*y+a2fPosYPosZOffset[i][1],2*z+a2fPosYPosZOffset[i][2],cur_level-1,blk);
 				}
 			}
 		}
-		if ( z == (minvals[cur_level]->get_zsize()-1) ) {
-			if ( e->get_zsize() > 2*z ) {
-				for(int i=0; i<4; ++i )	{
-					draw_cube(2*x+a2fPosZOffset[i][0],2*y+a2fPosZOffset[i][1],2*z+a2fPosZOffset[i][2],cur_level-1);
-				}
+		if ( pz ) {
+			for(int i=0; i<4; ++i )	{
+				draw_cube(2*x+a2fPosZOffset[i][0],2*y+a2fPosZOffset[i][1],2*z+a2fPosZOffset[i][2],cur_level-1,blk);
 			}
 		}
-
 	}
 }
 
@@ -830,11 +918,9 @@ float MarchingCubes::get_offset(float fValue1, float fValue2, float fValueDesire
         return (fValueDesired - fValue1)/fDelta;
 }
 
-int MarchingCubes::get_edge_num(int x, int y, int z, int edge) {
+unsigned long long MarchingCubes::get_edge_num(int x, int y, int z, int edge) {
 	// edge direction is right, down, back (x, y, z)
-	unsigned int index = 0;
-	index = (x << 22) | (y << 12) | (z << 2) | edge;
-	return index;
+	return ((unsigned long long)x << 42) | ((unsigned long long)y << 22) | ((unsigned long long)z << 2) | edge;
 }
 
 void MarchingCubes::color_vertices()
@@ -849,7 +935,7 @@ void MarchingCubes::color_vertices()
 	rgbgenerator.setNeedToRecolor(false);
 }
 
-void MarchingCubes::marching_cube(int fX, int fY, int fZ, int cur_level)
+void MarchingCubes::marching_cube(int fX, int fY, int fZ, int cur_level, Block& blk)
 {
 //	extern int aiCubeEdgeFlags[256];
 //	extern int a2iTriangleConnectionTable[256][16];
@@ -859,7 +945,7 @@ void MarchingCubes::marching_cube(int fX, int fY, int fZ, int cur_level)
 	Vector3 sColor;
 	float afCubeValue[8];
 	float asEdgeVertex[12][3];
-	int pointIndex[12];
+	unsigned long long pointIndex[12];
 
 	int fxScale = 1, fyScale = 1, fzScale = 1;
 	if ( cur_level != -1 )
@@ -962,20 +1048,21 @@ void MarchingCubes::marching_cube(int fX, int fY, int fZ, int cur_level)
 
 //			With vertex normalization
 			iVertex = a2iTriangleConnectionTable[iFlagIndex][3*iTriangle+iCorner];
-			map<int,int>::iterator it = point_map.find(pointIndex[iVertex]);
-			if ( it == point_map.end() ){
-				vv.push_back_3(&vox[0]);
-				int ss = pp.elem();
-				pp.push_back_3(&pts[iCorner][0]);
-				nn.push_back_3(&n[0]);
-				ff.push_back(ss);
-				point_map[pointIndex[iVertex]] = ss;
+			map<unsigned long long,int>::iterator it = blk.point_map.find(pointIndex[iVertex]);
+			if ( it == blk.point_map.end() ){
+				int ss = blk.keys.size();
+				blk.keys.push_back(pointIndex[iVertex]);
+				blk.vv.insert(blk.vv.end(), vox, vox+3);
+				blk.pp.insert(blk.pp.end(), &pts[iCorner][0], &pts[iCorner][0]+3);
+				blk.nn.insert(blk.nn.end(), n, n+3);
+				blk.ff.push_back(ss);
+				blk.point_map[pointIndex[iVertex]] = ss;
 			} else {
-				int idx = it->second;
-				ff.push_back(idx);
-				nn[idx] += n[0];
-				nn[idx+1] += n[1];
-				nn[idx+2] += n[2];
+				int idx = 3*it->second;
+				blk.ff.push_back(it->second);
+				blk.nn[idx] += n[0];
+				blk.nn[idx+1] += n[1];
+				blk.nn[idx+2] += n[2];
 			}
 		}
 	}
@@ -41,6 +41,9 @@ using std::vector;
 // Marching cubes debug will turn on debug and timing information
 #define MARCHING_CUBES_DEBUG 0
 
+// Number of tree levels in the blocks marched by one thread, a block is up to 2^MARCHING_CUBES_BLOCK_LEVELS cubes on a side
+#define MARCHING_CUBES_BLOCK_LEVELS 4
+
 #include <ostream>
 using std::ostream;
 
@@ -318,16 +321,32 @@ namespace EMAN
 		*/
 		int get_sampling_range() { return minvals.size()-1; }
 
+		/** Set the number of threads used to march the cubes
+		* @param n the number of threads, 0 or less means one per core
+		*/
+		void set_threads(const int n) { nthreads = n; }
+
+		/** Get the number of threads used to march the cubes
+		*/
+		int get_threads() const { return nthreads; }
+
 		/** Color the vertices
 		 */
 		void color_vertices();
 		
 		/** Get the isosurface as dictionary
 		* Traverses the tree and marches the cubes
-		* @return a dictionary object containing to float pointers (to vertex and normal data), and an int pointer (to face data)
+		* @return a dictionary object containing to float pointers (to vertex and normal data), and an int pointer (to face data),
+		* the number of face indices ("size") and vertices ("npoints"). If coloring is on it also has a float pointer to color data.
 		*/
 		Dict get_isosurface();
 
+		/** Get the isosurface as arrays, without any OpenGL calls
+		* @return a dictionary with "points" (x,y,z of each vertex), "normals" (one per vertex) and
+		* "faces" (three vertex indices per triangle)
+		*/
+		Dict get_mesh();
+
 		void surface_face_z();
 		
 		/** Functions to control colroing mode
@@ -366,7 +385,19 @@ namespace EMAN
 		}
 		
 	private:
-		map<int, int> point_map;
+		/** The triangles of one subtree of the search tree, see calculate_surface.
+		* Vertices are shared within the block, the blocks are merged into pp, nn, vv and ff
+		*/
+		struct Block {
+			int x, y, z;	// position of the subtree root at block_level
+			vector<float> pp, nn;
+			vector<int> vv;
+			vector<unsigned long long> keys;	// edge of each vertex, from get_edge_num
+			vector<unsigned int> ff;	// indices of local vertices
+			map<unsigned long long, int> point_map;
+		};
+
+		map<unsigned long long, int> point_map;
 		unsigned long _isodl;
 		GLuint buffer[4];
 
@@ -389,16 +420,30 @@ namespace EMAN
 		/// The "sampling rate"
 		int drawing_level;
 
+		/// Number of threads, 0 or less means one per core
+		int nthreads;
+
+		/// Tree level of the blocks which are marched independently
+		int block_level;
+
+		/// The blocks of the last surface, with the surface value and drawing level they were made for
+		vector<Block> blocks;
+		float blocks_value;
+		int blocks_level;
+		bool blocks_dirty;
+
 		/** The main cube drawing function
-		* To start the process of generate triangles call with draw_cube(0,0,0,minvals.size()-1)
-		* Once cur_level becomes drawing_level marching_cube is called
+		* To start the process of generate triangles call with draw_cube(0,0,0,minvals.size()-1,0)
+		* Without a block, subtrees at block_level are added to blocks instead of being traversed.
+		* With a block, once cur_level becomes drawing_level marching_cube is called
 		* @param x the current x value, relative to cur_level
 		* @param y the current y value, relative to cur_level
 		* @param z the current z value, relative to cur_level
 		* @param cur_level the current tree traversal level
+		* @param blk the block receiving the triangles, or 0 to collect the blocks
 		*
 		*/
-		void draw_cube(const int x, const int y, const int z, const int cur_level );
+		void draw_cube(const int x, const int y, const int z, const int cur_level, Block* blk);
 
 
 		/** Function for managing cases where a triangles can potentially be rendered
@@ -407,13 +452,20 @@ namespace EMAN
 		* @param fY the current y coordinate, relative to cur_level
 		* @param fZ the current z coordinate, relative to cur_level
 		* @param cur_level
+		* @param blk the block receiving the triangles
 		*/
-		void marching_cube(int fX, int fY, int fZ, const int cur_level);
+		void marching_cube(int fX, int fY, int fZ, const int cur_level, Block& blk);
 
 		/** Calculate and generate the entire set of vertices and normals using current states
-		 * Calls draw_cube(0,0,0,minvals.size()-1)
+		* The subtrees spanning the surface value at block_level are marched in parallel, then merged
+		* in the order of a serial traversal, so the mesh doesn't depend on the number of threads.
+		* The blocks are kept, so calling this again with the same surface value and sampling only merges them
 		*/
 		void calculate_surface();
+
+		/** Merge the blocks into pp, nn, vv and ff, sharing the vertices on block boundaries
+		*/
+		void merge_blocks();
 		
 		/** Find the approximate point of intersection of the surface between two
 		 * points with the values fValue1 and fValue2
@@ -426,9 +478,10 @@ namespace EMAN
 		float get_offset(float fValue1, float fValue2, float fValueDesired);
 
 		/** Get edge num
-		* needs better commenting
+		* A unique key for the edge in direction edge (0-2 for x, y, z) starting at cube x, y, z.
+		* Coordinates may be up to 2^20
 		*/
-		int get_edge_num(int x, int y, int z, int edge);
+		unsigned long long get_edge_num(int x, int y, int z, int edge);
 
 		/** Find the gradient of the scalar field at a point. This gradient can
 		 * be used as a very accurate vertx normal for lighting calculations.
@@ -34,7 +34,9 @@
 #include "util.h"
 #include "vec3.h"
 #include <vector>
+#include <algorithm>
 #include <cstring>
+#include <functional>
 #include <boost/random.hpp>
 
 #ifdef __APPLE__
@@ -105,6 +107,7 @@ PointArray::PointArray()
 	points = 0;
 	bfactor = 0;
 	n = 0;
+	nthreads = 0;
 	
 	adist=0;
 	aang=0;
@@ -117,6 +120,8 @@ PointArray::PointArray( int nn)
 {
 	n = nn;
 	points = (double *) calloc(4 * n, sizeof(double));
+	bfactor = 0;
+	nthreads = 0;
 	
 	adist=0;
 	aang=0;
@@ -152,6 +157,7 @@ PointArray *PointArray::copy()
 	pa2->set_number_points(get_number_points());
 	double *pa2data = pa2->get_points_array();
 	memcpy(pa2data, get_points_array(), sizeof(double) * 4 * get_number_points());
+	pa2->set_threads(nthreads);
 
 	return pa2;
 }
@@ -990,7 +996,13 @@ double PointArray::sim_potential() {
 	sim_updategeom();
 	
 	if (map &&mapc) {
-		for (size_t i=0; i<n; i++) ret+=sim_pointpotential(adist[i],aang[i],adihed[i])-mapc*map->sget_value_at_interp(points[i*4]/apix+centx,points[i*4+1]/apix+centy,points[i*4+2]/apix+centz);
+		// the map is interpolated in parallel, the terms are summed in order so the result doesn't depend on the number of threads
+		vector<double> mapval(n);
+		int nblk=(n+1023)/1024;
+		Util::parallel_for(nblk,Util::get_thread_count(nthreads,nblk),[&](int b,int) {
+			for (size_t i=b*(size_t)1024; i<n && i<(b+1)*(size_t)1024; i++) mapval[i]=map->sget_value_at_interp(points[i*4]/apix+centx,points[i*4+1]/apix+centy,points[i*4+2]/apix+centz);
+		});
+		for (size_t i=0; i<n; i++) ret+=sim_pointpotential(adist[i],aang[i],adihed[i])-mapc*mapval[i];
 	}
 	else {
 		for (size_t i=0; i<n; i++) ret+=sim_pointpotential(adist[i],aang[i],adihed[i]);
@@ -2273,6 +2285,57 @@ void PointArray::sort_by_axis(int axis)
 }
 
 
+/* Points are added to rows [0,nrows) of an image by splat(point, rowmin, rowmax, thread). The rows are split into
+ * slabs each owned by a single thread, and the points are binned by the slabs their rows [lo,hi) overlap. Threads
+ * never write the same pixel, and each pixel receives its contributions in point order as in a serial loop, so the
+ * result doesn't depend on the number of threads. */
+static void splat_by_slabs(int nrows, int nthreads, const vector<int> &lo, const vector<int> &hi,
+		const std::function<void (size_t, int, int, int)> &splat)
+{
+	size_t npoints = lo.size();
+	nthreads = Util::get_thread_count(nthreads, nrows);
+	if (nthreads == 1) {
+		for (size_t s = 0; s < npoints; s++) {
+			if (lo[s] < hi[s]) splat(s, lo[s], hi[s], 0);
+		}
+		return;
+	}
+
+	int width = (nrows + 4*nthreads - 1) / (4*nthreads);
+	int nslab = (nrows + width - 1) / width;
+	vector< vector<size_t> > bins(nslab);
+	for (size_t s = 0; s < npoints; s++) {
+		if (lo[s] >= hi[s]) continue;
+		for (int b = lo[s] / width; b <= (hi[s] - 1) / width; b++) bins[b].push_back(s);
+	}
+
+	Util::parallel_for(nslab, nthreads, [&](int b, int tid) {
+		int r0 = b * width, r1 = std::min(nrows, r0 + width);
+		for (vector<size_t>::const_iterator s = bins[b].begin(); s != bins[b].end(); ++s) {
+			splat(*s, std::max(lo[*s], r0), std::min(hi[*s], r1), tid);
+		}
+	});
+}
+
+/* Separable Gaussian factors of one point along one axis, for pixels [lo,hi) around center c. As in the lookup tables
+ * this replaces, the distance is quantized to step pixels, and factors beyond size steps are 0. A table of the
+ * factors may be given, otherwise they are computed with width w (A) and normalization norm. */
+static void gauss_factors(vector<double> &f, int lo, int hi, double c, double step, int size, const double *table,
+		float apix, double w, double norm)
+{
+	double inv_step = 1.0 / step;
+	f.resize(hi > lo ? hi - lo : 0);
+	for (int i = lo; i < hi; i++) {
+		size_t d = size_t (fabs(i - c) * inv_step);
+		if (d >= (size_t)size) f[i-lo] = 0;
+		else if (table) f[i-lo] = table[d];
+		else {
+			double x = -int (d) * step * apix / w;
+			f[i-lo] = norm == 1.0 ? exp(-x * x) : exp(-x * x) / norm;
+		}
+	}
+}
+
 EMData *PointArray::pdb2mrc_by_summation(int map_size, float apix, float res, int addpdbbfactor)
 {
 #ifdef DEBUG
@@ -2284,7 +2347,6 @@ EMData *PointArray::pdb2mrc_by_summation(int map_size, float apix, float res, in
 	double max_table_x = sqrt(-log(min_table_val));	// for exp(-x*x)
 
 	double table_step_size = 0.001;	// number of steps for each pixel
-	double inv_table_step_size = 1.0 / table_step_size;
 	
 //	sort_by_axis(2);			// sort by Z-axis
 
@@ -2293,82 +2355,66 @@ EMData *PointArray::pdb2mrc_by_summation(int map_size, float apix, float res, in
 	map->to_zero();
 	float *pd = map->get_data();
 	
-	vector<double> table;
-	double gauss_real_width;
-	int table_size;
-	int gbox;
-	
-	
-	for ( size_t s = 0; s < get_number_points(); ++s) {
+	// The z range of each point, the points are binned into z slabs by these
+	size_t npoints = get_number_points();
+	vector<int> kmin(npoints), kmax(npoints);
+	vector<double> gauss_real_width(npoints);
+	for ( size_t s = 0; s < npoints; ++s) {
+		if(addpdbbfactor==-1){
+			gauss_real_width[s] = res/M_PI;	// in Angstrom, res is in Angstrom
+		}else{
+			gauss_real_width[s] = (bfactor[s])/(4*sqrt(2.0)*M_PI);	// in Angstrom, res is in Angstrom
+		}
+		int gbox = int (max_table_x * gauss_real_width[s] / apix);	// local box half size in pixels to consider for each point
+		if (gbox <= 0)
+			gbox = 1;
+		double zc = points[4 * s + 2] / apix + map_size / 2;
+		kmin[s] = std::max(int (zc) - gbox, 0);
+		kmax[s] = std::min(int (zc) + gbox, map_size);
+	}
+
+	vector< vector<double> > xfac(Util::get_thread_count(nthreads, map_size)), yfac(xfac.size()), zfac(xfac.size());
+	splat_by_slabs(map_size, nthreads, kmin, kmax, [&](size_t s, int k0, int k1, int tid) {
 		double xc = points[4 * s] / apix + map_size / 2;
 		double yc = points[4 * s + 1] / apix + map_size / 2;
 		double zc = points[4 * s + 2] / apix + map_size / 2;
 		double fval = points[4 * s + 3];
-		
-		//printf("\n bfactor=%f",bfactor[s]);
-		
-		if(addpdbbfactor==-1){
-			gauss_real_width = res/M_PI;	// in Angstrom, res is in Angstrom
-		}else{
-			gauss_real_width = (bfactor[s])/(4*sqrt(2.0)*M_PI);	// in Angstrom, res is in Angstrom
-		}
-		
-		table_size = int (max_table_x * gauss_real_width / (apix * table_step_size) * 1.25);
-		table.resize(table_size);
-		for (int i = 0; i < table_size; i++){
-			table[i] = 0;
-		}
-		
-		for (int i = 0; i < table_size; i++) {						
-			double x = -i * table_step_size * apix / gauss_real_width;
-			if(addpdbbfactor==-1){
-				table[i] =  exp(-x * x);	
-			}
-			else{
-			table[i] =  exp(-x * x)/sqrt(gauss_real_width * gauss_real_width * 2 * M_PI);
-			}
-		}
+		double w = gauss_real_width[s];
+		double norm = addpdbbfactor==-1 ? 1.0 : sqrt(w * w * 2 * M_PI);
 
-		gbox = int (max_table_x * gauss_real_width / apix);	// local box half size in pixels to consider for each point
+		int table_size = int (max_table_x * w / (apix * table_step_size) * 1.25);
+		int gbox = int (max_table_x * w / apix);
 		if (gbox <= 0)
 			gbox = 1;
-		
-		int imin = int (xc) - gbox, imax = int (xc) + gbox;
-		int jmin = int (yc) - gbox, jmax = int (yc) + gbox;
-		int kmin = int (zc) - gbox, kmax = int (zc) + gbox;
-		if (imin < 0)
-			imin = 0;
-		if (jmin < 0)
-			jmin = 0;
-		if (kmin < 0)
-			kmin = 0;
-		if (imax > map_size)
-			imax = map_size;
-		if (jmax > map_size)
-			jmax = map_size;
-		if (kmax > map_size)
-			kmax = map_size;		
-		
-		for (int k = kmin; k < kmax; k++) {
-			size_t table_index_z = size_t (fabs(k - zc) * inv_table_step_size);
-			if ( table_index_z >= table.size() ) continue;
-			double zval = table[table_index_z];
-			size_t pd_index_z = k * map_size * map_size;
+		int i0 = std::max(int (xc) - gbox, 0), imax = std::min(int (xc) + gbox, map_size);
+		int jmin = std::max(int (yc) - gbox, 0), jmax = std::min(int (yc) + gbox, map_size);
+
+		vector<double> &xv = xfac[tid], &yv = yfac[tid], &zv = zfac[tid];
+		gauss_factors(xv, i0, imax, xc, table_step_size, table_size, 0, apix, w, norm);
+		gauss_factors(yv, jmin, jmax, yc, table_step_size, table_size, 0, apix, w, norm);
+		gauss_factors(zv, k0, k1, zc, table_step_size, table_size, 0, apix, w, norm);
+
+		// factors beyond the table are only at the ends of the range
+		int imin = i0;
+		while (imin < imax && xv[imin - i0] == 0) imin++;
+		while (imax > imin && xv[imax - 1 - i0] == 0) imax--;
+
+		for (int k = k0; k < k1; k++) {
+			double zval = zv[k - k0];
+			if ( zval == 0 ) continue;
+			size_t pd_index_z = (size_t)k * map_size * map_size;
 			
 			for (int j = jmin; j < jmax; j++) {
-				size_t table_index_y = size_t (fabs(j - yc) * inv_table_step_size);
-				if ( table_index_y >= table.size() ) continue;
-				double yval = table[table_index_y];
-				size_t pd_index = pd_index_z + j * map_size + imin;
-				for (int i = imin; i < imax; i++, pd_index++) {
-					size_t table_index_x = size_t (fabs(i - xc) * inv_table_step_size);
-					if ( table_index_x >= table.size() ) continue;
-					double xval = table[table_index_x];
-					pd[pd_index] += (float) (fval * zval * yval * xval);
+				double yval = yv[j - jmin];
+				if ( yval == 0 ) continue;
+				double zyval = fval * zval * yval;
+				float *row = pd + pd_index_z + (size_t)j * map_size;
+				for (int i = imin; i < imax; i++) {
+					row[i] += (float) (zyval * xv[i - i0]);
 				}
 			}
 		}
-	}
+	});
 
 	map->update();
 	map->set_attr("apix_x", apix);
@@ -2383,6 +2429,12 @@ EMData *PointArray::pdb2mrc_by_summation(int map_size, float apix, float res, in
 
 
 EMData *PointArray::projection_by_summation(int image_size, float apix, float res)
+{
+	// the identity leaves the coordinates unchanged, so this is the same as summing the points directly
+	return projections_by_summation(image_size, apix, res, vector<Transform>(1))[0]->copy();
+}
+
+vector<std::shared_ptr<EMData>> PointArray::projections_by_summation(int image_size, float apix, float res, const vector<Transform>& xforms)
 {
 	double gauss_real_width = res / (M_PI);	// in Angstrom, res is in Angstrom
 	//if ( gauss_real_width < apix) LOGERR("PointArray::projection_by_summation(): apix(%g) is too large for resolution (%g Angstrom in Fourier space) with %g pixels of 1/e half width", apix, res, gauss_real_width);
@@ -2390,15 +2442,9 @@ EMData *PointArray::projection_by_summation(int image_size, float apix, float re
 	double min_table_val = 1e-7;
 	double max_table_x = sqrt(-log(min_table_val));	// for exp(-x*x)
 
-	//double table_step_size = 0.001;    // number of steps for x=[0,1] in exp(-x*x)
-	//int table_size = int(max_table_x / table_step_size *1.25);
-	//double* table = (double*)malloc(sizeof(double) * table_size);
-	//for(int i=0; i<table_size; i++) table[i]=exp(-i*i*table_step_size*table_step_size);
-
 	double table_step_size = 0.001;	// number of steps for each pixel
-	double inv_table_step_size = 1.0 / table_step_size;
 	int table_size = int (max_table_x * gauss_real_width / (apix * table_step_size) * 1.25);
-	double *table = (double *) malloc(sizeof(double) * table_size);
+	vector<double> table(table_size);
 	for (int i = 0; i < table_size; i++) {
 		double x = -i * table_step_size * apix / gauss_real_width;
 		table[i] = exp(-x * x);
@@ -2407,50 +2453,92 @@ EMData *PointArray::projection_by_summation(int image_size, float apix, float re
 	int gbox = int (max_table_x * gauss_real_width / apix);	// local box half size in pixels to consider for each point
 	if (gbox <= 0)
 		gbox = 1;
-	EMData *proj = new EMData();
-	proj->set_size(image_size, image_size, 1);
-	proj->to_zero();
-	float *pd = proj->get_data();
-	for ( size_t s = 0; s < get_number_points(); ++s) {
-		double xc = points[4 * s] / apix + image_size / 2;
-		double yc = points[4 * s + 1] / apix + image_size / 2;
-		double fval = points[4 * s + 3];
-		int imin = int (xc) - gbox, imax = int (xc) + gbox;
-		int jmin = int (yc) - gbox, jmax = int (yc) + gbox;
-		if (imin < 0)
-			imin = 0;
-		if (jmin < 0)
-			jmin = 0;
-		if (imax > image_size)
-			imax = image_size;
-		if (jmax > image_size)
-			jmax = image_size;
-
-		for (int j = jmin; j < jmax; j++) {
-			//int table_index_y = int(fabs(j-yc)*apix/gauss_real_width/table_step_size);
-			int table_index_y = int (fabs(j - yc) * inv_table_step_size);
-			double yval = table[table_index_y];
-#ifdef DEBUG
-			//double yval2 = exp( - (j-yc)*(j-yc)*apix*apix/(gauss_real_width*gauss_real_width));
-			//if(fabs(yval2-yval)/yval2>1e-2) printf("s=%d\txc,yc=%g,%g\tyval,yval2=%g,%g\tdiff=%g\n",s,xc,yc,yval,yval2,fabs(yval2-yval)/yval2);
-#endif
-			int pd_index = j * image_size + imin;
-			for (int i = imin; i < imax; i++, pd_index++) {
-				//int table_index_x = int(fabs(i-xc)*apix/gauss_real_width/table_step_size);
-				int table_index_x = int (fabs(i - xc) * inv_table_step_size);
-				double xval = table[table_index_x];
-#ifdef DEBUG
-				//double xval2 = exp( - (i-xc)*(i-xc)*apix*apix/(gauss_real_width*gauss_real_width));
-				//if(fabs(xval2-xval)/xval2>1e-2) printf("\ts=%d\txc,yc=%g,%g\txval,xval2=%g,%g\tdiff=%g\n",s,xc,yc,xval,xval2,fabs(xval2-xval)/xval2);
-#endif
-				pd[pd_index] += (float)(fval * yval * xval);
+
+	// With several projections the points are binned once into cells about the size of their footprint and added
+	// cell by cell. Points close in space are close in every projection, so the pixels they touch stay in cache.
+	size_t npoints = get_number_points();
+	int nproj = xforms.size();
+	vector<size_t> order(npoints);
+	for ( size_t s = 0; s < npoints; ++s) order[s] = s;
+	if (nproj > 1) {
+		double cell = 2 * gbox * apix;
+		int ncell = std::max(1, std::min(64, int (image_size * apix / cell) + 1));
+		vector<size_t> start((size_t)ncell * ncell * ncell + 1, 0);
+		vector<int> cellid(npoints);
+		for ( size_t s = 0; s < npoints; ++s) {
+			int c[3];
+			for (int a = 0; a < 3; a++) {
+				c[a] = int (floor(points[4 * s + a] / cell + ncell / 2.0));
+				c[a] = std::min(std::max(c[a], 0), ncell - 1);
+			}
+			cellid[s] = c[0] + ncell * (c[1] + ncell * c[2]);
+			start[cellid[s] + 1]++;
+		}
+		for (size_t c = 1; c < start.size(); c++) start[c] += start[c - 1];
+		for ( size_t s = 0; s < npoints; ++s) order[start[cellid[s]]++] = s;
+	}
+
+	// Projections are computed in parallel, a single projection is split into row slabs instead
+	int inner = nproj == 1 ? Util::get_thread_count(nthreads, image_size) : 1;
+	vector<std::shared_ptr<EMData>> ret(nproj);
+	Util::parallel_for(nproj, Util::get_thread_count(nthreads, nproj), [&](int p, int) {
+		std::shared_ptr<EMData> proj(new EMData());
+		proj->set_size(image_size, image_size, 1);
+		proj->to_zero();
+		float *pd = proj->get_data();
+
+		vector<float> m = xforms[p].get_matrix();
+		auto center = [&](size_t s, double &xc, double &yc) {
+			double x = points[4 * s], y = points[4 * s + 1], z = points[4 * s + 2];
+			xc = (m[0] * x + m[1] * y + m[2] * z + m[3]) / apix + image_size / 2;
+			yc = (m[4] * x + m[5] * y + m[6] * z + m[7]) / apix + image_size / 2;
+		};
+
+		vector< vector<double> > xfac(inner), yfac(inner);
+		auto splat = [&](size_t o, int jmin, int jmax, int tid) {
+			size_t s = order[o];
+			double xc, yc;
+			center(s, xc, yc);
+			double fval = points[4 * s + 3];
+			int imin = std::max(int (xc) - gbox, 0), imax = std::min(int (xc) + gbox, image_size);
+
+			vector<double> &xv = xfac[tid], &yv = yfac[tid];
+			gauss_factors(xv, imin, imax, xc, table_step_size, table_size, table.data(), apix, gauss_real_width, 1.0);
+			gauss_factors(yv, jmin, jmax, yc, table_step_size, table_size, table.data(), apix, gauss_real_width, 1.0);
+			for (int j = jmin; j < jmax; j++) {
+				double yval = fval * yv[j - jmin];
+				float *row = pd + (size_t)j * image_size;
+				for (int i = imin; i < imax; i++) {
+					row[i] += (float)(yval * xv[i - imin]);
+				}
+			}
+		};
+
+		if (inner > 1) {
+			vector<int> jmin(npoints), jmax(npoints);
+			for ( size_t o = 0; o < npoints; ++o) {
+				double xc, yc;
+				center(order[o], xc, yc);
+				jmin[o] = std::max(int (yc) - gbox, 0);
+				jmax[o] = std::min(int (yc) + gbox, image_size);
 			}
+			splat_by_slabs(image_size, inner, jmin, jmax, splat);
 		}
-	}
-	for (int i = 0; i < image_size * image_size; i++)
-		pd[i] /= sqrt(M_PI);
-	proj->update();
-	return proj;
+		else {
+			for ( size_t o = 0; o < npoints; ++o) {
+				double xc, yc;
+				center(order[o], xc, yc);
+				splat(o, std::max(int (yc) - gbox, 0), std::min(int (yc) + gbox, image_size), 0);
+			}
+		}
+
+		for (size_t i = 0; i < (size_t)image_size * image_size; i++)
+			pd[i] /= sqrt(M_PI);
+		proj->update();
+		ret[p] = proj;
+	});
+
+	return ret;
 }
 
 void PointArray::replace_by_summation(EMData *proj, int ind, Vec3f vec, float amp, float apix, float res)
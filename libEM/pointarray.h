@@ -127,6 +127,24 @@ namespace EMAN
 		EMData *pdb2mrc_by_summation(int map_size, float apix, float res, int addpdbbfactor);	// return real space 3-D map
 		EMData *projection_by_nfft(int image_size, float apix, float res = 0);	// return 2-D Fourier Transform
 		EMData *projection_by_summation(int image_size, float apix, float res);	// return 2-D real space image
+
+		/** Projections of the points in many orientations, the same as projection_by_summation of a copy of the points
+		 * transformed by each xform in turn, up to rounding. The points are binned spatially once for all of the
+		 * projections, which are computed in parallel.
+		 * @param image_size size of the square projections
+		 * @param apix sampling in A/pixel
+		 * @param res resolution in A
+		 * @param xforms orientation of each projection, a point p is projected at xform*p
+		 * @return one 2-D real space image for each xform
+		 */
+		vector<std::shared_ptr<EMData>> projections_by_summation(int image_size, float apix, float res, const vector<Transform>& xforms);
+
+		/** Set the number of threads used by pdb2mrc_by_summation, projection_by_summation, projections_by_summation
+		 * and sim_potential. The maps and projections don't depend on the number of threads.
+		 * @param nthreads number of threads, 0 or less means one per core
+		 */
+		void set_threads(int nthreads) { this->nthreads = nthreads; }
+		int get_threads() const { return nthreads; }
 		void replace_by_summation(EMData *image, int i, Vec3f vec, float amp, float apix, float res); // changes a single Gaussian from the projection
 
 		/** Optimizes a pointarray based on a set of projection images (EMData objects)
@@ -221,6 +239,7 @@ namespace EMAN
 		double *points;
 		size_t n;
 		double *bfactor;
+		int nthreads;	// see set_threads
 		
 		// These are used internally for the simple dynamics/minimization code, and are otherwise unallocated
 		// Note that this is NOT for PDB MD, just for simplified point-chains, and mapping points into density
@@ -10537,6 +10537,168 @@ int EMAN::multi_processors(EMData * image, vector < string > processornames)
 	return 0;
 }
 
+// Interpolates one output row of a real image. The source coordinates are linear in i, (x0,y0,z0) at
+// i=0 stepping by (dx,dy,dz). Pixels whose 2x2(x2) neighborhood lies inside the image take the
+// unchecked path; the rest zero pixels mapping outside the image and clamp the neighborhood at the
+// last row/column/section, as the per-pixel code did. Since the coordinates are stepped in double
+// rather than computed per pixel as a float Vec*Transform, results agree with that code to within
+// float rounding, not bit for bit, and a pixel landing exactly on the image border may flip to zero.
+static void transform_real_row(const float *src, float *row, int nx, int ny, int nz,
+		double x0, double y0, double z0, double dx, double dy, double dz)
+{
+	size_t nxy = (size_t)nx*ny;
+
+	// range of i for which 0 <= coord < n-1 in every dimension, with a margin for rounding to float
+	const double margin = 0.01;
+	double lo = 0, hi = nx;
+	const double c0[3] = {x0, y0, z0}, dc[3] = {dx, dy, dz};
+	const int n[3] = {nx, ny, nz};
+	for (int d = 0; d < (nz > 1 ? 3 : 2); d++) {
+		if (dc[d] == 0) {
+			if (c0[d] < margin || c0[d] > n[d]-1-margin) hi = lo;
+		}
+		else {
+			double a = (margin - c0[d])/dc[d], b = (n[d]-1-margin - c0[d])/dc[d];
+			if (a > b) std::swap(a, b);
+			lo = std::max(lo, a);
+			hi = std::min(hi, b);
+		}
+	}
+	lo = ceil(lo) + 1;
+	hi = floor(hi) - 1;
+	int ilo = nx, ihi = nx;
+	if (hi >= lo) {
+		ilo = (int)lo;
+		ihi = (int)hi;
+	}
+
+	for (int i = 0; i < nx; i++) {
+		if (i == ilo) {
+			// interior, no bounds checks needed
+			if (nz == 1) {
+				for (; i < ihi; i++) {
+					float x2 = (float)(x0 + i*dx), y2 = (float)(y0 + i*dy);
+					int ix = (int)x2, iy = (int)y2;
+					const float *p = src + ix + (size_t)iy*nx;
+					row[i] = Util::bilinear_interpolate(p[0], p[1], p[nx], p[nx+1], x2-ix, y2-iy);
+				}
+			}
+			else {
+				for (; i < ihi; i++) {
+					float x2 = (float)(x0 + i*dx), y2 = (float)(y0 + i*dy), z2 = (float)(z0 + i*dz);
+					int ix = (int)x2, iy = (int)y2, iz = (int)z2;
+					const float *p = src + ix + (size_t)iy*nx + iz*nxy;
+					row[i] = Util::trilinear_interpolate(p[0], p[1], p[nx], p[nx+1], p[nxy], p[nxy+1],
+							p[nxy+nx], p[nxy+nx+1], x2-ix, y2-iy, z2-iz);
+				}
+			}
+			if (i >= nx) break;
+		}
+
+		float x2 = (float)(x0 + i*dx), y2 = (float)(y0 + i*dy), z2 = (float)(z0 + i*dz);
+		if (x2 < 0 || y2 < 0 || x2 >= nx || y2 >= ny || (nz > 1 && (z2 < 0 || z2 >= nz))) {
+			row[i] = 0;
+			continue;
+		}
+		int ix = Util::fast_floor(x2);
+		int iy = Util::fast_floor(y2);
+		size_t k0 = ix + (size_t)iy*nx;
+		size_t k1 = k0 + 1;
+		size_t k2 = k0 + nx;
+		size_t k3 = k0 + nx + 1;
+		if (ix == nx - 1) { k1--; k3--; }
+		if (iy == ny - 1) { k2 -= nx; k3 -= nx; }
+		if (nz == 1) {
+			row[i] = Util::bilinear_interpolate(src[k0], src[k1], src[k2], src[k3], x2-ix, y2-iy);
+			continue;
+		}
+		int iz = Util::fast_floor(z2);
+		k0 += iz*nxy; k1 += iz*nxy; k2 += iz*nxy; k3 += iz*nxy;
+		size_t k4 = k0 + nxy, k5 = k1 + nxy, k6 = k2 + nxy, k7 = k3 + nxy;
+		if (iz == nz - 1) { k4 -= nxy; k5 -= nxy; k6 -= nxy; k7 -= nxy; }
+		row[i] = Util::trilinear_interpolate(src[k0], src[k1], src[k2], src[k3], src[k4],
+				src[k5], src[k6], src[k7], x2-ix, y2-iy, z2-iz);
+	}
+}
+
+// Shifts a real image by multiplying its Fourier transform by a phase ramp. The result wraps around
+// periodically rather than being zero filled.
+static void transform_real_phaseshift(const EMData *image, float tx, float ty, float tz, float *des_data)
+{
+	int nx = image->get_xsize();
+	int ny = image->get_ysize();
+	int nz = image->get_zsize();
+	EMData *fft = image->do_fft();
+	int nx2 = fft->get_xsize()/2;
+	float *fd = fft->get_data();
+	size_t l = 0;
+	for (int k = 0; k < nz; k++) {
+		int kz = k <= nz/2 ? k : k-nz;
+		for (int j = 0; j < ny; j++) {
+			int ky = j <= ny/2 ? j : j-ny;
+			double phy = ky*(double)ty/ny + kz*(double)tz/nz;
+			for (int i = 0; i < nx2; i++, l += 2) {
+				double ph = -2.0*M_PI*(i*(double)tx/nx + phy);
+				float c = (float)cos(ph), s = (float)sin(ph);
+				float re = fd[l], im = fd[l+1];
+				fd[l] = re*c - im*s;
+				fd[l+1] = re*s + im*c;
+			}
+		}
+	}
+	fft->update();
+	EMData *shifted = fft->do_ift();
+	memcpy(des_data, shifted->get_const_data(), (size_t)nx*ny*nz*sizeof(float));
+	delete shifted;
+	delete fft;
+}
+
+void TransformProcessor::transform_real(const EMData* const image, const Transform& inv, float *des_data) const
+{
+	int nx = image->get_xsize();
+	int ny = image->get_ysize();
+	int nz = image->get_zsize();
+	size_t nxy = (size_t)nx*ny;
+	const float * const src_data = image->get_const_data();
+	int nthreads = params.set_default("threads",1);
+	vector<float> m = inv.get_matrix();
+	if (nz == 1) m[2] = m[6] = m[8] = m[9] = m[11] = 0;	// as Vec2f * Transform
+
+	bool pure_shift = m[0]==1 && m[1]==0 && m[2]==0 && m[4]==0 && m[5]==1 && m[6]==0 && (nz==1 || (m[8]==0 && m[9]==0 && m[10]==1));
+	if (pure_shift) {
+		int itx = (int)m[3], ity = (int)m[7], itz = (int)m[11];
+		if (itx == m[3] && ity == m[7] && itz == m[11]) {
+			// whole-pixel shift, interpolation would just copy values
+			Util::parallel_for(ny*nz, Util::get_thread_count(nthreads, ny*nz), [&](int jk, int) {
+				int j = jk%ny, k = jk/ny;
+				float *row = des_data + (size_t)jk*nx;
+				int sj = j+ity, sk = k+itz;
+				if (sj < 0 || sj >= ny || sk < 0 || sk >= nz) { std::fill(row, row+nx, 0.0f); return; }
+				const float *srow = src_data + sj*(size_t)nx + sk*nxy;
+				for (int i = 0; i < nx; i++) {
+					int si = i+itx;
+					row[i] = (si < 0 || si >= nx) ? 0.0f : srow[si];
+				}
+			});
+			return;
+		}
+		if ((int)params.set_default("phaseshift",0)) {
+			transform_real_phaseshift(image, -m[3], -m[7], nz == 1 ? 0.0f : -m[11], des_data);
+			return;
+		}
+	}
+
+	// source coordinate of output pixel (i,j,k) is m * (i-nx/2, j-ny/2, k-nz/2) + (nx/2, ny/2, nz/2)
+	Util::parallel_for(ny*nz, Util::get_thread_count(nthreads, nz > 1 ? nz : ny), [&](int jk, int) {
+		int j = jk%ny, k = jk/ny;
+		double xc = -(nx/2), yc = j-ny/2, zc = k-nz/2;
+		double x0 = m[0]*xc + m[1]*yc + m[2]*zc + m[3] + nx/2;
+		double y0 = m[4]*xc + m[5]*yc + m[6]*zc + m[7] + ny/2;
+		double z0 = m[8]*xc + m[9]*yc + m[10]*zc + m[11] + nz/2;
+		transform_real_row(src_data, des_data + (size_t)jk*nx, nx, ny, nz, x0, y0, z0, m[0], m[4], m[8]);
+	});
+}
+
 float* TransformProcessor::transform(const EMData* const image, const Transform& t) const {
 
 	ENTERFUNC;
@@ -10545,7 +10707,6 @@ float* TransformProcessor::transform(const EMData* const image, const Transform&
 	int nx = image->get_xsize();
 	int ny = image->get_ysize();
 	int nz = image->get_zsize();
-	int nxy = nx*ny;
 	int N	= ny;
 
 	int zerocorners = params.set_default("zerocorners",0);
@@ -10554,46 +10715,12 @@ float* TransformProcessor::transform(const EMData* const image, const Transform&
 	const float * const src_data = image->get_const_data();
 	float *des_data = (float *) EMUtil::em_calloc(sizeof(float)*nx,ny*nz);
 
-	if ((nz == 1)&&(image -> is_real()))  {
-		Vec2f offset(nx/2,ny/2);
-		for (int j = 0; j < ny; j++) {
-			for (int i = 0; i < nx; i++) {
-				Vec2f coord(i-nx/2,j-ny/2);
-				Vec2f soln = inv*coord;
-				soln += offset;
-
-				float x2 = soln[0];
-				float y2 = soln[1];
-
-				if (x2 < 0 || x2 >= nx || y2 < 0 || y2 >= ny ) {
-					des_data[i + j * nx] = 0; // It may be tempting to set this value to the
-					// mean but in fact this is not a good thing to do. Talk to S.Ludtke about it.
-				}
-				else {
-					int ii = Util::fast_floor(x2);
-					int jj = Util::fast_floor(y2);
-					int k0 = ii + jj * nx;
-					int k1 = k0 + 1;
-					int k2 = k0 + nx;
-					int k3 = k0 + nx + 1;
-
-					if (ii == nx - 1) {
-						k1--;
-						k3--;
-					}
-					if (jj == ny - 1) {
-						k2 -= nx;
-						k3 -= nx;
-					}
-
-					float t = x2 - ii;
-					float u = y2 - jj;
-
-					des_data[i + j * nx] = Util::bilinear_interpolate(src_data[k0],src_data[k1], src_data[k2], src_data[k3],t,u);
-				}
-			}
-		}
+	if (image->is_real()) {
+		transform_real(image, inv, des_data);
+		EXITFUNC;
+		return des_data;
 	}
+
 	if ((nz == 1)&&(image -> is_complex())&&(nx%2==0)&&((2*(nx-ny)-3)*(2*(nx-ny)-3)==1)&&(zerocorners==0) )	 {
 	  //printf("Hello 2-d complex  TransformProcessor \n");
 	  // make sure there was a realImage.process('xform.phaseorigin.tocorner')
@@ -11392,71 +11519,6 @@ float* TransformProcessor::transform(const EMData* const image, const Transform&
 				  des_data[IndexOut+1] = tempIb;
 		}}}	 // end z, y, x loops through new coordinates
 	}	//	end	 rotations in Fourier Space	 3D
-	if ((nz > 1)&&(image -> is_real())) {
-		size_t l=0, ii, k0, k1, k2, k3, k4, k5, k6, k7;
-		Vec3f offset(nx/2,ny/2,nz/2);
-		float x2, y2, z2, tuvx, tuvy, tuvz;
-		int ix, iy, iz;
-		for (int k = 0; k < nz; ++k) {
-			for (int j = 0; j < ny; ++j) {
-				for (int i = 0; i < nx; ++i,++l) {
-					Vec3f coord(i-nx/2,j-ny/2,k-nz/2);
-					Vec3f soln = inv*coord;
-					soln += offset;
-
-					x2 = soln[0];
-					y2 = soln[1];
-					z2 = soln[2];
-
-					if (x2 < 0 || y2 < 0 || z2 < 0 || x2 >= nx	|| y2 >= ny	 || z2>= nz ) {
-						des_data[l] = 0;
-					}
-					else {
-						ix = Util::fast_floor(x2);
-						iy = Util::fast_floor(y2);
-						iz = Util::fast_floor(z2);
-						tuvx = x2-ix;
-						tuvy = y2-iy;
-						tuvz = z2-iz;
-						ii = ix + iy * nx + iz * nxy;
-
-						k0 = ii;
-						k1 = k0 + 1;
-						k2 = k0 + nx;
-						k3 = k0 + nx+1;
-						k4 = k0 + nxy;
-						k5 = k1 + nxy;
-						k6 = k2 + nxy;
-						k7 = k3 + nxy;
-
-						if (ix == nx - 1) {
-							k1--;
-							k3--;
-							k5--;
-							k7--;
-						}
-						if (iy == ny - 1) {
-							k2 -= nx;
-							k3 -= nx;
-							k6 -= nx;
-							k7 -= nx;
-						}
-						if (iz == nz - 1) {
-							k4 -= nxy;
-							k5 -= nxy;
-							k6 -= nxy;
-							k7 -= nxy;
-						}
-
-						des_data[l] = Util::trilinear_interpolate(src_data[k0],
-								src_data[k1], src_data[k2], src_data[k3], src_data[k4],
-								src_data[k5], src_data[k6], src_data[k7], tuvx, tuvy, tuvz);
-					}
-				}
-			}
-		}
-	}
-
 	EXITFUNC;
 	return des_data;
 }
@@ -2812,6 +2812,8 @@ The data itself will remain stored in single precision floating point format, so
 				d.put("ty", EMObject::FLOAT, "y translation" );
 				d.put("tz", EMObject::FLOAT, "y translation" );
 				d.put("zerocorners",EMObject::INT,"If set, corners (anything beyond radius/2-1) may be zeroed out in real or Fourier space. This will produce a considerable speedup in Fourier rotations. ");
+				d.put("threads",EMObject::INT,"Number of threads used to transform real images, 0 for one per core. default=1");
+				d.put("phaseshift",EMObject::INT,"If set, a real image whose transform is a pure sub-pixel translation is shifted by a Fourier phase ramp instead of being interpolated. This is exact rather than bilinear, but wraps around periodically instead of zero filling. default=0");
 				return d;
 			}
 
@@ -2824,6 +2826,11 @@ The data itself will remain stored in single precision floating point format, so
 
 			float* transform(const EMData* const image, const Transform& t) const;
 		private:
+			/** Real images: whole-pixel shifts are copies, otherwise each output row is interpolated
+			 * from source coordinates stepped along the row, with bounds checks only near the edges.
+			 * Rows are spread over the "threads" parameter. */
+			void transform_real(const EMData* const image, const Transform& inv, float *des_data) const;
+
 			// This function became redundant if favor of EMData::scale_pixel
 			//void update_emdata_attributes(EMData* const image, const Dict& attr_dict, const float& scale) const;
 
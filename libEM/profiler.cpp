@@ -0,0 +1,243 @@
+/*
+ * Copyright (c) 2000- Baylor College of Medicine
+ * 
+ * This software is issued under a joint BSD/GNU license. You may use the
+ * source code in this file under either license. However, note that the
+ * complete EMAN2 and SPARX software packages have some GPL dependencies,
+ * so you are responsible for compliance with the licenses of these packages
+ * if you opt to use BSD licensing. The warranty disclaimer below holds
+ * in either instance.
+ * 
+ * This complete copyright notice must be included in any revised version of the
+ * source code. Additional authorship citations may be added, but existing
+ * author citations must be preserved.
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ * 
+ * */
+
+#include "profiler.h"
+#include "emdata.h"
+
+#include <map>
+#include <mutex>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using namespace EMAN;
+using std::map;
+
+std::atomic<bool> PluginProfiler::enabled(false);
+thread_local size_t PluginProfiler::thread_bytes = 0;
+
+namespace {
+	// call times are histogrammed in buckets 2^(1/4) wide starting at 1 us, covering ~70 minutes
+	const int NBUCKET = 128;
+	const double BUCKET0 = 1.0e-6;
+	const int MAXSIZES = 16;	// distinct image sizes listed per plugin
+
+	struct PluginStats {
+		PluginStats() : count(0), total(0), tmin(0), tmax(0), bytes(0), voxels(0), hist(NBUCKET, 0) {}
+
+		size_t count;
+		double total, tmin, tmax;
+		size_t bytes;
+		double voxels;
+		vector<size_t> hist;
+		map<string, size_t> sizes;
+	};
+
+	struct ProfileData {
+		std::mutex mutex;
+		map<string, map<string, PluginStats> > stats;	// by kind, then by name
+		string exit_file;
+	};
+
+	ProfileData & profile_data()
+	{
+		static ProfileData *data = new ProfileData();	// never destroyed, so it remains usable in atexit
+		return *data;
+	}
+
+	void write_at_exit()
+	{
+		PluginProfiler::write_json(profile_data().exit_file);
+	}
+
+	// Enables profiling from the EMAN2_PROFILE environment variable when the library is loaded
+	struct ProfileEnv {
+		ProfileEnv() {
+			const char *env = getenv("EMAN2_PROFILE");
+			if (env == 0 || env[0] == '\0' || strcmp(env, "0") == 0) return;
+			PluginProfiler::set_enabled(true);
+			if (strcmp(env, "1") != 0) {
+				profile_data().exit_file = env;
+				atexit(write_at_exit);
+			}
+		}
+	} profile_env;
+
+	double now()
+	{
+		return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	// approximate time of the q quantile, at the geometric center of its bucket
+	double percentile(const PluginStats & s, double q)
+	{
+		size_t target = (size_t)ceil(q*s.count);
+		if (target < 1) target = 1;
+		size_t n = 0;
+		for (int b = 0; b < NBUCKET; b++) {
+			n += s.hist[b];
+			if (n >= target) {
+				double t = BUCKET0*pow(2.0, (b+0.5)/4.0);
+				if (t < s.tmin) t = s.tmin;
+				if (t > s.tmax) t = s.tmax;
+				return t;
+			}
+		}
+		return s.tmax;
+	}
+
+	string json_string(const string & s)
+	{
+		string ret = "\"";
+		for (size_t i = 0; i < s.size(); i++) {
+			char c = s[i];
+			if (c == '"' || c == '\\') {
+				ret += '\\';
+				ret += c;
+			}
+			else if ((unsigned char)c < 0x20) {
+				char buf[8];
+				sprintf(buf, "\\u%04x", c);
+				ret += buf;
+			}
+			else ret += c;
+		}
+		return ret + "\"";
+	}
+}
+
+void PluginProfiler::reset()
+{
+	ProfileData & data = profile_data();
+	std::lock_guard<std::mutex> lock(data.mutex);
+	data.stats.clear();
+}
+
+void PluginProfiler::record(const char *kind, const string & name, double seconds, size_t bytes, int nx, int ny, int nz)
+{
+	int b = 0;
+	if (seconds > BUCKET0) b = (int)(4.0*log2(seconds/BUCKET0));
+	if (b >= NBUCKET) b = NBUCKET-1;
+
+	char size[64] = "";
+	if (nx > 0) sprintf(size, "%dx%dx%d", nx, ny, nz);
+
+	ProfileData & data = profile_data();
+	std::lock_guard<std::mutex> lock(data.mutex);
+	PluginStats & s = data.stats[kind][name];
+	if (s.count == 0 || seconds < s.tmin) s.tmin = seconds;
+	if (s.count == 0 || seconds > s.tmax) s.tmax = seconds;
+	s.count++;
+	s.total += seconds;
+	s.bytes += bytes;
+	s.hist[b]++;
+	if (nx > 0) {
+		s.voxels += (double)nx*ny*nz;
+		if (s.sizes.size() < MAXSIZES || s.sizes.count(size)) s.sizes[size]++;
+		else s.sizes["other"]++;
+	}
+}
+
+string PluginProfiler::to_json()
+{
+	ProfileData & data = profile_data();
+	std::lock_guard<std::mutex> lock(data.mutex);
+
+	string ret = "{";
+	char buf[512];
+	map<string, map<string, PluginStats> >::const_iterator kit;
+	for (kit = data.stats.begin(); kit != data.stats.end(); ++kit) {
+		if (kit != data.stats.begin()) ret += ",";
+		ret += "\n " + json_string(kit->first) + ": {";
+
+		map<string, PluginStats>::const_iterator it;
+		for (it = kit->second.begin(); it != kit->second.end(); ++it) {
+			const PluginStats & s = it->second;
+			if (it != kit->second.begin()) ret += ",";
+			sprintf(buf, "{\"count\": %lu, \"total_s\": %.9g, \"mean_s\": %.9g, \"min_s\": %.9g, \"max_s\": %.9g, "
+					"\"p50_s\": %.9g, \"p90_s\": %.9g, \"p99_s\": %.9g, \"bytes_allocated\": %lu, \"mean_voxels\": %.9g, \"sizes\": {",
+					(unsigned long)s.count, s.total, s.total/s.count, s.tmin, s.tmax,
+					percentile(s, 0.5), percentile(s, 0.9), percentile(s, 0.99), (unsigned long)s.bytes, s.voxels/s.count);
+			ret += "\n  " + json_string(it->first) + ": " + buf;
+
+			map<string, size_t>::const_iterator sit;
+			for (sit = s.sizes.begin(); sit != s.sizes.end(); ++sit) {
+				if (sit != s.sizes.begin()) ret += ", ";
+				sprintf(buf, ": %lu", (unsigned long)sit->second);
+				ret += json_string(sit->first) + buf;
+			}
+			ret += "}}";
+		}
+		ret += "\n }";
+	}
+	ret += "\n}\n";
+
+	return ret;
+}
+
+int PluginProfiler::write_json(const string & filename)
+{
+	string json = to_json();
+	FILE *out = fopen(filename.c_str(), "w");
+	if (!out) {
+		LOGERR("Cannot write profile to %s", filename.c_str());
+		return -1;
+	}
+	fputs(json.c_str(), out);
+	fclose(out);
+	return 0;
+}
+
+PluginProfiler::Scope::Scope(const char *kind, const string & name, const EMData * image) :
+	kind(0), nx(0), ny(0), nz(0), start(0), start_bytes(0)
+{
+	if (is_enabled()) begin(kind, name, image);
+}
+
+void PluginProfiler::Scope::begin(const char *kind, const string & name, const EMData * image)
+{
+	this->kind = kind;
+	this->name = name;
+	if (image) {
+		nx = image->get_xsize();
+		ny = image->get_ysize();
+		nz = image->get_zsize();
+	}
+	start_bytes = thread_bytes;
+	start = now();
+}
+
+PluginProfiler::Scope::~Scope()
+{
+	if (!kind) return;
+	record(kind, name, now()-start, thread_bytes-start_bytes, nx, ny, nz);
+}
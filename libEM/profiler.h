@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) 2000- Baylor College of Medicine
+ * 
+ * This software is issued under a joint BSD/GNU license. You may use the
+ * source code in this file under either license. However, note that the
+ * complete EMAN2 and SPARX software packages have some GPL dependencies,
+ * so you are responsible for compliance with the licenses of these packages
+ * if you opt to use BSD licensing. The warranty disclaimer below holds
+ * in either instance.
+ * 
+ * This complete copyright notice must be included in any revised version of the
+ * source code. Additional authorship citations may be added, but existing
+ * author citations must be preserved.
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ * 
+ * */
+
+#ifndef eman__profiler_h__
+#define eman__profiler_h__ 1
+
+#include <cstddef>
+#include <string>
+#include <atomic>
+
+using std::string;
+
+namespace EMAN
+{
+	class EMData;
+
+	/** Optional built-in profiling of plugin calls (processors, comparators, aligners, projectors)
+	 * made through EMData. For each plugin it records the number of calls, the total, minimum,
+	 * maximum and approximate percentile wall times, the bytes of image memory allocated during the
+	 * calls and the sizes of the images processed. Times and allocations are inclusive, so a
+	 * plugin which calls other plugins includes their cost too.
+	 *
+	 * Profiling is off by default, and costs a single flag test per call when off. It can be
+	 * enabled with set_enabled(), or by setting the EMAN2_PROFILE environment variable to 1. If
+	 * EMAN2_PROFILE is set to a file name instead, the statistics are also written to that file
+	 * as JSON when the program exits. Recording is thread-safe.
+	 *
+	 @code
+	 *    PluginProfiler::set_enabled(true);
+	 *    ...
+	 *    PluginProfiler::write_json("profile.json");
+	 @endcode
+	 */
+	class PluginProfiler
+	{
+	  public:
+		static void set_enabled(bool enable) { enabled.store(enable, std::memory_order_relaxed); }
+
+		static bool is_enabled() { return enabled.load(std::memory_order_relaxed); }
+
+		/** Discard all statistics collected so far */
+		static void reset();
+
+		/** Return the statistics as a JSON object, keyed by plugin type ("processor", "cmp", ...)
+		 * then plugin name */
+		static string to_json();
+
+		/** Write the statistics to a file as JSON
+		 * @return 0 on success */
+		static int write_json(const string & filename);
+
+		/** Record one call. Normally done by a Scope
+		 * @param kind plugin type, eg - "processor"
+		 * @param name plugin name
+		 * @param seconds wall time of the call
+		 * @param bytes image memory allocated during the call
+		 * @param nx,ny,nz size of the image the plugin was applied to, 0 if none */
+		static void record(const char *kind, const string & name, double seconds, size_t bytes, int nx, int ny, int nz);
+
+		/** Count memory allocated for image data by the current thread. Called by EMUtil::em_malloc and friends,
+		 * em_realloc only counts the growth of the block */
+		static void count_alloc(size_t bytes) {
+			if (is_enabled()) thread_bytes += bytes;
+		}
+
+		/** Times a plugin call from construction to destruction, if profiling is enabled */
+		class Scope
+		{
+		  public:
+			Scope(const char *kind, const string & name, const EMData * image);
+
+			/** Named after plugin, whose get_name() is only called if profiling is enabled */
+			template <class T>
+			Scope(const char *kind, const T * plugin, const EMData * image) :
+				kind(0), nx(0), ny(0), nz(0), start(0), start_bytes(0)
+			{
+				if (is_enabled()) begin(kind, plugin->get_name(), image);
+			}
+
+			~Scope();
+
+		  private:
+			Scope(const Scope &);
+			Scope & operator=(const Scope &);
+
+			void begin(const char *kind, const string & name, const EMData * image);
+
+			const char *kind;	// NULL if profiling was off when the call started
+			string name;
+			int nx, ny, nz;
+			double start;
+			size_t start_bytes;
+		};
+
+	  private:
+		static std::atomic<bool> enabled;
+		static thread_local size_t thread_bytes;
+	};
+}
+
+#endif	//eman__profiler_h__
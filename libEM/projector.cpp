@@ -66,20 +66,140 @@ template <> Factory < Projector >::Factory()
 //	force_add<XYZProjector>();
 }
 
+Projector::~Projector()
+{
+	clear_prepared();
+}
+
+void Projector::prepare(EMData * image)
+{
+	if (!image) throw NullPointerException("projection volume is NULL");
+	clear_prepared();
+	prepared = image->copy();
+}
+
+void Projector::clear_prepared()
+{
+	if (prepared) {
+		delete prepared;
+		prepared = 0;
+	}
+}
+
+EMData *Projector::project_prepared(const Transform & xform) const
+{
+	if (!prepared) throw NullPointerException("project_prepared() called before prepare()");
+
+	// a private projector, since project3d() takes the orientation from params
+	Dict p = params;
+	Transform t(xform);
+	p["transform"] = &t;
+	Projector *proj = Factory < Projector >::get(get_name(), p);
+	EMData *ret = proj->project3d(prepared);
+	delete proj;
+	return ret;
+}
+
+vector<EMData *> Projector::project_prepared_list(const vector<Transform> & xforms, int nthreads) const
+{
+	if (!prepared) throw NullPointerException("project_prepared_list() called before prepare()");
+
+	int n = xforms.size();
+	vector<EMData *> ret(n, (EMData *)0);
+	if (!is_prepared_thread_safe()) nthreads = 1;
+	try {
+		Util::parallel_for(n, Util::get_thread_count(nthreads, n), [&](int i, int) {
+			ret[i] = project_prepared(xforms[i]);
+		});
+	}
+	catch (...) {
+		for (size_t i = 0; i < ret.size(); i++) delete ret[i];
+		throw;
+	}
+	return ret;
+}
+
+vector<EMData *> Projector::project3d_list(EMData * image, const vector<Transform> & xforms, int nthreads)
+{
+	prepare(image);
+	vector<EMData *> ret;
+	try {
+		ret = project_prepared_list(xforms, nthreads);
+	}
+	catch (...) {
+		clear_prepared();
+		throw;
+	}
+	clear_prepared();
+	return ret;
+}
+
+EMData *GaussFFTProjector::prepare_fft(EMData * image, int mode) const
+{
+	if ( image->get_ndim() != 3 ) throw ImageDimensionException("Error, the projection volume must be 3D");
+
+	EMData *f;
+	if (!image->is_complex()) {
+		EMData *tmp = image->process("xform.phaseorigin.tocorner");
+		f = tmp->do_fft();
+		delete tmp;
+		f->process_inplace("xform.fourierorigin.tocenter");
+	}
+	else {
+		f = image->copy();
+	}
+	f->ap2ri();
+	if (f->is_complex() && mode >= 3) f->setup4slice();	// used by interp_ft_3d modes 3-7, computed once here rather than per pixel
+	return f;
+}
+
+void GaussFFTProjector::prepare(EMData * image)
+{
+	if (!image) throw NullPointerException("projection volume is NULL");
+	// the parameters are read once here, project_prepared() may run in several threads
+	int mode = params["mode"];
+	EMData *f = prepare_fft(image, mode);
+	clear_prepared();
+	prepared = f;
+	prepared_mode = mode;
+	prepared_returnfft = params["returnfft"];
+}
+
+EMData *GaussFFTProjector::project_prepared(const Transform & xform) const
+{
+	if (!prepared) throw NullPointerException("project_prepared() called before prepare()");
+	return project_fft(prepared, xform, prepared_mode, prepared_returnfft);
+}
+
 EMData *GaussFFTProjector::project3d(EMData * image) const
 {
 	Transform* t3d = params["transform"];
 	if ( t3d == NULL ) throw NullPointerException("The transform object (required for projection), was not specified");
-	if ( image->get_ndim() != 3 ) throw ImageDimensionException("Error, the projection volume must be 3D");
+	int mode = params["mode"];
+	int returnfft = params["returnfft"];
 
+	// A complex RI volume is projected as it is. The caller may have changed it since the last
+	// projection, so its setup4slice() table is rebuilt once here, the per pixel lookups reuse it
 	EMData *f = image;
-	if (!image->is_complex()) {
-		image->process_inplace("xform.phaseorigin.tocorner");
-		f = image->do_fft();
-		f->process_inplace("xform.fourierorigin.tocenter");
-		image->process_inplace("xform.phaseorigin.tocenter");
+	try {
+		if (image->get_ndim() != 3) throw ImageDimensionException("Error, the projection volume must be 3D");
+		if (image->is_complex() && image->is_ri()) {
+			if (mode >= 3) image->setup4slice(true);
+		}
+		else f = prepare_fft(image, mode);
 	}
+	catch (...) {
+		delete t3d;
+		throw;
+	}
+	EMData *ret = project_fft(f, *t3d, mode, returnfft);
+	if (f != image) delete f;
+	delete t3d;
+	return ret;
+}
 
+EMData *GaussFFTProjector::project_fft(EMData * f, const Transform & t3d, int mode, int returnfft) const
+{
 	int f_nx = f->get_xsize();
 	int f_ny = f->get_ysize();
 	int f_nz = f->get_zsize();
@@ -89,8 +209,6 @@ EMData *GaussFFTProjector::project3d(EMData * image) const
 		return 0;
 	}
 
-	f->ap2ri();
-
 	EMData *tmp = new EMData();
 	tmp->set_size(f_nx, f_ny, 1);
 	tmp->set_complex(true);
@@ -98,11 +216,10 @@ EMData *GaussFFTProjector::project3d(EMData * image) const
 
 	float *data = tmp->get_data();
 
-	Transform r = t3d->get_rotation_transform();
+	Transform r = t3d.get_rotation_transform();
 	r.invert();
-	float scale = t3d->get_scale();
+	float scale = t3d.get_scale();
 
-	int mode = params["mode"];
 	float gauss_width = 1;
 // 	if ( mode == 0 ) mode = 2;
 	if (mode == 2 ) {
@@ -168,12 +285,11 @@ EMData *GaussFFTProjector::project3d(EMData * image) const
 // 	f->update();
 	tmp->update();
 	
-	int returnfft=params["returnfft"];
 	EMData *ret;
 	if (returnfft==1){
 		//apperently there is something wrong with translating images in fourier space...
 // 		printf("return fft!\n");
-		Vec3f trans=t3d->get_trans();
+		Vec3f trans=t3d.get_trans();
 		ret=tmp->copy();
 		ret->process_inplace("xform.fourierorigin.tocorner");
 		ret->process_inplace("xform", Dict("tx", (float)trans[0], "ty", (float)trans[1]));
@@ -187,9 +303,9 @@ EMData *GaussFFTProjector::project3d(EMData * image) const
 		ret = tmp->do_ift();
 		ret->process_inplace("xform.phaseorigin.tocenter");
 
-		ret->translate(t3d->get_trans());
+		ret->translate(t3d.get_trans());
 
-		if (t3d->get_mirror() ) ret->process_inplace("xform.flip",Dict("axis","x"));
+		if (t3d.get_mirror() ) ret->process_inplace("xform.flip",Dict("axis","x"));
 
 		Dict filter_d;
 		filter_d["gauss_width"] = gauss_width;
@@ -203,11 +319,10 @@ EMData *GaussFFTProjector::project3d(EMData * image) const
 		tmp = 0;
 	}
 
-	ret->set_attr("xform.projection",t3d);
+	Transform tproj(t3d);
+	ret->set_attr("xform.projection",&tproj);
 	ret->update();
 
-	if(t3d) {delete t3d; t3d=0;}
-
 	return ret;
 }
 
@@ -298,7 +413,7 @@ bool GaussFFTProjector::interp_ft_3d(int mode, EMData * image, float x, float y,
 		int y0 = (int) floor(y + .5);
 		int z0 = (int) floor(z + .5);
 
-		float *supp = image->setup4slice();
+		float *supp = image->setup4slice(false);
 
 		if (x0 < nx - 4 && y0 <= ny - 3 && z0 <= nz - 3 && y0 >= 2 && z0 >= 2) {
 			float n = 0;
@@ -348,7 +463,7 @@ bool GaussFFTProjector::interp_ft_3d(int mode, EMData * image, float x, float y,
 		int y0 = (int) floor(y);
 		int z0 = (int) floor(z);
 
-		float *supp = image->setup4slice();
+		float *supp = image->setup4slice(false);
 
 		if (x0 < nx - 4 && y0 <= ny - 3 && z0 <= nz - 3 && y0 >= 2 && z0 >= 2) {
 			float n = 0;
@@ -397,7 +512,7 @@ bool GaussFFTProjector::interp_ft_3d(int mode, EMData * image, float x, float y,
 		int y0 = (int) floor(y + .5);
 		int z0 = (int) floor(z + .5);
 
-		float *supp = image->setup4slice();
+		float *supp = image->setup4slice(false);
 		float *gimx = Interp::get_gimx();
 
 		if (x0 < nx - 4 && y0 <= ny - 3 && z0 <= nz - 3 && y0 >= 2 && z0 >= 2) {
@@ -455,7 +570,7 @@ bool GaussFFTProjector::interp_ft_3d(int mode, EMData * image, float x, float y,
 		int y0 = (int) floor(y + .5);
 		int z0 = (int) floor(z + .5);
 
-		float *supp = image->setup4slice();
+		float *supp = image->setup4slice(false);
 
 		if (x0 < nx - 4 && y0 <= ny - 3 && z0 <= nz - 3 && y0 >= 2 && z0 >= 2) {
 			float n = 0;
@@ -507,7 +622,7 @@ bool GaussFFTProjector::interp_ft_3d(int mode, EMData * image, float x, float y,
 		int y0 = (int) floor(y + .5);
 		int z0 = (int) floor(z + .5);
 
-		float *supp = image->setup4slice();
+		float *supp = image->setup4slice(false);
 
 		if (x0 < nx - 4 && y0 <= ny - 3 && z0 <= nz - 3 && y0 >= 2 && z0 >= 2) {
 			float n = 0;
@@ -1187,18 +1302,33 @@ EMData *MaxValProjector::project3d(EMData * image) const
 // }
 
 
-EMData *FourierGriddingProjector::project3d(EMData * image) const
+FourierGriddingProjector::GriddingParams FourierGriddingProjector::get_gridding_params() const
+{
+	GriddingParams gp;
+	gp.npad = params.has_key("npad") ? int(params["npad"]) : 2;
+	gp.K = params.has_key("kb_K") ? int(params["kb_K"]) : 0;
+	if ( gp.K == 0 ) gp.K = 6;
+	gp.alpha = params.has_key("kb_alpha") ? float(params["kb_alpha"]) : 0.0f;
+	if ( gp.alpha == 0 ) gp.alpha = 1.25;
+	return gp;
+}
+
+// Kaiser-Bessel window used for gridding a volume of size m padded by npad
+static Util::KaiserBessel gridding_kb(int K, float alpha, int npad, int m)
+{
+	const int n = m*npad;
+	return Util::KaiserBessel(alpha, K, (float)(m/2), K/(2.0f*n), n);
+}
+
+EMData *FourierGriddingProjector::prepare_fft(EMData * image, const GriddingParams & gp) const
 {
-	if (!image) {
-		return 0;
-	}
 	if (3 != image->get_ndim())
 		throw ImageDimensionException(
 									  "FourierGriddingProjector needs a 3-D volume");
 	if (image->is_complex())
 		throw ImageFormatException(
 								   "FourierGriddingProjector requires a real volume");
-	const int npad = params.has_key("npad") ? int(params["npad"]) : 2;
+	const int npad = gp.npad;
 	const int nx = image->get_xsize();
 	const int ny = image->get_ysize();
 	const int nz = image->get_zsize();
@@ -1206,13 +1336,7 @@ EMData *FourierGriddingProjector::project3d(EMData * image) const
 		throw ImageDimensionException(
 									  "FourierGriddingProjector requires nx==ny==nz");
 	const int m = Util::get_min(nx,ny,nz);
-	const int n = m*npad;
-
-	int K = params["kb_K"];
-	if ( K == 0 ) K = 6;
-	float alpha = params["kb_alpha"];
-	if ( alpha == 0 ) alpha = 1.25;
-	Util::KaiserBessel kb(alpha, K, (float)(m/2), K/(2.0f*n), n);
+	Util::KaiserBessel kb = gridding_kb(gp.K, gp.alpha, npad, m);
 
 	// divide out gridding weights
 	EMData* tmpImage = image->copy();
@@ -1226,6 +1350,60 @@ EMData *FourierGriddingProjector::project3d(EMData * image) const
 	imgft->fft_shuffle();
 	delete tmpImage;
 
+	// extract_plane() leaves the offsets alone if they are already what it needs, so
+	// projections may then be extracted concurrently
+	int nhalf = (imgft->get_xsize() - 2)/2;
+	imgft->set_array_offsets(0, -nhalf, -nhalf);
+	return imgft;
+}
+
+EMData *FourierGriddingProjector::project_fft(EMData * imgft, int m, const Transform & tf, const GriddingParams & gp) const
+{
+	Util::KaiserBessel kb = gridding_kb(gp.K, gp.alpha, gp.npad, m);
+	EMData* proj = imgft->extract_plane(tf, kb);
+	if (proj->is_shuffled()) proj->fft_shuffle();
+	proj->center_origin_fft();
+	proj->do_ift_inplace();
+	EMData* winproj = proj->window_center(m);
+	delete proj;
+	return winproj;
+}
+
+void FourierGriddingProjector::prepare(EMData * image)
+{
+	if (!image) throw NullPointerException("projection volume is NULL");
+	// the parameters are read once here, project_prepared() may run in several threads
+	GriddingParams gp = get_gridding_params();
+	EMData *imgft = prepare_fft(image, gp);
+	clear_prepared();
+	prepared = imgft;
+	prepared_size = image->get_xsize();
+	prepared_params = gp;
+}
+
+EMData *FourierGriddingProjector::project_prepared(const Transform & xform) const
+{
+	if (!prepared) throw NullPointerException("project_prepared() called before prepare()");
+
+	// only the rotation is used, as in project3d()
+	Dict p = xform.get_rotation("spider");
+	Dict d("type","spider","phi",p["phi"],"theta",p["theta"],"psi",p["psi"]);
+	Transform tf(d);
+	EMData *ret = project_fft(prepared, prepared_size, tf, prepared_params);
+	Transform tproj(xform);
+	ret->set_attr("xform.projection",&tproj);
+	ret->update();
+	return ret;
+}
+
+EMData *FourierGriddingProjector::project3d(EMData * image) const
+{
+	if (!image) {
+		return 0;
+	}
+	const int nx = image->get_xsize();
+	const int ny = image->get_ysize();
+	const int m = nx;
 	// Do we have a list of angles?
 	int nangles = 0;
 	vector<float> anglelist;
@@ -1255,6 +1433,9 @@ EMData *FourierGriddingProjector::project3d(EMData * image) const
 
 	// End David Woolford modifications
 
+	GriddingParams gp = get_gridding_params();
+	EMData* imgft = prepare_fft(image, gp);
+
 	// initialize return object
 	EMData* ret = new EMData();
 	ret->set_size(nx, ny, nangles);
@@ -1264,12 +1445,7 @@ EMData *FourierGriddingProjector::project3d(EMData * image) const
 		int indx = 3*ia;
 		Dict d("type","spider","phi",anglelist[indx],"theta",anglelist[indx+1],"psi",anglelist[indx+2]);
 		Transform tf(d);
-		EMData* proj = imgft->extract_plane(tf, kb);
-		if (proj->is_shuffled()) proj->fft_shuffle();
-		proj->center_origin_fft();
-		proj->do_ift_inplace();
-		EMData* winproj = proj->window_center(m);
-		delete proj;
+		EMData* winproj = project_fft(imgft, m, tf, gp);
 		for (int iy=0; iy < ny; iy++)
 			for (int ix=0; ix < nx; ix++)
 				(*ret)(ix,iy,ia) = (*winproj)(ix,iy);
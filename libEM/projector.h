@@ -77,15 +77,56 @@ namespace EMAN
 	class Projector
 	{
 	  public:
-		virtual ~ Projector()
+		Projector() : prepared(0)
 		{
 		}
 
+		/** The prepared volume is not shared with the copy */
+		Projector(const Projector & p) : params(p.params), prepared(0)
+		{
+		}
+
+		virtual ~ Projector();
+
 		/** Project an 3D image into a 2D image.
 		 * @return A 2D image from the projection.
 		 */
 		virtual EMData *project3d(EMData * image) const = 0;
 
+		/** Prepare a volume for a series of projections. The projector keeps its own
+		 * prepared copy (eg - the padded Fourier transform), so the work is done once rather
+		 * than for every orientation, and image is neither modified nor referenced afterwards.
+		 * @param image The 3D volume to be projected.
+		 */
+		virtual void prepare(EMData * image);
+
+		/** Free the volume kept by prepare() */
+		void clear_prepared();
+
+		/** Project the volume given to prepare() in a single orientation. Projectors
+		 * which project in parallel take their parameters other than "transform" from
+		 * params as they were at prepare(), the others from the current params.
+		 * @param xform The projection orientation.
+		 * @return A 2D image from the projection.
+		 */
+		virtual EMData *project_prepared(const Transform & xform) const;
+
+		/** Project the volume given to prepare() in each of a list of orientations, in
+		 * parallel for projectors which support it (gauss_fft and fourier_gridding).
+		 * @param xforms The projection orientations.
+		 * @param nthreads Number of threads, 0 for one per core.
+		 * @return One new projection per orientation, in the order of xforms.
+		 */
+		vector<EMData *> project_prepared_list(const vector<Transform> & xforms, int nthreads = 0) const;
+
+		/** Convenience for prepare(), project_prepared_list() and clear_prepared().
+		 * @param image The 3D volume to be projected.
+		 * @param xforms The projection orientations.
+		 * @param nthreads Number of threads, 0 for one per core.
+		 * @return One new projection per orientation, in the order of xforms.
+		 */
+		vector<EMData *> project3d_list(EMData * image, const vector<Transform> & xforms, int nthreads = 0);
+
 		/** Back-project a 2D image into a 3D image.
 		 * @return A 3D image from the backprojection.
                  */
@@ -125,7 +166,17 @@ namespace EMAN
 		}
 
 	  protected:
+		/** Whether project_prepared() may be called concurrently from several threads */
+		virtual bool is_prepared_thread_safe() const
+		{
+			return false;
+		}
+
 		Dict params;
+		EMData *prepared;
+
+	  private:
+		Projector & operator=(const Projector &);
 	};
 
 	/** Gaussian FFT 3D projection.
@@ -146,7 +197,7 @@ namespace EMAN
 	class GaussFFTProjector:public Projector
 	{
 	  public:
-		GaussFFTProjector():alt(0), az(0), phi(0)
+		GaussFFTProjector():alt(0), az(0), phi(0), prepared_mode(0), prepared_returnfft(0)
 		{
 		}
 
@@ -154,6 +205,8 @@ namespace EMAN
                 // no implementation yet
 		EMData *backproject3d(EMData * image) const;
 
+		void prepare(EMData * image);
+		EMData *project_prepared(const Transform & xform) const;
 
 		void set_params(const Dict & new_params)
 		{
@@ -189,10 +242,21 @@ namespace EMAN
 		
 		static const string NAME;
 
+	  protected:
+		bool is_prepared_thread_safe() const
+		{
+			return true;
+		}
+
 	  private:
 		float alt, az, phi;
+		/** "mode" and "returnfft" as they were at prepare() */
+		int prepared_mode, prepared_returnfft;
 		bool interp_ft_3d(int mode, EMData * image, float x, float y,
 						  float z, float *data, float gauss_width) const;
+		/** The centered, ri Fourier transform of image, leaving image untouched */
+		EMData *prepare_fft(EMData * image, int mode) const;
+		EMData *project_fft(EMData * f, const Transform & t3d, int mode, int returnfft) const;
 	};
 
 	/** Fourier gridding projection routine.
@@ -203,10 +267,16 @@ namespace EMAN
 	class FourierGriddingProjector:public Projector
 	{
 	  public:
+		FourierGriddingProjector() : prepared_size(0)
+		{
+		}
+
 		EMData * project3d(EMData * image) const;
                 // no implementation yet
 		EMData * backproject3d(EMData * image) const;
 
+		void prepare(EMData * image);
+		EMData * project_prepared(const Transform & xform) const;
 
 		string get_name() const
 		{
@@ -237,6 +307,30 @@ namespace EMAN
 		}
 		
 		static const string NAME;
+
+	  protected:
+		bool is_prepared_thread_safe() const
+		{
+			return true;
+		}
+
+	  private:
+		/** "npad", "kb_K" and "kb_alpha", with their defaults filled in */
+		struct GriddingParams
+		{
+			int npad;
+			int K;
+			float alpha;
+		};
+		GriddingParams get_gridding_params() const;
+
+		/** Gridding corrected, padded and shuffled Fourier transform of image */
+		EMData * prepare_fft(EMData * image, const GriddingParams & gp) const;
+		EMData * project_fft(EMData * imgft, int m, const Transform & tf, const GriddingParams & gp) const;
+		/** Size of the volume given to prepare() */
+		int prepared_size;
+		/** Parameters as they were at prepare() */
+		GriddingParams prepared_params;
 	};
 
 
@@ -688,10 +688,13 @@ void FourierReconstructor::load_default_settings()
 	inserter=0;
 	image=0;
 	tmp_data=0;
+	thread_volumes_dirty=false;
+	insert_direct=false;
 }
 
 void FourierReconstructor::free_memory()
 {
+	free_thread_volumes();
 	if (image) { delete image; image=0; }
 	if (tmp_data) { delete tmp_data; tmp_data=0; }
 	if ( inserter != 0 )
@@ -723,10 +726,80 @@ void FourierReconstructor::load_inserter()
 		delete inserter;
 	}
 
+	// any per-thread inserters belong to the previous volume
+	free_thread_volumes();
+
 	inserter = Factory<FourierPixelInserter3D>::get((string)params["mode"], parms);
 	inserter->init();
 }
 
+void FourierReconstructor::setup_thread_volumes(int nthreads)
+{
+	if ((int)thread_inserters.size() == nthreads) return;
+	merge_thread_volumes();
+	free_thread_volumes();
+
+	for (int t = 0; t < nthreads; t++) {
+		// copy_head keeps the subvolume attributes the inserter needs
+		EMData *timage = image->copy_head();
+		timage->to_zero();
+		EMData *tnorm = new EMData(tmp_data->get_xsize(), tmp_data->get_ysize(), tmp_data->get_zsize());
+		tnorm->to_zero();
+
+		Dict parms;
+		parms["data"] = timage;
+		parms["norm"] = tnorm->get_data();
+		FourierPixelInserter3D *tinserter = Factory<FourierPixelInserter3D>::get((string)params["mode"], parms);
+		tinserter->init();
+
+		thread_images.push_back(timage);
+		thread_norms.push_back(tnorm);
+		thread_inserters.push_back(tinserter);
+	}
+}
+
+void FourierReconstructor::merge_thread_volumes()
+{
+	if (!thread_volumes_dirty) return;
+	thread_volumes_dirty = false;
+
+	float *rdata = image->get_data();
+	float *norm = tmp_data->get_data();
+	size_t nimg = image->get_size();
+	size_t nnorm = tmp_data->get_size();
+
+	// The volumes are summed in blocks by the insertion threads, always in thread order
+	const int nthreads = (int)thread_images.size();
+	const size_t block = 1 << 16;
+	const int nblocks = (int)((nimg + block - 1) / block);
+	Util::parallel_for(nblocks, nthreads, [&](int b, int) {
+		size_t i0 = b * block, i1 = std::min(nimg, i0 + block);
+		size_t n0 = std::min(nnorm, i0 / 2), n1 = b == nblocks - 1 ? nnorm : std::min(nnorm, i1 / 2);
+		for (int t = 0; t < nthreads; t++) {
+			float *trdata = thread_images[t]->get_data();
+			float *tnorm = thread_norms[t]->get_data();
+			for (size_t i = i0; i < i1; i++) { rdata[i] += trdata[i]; trdata[i] = 0; }
+			for (size_t i = n0; i < n1; i++) { norm[i] += tnorm[i]; tnorm[i] = 0; }
+		}
+	});
+
+	image->update();
+	tmp_data->update();
+}
+
+void FourierReconstructor::free_thread_volumes()
+{
+	for (size_t t = 0; t < thread_inserters.size(); t++) {
+		delete thread_inserters[t];
+		delete thread_images[t];
+		delete thread_norms[t];
+	}
+	thread_inserters.clear();
+	thread_images.clear();
+	thread_norms.clear();
+	thread_volumes_dirty = false;
+}
+
 void FourierReconstructor::setup()
 {
 	// default setting behavior - does not override if the parameter is already set
@@ -1016,7 +1089,17 @@ void FourierReconstructor::clear()
 
 	if(zeroimage) image->to_zero();
 	if(zerotmpimg) tmp_data->to_zero();
-	
+
+	for (size_t t = 0; t < thread_images.size(); t++) {
+		thread_images[t]->to_zero();
+		thread_norms[t]->to_zero();
+	}
+	thread_volumes_dirty = false;
+}
+
+void FourierReconstructor::sync()
+{
+	merge_thread_volumes();
 }
 
 EMData* FourierReconstructor::preprocess_slice( const EMData* const slice,  const Transform& t )
@@ -1162,51 +1245,61 @@ void FourierReconstructor::do_insert_slice_work(const EMData* const input_slice,
 		sscale=2.0*(ssnr.size()-1)/iny;
 	}
 	
-	float rweight=weight;
-	for ( vector<Transform>::const_iterator it = syms.begin(); it != syms.end(); ++it ) {
-		Transform t3d = arg*(*it);
-		for (int y = -iny/2; y < iny/2; y++) {
-			for (int x = 0; x < inx/2; x++) {
-
-				float rx = (float) x/(inx-2.0f);	// coords relative to Nyquist=.5
-				float ry = (float) y/iny;
-				if (corners) {
-					if (weight<0) {
-						int r=Util::hypot_fast_int(x,y);
-						rweight=Util::get_max(0.0f,ssnr[int(r*sscale)]);
-					}
-				}
-				else {
+	int nthreads = params.set_default("threads",1);
+	const int nsym = (int)syms.size();
+	const int ystart = (int)(-iny/2);
+	int nrows = 0;
+	for (int y = ystart; y < iny/2; y++) nrows++;
+	// The thread count is resolved against the volume rather than this slice so the set of private
+	// volumes doesn't change from one slice to the next
+	nthreads = insert_direct ? 1 : Util::get_thread_count(nthreads, ny);
+	if (nthreads > 1) {
+		setup_thread_volumes(nthreads);
+		thread_volumes_dirty = true;
+	}
+
+	vector<Transform> t3ds;
+	for ( vector<Transform>::const_iterator it = syms.begin(); it != syms.end(); ++it ) t3ds.push_back(arg*(*it));
+
+	// One work item is one row of the slice in one symmetric orientation. With threads each
+	// thread has its own inserter writing to a private volume
+	Util::parallel_for(nsym*nrows, nthreads, [&](int item, int tid) {
+		FourierPixelInserter3D *tinserter = nthreads == 1 ? inserter : thread_inserters[tid];
+		const Transform & t3d = t3ds[item / nrows];
+		const int y = ystart + item % nrows;
+		float rweight=weight;
+		for (int x = 0; x < inx/2; x++) {
+
+			float rx = (float) x/(inx-2.0f);	// coords relative to Nyquist=.5
+			float ry = (float) y/iny;
+			if (corners) {
+				if (weight<0) {
 					int r=Util::hypot_fast_int(x,y);
-					if (r>iny/2 && abs(inx-iny)<3) continue;	// no filling in Fourier corners...
-
-					if (weight<0) rweight=Util::get_max(0.0f,ssnr[int(r*sscale)]);
+					rweight=Util::get_max(0.0f,ssnr[int(r*sscale)]);
 				}
+			}
+			else {
+				int r=Util::hypot_fast_int(x,y);
+				if (r>iny/2 && abs(inx-iny)<3) continue;	// no filling in Fourier corners...
+
+				if (weight<0) rweight=Util::get_max(0.0f,ssnr[int(r*sscale)]);
+			}
 //				printf("%d\t%f\n",int(r*sscale),rweight);
 
-				Vec3f coord(rx,ry,0);
-				coord = coord*t3d; // transpose multiplication
-				float xx = coord[0]; // transformed coordinates in terms of Nyquist
-				float yy = coord[1];
-				float zz = coord[2];
+			Vec3f coord(rx,ry,0);
+			coord = coord*t3d; // transpose multiplication
+			float xx = coord[0]; // transformed coordinates in terms of Nyquist
+			float yy = coord[1];
+			float zz = coord[2];
 
-				// Map back to real pixel coordinates in output volume
-				xx=xx*(nx-2);
-				yy=yy*ny;
-				zz=zz*nz;
-				
-// 				if (x==10 && y==0) printf("10,0 -> %1.2f,%1.2f,%1.2f\t(%5.2f %5.2f %5.2f   %5.2f %5.2f %5.2f   %5.2f %5.2f %5.2f) %1.0f %d\n",
-// 					xx,yy,zz,t3d.at(0,0),t3d.at(0,1),t3d.at(0,2),t3d.at(1,0),t3d.at(1,1),t3d.at(1,2),t3d.at(2,0),t3d.at(2,1),t3d.at(2,2),inx,nx);
-// 				if (x==0 && y==10 FourierReconstructor:) printf("0,10 -> %1.2f,%1.2f,%1.2f\t(%5.2f %5.2f %5.2f   %5.2f %5.2f %5.2f   %5.2f %5.2f %5.2f)\n",
-// 					xx,yy,zz,t3d.at(0,0),t3d.at(0,1),t3d.at(0,2),t3d.at(1,0),t3d.at(1,1),t3d.at(1,2),t3d.at(2,0),t3d.at(2,1),t3d.at(2,2));
-
-				//printf("%3.1f %3.1f %3.1f\t %1.4f %1.4f\t%1.4f\n",xx,yy,zz,input_slice->get_complex_at(x,y).real(),input_slice->get_complex_at(x,y).imag(),weight);
-//				if (floor(xx)==45 && floor(yy)==45 &&floor(zz)==0) printf("%d. 45 45 0\t %d %d\t %1.4f %1.4f\t%1.4f\n",(int)input_slice->get_attr("n"),x,y,input_slice->get_complex_at(x,y).real(),input_slice->get_complex_at(x,y).imag(),weight);
-//				if (floor(xx)==21 && floor(yy)==21 &&floor(zz)==0) printf("%d. 21 21 0\t %d %d\t %1.4f %1.4f\t%1.4f\n",(int)input_slice->get_attr("n"),x,y,input_slice->get_complex_at(x,y).real(),input_slice->get_complex_at(x,y).imag(),weight);
-				inserter->insert_pixel(xx,yy,zz,input_slice->get_complex_at(x,y),rweight);
-			}
+			// Map back to real pixel coordinates in output volume
+			xx=xx*(nx-2);
+			yy=yy*ny;
+			zz=zz*nz;
+
+			tinserter->insert_pixel(xx,yy,zz,input_slice->get_complex_at(x,y),rweight);
 		}
-	}
+	});
 }
 
 int FourierReconstructor::determine_slice_agreement(EMData*  input_slice, const Transform & arg, const float weight,bool sub)
@@ -1233,6 +1326,9 @@ int FourierReconstructor::determine_slice_agreement(EMData*  input_slice, const
 	rotation->set_scale(1.0);
 	rotation->set_mirror(false);
 	rotation->set_trans(0,0,0);
+	// With threads the comparison is made against the volume as of the last sync(), so the slice
+	// is taken out of that volume directly and put back the same way below
+	insert_direct = true;
 	if (sub) do_insert_slice_work(slice, *rotation, -weight);
 	// Remove the current slice first (not threadsafe, but otherwise performance would be awful)
 	
@@ -1247,6 +1343,7 @@ int FourierReconstructor::determine_slice_agreement(EMData*  input_slice, const
 
 	// Now put the slice back
 	if (sub) do_insert_slice_work(slice, *rotation, weight);
+	insert_direct = false;
 
 	delete rotation;
 	delete slice;
@@ -1550,6 +1647,8 @@ EMData *FourierReconstructor::finish(bool doift)
 {
 // 	float *norm = tmp_data->get_data();
 // 	float *rdata = image->get_data();
+	merge_thread_volumes();
+	free_thread_volumes();
 #ifdef EMAN2_USING_CUDA
 	if(EMData::usecuda == 1 && image->getcudarwdata()){
 		cout << "copy back from CUDA" << endl;
@@ -2957,6 +3056,43 @@ EMData* EMAN::padfft_slice( const EMData* const slice, const Transform& t, int n
 	return padfftslice;
 }
 
+void NNInsertQueue::add(const EMData* padfft, const EMData* ctf2d2, const vector<float> & noise,
+						const vector<Transform> & tins, const vector<float> & w)
+{
+	EMData* fcopy = new EMData(*padfft);
+	owned.push_back(fcopy);
+	nfloats += fcopy->get_size();
+
+	EMData* ccopy = NULL;
+	if (ctf2d2) {
+		ccopy = new EMData(*ctf2d2);
+		owned.push_back(ccopy);
+		nfloats += ccopy->get_size();
+	}
+
+	for (size_t i = 0; i < tins.size(); i++) {
+		padffts.push_back(fcopy);
+		ctfs.push_back(ccopy);
+		bckgnoise.push_back(noise);
+		trans.push_back(tins[i]);
+		weights.push_back(w[i]);
+	}
+	nparticles++;
+}
+
+void NNInsertQueue::clear()
+{
+	for (size_t i = 0; i < owned.size(); i++) checked_delete(owned[i]);
+	owned.clear();
+	padffts.clear();
+	ctfs.clear();
+	bckgnoise.clear();
+	trans.clear();
+	weights.clear();
+	nparticles = 0;
+	nfloats = 0;
+}
+
 
 //####################################################################################
 
@@ -3204,6 +3340,7 @@ void nn4Reconstructor::setup( const string& symmetry, int size, int npad )
 {
 	m_weighting = ESTIMATE;
 	m_wghta = 0.2f;
+	m_nthreads = params.has_key("threads") ? int(params["threads"]) : 1;
 
 	m_symmetry = symmetry;
 	m_npad = npad;
@@ -3221,6 +3358,7 @@ void nn4Reconstructor::setup( const string& symmetry, int size, int npad )
 	m_vnyc = m_vnyp/2;
 	m_vnzc = (m_ndim==3) ? m_vnzp/2 : 1;
 
+	m_queue.clear();
 	buildFFTVolume();
 	buildNormVolume();
 
@@ -3341,14 +3479,32 @@ int nn4Reconstructor::insert_padfft_slice( EMData* padfft, const Transform& t, f
 {
 	Assert( padfft != NULL );
 
+	// all symmetric copies are inserted together, with the volume split between threads
 	vector<Transform> tsym = t.get_sym_proj(m_symmetry);
-	for (unsigned int isym=0; isym < tsym.size(); isym++)  m_volume->nn( m_wptr, padfft, tsym[isym], weight);
+	vector<float> weights(tsym.size(), weight);
+	if (m_nthreads == 1) {
+		vector<EMData*> padffts(tsym.size(), padfft);
+		m_volume->nn_batch( m_wptr, padffts, tsym, weights, m_nthreads );
+	}
+	else {
+		// several particles go to each call, so their orientations spread over the slabs
+		m_queue.add( padfft, NULL, vector<float>(), tsym, weights );
+		if (m_queue.full()) flush_queue();
+	}
 	
 	return 0;
 }
 
+void nn4Reconstructor::flush_queue()
+{
+	if (m_queue.empty()) return;
+	m_volume->nn_batch( m_wptr, m_queue.padffts, m_queue.trans, m_queue.weights, m_nthreads );
+	m_queue.clear();
+}
+
 
 EMData* nn4Reconstructor::finish(bool) {
+	flush_queue();
 
 	if( m_ndim == 3 ) {
 		m_volume->symplane0(m_wptr);
@@ -4217,6 +4373,7 @@ void nn4_ctfReconstructor::setup( const string& symmetry, int size, int npad, fl
 	m_npad = npad;
 	m_sign = sign;
 	m_nsym = Transform::get_nsym(m_symmetry);
+	m_nthreads = params.has_key("threads") ? int(params["threads"]) : 1;
 
 	m_snr = snr;
 
@@ -4232,6 +4389,7 @@ void nn4_ctfReconstructor::setup( const string& symmetry, int size, int npad, fl
 	m_vnyc = m_vnyp/2;
 	m_vnzc = m_vnzp/2;
 
+	m_queue.clear();
 	buildFFTVolume();
 	buildNormVolume();
 }
@@ -4359,20 +4517,41 @@ int nn4_ctfReconstructor::insert_padfft_slice( EMData* padfft, EMData* ctf2d2, c
 		abc_list_len = abc_list.size();
 	}
 				
+	// all symmetric (and smeared) copies are inserted together, with the volume split between threads
 	vector<Transform> tsym = t.get_sym_proj(m_symmetry);
+	vector<Transform> tins;
+	vector<float> weights;
 	for (unsigned int isym=0; isym < tsym.size(); isym++) {
-		if (abc_list_len == 0)
-			m_volume->nn_ctf_exists(m_wptr, padfft, ctf2d2, tsym[isym], weight);
+		if (abc_list_len == 0) {
+			tins.push_back(tsym[isym]);
+			weights.push_back(weight);
+		}
 		else
 			for (int i = 0; i < abc_list_len; i += 4) {
-				m_volume->nn_ctf_exists(m_wptr, padfft, ctf2d2, tsym[isym] * Transform(Dict("type", "SPIDER", "phi",  abc_list[i], "theta", abc_list[i+1], "psi", abc_list[i+2])), weight * abc_list[i+3]);
+				tins.push_back(tsym[isym] * Transform(Dict("type", "SPIDER", "phi",  abc_list[i], "theta", abc_list[i+1], "psi", abc_list[i+2])));
+				weights.push_back(weight * abc_list[i+3]);
 			}
 	}
+	if (m_nthreads == 1) {
+		m_volume->nn_ctf_exists_batch(m_wptr, vector<EMData*>(tins.size(), padfft), vector<EMData*>(tins.size(), ctf2d2), tins, weights, m_nthreads);
+	}
+	else {
+		m_queue.add(padfft, ctf2d2, vector<float>(), tins, weights);
+		if (m_queue.full()) flush_queue();
+	}
 	return 0;
 }
 
+void nn4_ctfReconstructor::flush_queue()
+{
+	if (m_queue.empty()) return;
+	m_volume->nn_ctf_exists_batch(m_wptr, m_queue.padffts, m_queue.ctfs, m_queue.trans, m_queue.weights, m_nthreads);
+	m_queue.clear();
+}
+
 EMData* nn4_ctfReconstructor::finish(bool)
 {
+	flush_queue();
 	m_volume->set_array_offsets(0, 1, 1);
 	m_wptr->set_array_offsets(0, 1, 1);
 	m_volume->symplane0_ctf(m_wptr);
@@ -4521,6 +4700,7 @@ void nn4_ctfwReconstructor::setup( const string& symmetry, int size, int npad, f
 	m_npad = npad;
 	m_sign = sign;
 	m_nsym = Transform::get_nsym(m_symmetry);
+	m_nthreads = params.has_key("threads") ? int(params["threads"]) : 1;
 	m_do_ctf = do_ctf;
 
 	m_snr = snr;
@@ -4540,6 +4720,7 @@ void nn4_ctfwReconstructor::setup( const string& symmetry, int size, int npad, f
 	m_vnyc = m_vnyp/2;
 	m_vnzc = m_vnzp/2;
 
+	m_queue.clear();
 	buildFFTVolume();
 	buildNormVolume();
 	m_refvol = params["refvol"];
@@ -4654,20 +4835,43 @@ int nn4_ctfwReconstructor::insert_padfft_slice_weighted( EMData* padfft, EMData*
 		abc_list_len = abc_list.size();
 	}
 
+	// all symmetric (and smeared) copies are inserted together, with the volume split between threads
 	vector<Transform> tsym = t.get_sym_proj(m_symmetry);
+	vector<Transform> tins;
+	vector<float> weights;
 	for (unsigned int isym=0; isym < tsym.size(); isym++) {
-		if (abc_list_len == 0)
-			m_volume->nn_ctfw(m_wptr, padfft, ctf2d2, m_npad, bckgnoise, tsym[isym], weight);
+		if (abc_list_len == 0) {
+			tins.push_back(tsym[isym]);
+			weights.push_back(weight);
+		}
 		else
-			for (int i = 0; i < abc_list_len; i += 4) 
-				m_volume->nn_ctfw(m_wptr, padfft, ctf2d2, m_npad, bckgnoise, tsym[isym] * Transform(Dict("type", "SPIDER", "phi",  abc_list[i], "theta", abc_list[i+1], "psi", abc_list[i+2])), weight * abc_list[i+3]);
+			for (int i = 0; i < abc_list_len; i += 4) {
+				tins.push_back(tsym[isym] * Transform(Dict("type", "SPIDER", "phi",  abc_list[i], "theta", abc_list[i+1], "psi", abc_list[i+2])));
+				weights.push_back(weight * abc_list[i+3]);
+			}
+	}
+	if (m_nthreads == 1) {
+		size_t nins = tins.size();
+		m_volume->nn_ctfw_batch(m_wptr, vector<EMData*>(nins, padfft), vector<EMData*>(nins, ctf2d2), m_npad, vector< vector<float> >(nins, bckgnoise), tins, weights, m_nthreads);
+	}
+	else {
+		m_queue.add(padfft, ctf2d2, bckgnoise, tins, weights);
+		if (m_queue.full()) flush_queue();
 	}
 	return 0;
 }
 
+void nn4_ctfwReconstructor::flush_queue()
+{
+	if (m_queue.empty()) return;
+	m_volume->nn_ctfw_batch(m_wptr, m_queue.padffts, m_queue.ctfs, m_npad, m_queue.bckgnoise, m_queue.trans, m_queue.weights, m_nthreads);
+	m_queue.clear();
+}
+
 
 EMData* nn4_ctfwReconstructor::finish(bool compensate)
 {
+	flush_queue();
 	m_volume->set_array_offsets(0, 1, 1);
 	m_wptr->set_array_offsets(0, 1, 1);
 	m_refvol->set_array_offsets(0, 1, 1);
@@ -5116,6 +5320,7 @@ void nn4_ctfwsReconstructor::setup( const string& symmetry, int size, int npad,
 	else m_npad = 0;
 	m_sign = sign;
 	m_nsym = Transform::get_nsym(m_symmetry);
+	m_nthreads = params.has_key("threads") ? int(params["threads"]) : 1;
 	m_do_ctf = do_ctf;
 
 	m_snr = snr;
@@ -5135,6 +5340,7 @@ void nn4_ctfwsReconstructor::setup( const string& symmetry, int size, int npad,
 	m_vnyc = m_vnyp/2;
 	m_vnzc = m_vnzp/2;
 
+	m_queue.clear();
 	buildFFTVolume();
 	buildNormVolume();
 	m_refvol = params["refvol"];
@@ -5268,20 +5474,43 @@ int nn4_ctfwsReconstructor::insert_padfft_slice_weighted( EMData* padfft, EMData
 		abc_list_len = abc_list.size();
 	}
 
+	// all symmetric (and smeared) copies are inserted together, with the volume split between threads
 	vector<Transform> tsym = t.get_sym_proj(m_symmetry);
+	vector<Transform> tins;
+	vector<float> weights;
 	for (unsigned int isym=0; isym < tsym.size(); isym++) {
-		if (abc_list_len == 0)
-			m_volume->nn_ctfw(m_wptr, padfft, ctf2d2, m_npad, bckgnoise, tsym[isym], weight);
+		if (abc_list_len == 0) {
+			tins.push_back(tsym[isym]);
+			weights.push_back(weight);
+		}
 		else
-			for (int i = 0; i < abc_list_len; i += 4) 
-				m_volume->nn_ctfw(m_wptr, padfft, ctf2d2, m_npad, bckgnoise, tsym[isym] * Transform(Dict("type", "SPIDER", "phi",  abc_list[i], "theta", abc_list[i+1], "psi", abc_list[i+2])), weight * abc_list[i+3]);
+			for (int i = 0; i < abc_list_len; i += 4) {
+				tins.push_back(tsym[isym] * Transform(Dict("type", "SPIDER", "phi",  abc_list[i], "theta", abc_list[i+1], "psi", abc_list[i+2])));
+				weights.push_back(weight * abc_list[i+3]);
+			}
+	}
+	if (m_nthreads == 1) {
+		size_t nins = tins.size();
+		m_volume->nn_ctfw_batch(m_wptr, vector<EMData*>(nins, padfft), vector<EMData*>(nins, ctf2d2), m_npad, vector< vector<float> >(nins, bckgnoise), tins, weights, m_nthreads);
+	}
+	else {
+		m_queue.add(padfft, ctf2d2, bckgnoise, tins, weights);
+		if (m_queue.full()) flush_queue();
 	}
 	return 0;
 }
 
+void nn4_ctfwsReconstructor::flush_queue()
+{
+	if (m_queue.empty()) return;
+	m_volume->nn_ctfw_batch(m_wptr, m_queue.padffts, m_queue.ctfs, m_npad, m_queue.bckgnoise, m_queue.trans, m_queue.weights, m_nthreads);
+	m_queue.clear();
+}
+
 
 EMData* nn4_ctfwsReconstructor::finish(bool compensate)
 {
+	flush_queue();
 	m_volume->set_array_offsets(0, 1, 1);
 	m_wptr->set_array_offsets(0, 1, 1);
 	m_refvol->set_array_offsets(0, 1, 1);
@@ -183,6 +183,12 @@ namespace EMAN
 		*/
 		virtual void clear() {throw; }
 
+		/** Make everything inserted so far visible to determine_slice_agreement() and projection(). Only
+		 * reconstructors which buffer insertions (for example in private per-thread volumes) need this,
+		 * finish() always does it implicitly.
+		 */
+		virtual void sync() {}
+
 		/** Print the current parameters to std::out
 		 */
 		void print_params() const
@@ -473,6 +479,11 @@ namespace EMAN
 		*/
 		virtual void clear();
 
+		/** Sum the private per-thread volumes used with threads>1 into the volume that
+		 * determine_slice_agreement() and projection() read.
+		 */
+		virtual void sync();
+
 		/** Get the unique name of the reconstructor
 		*/
 		virtual string get_name() const
@@ -510,6 +521,7 @@ namespace EMAN
 			d.put("verbose", EMObject::BOOL, "Optional. Toggles writing useful information to standard out. Default is false.");
 			d.put("quiet", EMObject::BOOL, "Optional. If false, print verbose information.");
 			d.put("subvolume",EMObject::INTARRAY, "Optional. (xorigin,yorigin,zorigin,xsize,ysize,zsize) all in Fourier pixels. Useful for parallelism.");
+			d.put("threads",EMObject::INT, "Optional. Number of threads used to insert each slice. Each thread accumulates into its own private copy of the volume. These are summed by finish() or sync(), and determine_slice_agreement() and projection() only see slices inserted before the last sync(). Default is 1.");
 			d.put("savenorm",EMObject::STRING, "Debug. Will cause the normalization volume to be written directly to the specified file when finish() is called.");
 			
 			d.put("normout",EMObject::EMDATA, "Will write the normalization volume to the given EMData object file when finish() is called.");
@@ -539,6 +551,20 @@ namespace EMAN
 		 */
 		virtual void do_insert_slice_work(const EMData* const input_slice, const Transform & euler,const float weight, const bool corners=false);
 
+		/** Allocate the private accumulation volumes and pixel inserters used by the insertion threads.
+		 * Anything still held by a previous set of volumes is merged first.
+		 * @param nthreads the total number of insertion threads
+		 */
+		void setup_thread_volumes(int nthreads);
+
+		/** Add the private per-thread accumulation volumes into image/tmp_data and zero them.
+		 */
+		void merge_thread_volumes();
+
+		/** Free the per-thread volumes and inserters without merging them
+		 */
+		void free_thread_volumes();
+
 		/** A function to perform the nuts and bolts of comparing an image slice
 		 * @param input_slice the slice to insert into the 3D volume
 		 * @param euler a transform storing the slice euler angle
@@ -554,6 +580,15 @@ namespace EMAN
 		/// A pixel inserter pointer which inserts pixels into the 3D volume using one of a variety of insertion methods
 		FourierPixelInserter3D* inserter;
 
+		/// Private Fourier volumes, normalization volumes and inserters, one per insertion thread when threads>1
+		vector<EMData*> thread_images;
+		vector<EMData*> thread_norms;
+		vector<FourierPixelInserter3D*> thread_inserters;
+		/// Set when a slice was inserted into the private volumes since the last merge
+		bool thread_volumes_dirty;
+		/// Set while determine_slice_agreement() takes a slice out of image/tmp_data and puts it back
+		bool insert_direct;
+
 	  private:
 		 /** Disallow copy construction
   		 */
@@ -1004,6 +1039,50 @@ namespace EMAN
 		vector<Transform> xforms;
 	};
 
+	/** Slices waiting to be inserted by the nn4 family of reconstructors. Inserting one
+	 * particle at a time gives EMData::nn_batch only its symmetric copies, so with C1 or a
+	 * tilt near 0 most z slabs get no work. With more than one thread, particles are copied
+	 * into this queue and inserted NN_QUEUE_PARTICLES at a time (fewer if they reach
+	 * NN_QUEUE_FLOATS), and whatever is left is inserted by sync() or finish(). Until then
+	 * fftvol and weight are missing the queued particles, so a caller which reads or reduces
+	 * them itself (e.g. reduce_EMData_to_root before finish() on one node) must call sync()
+	 * first. With threads=1, the default, nothing is queued.
+	 */
+#define NN_QUEUE_PARTICLES 16
+#define NN_QUEUE_FLOATS (32 << 20)
+
+	class NNInsertQueue
+	{
+	  public:
+		NNInsertQueue() : nparticles(0), nfloats(0) {}
+		~NNInsertQueue() { clear(); }
+
+		/** Queue copies of padfft and ctf2d2 (may be NULL), inserted with each of tins and weights */
+		void add(const EMData* padfft, const EMData* ctf2d2, const vector<float> & bckgnoise,
+				 const vector<Transform> & tins, const vector<float> & weights);
+
+		bool full() const { return nparticles >= NN_QUEUE_PARTICLES || nfloats >= NN_QUEUE_FLOATS; }
+		bool empty() const { return nparticles == 0; }
+
+		/** Delete the queued slices */
+		void clear();
+
+		// one entry per inserted copy, in the order the slices were added
+		vector<EMData*> padffts;
+		vector<EMData*> ctfs;
+		vector< vector<float> > bckgnoise;
+		vector<Transform> trans;
+		vector<float> weights;
+
+	  private:
+		NNInsertQueue(const NNInsertQueue &);
+		NNInsertQueue & operator=(const NNInsertQueue &);
+
+		vector<EMData*> owned;
+		int nparticles;
+		size_t nfloats;
+	};
+
 	/** Direct Fourier inversion Reconstructor
      *
      */
@@ -1032,6 +1111,9 @@ namespace EMAN
 
 		virtual EMData *finish(bool doift=true);
 
+		/** Insert the queued slices into fftvol and weight, see NNInsertQueue */
+		virtual void sync() { flush_queue(); }
+
 		virtual string get_name() const
 		{
 			return NAME;
@@ -1060,6 +1142,7 @@ namespace EMAN
 			d.put("fftvol",		EMObject::EMDATA);
 			d.put("weight",		EMObject::EMDATA);
 			d.put("weighting",  EMObject::INT);
+			d.put("threads",    EMObject::INT, "Optional. Number of threads for inserting slices. With more than one, slices are queued and fftvol and weight are only complete after sync() or finish(). Default is 1.");
 			return d;
 		}
 
@@ -1077,6 +1160,9 @@ namespace EMAN
 		int m_vnx, m_vny, m_vnz;
 		int m_npad;
 		int m_nsym;
+		int m_nthreads;	// threads for slab parallel insertion, see EMData::nn_batch
+		NNInsertQueue m_queue;	// particles waiting for insertion, see NNInsertQueue
+		void flush_queue();
 		int m_ndim;
 		int m_vnzp, m_vnyp, m_vnxp;
 		int m_vnzc, m_vnyc, m_vnxc;
@@ -1300,6 +1386,9 @@ namespace EMAN
 
 		virtual EMData *finish(bool doift=true);
 
+		/** Insert the queued slices into fftvol and weight, see NNInsertQueue */
+		virtual void sync() { flush_queue(); }
+
 		virtual string get_name() const
 		{
 			return NAME;
@@ -1327,6 +1416,7 @@ namespace EMAN
 			d.put("fftvol",		EMObject::EMDATA);
 			d.put("weight",		EMObject::EMDATA);
 			d.put("weighting",  EMObject::INT);
+			d.put("threads",    EMObject::INT, "Optional. Number of threads for inserting slices. With more than one, slices are queued and fftvol and weight are only complete after sync() or finish(). Default is 1.");
 			d.put("varsnr",     EMObject::INT);
 			return d;
 		}
@@ -1353,6 +1443,9 @@ namespace EMAN
 		float m_snr;
 		string m_symmetry;
 		int m_nsym;
+		int m_nthreads;	// threads for slab parallel insertion, see EMData::nn_batch
+		NNInsertQueue m_queue;	// particles waiting for insertion, see NNInsertQueue
+		void flush_queue();
 
 		void buildFFTVolume();
 		void buildNormVolume();
@@ -1388,6 +1481,9 @@ namespace EMAN
 
 		virtual EMData *finish(bool compensate=true);
 
+		/** Insert the queued slices into fftvol and weight, see NNInsertQueue */
+		virtual void sync() { flush_queue(); }
+
 		virtual string get_name() const
 		{
 			return NAME;
@@ -1416,6 +1512,7 @@ namespace EMAN
 			d.put("weight",		EMObject::EMDATA);
 			d.put("refvol",		EMObject::EMDATA);
 			d.put("weighting",  EMObject::INT);
+			d.put("threads",    EMObject::INT, "Optional. Number of threads for inserting slices. With more than one, slices are queued and fftvol and weight are only complete after sync() or finish(). Default is 1.");
 			d.put("varsnr",     EMObject::INT);
 			d.put("do_ctf",     EMObject::INT);
 			return d;
@@ -1445,6 +1542,9 @@ namespace EMAN
 		float  m_snr;
 		string m_symmetry;
 		int    m_nsym;
+		int    m_nthreads;	// threads for slab parallel insertion, see EMData::nn_batch
+		NNInsertQueue m_queue;	// particles waiting for insertion, see NNInsertQueue
+		void flush_queue();
 		int    m_do_ctf;
 
 		void buildFFTVolume();
@@ -1480,6 +1580,9 @@ namespace EMAN
 
 		virtual EMData *finish(bool compensate=true);
 
+		/** Insert the queued slices into fftvol and weight, see NNInsertQueue */
+		virtual void sync() { flush_queue(); }
+
 		virtual string get_name() const
 		{
 			return NAME;
@@ -1508,6 +1611,7 @@ namespace EMAN
 			d.put("weight",		EMObject::EMDATA);
 			d.put("refvol",		EMObject::EMDATA);
 			d.put("weighting",  EMObject::INT);
+			d.put("threads",    EMObject::INT, "Optional. Number of threads for inserting slices. With more than one, slices are queued and fftvol and weight are only complete after sync() or finish(). Default is 1.");
 			d.put("varsnr",     EMObject::INT);
 			d.put("do_ctf",     EMObject::INT);
 			return d;
@@ -1537,6 +1641,9 @@ namespace EMAN
 		float  m_snr;
 		string m_symmetry;
 		int    m_nsym;
+		int    m_nthreads;	// threads for slab parallel insertion, see EMData::nn_batch
+		NNInsertQueue m_queue;	// particles waiting for insertion, see NNInsertQueue
+		void flush_queue();
 		int    m_do_ctf;
 
 		void buildFFTVolume();
@@ -34,6 +34,7 @@
 #include <cstring>
 #include <math.h>
 #include <gsl/gsl_sf_bessel.h>
+#include <mutex>
 #include "reconstructor_tools.h"
 
 
@@ -591,22 +592,45 @@ void FourierInserter3DMode8::init()
 
 }
 
+namespace {
+	// Debugging output of a few pixels, shared by every Mode8 inserter. FourierReconstructor gives
+	// each insertion thread its own inserter, so the files are opened once and written under a lock
+	struct Mode8PixelLog {
+		FILE *out400, *out862, *out962, *out872, *out4093;
+		std::mutex lock;
+
+		Mode8PixelLog() {
+			out400=fopen("pxl4_0_0.txt","w");
+			out862=fopen("pxl8_6_2.txt","w");
+			out962=fopen("pxl9_6_2.txt","w");
+			out872=fopen("pxl8_7_2.txt","w");
+			out4093=fopen("pxl40_9_3.txt","w");
+		}
+
+		void write(FILE *out, const std::complex<float> & dt, float gg) {
+			if (!out) return;
+			std::lock_guard<std::mutex> l(lock);
+			fprintf(out,"%1.4f\t%1.4f\t%1.4f\t%1.4f\t%1.4f\n",dt.real(),dt.imag(),gg,std::abs(dt),std::arg(dt));
+			fflush(out);
+		}
+	};
+
+	Mode8PixelLog & mode8_pixel_log()
+	{
+		static Mode8PixelLog log;
+		return log;
+	}
+}
+
 bool FourierInserter3DMode8::insert_pixel(const float& xx, const float& yy, const float& zz, const std::complex<float> dt,const float& weight)
 {
-	static FILE *out400=NULL,*out862=NULL,*out962,*out872,*out4093=NULL;
+	Mode8PixelLog & plog = mode8_pixel_log();
 	
 	int x0 = (int) floor(xx);
 	int y0 = (int) floor(yy);
 	int z0 = (int) floor(zz);
 
-	if (out400==NULL) {
-		out400=fopen("pxl4_0_0.txt","w");
-		out862=fopen("pxl8_6_2.txt","w");
-		out962=fopen("pxl9_6_2.txt","w");
-		out872=fopen("pxl8_7_2.txt","w");
-		out4093=fopen("pxl40_9_3.txt","w");
-	}
-		
+	
 	// note that subnx differs in the inserters. In the reconstructors it subx0 is 0 for the full volume. Here it is -1
 	if (subx0<0) {			// normal full reconstruction
 		if (x0<-nx2-1 || y0<-ny2-1 || z0<-nz2-1 || x0>nx2 || y0>ny2 || z0>nz2 ) return false;
@@ -640,11 +664,11 @@ bool FourierInserter3DMode8::insert_pixel(const float& xx, const float& yy, cons
 //					off=data->add_complex_at(i,j,k,dt*gg);
 					if (off!=nxyz) norm[off/2]+=gg;
 					
-					if (i==4&&j==0&&k==0) { fprintf(out400,"%1.4f\t%1.4f\t%1.4f\t%1.4f\t%1.4f\n",dt.real(),dt.imag(),gg,std::abs(dt),std::arg(dt)); fflush(out400); }
-					if (i==8&&j==6&&k==2) { fprintf(out862,"%1.4f\t%1.4f\t%1.4f\t%1.4f\t%1.4f\n",dt.real(),dt.imag(),gg,std::abs(dt),std::arg(dt)); fflush(out862); }
-					if (i==9&&j==6&&k==2) { fprintf(out962,"%1.4f\t%1.4f\t%1.4f\t%1.4f\t%1.4f\n",dt.real(),dt.imag(),gg,std::abs(dt),std::arg(dt)); fflush(out962); }
-					if (i==8&&j==7&&k==2) { fprintf(out872,"%1.4f\t%1.4f\t%1.4f\t%1.4f\t%1.4f\n",dt.real(),dt.imag(),gg,std::abs(dt),std::arg(dt)); fflush(out872); }
-					if (i==40&&j==9&&k==3) { fprintf(out4093,"%1.4f\t%1.4f\t%1.4f\t%1.4f\t%1.4f\n",dt.real(),dt.imag(),gg,std::abs(dt),std::arg(dt)); fflush(out4093); }
+					if (i==4&&j==0&&k==0) plog.write(plog.out400, dt, gg);
+					if (i==8&&j==6&&k==2) plog.write(plog.out862, dt, gg);
+					if (i==9&&j==6&&k==2) plog.write(plog.out962, dt, gg);
+					if (i==8&&j==7&&k==2) plog.write(plog.out872, dt, gg);
+					if (i==40&&j==9&&k==3) plog.write(plog.out4093, dt, gg);
 				}
 			}
 		}
@@ -40,6 +40,8 @@
 #include <gsl/gsl_sf_bessel.h>
 #include <gsl/gsl_errno.h>
 #include <vector>
+#include <algorithm>
+#include <functional>
 using std::vector;
 using std::cout;
 using namespace EMAN;
@@ -1214,10 +1216,85 @@ EMData* EMData::average_circ_sub() const
 
 //  Helper functions for method nn
 
+// True if some point of line j of a slice, inserted with transform tf, can land on one of the z
+// planes zlo..zhi of a Fourier volume with nw planes. Coordinates are scaled by scale before
+// rounding. This is conservative, it is only used to skip whole lines in slab parallel insertion.
+static bool line_reaches_slab(int j, int n2, int nw, float scale, const Transform& tf, int zlo, int zhi)
+{
+	float a = tf[0][2]*scale, b = tf[1][2]*scale;	// z = i*a + j*b
+	float c = tf[0][0], d = tf[1][0];		// points with x = i*c + j*d < 0 are conjugated, z -> -z
+
+	float zmin = FLT_MAX, zmax = -FLT_MAX;
+	float ends[3] = { 0.0f, (float)n2, (float)n2 };
+	int nseg = 1;
+	if (c != 0) {
+		float r = -j*d/c;	// x changes sign here
+		if (r > 0 && r < n2) {
+			ends[1] = r;
+			nseg = 2;
+		}
+	}
+	for (int s = 0; s < nseg; s++) {
+		float mid = 0.5f*(ends[s] + ends[s+1]);
+		float sign = (mid*c + j*d < 0) ? -1.0f : 1.0f;
+		for (int e = s; e <= s+1; e++) {
+			float z = sign*(ends[e]*a + j*b);
+			zmin = std::min(zmin, z);
+			zmax = std::max(zmax, z);
+		}
+	}
+
+	// unwrapped plane numbers, with a margin for rounding and trilinear neighbours
+	int lo = (int)floor(zmin) - 2, hi = (int)ceil(zmax) + 2;
+
+	// planes zlo..zhi hold z = zlo-1..zhi-1 for z >= 0, and z = zlo-nw-1..zhi-nw-1 for z < 0
+	if (lo <= zhi-1 && std::max(zlo-1, 0) <= hi) return true;
+	if (lo <= std::min(zhi-nw-1, -1) && zlo-nw-1 <= hi) return true;
+	return false;
+}
+
+// Runs insert(zlo, zhi) for slabs of the z planes 1..nz in parallel. Each slab is written by one
+// thread only, and each call inserts all entries in order, so the result doesn't depend on nthreads.
+static void insert_by_slabs(int nz, int nthreads, const std::function<void (int, int)> & insert)
+{
+	nthreads = Util::get_thread_count(nthreads, nz);
+	if (nthreads == 1) {
+		insert(1, nz);
+		return;
+	}
+
+	// a few slabs per thread, since the number of points per plane varies
+	int nslab = std::min(nz, 4*nthreads);
+	Util::parallel_for(nslab, nthreads, [&](int s, int) {
+		insert(1 + (int)((long)nz*s/nslab), (int)((long)nz*(s+1)/nslab));
+	});
+}
+
+// Sets the array offsets of each distinct image in a list, returning the old ones
+static vector< vector<int> > set_list_offsets(const vector<EMData*>& images, vector<EMData*>& distinct, int yoff)
+{
+	distinct = images;
+	std::sort(distinct.begin(), distinct.end());
+	distinct.erase(std::unique(distinct.begin(), distinct.end()), distinct.end());
+
+	vector< vector<int> > saved;
+	for (size_t i = 0; i < distinct.size(); i++) {
+		saved.push_back(distinct[i]->get_array_offsets());
+		distinct[i]->set_array_offsets(0, yoff);
+	}
+	return saved;
+}
 
-void EMData::onelinenn(int j, int n, int n2, EMData* wptr, EMData* bi, const Transform& tf)
+static void restore_list_offsets(const vector<EMData*>& distinct, const vector< vector<int> >& saved)
+{
+	for (size_t i = 0; i < distinct.size(); i++) distinct[i]->set_array_offsets(saved[i]);
+}
+
+void EMData::onelinenn(int j, int n, int n2, EMData* wptr, EMData* bi, const Transform& tf, int zlo, int zhi)
 {
         //std::cout<<"   onelinenn  "<<j<<"  "<<n<<"  "<<n2<<"  "<<std::endl;
+	if (zhi < 0) zhi = nz;
+	else if (!line_reaches_slab(j, n2, n, 1.0f, tf, zlo, zhi)) return;
 	int nnd4 = n*n/4;
 	int jp = (j >= 0) ? j+1 : n+j+1;
 	//for(int i = 0; i <= 2; i++){{for(int l = 0; l <= 2; l++) std::cout<<"  "<<tf[l][i];}std::cout<<std::endl;};std::cout<<std::endl;
@@ -1249,6 +1326,7 @@ void EMData::onelinenn(int j, int n, int n2, EMData* wptr, EMData* bi, const Tra
 			else	      iya = n + iyn + 1;
 
             //cout <<"  "<<jp<<"  "<<i<<"  "<<j<<"  "<< btq<<endl;
+			if (iza < zlo || iza > zhi) continue;
 
 			cmplx(ixn,iya,iza) += btq;
 			//std::cout<<"    "<<j<<"  "<<ixn<<"  "<<iya<<"  "<<iza<<"  "<<btq<<std::endl;
@@ -1284,9 +1362,11 @@ void EMData::onelinenn(int j, int n, int n2, EMData* wptr, EMData* bi, const Tra
 }
 
 
-void EMData::onelinenn_mult(int j, int n, int n2, EMData* wptr, EMData* bi, const Transform& tf, float mult)
+void EMData::onelinenn_mult(int j, int n, int n2, EMData* wptr, EMData* bi, const Transform& tf, float mult, int zlo, int zhi)
 {
         //std::cout<<"   onelinenn  "<<j<<"  "<<n<<"  "<<n2<<"  "<<std::endl;
+	if (zhi < 0) zhi = nz;
+	else if (!line_reaches_slab(j, n2, n, 1.0f, tf, zlo, zhi)) return;
 	int jp = (j >= 0) ? j+1 : n+j+1;
 	//for(int i = 0; i <= 1; i++){for(int l = 0; l <= 2; l++){std::cout<<"  "<<tf[i][l]<<"  "<<std::endl;}}
 	// loop over x
@@ -1317,6 +1397,7 @@ void EMData::onelinenn_mult(int j, int n, int n2, EMData* wptr, EMData* bi, cons
 			if (iyn >= 0) iya = iyn + 1;
 			else	      iya = n + iyn + 1;
 
+			if (iza < zlo || iza > zhi) continue;
 			cmplx(ixn,iya,iza) += btq * mult;
 			(*wptr)(ixn,iya,iza)+= mult;
 			
@@ -1371,6 +1452,35 @@ void EMData::nn(EMData* wptr, EMData* myfft, const Transform& tf, float mult)
 	EXITFUNC;
 }
 
+void EMData::nn_batch(EMData* wptr, const vector<EMData*>& myffts, const vector<Transform>& tfs, const vector<float>& mults, int nthreads)
+{
+	ENTERFUNC;
+	size_t nentry = tfs.size();
+	if (myffts.size() != nentry || mults.size() != nentry) {
+		throw InvalidParameterException("nn_batch: myffts, tfs and mults must have the same length");
+	}
+
+	int nxc = attr_dict["nxc"]; // # of complex elements along x
+	vector<int> saved_offsets = get_array_offsets();
+	set_array_offsets(0,1,1);
+	vector<EMData*> ffts;
+	vector< vector<int> > ffts_saved_offsets = set_list_offsets(myffts, ffts, 1);
+
+	insert_by_slabs(nz, nthreads, [&](int zlo, int zhi) {
+		for (size_t k = 0; k < nentry; k++) {
+			if( mults[k] == 1 ) {
+				for (int iy = -ny/2 + 1; iy <= ny/2; iy++) onelinenn(iy, ny, nxc, wptr, myffts[k], tfs[k], zlo, zhi);
+			} else {
+				for (int iy = -ny/2 + 1; iy <= ny/2; iy++) onelinenn_mult(iy, ny, nxc, wptr, myffts[k], tfs[k], mults[k], zlo, zhi);
+			}
+		}
+	});
+
+	set_array_offsets(saved_offsets);
+	restore_list_offsets(ffts, ffts_saved_offsets);
+	EXITFUNC;
+}
+
 
 void EMData::insert_rect_slice(EMData* w, EMData* myfft, const Transform& trans, int sizeofprojection, float xratio, float yratio, float zratio, int npad, float mult)
 {
@@ -2055,8 +2165,10 @@ void EMData::onelinenn_ctfw(int j, int n, int n2,
 
 //  Helper functions for method nn4_ctfw with tri-linear interpolation
 void EMData::onelinetr_ctfw(int j, int bign, int n, int n2, int npad,
-		          EMData* w, EMData* bi, EMData* c2, vector<float> bckgnoise, const Transform& tf, float weight) {
+		          EMData* w, EMData* bi, EMData* c2, const vector<float>& bckgnoise, const Transform& tf, float weight, int zlo, int zhi) {
 //std::cout<<"   onelinetr_ctfw  "<<j<<"  "<<n<<"   "<<bign<<"  "<<n<<"  "<<n2<<"  "<<npad<<std::endl;
+	if (zhi < 0) zhi = nz;
+	else if (!line_reaches_slab(j, n2, bign, (float)npad, tf, zlo, zhi)) return;
 
 	int nnd4 = n*n/4;
 	int jp = (j >= 0) ? j+1 : n+j+1;
@@ -2164,24 +2276,35 @@ void EMData::onelinetr_ctfw(int j, int bign, int n, int n2, int npad,
 	if(iy1<1 or iy1 >bign)  cout<<"  error   iy1  "<<iy1<<endl;
 	if(iz1<1 or iz1 >bign)  cout<<"  error   iz1  "<<iz1<<endl;
 */
+			bool za = (iza >= zlo && iza <= zhi);
+			bool z1 = (iz1 >= zlo && iz1 <= zhi);
+
 			// numerator
-			cmplx(ixn, iya, iza) += qq000 * numerator;
-			cmplx(ixn, iy1, iza) += qq010 * numerator;
-			cmplx(ix1, iya, iza) += qq100 * numerator;
-			cmplx(ix1, iy1, iza) += qq110 * numerator;
-			cmplx(ixn, iya, iz1) += qq001 * numerator;
-			cmplx(ixn, iy1, iz1) += qq011 * numerator;
-			cmplx(ix1, iya, iz1) += qq101 * numerator;
-			cmplx(ix1, iy1, iz1) += qq111 * numerator;
+			if (za) {
+				cmplx(ixn, iya, iza) += qq000 * numerator;
+				cmplx(ixn, iy1, iza) += qq010 * numerator;
+				cmplx(ix1, iya, iza) += qq100 * numerator;
+				cmplx(ix1, iy1, iza) += qq110 * numerator;
+			}
+			if (z1) {
+				cmplx(ixn, iya, iz1) += qq001 * numerator;
+				cmplx(ixn, iy1, iz1) += qq011 * numerator;
+				cmplx(ix1, iya, iz1) += qq101 * numerator;
+				cmplx(ix1, iy1, iz1) += qq111 * numerator;
+			}
 			// denominator
-			(*w)(ixn, iya, iza) += qq000 * denominator;
-			(*w)(ixn, iy1, iza) += qq010 * denominator;
-			(*w)(ix1, iy1, iza) += qq110 * denominator;
-			(*w)(ix1, iya, iza) += qq100 * denominator;
-			(*w)(ixn, iya, iz1) += qq001 * denominator;
-			(*w)(ixn, iy1, iz1) += qq011 * denominator;
-			(*w)(ix1, iya, iz1) += qq101 * denominator;
-			(*w)(ix1, iy1, iz1) += qq111 * denominator;
+			if (za) {
+				(*w)(ixn, iya, iza) += qq000 * denominator;
+				(*w)(ixn, iy1, iza) += qq010 * denominator;
+				(*w)(ix1, iy1, iza) += qq110 * denominator;
+				(*w)(ix1, iya, iza) += qq100 * denominator;
+			}
+			if (z1) {
+				(*w)(ixn, iya, iz1) += qq001 * denominator;
+				(*w)(ixn, iy1, iz1) += qq011 * denominator;
+				(*w)(ix1, iya, iz1) += qq101 * denominator;
+				(*w)(ix1, iy1, iz1) += qq111 * denominator;
+			}
 
 
 		}
@@ -2235,9 +2358,11 @@ void EMData::onelinenn_ctf_applied(int j, int n, int n2,
 }
 
 void EMData::onelinenn_ctf_exists(int j, int n, int n2,
-		          EMData* w, EMData* bi, EMData* c2, const Transform& tf, float weight) {
+		          EMData* w, EMData* bi, EMData* c2, const Transform& tf, float weight, int zlo, int zhi) {
 	//std::cout<<"   onelinenn_ctf  "<<j<<"  "<<n<<"  "<<n2<<"  "<<std::endl;
     //int remove = bi->get_attr_default( "remove", 0 );
+	if (zhi < 0) zhi = nz;
+	else if (!line_reaches_slab(j, n2, n, 1.0f, tf, zlo, zhi)) return;
 
 	int nnd4 = n*n/4;
 	int jp = (j >= 0) ? j+1 : n+j+1;
@@ -2271,6 +2396,8 @@ void EMData::onelinenn_ctf_exists(int j, int n, int n2,
 			if (iyn >= 0) iya = iyn + 1;
 			else          iya = n + iyn + 1;
 
+			if (iza < zlo || iza > zhi) continue;
+
 			//if( remove > 0 ) {
 			//	cmplx(ixn,iya,iza) -= btq*weight;
 			//	(*w)(ixn,iya,iza) -= c2val*weight;
@@ -2326,6 +2453,34 @@ void EMData::nn_ctfw(EMData* w, EMData* myfft, EMData* ctf2d2, int npad, vector<
 	EXITFUNC;
 }
 
+void EMData::nn_ctfw_batch(EMData* w, const vector<EMData*>& myffts, const vector<EMData*>& ctf2d2s, int npad, const vector< vector<float> >& bckgnoises, const vector<Transform>& tfs, const vector<float>& weights, int nthreads)
+{
+	ENTERFUNC;
+	size_t nentry = tfs.size();
+	if (myffts.size() != nentry || ctf2d2s.size() != nentry || bckgnoises.size() != nentry || weights.size() != nentry) {
+		throw InvalidParameterException("nn_ctfw_batch: myffts, ctf2d2s, bckgnoises, tfs and weights must have the same length");
+	}
+
+	vector<int> saved_offsets = get_array_offsets();
+	set_array_offsets(0,1,1);
+	vector<EMData*> slices(myffts);
+	slices.insert(slices.end(), ctf2d2s.begin(), ctf2d2s.end());
+	vector<EMData*> distinct;
+	vector< vector<int> > slices_saved_offsets = set_list_offsets(slices, distinct, 1);
+
+	insert_by_slabs(nz, nthreads, [&](int zlo, int zhi) {
+		for (size_t k = 0; k < nentry; k++) {
+			int mynx = myffts[k]->get_xsize()/2;
+			int myny = myffts[k]->get_ysize();
+			for (int iy = -myny/2 + 1; iy <= myny/2; iy++) onelinetr_ctfw(iy, ny, myny, mynx, npad, w, myffts[k], ctf2d2s[k], bckgnoises[k], tfs[k], weights[k], zlo, zhi);
+		}
+	});
+
+	set_array_offsets(saved_offsets);
+	restore_list_offsets(distinct, slices_saved_offsets);
+	EXITFUNC;
+}
+
 void EMData::nn_ctf_applied(EMData* w, EMData* myfft, const Transform& tf, float mult) {
 	ENTERFUNC;
 	int nxc = attr_dict["nxc"]; // # of complex elements along x
@@ -2366,6 +2521,33 @@ void EMData::nn_ctf_exists(EMData* w, EMData* myfft, EMData* ctf2d2, const Trans
 	EXITFUNC;
 }
 
+void EMData::nn_ctf_exists_batch(EMData* w, const vector<EMData*>& myffts, const vector<EMData*>& ctf2d2s, const vector<Transform>& tfs, const vector<float>& weights, int nthreads)
+{
+	ENTERFUNC;
+	size_t nentry = tfs.size();
+	if (myffts.size() != nentry || ctf2d2s.size() != nentry || weights.size() != nentry) {
+		throw InvalidParameterException("nn_ctf_exists_batch: myffts, ctf2d2s, tfs and weights must have the same length");
+	}
+
+	int nxc = attr_dict["nxc"]; // # of complex elements along x
+	vector<int> saved_offsets = get_array_offsets();
+	set_array_offsets(0,1,1);
+	vector<EMData*> slices(myffts);
+	slices.insert(slices.end(), ctf2d2s.begin(), ctf2d2s.end());
+	vector<EMData*> distinct;
+	vector< vector<int> > slices_saved_offsets = set_list_offsets(slices, distinct, 1);
+
+	insert_by_slabs(nz, nthreads, [&](int zlo, int zhi) {
+		for (size_t k = 0; k < nentry; k++) {
+			for (int iy = -ny/2 + 1; iy <= ny/2; iy++) onelinenn_ctf_exists(iy, ny, nxc, w, myffts[k], ctf2d2s[k], tfs[k], weights[k], zlo, zhi);
+		}
+	});
+
+	set_array_offsets(saved_offsets);
+	restore_list_offsets(distinct, slices_saved_offsets);
+	EXITFUNC;
+}
+
 void EMData::insert_rect_slice_ctf(EMData* w, EMData* myfft, const Transform& trans, int sizeofprojection, float xratio, float yratio, float zratio, int npad, float mult)
 {
 	ENTERFUNC;
@@ -5304,8 +5486,11 @@ EMData* EMData::extract_plane(const Transform& tf, Util::KaiserBessel& kb) {
 	// Array offsets: (0..nhalf,-nhalf..nhalf-1,-nhalf..nhalf-1)
 	int n = nxreal;
 	int nhalf = n/2;
+	// the offsets are only changed if needed, so several threads may extract planes from a volume
+	// whose offsets were set up in advance
 	vector<int> saved_offsets = get_array_offsets();
-	set_array_offsets(0,-nhalf,-nhalf);
+	bool set_offsets = (saved_offsets[0] != 0 || saved_offsets[1] != -nhalf || saved_offsets[2] != -nhalf);
+	if (set_offsets) set_array_offsets(0,-nhalf,-nhalf);
 	res->set_array_offsets(0,-nhalf,0);
 	// set up some temporary weighting arrays
 	int kbsize =  kb.get_window_size();
@@ -5478,7 +5663,7 @@ EMData* EMData::extract_plane(const Transform& tf, Util::KaiserBessel& kb) {
 		for (int jx = 0; jx <= nhalf; jx++)
 			res->cmplx(jx,jy) *= count/wsum;
 	delete[] wx0; delete[] wy0; delete[] wz0;
-	set_array_offsets(saved_offsets);
+	if (set_offsets) set_array_offsets(saved_offsets);
 	res->set_array_offsets(0,0,0);
 	res->set_shuffled(true);
 	return res;
@@ -166,10 +166,12 @@ EMData* average_circ_sub() const;
  * @param wptr Normalization matrix [0:n2][1:n][1:n]
  * @param bi Fourier transform matrix [0:n2][1:n]
  * @param tf Transform reference
+ * @param zlo first z plane (1 based) which may be updated
+ * @param zhi last z plane which may be updated, <0 for the last plane of the volume
  */
-void onelinenn(int j, int n, int n2, EMData* wptr, EMData* bi, const Transform& tf);
+void onelinenn(int j, int n, int n2, EMData* wptr, EMData* bi, const Transform& tf, int zlo=1, int zhi=-1);
 
-void onelinenn_mult(int j, int n, int n2, EMData* wptr, EMData* bi, const Transform& tf, float mult);
+void onelinenn_mult(int j, int n, int n2, EMData* wptr, EMData* bi, const Transform& tf, float mult, int zlo=1, int zhi=-1);
 
 /** Nearest Neighbor interpolation.
  *  Modifies the current object.
@@ -180,6 +182,19 @@ void onelinenn_mult(int j, int n, int n2, EMData* wptr, EMData* bi, const Transf
  * @param mult
  */
 void nn(EMData* wptr, EMData* myfft, const Transform& tf, float mult=1);
+
+/** Nearest Neighbor interpolation of a list of slices, the same as calling nn()
+ *  for each entry in turn. The z planes of the volume are split into slabs, and
+ *  each slab is updated by one thread which inserts every entry in order, so the
+ *  result is identical to the serial loop for any number of threads.
+ *
+ * @param wptr Normalization data.
+ * @param myffts FFT data of each entry, the same slice may be listed several times
+ * @param tfs Transform of each entry
+ * @param mults weight of each entry
+ * @param nthreads number of threads, <=0 for one per core
+ */
+void nn_batch(EMData* wptr, const vector<EMData*>& myffts, const vector<Transform>& tfs, const vector<float>& mults, int nthreads=0);
 void insert_rect_slice( EMData* w, EMData* myfft,const Transform& trans, int sizeofprojection, float xratio, float yratio, float zratio, int npad, float mult);
 
 /** Nearest Neighbor interpolation, meanwhile return necessary data such as
@@ -286,7 +301,7 @@ void onelinenn_ctfw(int j, int n, int n2, EMData* w, EMData* bi, EMData* c2, vec
  * @param tf Transform reference
  * @param mult
  */
-void onelinetr_ctfw(int j, int bign, int n, int n2, int npad, EMData* w, EMData* bi, EMData* c2, vector<float> bckgnoise, const Transform& tf, float weight);
+void onelinetr_ctfw(int j, int bign, int n, int n2, int npad, EMData* w, EMData* bi, EMData* c2, const vector<float>& bckgnoise, const Transform& tf, float weight, int zlo=1, int zhi=-1);
 
 
 /** Nearest Neighbor interpolation.
@@ -317,7 +332,7 @@ void insert_rect_slice_ctf_applied(EMData* w, EMData* myfft, const Transform& tr
  * @param mult
  */
 void onelinenn_ctf_applied(int j, int n, int n2, EMData* w, EMData* bi, const Transform& tf, float mult);
-void onelinenn_ctf_exists(int j, int n, int n2, EMData* w, EMData* bi, EMData* c2, const Transform& tf, float weight);
+void onelinenn_ctf_exists(int j, int n, int n2, EMData* w, EMData* bi, EMData* c2, const Transform& tf, float weight, int zlo=1, int zhi=-1);
 
 /** Nearest Neighbor interpolation.
  *  Modifies the current object.
@@ -332,6 +347,10 @@ void nn_ctf_applied(EMData* w, EMData* myfft, const Transform& tf, float mult );
 
 void nn_ctf_exists(EMData* w, EMData* myfft, EMData* ctf2d2, const Transform& tf, float weight);
 
+/** nn_ctf_exists() for a list of slices, see nn_batch().
+ */
+void nn_ctf_exists_batch(EMData* w, const vector<EMData*>& myffts, const vector<EMData*>& ctf2d2s, const vector<Transform>& tfs, const vector<float>& weights, int nthreads=0);
+
 /** Helper functions for method nn4_ctf.
  *
  * @param j y fourier index (frequency)
@@ -344,6 +363,10 @@ void nn_ctf_exists(EMData* w, EMData* myfft, EMData* ctf2d2, const Transform& tf
  */
 void nn_ctfw(EMData* w, EMData* myfft, EMData* ctf2d2, int npad, vector<float> bckgnoise, const Transform& tf, float weight);
 
+/** nn_ctfw() for a list of slices, see nn_batch().
+ */
+void nn_ctfw_batch(EMData* w, const vector<EMData*>& myffts, const vector<EMData*>& ctf2d2s, int npad, const vector< vector<float> >& bckgnoises, const vector<Transform>& tfs, const vector<float>& weights, int nthreads=0);
+
 
 /** Symmetrize volume in real space.
  *
@@ -295,24 +295,12 @@ Output: 1-2-3D real image with the result
 					case CORRELATION:
 					// fpmat:=fpmat*conjg(gpmat)
 					// Note nxp are padded dimensions
-						for (int iz = 1; iz <= nzp; iz++) {
-							for (int iy = 1; iy <= nyp; iy++) {
-								for (int ix = 1; ix <= lsd2; ix++) {
-									fp->cmplx(ix,iy,iz) *= conj(gp->cmplx(ix,iy,iz));
-								}
-							}
-						}
+						Util::array_mult_complex(fp->get_data(), gp->get_data(), (size_t)lsd2*nyp*nzp, true);
 					break;
 					case CONVOLUTION:
 					// fpmat:=fpmat*gpmat
 					// Note nxp are padded dimensions
-						for (int iz = 1; iz <= nzp; iz++) {
-							for (int iy = 1; iy <= nyp; iy++) {
-								for (int ix = 1; ix <= lsd2; ix++) {
-									fp->cmplx(ix,iy,iz) *= gp->cmplx(ix,iy,iz);
-								}
-							}
-						}
+						Util::array_mult_complex(fp->get_data(), gp->get_data(), (size_t)lsd2*nyp*nzp, false);
 						break;
 					default:
 						LOGERR("Illegal option in Fourier Product");
@@ -421,13 +409,7 @@ Output: 1-2-3D real image with the result
 					break;
 				case CORRELATION:
 					//phase_mult = 1;
-					for (int iz = 1; iz <= nzp; iz++) {
-						for (int iy = 1; iy <= nyp; iy++) {
-							for (int ix = 1; ix <= lsd2; ix++) {
-								fp->cmplx(ix,iy,iz)*= conj(gp->cmplx(ix,iy,iz));
-							}
-						}
-					}
+					Util::array_mult_complex(fp->get_data(), gp->get_data(), (size_t)lsd2*nyp*nzp, true);
 					break;
 				case CONVOLUTION:
 					if(npad == 1) {
@@ -445,13 +427,7 @@ Output: 1-2-3D real image with the result
 							}
 						}
 					} else {
-						for (int iz = 1; iz <= nzp; iz++) {
-							for (int iy = 1; iy <= nyp; iy++) {
-								for (int ix = 1; ix <= lsd2; ix++) {
-									fp->cmplx(ix,iy,iz)*= gp->cmplx(ix,iy,iz);
-								}
-							}
-						}
+						Util::array_mult_complex(fp->get_data(), gp->get_data(), (size_t)lsd2*nyp*nzp, false);
 					}
 					break;
 				default:
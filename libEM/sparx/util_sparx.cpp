@@ -8979,13 +8979,13 @@ c       automatic arrays
 	return  retvals;
 }
 
-Dict Util::Crosrng_ms(EMData* circ1p, EMData* circ2p, vector<int> numr, float delta_psi) {
+// The body of Crosrng_ms on raw ring data, also used by MultiRefPolarAligner. q and t are work arrays of
+// maxrin doubles, which are cleared here.
+static void crosrng_ms_raw(const float *circ1, const float *circ2, const vector<int> &numr, float delta_psi,
+                           double *q, double *t, double &qn, float &tot, double &qm, float &tmt) {
 	int nring = numr.size()/3;
 	//int lcirc = numr[3*nring-2]+numr[3*nring-1]-1;
 	int maxrin = numr[numr.size()-1];
-	double qn; float tot; double qm; float tmt;
-	float *circ1 = circ1p->get_data();
-	float *circ2 = circ2p->get_data();
 /*
 c
 c  checks both straight & mirrored positions
@@ -8998,7 +8998,7 @@ c
 	// dimension		 circ1(lcirc),circ2(lcirc)
 
 	// t(maxrin), q(maxrin), t7(-3:3)  //maxrin+2 removed
-	double *t, *q, t7[7];
+	double t7[7];
 
 	int   ip, jc, numr3i, numr2i, i, j, k, jtot = 0;
 	float t1, t2, t3, t4, c1, c2, d1, d2, pos;
@@ -9017,11 +9017,11 @@ c
 	//  c - straight  = circ1 * conjg(circ2)
 	//  zero q array
 
-	q = (double*)calloc(maxrin,sizeof(double));
+	memset(q,0,maxrin*sizeof(double));
 
 	//   t - mirrored  = conjg(circ1) * conjg(circ2)
 	//   zero t array
-	t = (double*)calloc(maxrin,sizeof(double));
+	memset(t,0,maxrin*sizeof(double));
 
    //   premultiply  arrays ie( circ12 = circ1 * circ2) much slower
 	for (i=1; i<=nring; i++) {
@@ -9079,7 +9079,7 @@ c
 	}
 
 	//for (j=1; j<=maxrin; j++) cout <<"  "<<j<<"   "<<q(j) <<"   "<<t(j) <<endl;
-	fftr_d(q,ip);
+	Util::fftr_d(q,ip);
 
 	qn  = -1.0e20;
 
@@ -9106,11 +9106,11 @@ c
 		}
 
 		// interpolate
-		prb1d(t7,7,&pos);
+		Util::prb1d(t7,7,&pos);
 		tot = (float)(jtot)+pos;
 	}
 	// mirrored
-	fftr_d(t,ip);
+	Util::fftr_d(t,ip);
 
 	// find angle
 	qm = -1.0e20;
@@ -9139,9 +9139,17 @@ c
 
 		// interpolate
 
-		prb1d(t7,7,&pos);
+		Util::prb1d(t7,7,&pos);
 		tmt = float(jtot) + pos;
 	}
+}
+
+Dict Util::Crosrng_ms(EMData* circ1p, EMData* circ2p, vector<int> numr, float delta_psi) {
+	int maxrin = numr[numr.size()-1];
+	double qn; float tot; double qm; float tmt;
+	double *q = (double*)malloc(maxrin*sizeof(double));
+	double *t = (double*)malloc(maxrin*sizeof(double));
+	crosrng_ms_raw(circ1p->get_data(), circ2p->get_data(), numr, delta_psi, q, t, qn, tot, qm, tmt);
 	free(t);
 	free(q);
 
@@ -26357,6 +26365,238 @@ vector<float> Util::multiref_polar_ali_2d_peaklist(EMData* image, const vector<
 	return peak;
 }
 
+Util::MultiRefPolarAligner::MultiRefPolarAligner(const vector<EMData*>& crefim, vector<int> numr_in, string mode_in, int nthreads_in)
+	: numr(numr_in), mode(mode_in), nthreads(nthreads_in)
+{
+	if (numr.size() < 3 || numr.size()%3 != 0) throw InvalidValueException(numr.size(), "numr must hold 3 values per ring");
+	int nring = numr.size()/3;
+	lcirc = numr[3*nring-2]+numr[3*nring-1]-1;
+	nref = crefim.size();
+
+	refs.resize((size_t)nref*lcirc);
+	for (int i = 0; i < nref; i++) {
+		if (crefim[i]->get_size() < (size_t)lcirc) throw ImageDimensionException("reference rings are shorter than numr requires");
+		memcpy(&refs[(size_t)i*lcirc], crefim[i]->get_const_data(), lcirc*sizeof(float));
+	}
+}
+
+void Util::MultiRefPolarAligner::scan(const vector<EMData*>& images, size_t first, size_t count, const vector<float>& xrng,
+		const vector<float>& yrng, float step, const vector<float>& cnx, const vector<float>& cny,
+		vector<Grid>& grids, vector<Match>& matches) const
+{
+	// the search grid of each image, laid out as in multiref_polar_ali_2d
+	grids.resize(count);
+	size_t nshift = 0;
+	for (size_t n = 0; n < count; n++) {
+		size_t im = first+n;
+		size_t ir = xrng.size() == 2 ? 0 : 2*im;
+		size_t ic = cnx.size() == 1 ? 0 : im;
+		Grid &g = grids[n];
+		g.lkx = int(xrng[ir]/step);
+		g.rkx = int(xrng[ir+1]/step);
+		ir = yrng.size() == 2 ? 0 : 2*im;
+		g.lky = int(yrng[ir]/step);
+		g.rky = int(yrng[ir+1]/step);
+		g.cnx = cnx[ic];
+		g.cny = cny[cny.size() == 1 ? 0 : im];
+		g.first = nshift;
+		nshift += (size_t)std::max(0, g.rkx+g.lkx+1)*std::max(0, g.rky+g.lky+1);
+	}
+	vector<int> shift_image(nshift);
+	for (size_t n = 0; n < count; n++) {
+		size_t end = n+1 < count ? grids[n+1].first : nshift;
+		for (size_t k = grids[n].first; k < end; k++) shift_image[k] = n;
+	}
+
+	// polar rings of every image at every shift
+	vector<float> rings(nshift*lcirc);
+	Util::parallel_for(nshift, Util::get_thread_count(nthreads, nshift), [&](int k, int) {
+		const Grid &g = grids[shift_image[k]];
+		int nx = g.rkx+g.lkx+1;
+		int i = (k-g.first)/nx - g.lky;
+		int j = (k-g.first)%nx - g.lkx;
+		float iy = i * step;
+		float ix = j * step;
+		EMData* cimage = Util::Polar2Dm(images[first+shift_image[k]], g.cnx+ix, g.cny+iy, numr, mode);
+		Util::Normalize_ring(cimage, numr, 0);
+		Util::Frngs(cimage, numr);
+		memcpy(&rings[(size_t)k*lcirc], cimage->get_const_data(), lcirc*sizeof(float));
+		delete cimage;
+	});
+
+	// every ring against a block of references, so the block stays in cache
+	const int rblock = 16;
+	int nrblock = (nref+rblock-1)/rblock;
+	int ntask = nshift*nrblock;
+	int nthr = Util::get_thread_count(nthreads, ntask);
+	int maxrin = numr[numr.size()-1];
+	vector<vector<double> > work(nthr, vector<double>(2*maxrin));
+	matches.resize(nshift*nref);
+	Util::parallel_for(ntask, nthr, [&](int task, int tid) {
+		size_t k = task/nrblock;
+		int r0 = (task%nrblock)*rblock;
+		int r1 = std::min(r0+rblock, nref);
+		double *q = &work[tid][0];
+		double *t = q+maxrin;
+		for (int r = r0; r < r1; r++) {
+			Match &m = matches[k*nref+r];
+			crosrng_ms_raw(&refs[(size_t)r*lcirc], &rings[k*lcirc], numr, 0.0f, q, t, m.qn, m.tot, m.qm, m.tmt);
+		}
+	});
+}
+
+void Util::MultiRefPolarAligner::for_batches(const vector<EMData*>& images, const vector<float>& xrng, const vector<float>& yrng,
+		float step, const vector<float>& cnx, const vector<float>& cny,
+		const std::function<void (size_t, size_t, const vector<Grid>&, const vector<Match>&)>& func) const
+{
+	size_t nima = images.size();
+	if (xrng.size() != 2 && xrng.size() != 2*nima) throw InvalidValueException(xrng.size(), "xrng must have 2 values, or 2 per image");
+	if (yrng.size() != 2 && yrng.size() != 2*nima) throw InvalidValueException(yrng.size(), "yrng must have 2 values, or 2 per image");
+	if (cnx.size() != 1 && cnx.size() != nima) throw InvalidValueException(cnx.size(), "cnx must have 1 value, or 1 per image");
+	if (cny.size() != 1 && cny.size() != nima) throw InvalidValueException(cny.size(), "cny must have 1 value, or 1 per image");
+
+	// keep the matches for a batch to about 64 MB
+	const size_t max_matches = (64u<<20)/sizeof(Match);
+	vector<Grid> grids;
+	vector<Match> matches;
+	size_t first = 0;
+	while (first < nima) {
+		size_t count = 0, nmatch = 0;
+		while (first+count < nima) {
+			size_t im = first+count;
+			size_t ir = xrng.size() == 2 ? 0 : 2*im;
+			size_t nx = std::max(0, int(xrng[ir+1]/step)+int(xrng[ir]/step)+1);
+			ir = yrng.size() == 2 ? 0 : 2*im;
+			size_t ny = std::max(0, int(yrng[ir+1]/step)+int(yrng[ir]/step)+1);
+			size_t n = nx*ny*nref;
+			if (count > 0 && nmatch+n > max_matches) break;
+			nmatch += n;
+			count++;
+		}
+		scan(images, first, count, xrng, yrng, step, cnx, cny, grids, matches);
+		func(first, count, grids, matches);
+		first += count;
+	}
+}
+
+vector<float> Util::MultiRefPolarAligner::align(const vector<EMData*>& images, vector<float> xrng, vector<float> yrng,
+		float step, vector<float> cnx, vector<float> cny) const
+{
+	const float qv = static_cast<float>( pi/180.0 );
+	vector<float> res(images.size()*6);
+
+	for_batches(images, xrng, yrng, step, cnx, cny, [&](size_t first, size_t count, const vector<Grid>& grids, const vector<Match>& matches) {
+		// pick the peak exactly as multiref_polar_ali_2d does
+		Util::parallel_for(count, Util::get_thread_count(nthreads, count), [&](int n, int) {
+			const Grid &g = grids[n];
+			const Match *m = &matches[g.first*nref];
+			int   nref_best=0, mirror=0;
+			float iy, ix, sx=0, sy=0;
+			float peak = -1.0E23f;
+			float ang=0.0f;
+			for (int i = -g.lky; i <= g.rky; i++) {
+				iy = i * step ;
+				for (int j = -g.lkx; j <= g.rkx; j++) {
+					ix = j*step ;
+					for (int iref = 0; iref < nref; iref++, m++) {
+						double qn = m->qn;
+						double qm = m->qm;
+						if(qn >= peak || qm >= peak) {
+							sx = -ix;
+							sy = -iy;
+							nref_best = iref;
+							if (qn >= qm) {
+								ang = ang_n(m->tot, mode, numr[numr.size()-1]);
+								peak = static_cast<float>(qn);
+								mirror = 0;
+							} else {
+								ang = ang_n(m->tmt, mode, numr[numr.size()-1]);
+								peak = static_cast<float>(qm);
+								mirror = 1;
+							}
+						}
+					}
+				}
+			}
+
+			float co, so, sxs, sys;
+			co = static_cast<float>(  cos(ang*qv) );
+			so = static_cast<float>( -sin(ang*qv) );
+			sxs = sx*co - sy*so;
+			sys = sx*so + sy*co;
+			float *r = &res[(first+n)*6];
+			r[0] = ang;
+			r[1] = sxs;
+			r[2] = sys;
+			r[3] = static_cast<float>(mirror);
+			r[4] = static_cast<float>(nref_best);
+			r[5] = peak;
+		});
+	});
+	return res;
+}
+
+vector<float> Util::MultiRefPolarAligner::align_peaklist(const vector<EMData*>& images, vector<float> xrng, vector<float> yrng,
+		float step, vector<float> cnx, vector<float> cny) const
+{
+	const float qv = static_cast<float>( pi/180.0 );
+	vector<float> res(images.size()*nref*5);
+
+	for_batches(images, xrng, yrng, step, cnx, cny, [&](size_t first, size_t count, const vector<Grid>& grids, const vector<Match>& matches) {
+		// pick the peaks exactly as multiref_polar_ali_2d_peaklist does
+		Util::parallel_for(count, Util::get_thread_count(nthreads, count), [&](int n, int) {
+			const Grid &g = grids[n];
+			const Match *m = &matches[g.first*nref];
+			float *peak = &res[(first+n)*nref*5];
+			for (int iref = 0; iref < nref; iref++) {
+				peak[iref*5] = -1.0e23f;
+				peak[iref*5+1] = 0.0f;
+				peak[iref*5+2] = 0.0;
+				peak[iref*5+3] = 0.0;
+				peak[iref*5+4] = 0;
+			}
+
+			float iy, ix;
+			for (int i = -g.lky; i <= g.rky; i++) {
+				iy = i * step ;
+				for (int j = -g.lkx; j <= g.rkx; j++) {
+					ix = j*step ;
+					for (int iref = 0; iref < nref; iref++, m++) {
+						double qn = m->qn;
+						double qm = m->qm;
+						if(qn >= peak[iref*5] || qm >= peak[iref*5]) {
+							peak[iref*5+2] = -ix;
+							peak[iref*5+3] = -iy;
+							if (qn >= qm) {
+								peak[iref*5] = static_cast<float>(qn);
+								peak[iref*5+1] = ang_n(m->tot, mode, numr[numr.size()-1]);
+								peak[iref*5+4] = 0;
+							} else {
+								peak[iref*5] = static_cast<float>(qm);
+								peak[iref*5+1] = ang_n(m->tmt, mode, numr[numr.size()-1]);
+								peak[iref*5+4] = 1;
+							}
+						}
+					}
+				}
+			}
+
+			for (int iref = 0; iref < nref; iref++) {
+				float ang = peak[iref*5+1];
+				float sx  = peak[iref*5+2];
+				float sy  = peak[iref*5+3];
+				float co  =  cos(ang*qv);
+				float so  = -sin(ang*qv);
+				float sxs = sx*co - sy*so;
+				float sys = sx*so + sy*co;
+				peak[iref*5+2] = sxs;
+				peak[iref*5+3] = sys;
+			}
+		});
+	});
+	return res;
+}
+
 vector<float> Util::multiref_polar_ali_2d_peaklist_local(EMData* image, const vector< EMData* >& crefim,
                 vector<float> xrng, vector<float> yrng, float step, float ant, string mode,
                 vector<int>numr, float cnx, float cny) {
@@ -1083,6 +1083,54 @@ public:
                 vector<float> xrng, vector<float> yrng, float step, float ant, string mode,
                 vector< int >numr, float cnx, float cny);
 
+	/** Aligns batches of images against one set of references, with the same results as calling
+	 * multiref_polar_ali_2d or multiref_polar_ali_2d_peaklist for each image. The reference rings
+	 * (Fourier transformed, weights applied) are copied once into one contiguous array. For each batch
+	 * of images, the polar rings at every shift and then the image shift x reference comparisons are
+	 * spread over threads. The peaks are finally picked in the original order, so ties resolve the
+	 * same way.
+	 *
+	 * The per-image arguments xrng, yrng (2 values per image), cnx and cny (1 value per image) may
+	 * instead be given once for all images.
+	 */
+	class MultiRefPolarAligner
+	{
+	public:
+		MultiRefPolarAligner(const vector<EMData*>& crefim, vector<int> numr, string mode, int nthreads=0);
+
+		/** @return 6 values per image, as from multiref_polar_ali_2d */
+		vector<float> align(const vector<EMData*>& images, vector<float> xrng, vector<float> yrng,
+		                    float step, vector<float> cnx, vector<float> cny) const;
+
+		/** @return 5*nref values per image, as from multiref_polar_ali_2d_peaklist */
+		vector<float> align_peaklist(const vector<EMData*>& images, vector<float> xrng, vector<float> yrng,
+		                             float step, vector<float> cnx, vector<float> cny) const;
+
+		int get_nref() const { return nref; }
+
+	private:
+		/** Crosrng_ms result for one image shift against one reference */
+		struct Match { double qn, qm; float tot, tmt; };
+
+		/** The search grid for one image */
+		struct Grid { int lkx, rkx, lky, rky; float cnx, cny; size_t first; };
+
+		/** Fills grids and matches for images [first, first+count), shift-major and reference-minor */
+		void scan(const vector<EMData*>& images, size_t first, size_t count, const vector<float>& xrng,
+		          const vector<float>& yrng, float step, const vector<float>& cnx, const vector<float>& cny,
+		          vector<Grid>& grids, vector<Match>& matches) const;
+
+		/** Calls func(first, count, grids, matches) for batches of images small enough to keep the matches in memory */
+		void for_batches(const vector<EMData*>& images, const vector<float>& xrng, const vector<float>& yrng,
+		                 float step, const vector<float>& cnx, const vector<float>& cny,
+		                 const std::function<void (size_t, size_t, const vector<Grid>&, const vector<Match>&)>& func) const;
+
+		vector<float> refs;		// nref x lcirc
+		vector<int> numr;
+		string mode;
+		int nref, lcirc, nthreads;
+	};
+
 	/* In this version order of rotation/shift is not changed*/
 	static vector<float> multiref_polar_ali_3d(EMData* image, const vector< EMData* >& crefim,
                 vector<float> xrng, vector<float> yrng, float step, string mode,
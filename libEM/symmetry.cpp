@@ -35,6 +35,8 @@
 #include "exception.h"
 #include "util.h"
 
+#include <mutex>
+
 using namespace EMAN;
 
 const string CSym::NAME = "c";
@@ -167,21 +169,92 @@ map<string, vector<string> > EMAN::dump_orientgens_list()
 vector<Transform> Symmetry3D::gen_orientations(const string& generatorname, const Dict& parms)
 {
 	ENTERFUNC;
+	std::shared_ptr<const vector<float> > table = gen_orientation_table(generatorname, parms);
+
+	size_t n = table->size()/12;
 	vector<Transform> ret;
-	OrientationGenerator *g = Factory < OrientationGenerator >::get(Util::str_to_lower(generatorname), parms);
-	if (g) {
-		ret = g->gen_orientations(this);
-		if( g )
-		{
-			delete g;
-			g = 0;
+	ret.reserve(n);
+	for (size_t i = 0; i < n; ++i) ret.push_back(Transform(&(*table)[i*12]));
+
+	EXITFUNC;
+
+	return ret;
+}
+
+// Appends a key identifying a Dict by value to key, for the orientation table cache.
+// Returns false if the Dict contains values which can't be compared this way
+static bool dict_key(const Dict& d, string& key)
+{
+	char val[32];
+	vector<string> keys = d.keys();
+	sort(keys.begin(), keys.end());
+	for (vector<string>::const_iterator it = keys.begin(); it != keys.end(); ++it) {
+		EMObject obj = d[*it];
+		switch (obj.get_type()) {
+		case EMObject::BOOL:
+		case EMObject::SHORT:
+		case EMObject::INT:
+		case EMObject::UNSIGNEDINT:
+		case EMObject::STRING:
+			key += *it + "=" + obj.to_str() + ";";
+			break;
+		case EMObject::FLOAT:
+		case EMObject::DOUBLE:
+			sprintf(val, "%.17g", (double)obj);
+			key += *it + "=" + val + ";";
+			break;
+		default:
+			return false;
 		}
 	}
+	return true;
+}
+
+std::shared_ptr<const vector<float> > Symmetry3D::gen_orientation_table(const string& generatorname, const Dict& parms)
+{
+	static std::mutex cache_mutex;
+	static map<string, std::shared_ptr<const vector<float> > > cache;
+	const size_t max_tables = 32;
+
+	string gname = Util::str_to_lower(generatorname);
+
+	// random generators, or generators asked for random phi/perturbation, must regenerate every time
+	bool cacheable = gname != RandomOrientationGenerator::NAME;
+	if (parms.has_key("random_phi") && (bool)parms["random_phi"]) cacheable = false;
+	if (parms.has_key("perturb") && (bool)parms["perturb"]) cacheable = false;
+
+	string key = get_name() + ":";
+	cacheable = cacheable && dict_key(params, key);
+	key += "|" + gname + ":";
+	cacheable = cacheable && dict_key(parms, key);
+	if (cacheable) {
+		std::lock_guard<std::mutex> lock(cache_mutex);
+		map<string, std::shared_ptr<const vector<float> > >::const_iterator it = cache.find(key);
+		if (it != cache.end()) return it->second;
+	}
+
+	vector<Transform> xforms;
+	OrientationGenerator *g = Factory < OrientationGenerator >::get(gname, parms);
+	if (g) {
+		xforms = g->gen_orientations(this);
+		delete g;
+		g = 0;
+	}
 	else throw;
 
-	EXITFUNC;
+	std::shared_ptr<vector<float> > table(new vector<float>(xforms.size()*12));
+	for (size_t i = 0; i < xforms.size(); ++i) {
+		vector<float> m = xforms[i].get_matrix();
+		std::copy(m.begin(), m.begin()+12, table->begin()+i*12);
+	}
 
-	return ret;
+	if (cacheable) {
+		std::lock_guard<std::mutex> lock(cache_mutex);
+		if (cache.size() >= max_tables) cache.clear();
+		cache[key] = table;
+	}
+
+	return table;
 }
 
 void OrientationGenerator::get_az_max(const Symmetry3D* const sym, const float& altmax, const bool inc_mirror, const float& alt_iterator,const float& h,bool& d_odd_mirror_flag, float& azmax_adjusted) const
@@ -975,6 +1048,9 @@ Transform Symmetry3D::reduce(const Transform& t, int n) const
 {
 	// Determine which asym unit the given asym unit is in
 	int soln = in_which_asym_unit(t);
+	if (cached_au_planes == 0) {
+		cache_au_planes();
+	}
 
 	// This should never happen
 	if ( soln == -1 ) {
@@ -984,20 +1060,37 @@ Transform Symmetry3D::reduce(const Transform& t, int n) const
 	}
 
 	// Get the symmetry operation corresponding to the intersection asymmetric unit
-	Transform nt = get_sym(soln);
+	// (in_which_asym_unit has filled the symmetry operator cache)
+	Transform nt = cached_syms[soln];
 	// Transpose it (invert it)
 	nt.invert();
 	// Now we can transform the argument orientation into the default asymmetric unit
 	nt  = t*nt;
 	// Now that we're at the default asymmetric unit, we can map into the requested asymmunit by doing this
 	if ( n != 0 ) {
-		nt = nt*get_sym(n);
+		nt = nt*(n < (int)cached_syms.size() ? cached_syms[n] : get_sym(n));
 	}
 	// Done!
 	return nt;
 
 }
 
+vector<Transform> Symmetry3D::reduce_list(const vector<Transform>& xforms, int n, int nthreads) const
+{
+	// build the caches here, they aren't safe to build from several threads at once
+	if (cached_au_planes == 0) {
+		cache_au_planes();
+	}
+
+	vector<Transform> ret(xforms.size());
+	int nx = xforms.size();
+	Util::parallel_for(nx, Util::get_thread_count(nthreads, nx), [&](int i, int) {
+		ret[i] = reduce(xforms[i], n);
+	});
+
+	return ret;
+}
+
 int Symmetry3D::in_which_asym_unit(const Transform& t3d) const
 {
 	// Here it is assumed that final destination of the orientation (as encapsulated in the t3d object) is
@@ -1023,6 +1116,9 @@ void Symmetry3D::cache_au_planes() const {
 		num_triangles = au_triangles.size();
 		cache_size = get_nsym()*au_triangles.size();
 
+		cached_syms = get_syms();
+		cached_au_tri.resize(cache_size*13);
+
 		cached_au_planes = new float*[cache_size];
 		float** fit = cached_au_planes;
 		for(int i =0; i < cache_size; ++i,++fit) {
@@ -1042,7 +1138,7 @@ void Symmetry3D::cache_au_planes() const {
 					for (vector<Vec3f>::iterator iit = points.begin(); iit != points.end(); ++iit ) {
 						// Rotate the points in the triangle so that the triangle occupies the
 						// space of the current asymmetric unit
-						*iit = (*iit)*get_sym(i);
+						*iit = (*iit)*cached_syms[i];
 					}
 				}
 
@@ -1050,6 +1146,23 @@ void Symmetry3D::cache_au_planes() const {
 
 				// Determine the equation of the plane for the points, store it in plane
 				Util::equation_of_plane(points[0],points[2],points[1],cached_au_planes[k]);
+
+				// terms of the point in triangle test in point_in_which_asym_unit
+				Vec3f v = points[2]-points[0];
+				Vec3f u = points[1]-points[0];
+				float udotu = u.dot(u);
+				float udotv = u.dot(v);
+				float vdotv = v.dot(v);
+				float *tri = &cached_au_tri[k*13];
+				for (int j = 0; j < 3; ++j) {
+					tri[j] = points[0][j];
+					tri[3+j] = u[j];
+					tri[6+j] = v[j];
+				}
+				tri[9] = udotu;
+				tri[10] = udotv;
+				tri[11] = vdotv;
+				tri[12] = 1.0f/(udotv*udotv - udotu*vdotv);
 			}
 		}
 	}
@@ -1067,6 +1180,8 @@ void Symmetry3D::delete_au_planes() {
 
 	delete [] cached_au_planes;
 	cached_au_planes = 0;
+	cached_syms.clear();
+	cached_au_tri.clear();
 }
 
 int Symmetry3D::point_in_which_asym_unit(const Vec3f& p) const
@@ -1077,9 +1192,10 @@ int Symmetry3D::point_in_which_asym_unit(const Vec3f& p) const
 	
 	float epsNow=0.01f;
 	int k = 0;
-	for(int i = 0; i < get_nsym(); ++i) {
+	int nsym = cached_syms.size();
+	for(int i = 0; i < nsym; ++i) {
 		for( int j = 0; j < num_triangles; ++j,++k) {
-			vector<Vec3f> points = au_sym_triangles[k];
+			const float *tri = &cached_au_tri[k*13];
 
 			float* plane = cached_au_planes[k];
 			Vec3f tmp = p;
@@ -1103,17 +1219,18 @@ int Symmetry3D::point_in_which_asym_unit(const Vec3f& p) const
 			// If it is inside the region then p is in this asymmetric unit.
 
 			// This formula take from FIXME fill in once I get to work
-			Vec3f v = points[2]-points[0];
-			Vec3f u = points[1]-points[0];
-			Vec3f w = pp - points[0];
+			// The terms which depend only on the triangle are precomputed in cache_au_planes
+			Vec3f u(tri[3],tri[4],tri[5]);
+			Vec3f v(tri[6],tri[7],tri[8]);
+			Vec3f w = pp - Vec3f(tri[0],tri[1],tri[2]);
 
-			float udotu = u.dot(u);
-			float udotv = u.dot(v);
+			float udotu = tri[9];
+			float udotv = tri[10];
 			float udotw = u.dot(w);
-			float vdotv = v.dot(v);
+			float vdotv = tri[11];
 			float vdotw = v.dot(w);
 
-			float d = 1.0f/(udotv*udotv - udotu*vdotv);
+			float d = tri[12];
 			float s = udotv*vdotw - vdotv*udotw;
 			s *= d;
 
@@ -37,6 +37,8 @@
 #include "vec3.h"
 #include "transform.h"
 
+#include <memory>
+
 namespace EMAN {
 
 	/** Symmetry3D - A base class for 3D Symmetry objects.
@@ -143,6 +145,16 @@ namespace EMAN {
 		 */
 		vector<Transform> gen_orientations(const string& generatorname="eman", const Dict& parms=Dict());
 
+		/** The orientations generated by gen_orientations as a flat array of 3x4 matrices, 12 floats
+		 * per orientation in the order used by Transform::get_matrix. Tables from deterministic generators
+		 * are cached, and shared by all symmetry objects with the same parameters, so repeated calls with
+		 * the same symmetry, generator and parameters don't regenerate the orientations
+		 * @param generatorname the string name of the OrientationGenerator
+		 * @param parms the parameters handed to OrientationGenerator::set_params
+		 * @return the orientation table, which must not be modified
+		 */
+		std::shared_ptr<const vector<float> > gen_orientation_table(const string& generatorname="eman", const Dict& parms=Dict());
+
 		/** A function to be used when generating orientations over portion of the unit sphere
 		 * defined by parameters returned by get_delimiters. In platonic symmetry altitude and azimuth
 		 * alone are not enough to correctly demarcate the asymmetric unit. See the get_delimiters comments.
@@ -164,6 +176,15 @@ namespace EMAN {
 		 */
 		virtual Transform reduce(const Transform& t3d, int n=0) const;
 
+		/** Reduce a list of orientations into an asymmetric unit in a single call, equivalent to calling
+		 * reduce on each of them
+		 * @param xforms the orientations to reduce
+		 * @param n the number of the asymmetric unit to map the orientations into
+		 * @param nthreads number of threads to use, <=0 for one per core
+		 * @return the reduced orientations, in the same order as xforms
+		 */
+		vector<Transform> reduce_list(const vector<Transform>& xforms, int n=0, int nthreads=0) const;
+
 
 		/** A function that will determine in which asymmetric unit a given orientation resides
 		 * The asymmetric unit 'number' will depend entirely on the order in which different symmetry operations are return by the
@@ -212,6 +233,10 @@ namespace EMAN {
 		mutable int num_triangles;
 		/// This cache is of size cache_size
 		mutable vector< vector<Vec3f> > au_sym_triangles;
+		/// The symmetry operators, built with the asymmetric unit planes cache since get_sym is slow for some symmetries
+		mutable vector<Transform> cached_syms;
+		/// Per triangle terms of the point in triangle test which don't depend on the point, 13 floats per triangle
+		mutable vector<float> cached_au_tri;
 		/** Establish the asymmetric unit planes cache
 		*/
 		void cache_au_planes() const;
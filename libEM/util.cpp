@@ -45,6 +45,12 @@
 #include <sys/types.h>
 #include <gsl/gsl_linalg.h>
 #include <algorithm> // using accumulate, inner_product, transform
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <new>
+#include <thread>
 
 #ifndef WIN32
 	#include <unistd.h>
@@ -92,6 +98,146 @@ int Util::MUTEX_UNLOCK(MUTEX *mutex)
 	return -1;
 }
 
+int Util::get_thread_count(int nthreads, int nitems)
+{
+	if (nthreads <= 0) nthreads = std::thread::hardware_concurrency();
+	if (nthreads > nitems) nthreads = nitems;
+	return nthreads < 1 ? 1 : nthreads;
+}
+
+namespace {
+	/** The persistent worker threads behind Util::parallel_for. Starting and joining a set of
+	 * threads costs tens of microseconds, which adds up when parallel_for is called once per
+	 * particle, so the workers are started on first use and then wait for jobs. A job is run by
+	 * the calling thread plus however many idle workers pick it up, so nested or concurrent calls
+	 * never wait on each other; at worst the caller does all of the work itself.
+	 */
+	class WorkerPool
+	{
+	  public:
+		struct Job
+		{
+			Job(int n, int nthreads, const std::function<void (int, int)> & func) :
+				func(func), n(n), nthreads(nthreads), next(0), next_tid(1), active(0) {}
+
+			const std::function<void (int, int)> & func;
+			int n;
+			int nthreads;
+			std::atomic<int> next;		// next work item
+			int next_tid;			// next thread id to hand to a worker, guarded by the pool mutex
+			int active;			// workers currently inside the job, guarded by the pool mutex
+			std::mutex err_mutex;
+			std::exception_ptr err;
+		};
+
+		static WorkerPool & instance()
+		{
+			// Never destroyed, the workers are still waiting on it when the process exits
+			static WorkerPool *pool = new WorkerPool();
+			return *pool;
+		}
+
+		void run(Job & job)
+		{
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				while (nworkers < job.nthreads - 1) {
+					std::thread(&WorkerPool::worker, this).detach();
+					nworkers++;
+				}
+				jobs.push_back(&job);
+			}
+			job_cond.notify_all();
+
+			work(job, 0);
+
+			std::unique_lock<std::mutex> lock(mutex);
+			std::vector<Job *>::iterator it = std::find(jobs.begin(), jobs.end(), &job);
+			if (it != jobs.end()) jobs.erase(it);
+			done_cond.wait(lock, [&job] { return job.active == 0; });
+		}
+
+	  private:
+		WorkerPool() : nworkers(0)
+		{
+#ifndef WIN32
+			pthread_atfork(&WorkerPool::before_fork, &WorkerPool::after_fork_parent, &WorkerPool::after_fork_child);
+#endif
+		}
+
+		static void work(Job & job, int tid)
+		{
+			for (int i = job.next++; i < job.n; i = job.next++) {
+				try {
+					job.func(i, tid);
+				}
+				catch (...) {
+					std::lock_guard<std::mutex> lock(job.err_mutex);
+					if (!job.err) job.err = std::current_exception();
+					job.next = job.n;
+				}
+			}
+		}
+
+		void worker()
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			while (true) {
+				job_cond.wait(lock, [this] { return !jobs.empty(); });
+
+				Job *job = jobs.front();
+				int tid = job->next_tid++;
+				if (job->next_tid >= job->nthreads) jobs.erase(jobs.begin());
+				job->active++;
+
+				lock.unlock();
+				work(*job, tid);
+				lock.lock();
+
+				if (--job->active == 0) done_cond.notify_all();
+			}
+		}
+
+#ifndef WIN32
+		// A forked child (Python multiprocessing) has none of the parent's threads, so it starts an empty pool
+		static void before_fork() { instance().mutex.lock(); }
+		static void after_fork_parent() { instance().mutex.unlock(); }
+		static void after_fork_child()
+		{
+			// The condition variables still count the parent's waiting workers, so they are rebuilt
+			WorkerPool & pool = instance();
+			pool.nworkers = 0;
+			pool.jobs.clear();
+			new (&pool.job_cond) std::condition_variable();
+			new (&pool.done_cond) std::condition_variable();
+			pool.mutex.unlock();
+		}
+#endif
+
+		std::mutex mutex;
+		std::condition_variable job_cond;	// workers wait here for a job
+		std::condition_variable done_cond;	// callers wait here for the workers to leave their job
+		std::vector<Job *> jobs;		// jobs still taking workers
+		int nworkers;
+	};
+}
+
+void Util::parallel_for(int n, int nthreads, const std::function<void (int, int)> & func)
+{
+	if (n <= 0) return;
+	nthreads = get_thread_count(nthreads, n);
+
+	if (nthreads == 1) {
+		for (int i = 0; i < n; i++) func(i, 0);
+		return;
+	}
+
+	WorkerPool::Job job(n, nthreads, func);
+	WorkerPool::instance().run(job);
+
+	if (job.err) std::rethrow_exception(job.err);
+}
+
 
 ///////////////////////////////////////////
 void Util::ap2ri(float *data, size_t n)
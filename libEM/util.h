@@ -45,6 +45,7 @@
 
 #include <vector>
 #include <iostream>
+#include <functional>
 
 #include <string>
 using std::string;
@@ -99,6 +100,86 @@ namespace EMAN
 		static int MUTEX_LOCK(MUTEX *mutex);
 		static int MUTEX_UNLOCK(MUTEX *mutex);
 
+		/** Run func(i, thread_id) for every i in [0, n) on a pool of worker threads.
+		 * The workers are started on first use and kept for the life of the process, so
+		 * calling this for every image is cheap. Indices are handed out one at a time, so
+		 * uneven work balances itself. thread_id
+		 * is in [0, nthreads) and may be used to select per-thread scratch space. With
+		 * nthreads <= 1 everything runs in the calling thread. If any call throws, the
+		 * remaining indices are skipped and the first exception is rethrown in the caller.
+		 * @param n number of work items
+		 * @param nthreads number of threads to use, <= 0 means one per hardware thread
+		 * @param func the work to do for one index
+		 */
+		static void parallel_for(int n, int nthreads, const std::function<void (int, int)> & func);
+
+		/** Resolve a user supplied thread count, <= 0 meaning one per hardware thread
+		 * @param nthreads requested number of threads
+		 * @param nitems the number of work items, the result never exceeds this
+		 * @return number of threads to actually use, at least 1
+		 */
+		static int get_thread_count(int nthreads, int nitems);
+
+		/** Element-wise array kernels behind the EMData arithmetic and statistics. These
+		 * are compiled for AVX-512, AVX2 and the baseline instruction set, and the best
+		 * version for the running CPU is picked when the library is loaded (GCC or Clang
+		 * on x86-64 Linux, elsewhere only the baseline version exists). See util_simd.cpp
+		 * @param a the array to modify, n elements
+		 * @param b the second operand, n elements
+		 * @param n number of elements
+		 */
+		static void array_add(float *a, const float *b, size_t n);
+		static void array_sub(float *a, const float *b, size_t n);
+		static void array_mult(float *a, const float *b, size_t n);
+		/** a[i]+=b[i]*b[i] */
+		static void array_addsquare(float *a, const float *b, size_t n);
+		/** a[i]-=b[i]*b[i] */
+		static void array_subsquare(float *a, const float *b, size_t n);
+		static void array_add(float *a, float f, size_t n);
+		static void array_mult(float *a, float f, size_t n);
+
+		/** Multiply two interleaved real/imaginary arrays, a*=b or a*=conj(b)
+		 * @param a the complex array to modify
+		 * @param b the second complex array
+		 * @param n number of complex values, so 2n floats
+		 * @param conj_b use the complex conjugate of b, as in a cross correlation
+		 */
+		static void array_mult_complex(float *a, const float *b, size_t n, bool conj_b = false);
+
+		/** a[i]/=b[i] wherever b[i] is not zero. A zero b[i] leaves a zero a[i] alone, and stops
+		 * the division at the first nonzero a[i] it meets, the values from there on being untouched
+		 * @return the index of that first nonzero a[i] over a zero b[i], or n if there was none
+		 */
+		static size_t array_div(float *a, const float *b, size_t n);
+
+		/** Divide two interleaved real/imaginary arrays, a/=b
+		 * @param n number of complex values, so 2n floats
+		 */
+		static void array_div_complex(float *a, const float *b, size_t n);
+
+		/** @return the sum of a[i]*b[i] in double precision */
+		static double array_dot(const float *a, const float *b, size_t n);
+
+		/** @return the sum of (a[i]-b[i])^2 in double precision */
+		static double array_sqdist(const float *a, const float *b, size_t n);
+
+		/** The statistics EMData::update_stat() needs, in one pass over every step'th value.
+		 * NaNs are skipped by min and max, but do end up in the sums
+		 * @param data the array
+		 * @param n number of elements in data
+		 * @param step 1 for every value, 2 for every other one (amplitudes of complex images)
+		 * @param[out] min smallest value
+		 * @param[out] max largest value
+		 * @param[out] sum sum of the values
+		 * @param[out] square_sum sum of the squares of the values
+		 * @param[out] n_nonzero number of values that are not zero
+		 */
+		static void array_stats(const float *data, size_t n, int step, float & min, float & max,
+								double & sum, double & square_sum, size_t & n_nonzero);
+
+		/** @return the instruction set the array kernels are running with, "avx512f", "avx2" or "default" */
+		static string array_kernel_isa();
+
 		/** tell whether a float value is a NaN
 		 * @param number float value
 		 */
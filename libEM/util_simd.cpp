@@ -0,0 +1,293 @@
+/*
+ * Copyright (c) 2000- Baylor College of Medicine
+ * 
+ * This software is issued under a joint BSD/GNU license. You may use the
+ * source code in this file under either license. However, note that the
+ * complete EMAN2 and SPARX software packages have some GPL dependencies,
+ * so you are responsible for compliance with the licenses of these packages
+ * if you opt to use BSD licensing. The warranty disclaimer below holds
+ * in either instance.
+ * 
+ * This complete copyright notice must be included in any revised version of the
+ * source code. Additional authorship citations may be added, but existing
+ * author citations must be preserved.
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ * 
+ * */
+
+// Array kernels for EMData arithmetic and statistics. The loops are written so the compiler can
+// vectorize them (no std::complex, no branches on the data, reductions in separate accumulators)
+// and with GCC or Clang on x86-64 Linux each is cloned for AVX-512, AVX2 and the baseline
+// instruction set. The dynamic loader picks the best clone for the running CPU (ifunc), so a
+// generic build still uses the full vector width of the machine it runs on.
+
+#include "util.h"
+
+#include <cfloat>
+
+using namespace EMAN;
+
+#if defined(__x86_64__) && defined(__linux__) && \
+	((defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 6) || (defined(__clang__) && __clang_major__ >= 14))
+	#define EMAN_ARRAY_KERNEL __attribute__((target_clones("avx512f","avx2","default"))) static
+	#define EMAN_ARRAY_KERNEL_CLONED 1
+#else
+	#define EMAN_ARRAY_KERNEL static
+#endif
+
+EMAN_ARRAY_KERNEL void add_kernel(float *a, const float *b, size_t n)
+{
+	for (size_t i = 0; i < n; i++) a[i] += b[i];
+}
+
+EMAN_ARRAY_KERNEL void sub_kernel(float *a, const float *b, size_t n)
+{
+	for (size_t i = 0; i < n; i++) a[i] -= b[i];
+}
+
+EMAN_ARRAY_KERNEL void mult_kernel(float *a, const float *b, size_t n)
+{
+	for (size_t i = 0; i < n; i++) a[i] *= b[i];
+}
+
+EMAN_ARRAY_KERNEL void addsquare_kernel(float *a, const float *b, size_t n)
+{
+	for (size_t i = 0; i < n; i++) a[i] += b[i]*b[i];
+}
+
+EMAN_ARRAY_KERNEL void subsquare_kernel(float *a, const float *b, size_t n)
+{
+	for (size_t i = 0; i < n; i++) a[i] -= b[i]*b[i];
+}
+
+EMAN_ARRAY_KERNEL void add_scalar_kernel(float *a, float f, size_t n)
+{
+	for (size_t i = 0; i < n; i++) a[i] += f;
+}
+
+EMAN_ARRAY_KERNEL void mult_scalar_kernel(float *a, float f, size_t n)
+{
+	for (size_t i = 0; i < n; i++) a[i] *= f;
+}
+
+EMAN_ARRAY_KERNEL void mult_complex_kernel(float *a, const float *b, size_t n)
+{
+	for (size_t i = 0; i < 2*n; i += 2) {
+		float ar = a[i], ai = a[i+1];
+		float br = b[i], bi = b[i+1];
+		a[i]   = ar*br - ai*bi;
+		a[i+1] = ar*bi + ai*br;
+	}
+}
+
+EMAN_ARRAY_KERNEL void mult_complex_conj_kernel(float *a, const float *b, size_t n)
+{
+	for (size_t i = 0; i < 2*n; i += 2) {
+		float ar = a[i], ai = a[i+1];
+		float br = b[i], bi = b[i+1];
+		a[i]   = ar*br + ai*bi;
+		a[i+1] = ai*br - ar*bi;
+	}
+}
+
+// a[i]/=b[i] where b[i] is not zero. Each block is checked first, so the division itself has no
+// early exit and vectorizes; a block with a zero divisor under a nonzero value is redone one value
+// at a time to find it, leaving everything after it unchanged
+EMAN_ARRAY_KERNEL size_t div_kernel(float *a, const float *b, size_t n)
+{
+	const size_t block = 1024;
+	for (size_t i0 = 0; i0 < n; i0 += block) {
+		size_t i1 = i0 + block < n ? i0 + block : n;
+
+		int bad = 0;
+		for (size_t i = i0; i < i1; i++) bad |= (b[i] == 0) & (a[i] != 0);
+		if (bad) {
+			for (size_t i = i0; i < i1; i++) {
+				if (b[i] != 0) a[i] /= b[i];
+				else if (a[i] != 0) return i;
+			}
+		}
+
+		for (size_t i = i0; i < i1; i++) a[i] = b[i] != 0 ? a[i]/b[i] : a[i];
+	}
+	return n;
+}
+
+EMAN_ARRAY_KERNEL void div_complex_kernel(float *a, const float *b, size_t n)
+{
+	for (size_t i = 0; i < 2*n; i += 2) {
+		float ar = a[i], ai = a[i+1];
+		float br = b[i], bi = b[i+1];
+		float d = br*br + bi*bi;
+		a[i]   = (ar*br + ai*bi)/d;
+		a[i+1] = (ai*br - ar*bi)/d;
+	}
+}
+
+EMAN_ARRAY_KERNEL double dot_kernel(const float *a, const float *b, size_t n)
+{
+	double sum = 0;
+	for (size_t i = 0; i < n; i++) sum += a[i]*(double)b[i];
+	return sum;
+}
+
+EMAN_ARRAY_KERNEL double sqdist_kernel(const float *a, const float *b, size_t n)
+{
+	double sum = 0;
+	for (size_t i = 0; i < n; i++) {
+		float d = a[i] - b[i];
+		sum += d*(double)d;
+	}
+	return sum;
+}
+
+EMAN_ARRAY_KERNEL void stats_kernel(const float *data, size_t n, float *minmax, double *sums, size_t *n_nonzero)
+{
+	float max = -FLT_MAX;
+	float min = FLT_MAX;
+	double sum = 0;
+	double square_sum = 0;
+	size_t nz = 0;
+
+	// a comparison with a NaN is false, so NaNs never replace min or max. util_simd.cpp is built
+	// with -fno-finite-math-only so the compiler has to keep it that way
+	for (size_t i = 0; i < n; i++) {
+		float v = data[i];
+		max = v > max ? v : max;
+		min = v < min ? v : min;
+		sum += v;
+		square_sum += v*(double)v;
+		nz += (v != 0);
+	}
+
+	minmax[0] = min;
+	minmax[1] = max;
+	sums[0] = sum;
+	sums[1] = square_sum;
+	*n_nonzero = nz;
+}
+
+// every other value, for amplitude/phase images where only the amplitudes count
+EMAN_ARRAY_KERNEL void stats_step2_kernel(const float *data, size_t n, float *minmax, double *sums, size_t *n_nonzero)
+{
+	float max = -FLT_MAX;
+	float min = FLT_MAX;
+	double sum = 0;
+	double square_sum = 0;
+	size_t nz = 0;
+
+	for (size_t i = 0; i < n; i += 2) {
+		float v = data[i];
+		max = v > max ? v : max;
+		min = v < min ? v : min;
+		sum += v;
+		square_sum += v*(double)v;
+		nz += (v != 0);
+	}
+
+	minmax[0] = min;
+	minmax[1] = max;
+	sums[0] = sum;
+	sums[1] = square_sum;
+	*n_nonzero = nz;
+}
+
+void Util::array_add(float *a, const float *b, size_t n)
+{
+	add_kernel(a, b, n);
+}
+
+void Util::array_sub(float *a, const float *b, size_t n)
+{
+	sub_kernel(a, b, n);
+}
+
+void Util::array_mult(float *a, const float *b, size_t n)
+{
+	mult_kernel(a, b, n);
+}
+
+void Util::array_addsquare(float *a, const float *b, size_t n)
+{
+	addsquare_kernel(a, b, n);
+}
+
+void Util::array_subsquare(float *a, const float *b, size_t n)
+{
+	subsquare_kernel(a, b, n);
+}
+
+void Util::array_add(float *a, float f, size_t n)
+{
+	add_scalar_kernel(a, f, n);
+}
+
+void Util::array_mult(float *a, float f, size_t n)
+{
+	mult_scalar_kernel(a, f, n);
+}
+
+void Util::array_mult_complex(float *a, const float *b, size_t n, bool conj_b)
+{
+	if (conj_b) mult_complex_conj_kernel(a, b, n);
+	else mult_complex_kernel(a, b, n);
+}
+
+size_t Util::array_div(float *a, const float *b, size_t n)
+{
+	return div_kernel(a, b, n);
+}
+
+void Util::array_div_complex(float *a, const float *b, size_t n)
+{
+	div_complex_kernel(a, b, n);
+}
+
+double Util::array_dot(const float *a, const float *b, size_t n)
+{
+	return dot_kernel(a, b, n);
+}
+
+double Util::array_sqdist(const float *a, const float *b, size_t n)
+{
+	return sqdist_kernel(a, b, n);
+}
+
+void Util::array_stats(const float *data, size_t n, int step, float & min, float & max,
+					   double & sum, double & square_sum, size_t & n_nonzero)
+{
+	float minmax[2];
+	double sums[2];
+
+	if (step == 1) stats_kernel(data, n, minmax, sums, &n_nonzero);
+	else if (step == 2) stats_step2_kernel(data, n, minmax, sums, &n_nonzero);
+	else throw InvalidValueException(step, "array_stats step must be 1 or 2");
+
+	min = minmax[0];
+	max = minmax[1];
+	sum = sums[0];
+	square_sum = sums[1];
+}
+
+string Util::array_kernel_isa()
+{
+#ifdef EMAN_ARRAY_KERNEL_CLONED
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512f")) return "avx512f";
+	if (__builtin_cpu_supports("avx2")) return "avx2";
+#endif
+	return "default";
+}
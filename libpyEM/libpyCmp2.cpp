@@ -36,6 +36,7 @@
 #include <emdata.h>
 #include <emobject.h>
 #include <log.h>
+#include <profiler.h>
 #include <transform.h>
 #include <xydata.h>
 
@@ -142,6 +143,26 @@ BOOST_PYTHON_MODULE(libpyCmp2)
 
     delete EMAN_Log_scope;
 
+    class_< EMAN::PluginProfiler, boost::noncopyable >("PluginProfiler",
+    		"Optional built-in profiling of processor, cmp, aligner and projector calls made through EMData.\n"
+    		"Records per-plugin call counts, wall times with percentiles, allocated image memory and image sizes.\n"
+    		"Typical usage:\n"
+    		"PluginProfiler.set_enabled(True)\n"
+    		"...\n"
+    		"print(PluginProfiler.to_json())\n",
+    		no_init)
+        .def("set_enabled", &EMAN::PluginProfiler::set_enabled, args("enable"), "Turn profiling on or off")
+        .def("is_enabled", &EMAN::PluginProfiler::is_enabled)
+        .def("reset", &EMAN::PluginProfiler::reset, "Discard all statistics collected so far")
+        .def("to_json", &EMAN::PluginProfiler::to_json, "Return the statistics as a JSON string, keyed by plugin type then plugin name")
+        .def("write_json", &EMAN::PluginProfiler::write_json, args("filename"), "Write the statistics to a file as JSON")
+        .staticmethod("set_enabled")
+        .staticmethod("is_enabled")
+        .staticmethod("reset")
+        .staticmethod("to_json")
+        .staticmethod("write_json")
+    ;
+
     scope* EMAN_XYData_scope = new scope(
     class_< EMAN::XYData >("XYData", "XYData defines a 1D (x,y) data set.", init<  >())
         .enable_pickling()
@@ -65,8 +65,14 @@ BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(EMAN_EMData_write_lst_overloads_1_4, writ
 
 BOOST_PYTHON_FUNCTION_OVERLOADS(EMAN_EMData_read_images_overloads_1_4, EMAN::EMData::read_images, 1, 4)
 
+BOOST_PYTHON_FUNCTION_OVERLOADS(EMAN_EMData_read_eer_fractions_overloads_2_5, EMAN::EMData::read_eer_fractions, 2, 5)
+
 BOOST_PYTHON_FUNCTION_OVERLOADS(EMAN_EMData_write_images_overloads_2_7, EMAN::EMData::write_images, 2, 7)
 
+BOOST_PYTHON_FUNCTION_OVERLOADS(EMAN_EMData_do_fft_batch_overloads_1_2, EMAN::EMData::do_fft_batch, 1, 2)
+
+BOOST_PYTHON_FUNCTION_OVERLOADS(EMAN_EMData_do_ift_batch_overloads_1_2, EMAN::EMData::do_ift_batch, 1, 2)
+
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(EMAN_EMData_set_size_overloads_1_4, EMAN::EMData::set_size, 1, 4)
 
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(EMAN_EMData_set_complex_size_overloads_1_3, EMAN::EMData::set_complex_size, 1, 3)
@@ -107,6 +113,8 @@ BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(EMAN_EMData_real2complex_overloads_0_1, E
 
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(EMAN_EMData_nn_overloads_3_4, EMAN::EMData::nn, 3, 4)
 
+BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(EMAN_EMData_nn_batch_overloads_4_5, EMAN::EMData::nn_batch, 4, 5)
+
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(EMAN_EMData_nn_SSNR_overloads_4_5, EMAN::EMData::nn_SSNR, 4, 5)
 
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(EMAN_EMData_nn_SSNR_ctf_overloads_5_6, EMAN::EMData::nn_SSNR_ctf, 5, 6)
@@ -544,6 +552,7 @@ BOOST_PYTHON_MODULE(libpyEMData2)
 	.def("append_image", &EMAN::EMData::append_image, EMAN_EMData_append_image_overloads_1_3(args("filename", "imgtype", "header_only"), "append to an image file; If the file doesn't exist, create one.\nfilename - The image file name.\nimgtype - Write to the given image format type. if not specified, use the 'filename' extension to decide.\nheader_only - To write only the header or both header and data."))
 	.def("write_lst", &EMAN::EMData::write_lst, EMAN_EMData_write_lst_overloads_1_4(args("filename", "reffile", "refn", "comment"), "Append data to a LST image file.\nfilename - The LST image file name.\nreffile - Reference file name.\nrefn The reference file number.\ncomment - The comment to the added reference file."))
 	.def("read_images", &EMAN::EMData::read_images, EMAN_EMData_read_images_overloads_1_4(args("filename", "img_indices", "imgtype", "header_only"),"Read a set of images from file specified by 'filename'.\nWhich images are read is set by 'img_indices'.\nfilename The image file name.\nimg_indices Which images are read. If it is empty, all images are read. If it is not empty, only those in this array are read.\nheader_only If true, only read image header. If false, read both data and header.\nreturn The set of images read from filename."))
+	.def("read_eer_fractions", &EMAN::EMData::read_eer_fractions, EMAN_EMData_read_eer_fractions_overloads_2_5(args("filename", "frames_per_sum", "binning", "imgtype", "nthreads"), "Read an EER movie as a set of sums of consecutive frames in one pass, binning while decoding.\n \nfilename - the EER file name\nframes_per_sum - number of frames in each sum, leftover frames form a final smaller sum\nbinning - bin the decoded grid by this power of 2(default=1)\nimgtype - IMAGE_EER, IMAGE_EER2X or IMAGE_EER4X for the 4k, 8k or 16k grid(default=IMAGE_EER)\nnthreads - number of threads, <= 0 for all cores(default=0)\n \nreturn A list of the frame sums."))
 	.def("write_images", &EMAN::EMData::write_images, EMAN_EMData_write_images_overloads_2_7(args("filename", "imgs", "imgtype", "header_only", "region", "filestoragetype", "use_host_endian"),"Write a set of images to file specified by 'filename'.\nWhich images are written is set by 'imgs'.\nfilename The image file name.\\n\\nIf a region is given, then write a region only.\\n\\nfilename - The image file name.\\nimgs - Images to write.\\nimgtype - Write to the given image format type. if not specified, use the 'filename' extension to decide.\\nheader_only - To write only the header or both header and data.\\nregion - Define the region to write to.\\nfilestoragetype - The image data type used in the output file.\\nuse_host_endian - To write in the host computer byte order.\\n\\nreturn True if images written successfully to filename."))
 	.def("get_fft_amplitude", &EMAN::EMData::get_fft_amplitude, return_value_policy< manage_new_object >(), "return the amplitudes of the FFT including the left half\n \nreturn The current FFT image's amplitude image.\nexception - ImageFormatException If the image is not a complex image.")
 	.def("get_fft_amplitude2D", &EMAN::EMData::get_fft_amplitude2D, return_value_policy< manage_new_object >(), "return the amplitudes of the 2D FFT including the left half, PRB\n \nreturn The current FFT image's amplitude image.\nexception - ImageFormatException If the image is not a complex image.")
@@ -649,6 +658,8 @@ BOOST_PYTHON_MODULE(libpyEMData2)
 	.def("backproject", &EMAN::EMData::backproject, EMAN_EMData_backproject_overloads_1_2(args("peojector_name", "params"), "Calculate the backprojection of this image (stack) and return the result.\n \nprojector_name - Projection algorithm name. Only \"pawel\" and \"chao\" have been implemented now.\nparams - Projection Algorithm parameters, default to Null.\n \nreturn The result image.\nexception - NotExistingObjectError If the projection algorithm doesn't exist.")[ return_value_policy< manage_new_object >() ])
 	.def("do_fft", &EMData_do_fft_wrapper, return_value_policy< manage_new_object >(), "return the fast fourier transform (FFT) image of the current\nimage. the current image is not changed. The result is in\nreal/imaginary format.\n \nreturn The FFT of the current image in real/imaginary format.")
 	.def("do_fft_inplace", &EMAN::EMData::do_fft_inplace, return_value_policy< reference_existing_object >(), "Do FFT inplace. And return the FFT image.\n \nreturn The FFT of the current image in real/imaginary format.")
+	.def("do_fft_batch", &EMAN::EMData::do_fft_batch, EMAN_EMData_do_fft_batch_overloads_1_2(args("images", "nthreads"), "Fourier transform a list of real images of the same size, in groups with a single FFTW plan.\nThe input images are not changed.\n \nimages - the real images to transform\nnthreads - number of threads to use, <= 0 for all cores(default=1)\n \nreturn A list of FFTs in real/imaginary format."))
+	.def("do_ift_batch", &EMAN::EMData::do_ift_batch, EMAN_EMData_do_ift_batch_overloads_1_2(args("images", "nthreads"), "Inverse Fourier transform a list of complex images of the same size, in groups with a single FFTW plan.\n \nimages - the complex images to transform\nnthreads - number of threads to use, <= 0 for all cores(default=1)\n \nreturn A list of real space images."))
 	.def("do_ift", &EMAN::EMData::do_ift, return_value_policy< manage_new_object >(), "return the inverse fourier transform (IFT) image of the current\nimage. the current image may be changed if it is in amplitude/phase\nformat as opposed to real/imaginary format - if this change is\nperformed it is not undone.\n \nreturn The current image's inverse fourier transform image.\nexception - ImageFormatException If the image is not a complex image.")
 	.def("do_ift_inplace", &EMAN::EMData::do_ift_inplace, return_value_policy< reference_existing_object >(), "Do IFT inplace. And return the IFT image.\n \nreturn The IFT image.")
 	.def("bispecRotTransInvN", &EMAN::EMData::bispecRotTransInvN, return_value_policy< reference_existing_object >(), args("N", "NK"), "This computes the rotational and translational bispectral\ninvariants of an image. The invariants are labelled by the Fourier\nHarmonic label given by N.\nNK is the number of Fourier components one wishes to use in calculating this bispectrum.\nthe output is a single 2D image whose x,y labels are lengths, corresponding to the two lengths of sides of a triangle.")
@@ -752,6 +763,7 @@ BOOST_PYTHON_MODULE(libpyEMData2)
 //	.def("onelinenn", &EMAN::EMData::onelinenn)
 //	.def("onelinenn_mult", &EMAN::EMData::onelinenn_mult)
 	.def("nn", &EMAN::EMData::nn, EMAN_EMData_nn_overloads_3_4(args("wptr", "myfft", "tf", "mult"), "Nearest Neighbor interpolation.\nModifies the current object.\n \nwptr - Normalization data.\nmyfft - FFT data.\ntf - Transform reference\nmult - default to 1."))
+	.def("nn_batch", &EMAN::EMData::nn_batch, EMAN_EMData_nn_batch_overloads_4_5(args("wptr", "myffts", "tfs", "mults", "nthreads"), "Nearest Neighbor interpolation of a list of slices, the same as calling nn() for each entry in turn.\nThe volume is split into z slabs updated by different threads, the result doesn't depend on the number of threads.\n \nwptr - Normalization data.\nmyffts - FFT data of each entry.\ntfs - Transform of each entry\nmults - weight of each entry\nnthreads - number of threads, default 0 for one per core."))
 	.def("nn_SSNR", &EMAN::EMData::nn_SSNR, EMAN_EMData_nn_SSNR_overloads_4_5(args("wptr", "wptr2", "myfft", "tf", "mult"), "Nearest Neighbor interpolation, meanwhile return necessary data such as\nKn, sum_k(F_k^n) ans sum_k(|F_k^n|^2)\nModifies the current object.\n \nwptr - Normalization data.\nwptr2 - \nmyfft - FFT data.\ntf - Transform reference\nmult - default to 1."))
 	.def("nn_SSNR_ctf", &EMAN::EMData::nn_SSNR_ctf, EMAN_EMData_nn_SSNR_ctf_overloads_5_6(args("wptr", "wptr2", "wptr3", "myfft", "tf", "mult"), "Nearest Neighbor interpolation, meanwhile return necessary data such as\nKn, sum_k(F_k^n) ans sum_k(|F_k^n|^2)\nModifies the current object.\n \nwptr - Normalization data.\nwptr2 - \nwptr3 - \nmyfft - FFT data.\ntf - Transform reference\nmult - default to 1."))
 	.def("symplane0", &EMAN::EMData::symplane0, args("norm"), "Calculate Wiener summation from the inserted 2D slice\nput the summation into 3D grids using nearest neighbour approximation\na. Map the 2D coordinates of the interted slice into 3D grid using 3D transformation\nb. calculate 2D CTF_K^2  and CTF_K*F_K, and put them on the voxel of 3D volume\nc. count the number of images entering each boxel wptr3")
@@ -883,7 +895,10 @@ BOOST_PYTHON_MODULE(libpyEMData2)
 	.def("__getitem__", &emdata_getitem)
 	.def("__setitem__", &emdata_setitem)
 	.staticmethod("read_images")
+	.staticmethod("read_eer_fractions")
 	.staticmethod("write_images")
+	.staticmethod("do_fft_batch")
+	.staticmethod("do_ift_batch")
 	.def("__add__", (EMAN::EMData* (*)(const EMAN::EMData&, const EMAN::EMData&) )&EMAN::operator+, return_value_policy< manage_new_object >() )
 	.def("__sub__", (EMAN::EMData* (*)(const EMAN::EMData&, const EMAN::EMData&) )&EMAN::operator-, return_value_policy< manage_new_object >() )
 	.def("__mul__", (EMAN::EMData* (*)(const EMAN::EMData&, const EMAN::EMData&) )&EMAN::operator*, return_value_policy< manage_new_object >() )
@@ -34,6 +34,7 @@
 // Includes ====================================================================
 #include <emdata.h>
 #include <sparx/fundamentals.h>
+#include <ccfworkspace.h>
 
 // Using =======================================================================
 using namespace boost::python;
@@ -77,5 +78,17 @@ BOOST_PYTHON_MODULE(libpyFundamentals2)
     def("filt_median_", &EMAN::filt_median_, return_value_policy< manage_new_object >());
     def("filt_dilation_", &EMAN::filt_dilation_, return_value_policy< manage_new_object >());
     def("filt_erosion_", &EMAN::filt_erosion_, return_value_policy< manage_new_object >());
+
+    class_< EMAN::CCFWorkspace, boost::noncopyable >("CCFWorkspace", init< int, optional< int, int, int > >())
+        .def("get_xsize", &EMAN::CCFWorkspace::get_xsize)
+        .def("get_ysize", &EMAN::CCFWorkspace::get_ysize)
+        .def("get_zsize", &EMAN::CCFWorkspace::get_zsize)
+        .def("ccf", (void (EMAN::CCFWorkspace::*)(const EMAN::EMData*, const EMAN::EMData*, EMAN::EMData*, bool))&EMAN::CCFWorkspace::ccf, (arg("image"), arg("with"), arg("out"), arg("center")=false))
+        .def("set_references", &EMAN::CCFWorkspace::set_references)
+        .def("get_nref", &EMAN::CCFWorkspace::get_nref)
+        .def("ccf_references", (void (EMAN::CCFWorkspace::*)(const EMAN::EMData*, const std::vector<EMAN::EMData*>&, bool))&EMAN::CCFWorkspace::ccf_references, (arg("image"), arg("out"), arg("center")=false))
+        .def("clear_thread_cache", &EMAN::CCFWorkspace::clear_thread_cache)
+        .staticmethod("clear_thread_cache")
+    ;
 }
 
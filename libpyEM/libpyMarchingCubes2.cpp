@@ -118,6 +118,9 @@ BOOST_PYTHON_MODULE(libpyMarchingCubes2)
 	/* We do not wrap default constructor of MarchingCubes into Python */
 	//class_< EMAN::MarchingCubes, bases<EMAN::Isosurface> >("MarchingCubes", init<  >())
 	class_< EMAN::MarchingCubes, bases<EMAN::Isosurface> >("MarchingCubes", init< EMAN::EMData *>())
+		.def("set_threads", &EMAN::MarchingCubes::set_threads, args("n"), "Set the number of threads used to march the cubes, 0 or less means one per core.")
+		.def("get_threads", &EMAN::MarchingCubes::get_threads)
+		.def("get_mesh", &EMAN::MarchingCubes::get_mesh, "Get the isosurface without any OpenGL calls, as a dict of lists: points (x,y,z of each vertex), normals (one per vertex) and faces (three vertex indices per triangle).")
 		//.def(init< EMAN::EMData *, optional< bool > >())
 		;
 }
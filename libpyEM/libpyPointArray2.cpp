@@ -102,6 +102,9 @@ BOOST_PYTHON_MODULE(libpyPointArray2)
         .def("pdb2mrc_by_summation", &EMAN::PointArray::pdb2mrc_by_summation, return_value_policy< manage_new_object >())
         .def("projection_by_nfft", &EMAN::PointArray::projection_by_nfft, EMAN_PointArray_projection_by_nfft_overloads_2_3()[ return_value_policy< manage_new_object >() ])
         .def("projection_by_summation", &EMAN::PointArray::projection_by_summation, return_value_policy< manage_new_object >())
+        .def("projections_by_summation", &EMAN::PointArray::projections_by_summation, args("image_size", "apix", "res", "xforms"), "Projections of the points in many orientations, a point p is projected at xform*p. The points are binned once for all of the projections.")
+        .def("set_threads", &EMAN::PointArray::set_threads, args("nthreads"), "Set the number of threads used for map and projection synthesis and sim_potential, 0 or less means one per core.")
+        .def("get_threads", &EMAN::PointArray::get_threads)
         .def("replace_by_summation", &EMAN::PointArray::replace_by_summation)
         .def("opt_from_proj", &EMAN::PointArray::opt_from_proj)
         .def("sim_set_pot_parms", &EMAN::PointArray::sim_set_pot_parms)
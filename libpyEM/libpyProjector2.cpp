@@ -102,6 +102,11 @@ BOOST_PYTHON_MODULE(libpyProjector2)
         .def("get_params", &EMAN::Projector::get_params, &EMAN_Projector_Wrapper::default_get_params)
         .def("get_param_types", &EMAN::Projector::get_param_types, &EMAN_Projector_Wrapper::default_get_param_types)
         .def("set_params", &EMAN::Projector::set_params)
+        .def("prepare", &EMAN::Projector::prepare)
+        .def("clear_prepared", &EMAN::Projector::clear_prepared)
+        .def("project_prepared", &EMAN::Projector::project_prepared, return_value_policy< manage_new_object >())
+        .def("project_prepared_list", &EMAN::Projector::project_prepared_list, (arg("xforms"), arg("nthreads")=0))
+        .def("project3d_list", &EMAN::Projector::project3d_list, (arg("image"), arg("xforms"), arg("nthreads")=0))
     ;
 
     class_< EMAN::Factory<EMAN::Projector>, boost::noncopyable >("Projectors", no_init)
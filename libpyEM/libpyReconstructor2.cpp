@@ -192,6 +192,7 @@ BOOST_PYTHON_MODULE(libpyReconstructor2)
     class_< EMAN::Reconstructor, boost::noncopyable, EMAN_Reconstructor_Wrapper >("__Reconstructor", init<  >())
         .def("setup", pure_virtual(&EMAN::Reconstructor::setup))
         .def("clear", pure_virtual(&EMAN::Reconstructor::clear))
+		.def("sync", &EMAN::Reconstructor::sync)
 		.def("setup_seed", (int (EMAN::Reconstructor::*)(const EMAN::EMData*, const float))&EMAN::Reconstructor::setup_seed)
 		.def("setup_seedandweights", (int (EMAN::Reconstructor::*)(const EMAN::EMData*, const EMAN::EMData*))&EMAN::Reconstructor::setup_seedandweights)
 //		.def("insert_slice", (int (EMAN::Reconstructor::*)(const EMAN::EMData* const, const EMAN::Transform&, const float))&EMAN::Reconstructor::insert_slice)
@@ -180,6 +180,7 @@ BOOST_PYTHON_MODULE(libpyTransform2)
 		.def("get_asym_unit_points", pure_virtual(&EMAN::Symmetry3D::get_asym_unit_points), args("inc_mirror"), "to demarcate the asymmetric unit. The last should may be connected to the first.\n \ninc_mirror - whether or not to include the mirror portion of the asymmetric unit (default=False)\n \nreturn a cyclic set of points which can be connected using great arcs on the unit sphere\n")
 		.def("insert_params", pure_virtual(&EMAN::Symmetry3D::insert_params), args("new_params"), "Insert parameters. Previously present parameters are replaced, new ones are inserted.\n \nnew_params - the parameters to insert\n")
 		.def("reduce", &EMAN::Symmetry3D::reduce, args("t3d", "n"), "A function that will reduce an orientation, as characterized by Euler anges, into a specific asymmetric unit.\nDefault behavior is to map the given orientation into the default asymmetric unit of the symmetry (n=0). This\nis a concrete implementation that works for all symmetries, relying on a concrete instance\nof the get_asym_unit_triangles function\n \nt3d - a Transform characterizing an orientation\nn - the number of the asymmetric unit you wish to map the given orientation into. There is a strong relationship between n and to Symmetry3D::get_sym (default = 0)\n \nreturn the orientation the specified asymmetric unit (by default this is the default asymmetric unit of the symmetry)")
+		.def("reduce_list", &EMAN::Symmetry3D::reduce_list, (arg("xforms"), arg("n")=0, arg("nthreads")=0), "Reduce a list of orientations into an asymmetric unit in a single call, equivalent to calling reduce on each of them\n \nxforms - the orientations to reduce\nn - the number of the asymmetric unit to map the orientations into (default = 0)\nnthreads - number of threads to use, <=0 for one per core (default = 0)\n \nreturn the reduced orientations, in the same order as xforms")
 		.def("in_which_asym_unit", &EMAN::Symmetry3D::in_which_asym_unit, args("t3d"), "A function that will determine in which asymmetric unit a given orientation resides\nThe asymmetric unit 'number' will depend entirely on the order in which different symmetry\noperations are return by the Symmetry3D::get_sym function\n \nt3d - a Transform characterizing an orientation\n \nreturn the asymmetric unit number the the orientation is in\n")
 		.def("point_in_which_asym_unit", &EMAN::Symmetry3D::point_in_which_asym_unit, args("v"), "A function that will determine in which asymmetric unit a given vector resides\nThe asymmetric unit 'number' will depend entirely on the order in which different\nsymmetry operations are return by the Symmetry3D::get_sym function\n \nv a Vec3f characterizing a point\n \nreturn the asymmetric unit number the the orientation is in\n")
 		.def("get_touching_au_transforms",&EMAN::Symmetry3D::get_touching_au_transforms, args("inc_mirror"), "Gets a vector of Transform objects that define the set of asymmetric units that touch the default\nasymmetric unit. The 'default asymmetric unit' is defined by the results of Symmetry3d::get_asym_unit_points\nand is sensitive to whether or not you want to include the mirror part of the asymmetric unit.\nThis function is useful when used in conjunction with Symmetry3D::reduce, and particularly when finding\nthe angular deviation of particles through different stages of iterative Single Particle Reconstruction\nThis function could be expanded to work for an asymmetric unit number supplied by the user.\n \ninc_mirror - whether or not to include the mirror portion of the asymmetric unit\n \nreturn a vector of Transform objects that map the default asymmetric unit to the neighboring asymmetric unit\n")
@@ -43,6 +43,8 @@
 #include <xydata.h>
 #include <emobject.h>
 #include <randnum.h>
+#include <imagestream.h>
+#include <io/hdf_filecache.h>
 #include "ctf.h"
 #include "geometry.h"
 #include "portable_fileio.h"
@@ -238,6 +240,8 @@ struct EMAN_Util_FakeKaiserBessel_Wrapper: EMAN::Util::FakeKaiserBessel
 
 BOOST_PYTHON_FUNCTION_OVERLOADS(EMAN_EMUtil_get_imageio_overloads_2_3, EMAN::EMUtil::get_imageio, 2, 3)
 
+BOOST_PYTHON_FUNCTION_OVERLOADS(EMAN_EMUtil_get_attribute_columns_overloads_2_5, EMAN::EMUtil::get_attribute_columns, 2, 5)
+
 #ifdef USE_HDF5
 BOOST_PYTHON_FUNCTION_OVERLOADS(EMAN_EMUtil_read_hdf_attribute_2_3, EMAN::EMUtil::read_hdf_attribute, 2, 3)
 
@@ -1173,6 +1177,16 @@ hyb -- y- mesh spacing above f0\nhya -- y- mesh spacing below f0\n \nInterpolant
     ;
 
 
+    class_< EMAN::Util::MultiRefPolarAligner, boost::noncopyable >("MultiRefPolarAligner",
+    		"Aligns batches of images against one set of reference rings on several threads, with the same\n"
+    		"results as multiref_polar_ali_2d and multiref_polar_ali_2d_peaklist. xrng and yrng take 2 values\n"
+    		"per image and cnx, cny 1 value per image, or one set of values for all images.",
+    		init< const std::vector<EMAN::EMData*>&, std::vector<int>, std::string, optional< int > >(args("crefim", "numr", "mode", "nthreads")))
+        .def("align", &EMAN::Util::MultiRefPolarAligner::align, args("images", "xrng", "yrng", "step", "cnx", "cny"), "Returns [ang, sxs, sys, mirror, iref, peak] for each image, as one list")
+        .def("align_peaklist", &EMAN::Util::MultiRefPolarAligner::align_peaklist, args("images", "xrng", "yrng", "step", "cnx", "cny"), "Returns [peak, ang, sxs, sys, mirror] for each reference and each image, as one list")
+        .def("get_nref", &EMAN::Util::MultiRefPolarAligner::get_nref)
+    ;
+
     class_< EMAN::Util::tmpstruct >("tmpstruct", init<  >())
         .def(init< const EMAN::Util::tmpstruct& >())
         .def_readwrite("theta1", &EMAN::Util::tmpstruct::theta1)
@@ -1204,6 +1218,7 @@ hyb -- y- mesh spacing above f0\nhya -- y- mesh spacing below f0\n \nInterpolant
         .def("jump_lines", &EMAN::EMUtil::jump_lines, args("file", "nlines"), "")
         .def("get_euler_names", &EMAN::EMUtil::get_euler_names, args("euler_type"), "")
         .def("get_all_attributes", &EMAN::EMUtil::get_all_attributes, args("file_name", "attr_name"), "Get an attribute from a stack of image, returned as a vector\n \nfile_name - the image file name\nattr_name - The header attribute name.\n \nreturn the vector of attribute value\n \nexception - NotExistingObjectException when access an non-existing attribute\nexception - InvalidCallException when call this function for a non-stack image")
+        .def("get_attribute_columns", &EMAN::EMUtil::get_attribute_columns, EMAN_EMUtil_get_attribute_columns_overloads_2_5(args("file_name", "keys", "first", "n", "use_cache"), "Read several header attributes from a range of images as typed columns, without reading full headers.\n \nfile_name - the image file name\nkeys - list of header attribute names\nfirst - index of the first image, default=0\nn - number of images, default=-1 for all remaining images\nuse_cache - keep the columns in a sidecar file, reused until the image file changes (ignored for LST/LSX files), default=False\n \nreturn a dict with one list per key: floats (NaN if missing), Transforms or strings"))
 		.def("cuda_available", &EMAN::EMUtil::cuda_available)
 #ifdef USE_HDF5
 		.def("read_hdf_attribute", &EMAN::EMUtil::read_hdf_attribute, EMAN_EMUtil_read_hdf_attribute_2_3(args("filename", "key", "image_index"), "Retrive a single attribute value from a HDF5 image file.\n \nfilename - HDF5 image's file name\nkey - the attribute's key name\nimage_index - the image index, default=0\n \nreturn the attribute value for the given key"))
@@ -1216,6 +1231,7 @@ hyb -- y- mesh spacing above f0\nhya -- y- mesh spacing below f0\n \nInterpolant
         .staticmethod("get_datatype_string")
         .staticmethod("dump_dict")
         .staticmethod("get_all_attributes")
+        .staticmethod("get_attribute_columns")
         .staticmethod("get_imageio")
         .staticmethod("get_image_count")
         .staticmethod("get_imagetype_name")
@@ -1285,6 +1301,28 @@ hyb -- y- mesh spacing above f0\nhya -- y- mesh spacing below f0\n \nInterpolant
 
     delete EMAN_EMUtil_scope;
 
+    class_< EMAN::ImageStream, boost::noncopyable >("ImageStream", "Reads images from one file on background threads, returning them in order from next().",
+    	init< const std::string&, optional< const std::vector<int>&, bool, int, int > >(args("filename", "img_indices", "header_only", "nthreads", "queue_size")))
+        .def("next", (EMAN::EMData* (EMAN::ImageStream::*)())&EMAN::ImageStream::next, return_value_policy< manage_new_object >(), "The next image in the list, or None after the last one")
+        .def("size", &EMAN::ImageStream::size, "The number of images the stream will return")
+    ;
+
+#ifdef HDFIO_CACHE
+    class_< EMAN::HDFCache, boost::noncopyable >("HDFCache", "Least recently used cache of HDF5 files opened read only by EMUtil.get_imageio.", no_init)
+        .def("instance", &EMAN::HDFCache::instance, return_value_policy< reference_existing_object >())
+        .def("close_file", &EMAN::HDFCache::close_file, args("filename"), "Close a file now, unless it is in use\n \nreturn 0 if the file was closed, -1 otherwise")
+        .def("clear", &EMAN::HDFCache::clear, "Close all files which aren't in use")
+        .def("set_capacity", &EMAN::HDFCache::set_capacity, args("capacity"), "Set the maximum number of open files")
+        .def("get_capacity", &EMAN::HDFCache::get_capacity)
+        .def("get_size", &EMAN::HDFCache::get_size, "The number of files in the cache")
+        .def("get_hits", &EMAN::HDFCache::get_hits)
+        .def("get_misses", &EMAN::HDFCache::get_misses)
+        .def("get_evictions", &EMAN::HDFCache::get_evictions)
+        .def("reset_stats", &EMAN::HDFCache::reset_stats)
+        .staticmethod("instance")
+    ;
+#endif	//HDFIO_CACHE
+
     class_< EMAN::ImageSort >("ImageSort", init< const EMAN::ImageSort& >())
         .def(init< int >())
         .def("sort", &EMAN::ImageSort::sort)
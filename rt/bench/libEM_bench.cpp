@@ -0,0 +1,499 @@
+/*
+ * Copyright (c) 2000- Baylor College of Medicine
+ * 
+ * This software is issued under a joint BSD/GNU license. You may use the
+ * source code in this file under either license. However, note that the
+ * complete EMAN2 and SPARX software packages have some GPL dependencies,
+ * so you are responsible for compliance with the licenses of these packages
+ * if you opt to use BSD licensing. The warranty disclaimer below holds
+ * in either instance.
+ * 
+ * This complete copyright notice must be included in any revised version of the
+ * source code. Additional authorship citations may be added, but existing
+ * author citations must be preserved.
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ * 
+ * */
+
+// libEM_bench times a fixed set of representative libEM workloads and writes the results as JSON,
+// so numbers from two builds or two releases can be compared mechanically:
+//
+//   libEM_bench [--quick] [--only <substring>] [--tmpdir <dir>] [--output <file.json>]
+//
+// --quick reduces sizes and repetitions for a smoke run, --only restricts the run to benchmarks whose
+// "group/name" contains the substring, --tmpdir is where the ImageIO test files are written (default
+// the current directory) and --output writes the JSON to a file instead of stdout. Progress goes to
+// stderr. Every benchmark reports the mean and minimum time of one repetition in seconds; a benchmark
+// which throws is reported with an "error" string rather than aborting the run.
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <functional>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "emdata.h"
+#include "cmp.h"
+#include "aligner.h"
+#include "reconstructor.h"
+#include "transform.h"
+#include "emutil.h"
+#include "util.h"
+
+using namespace std;
+using namespace EMAN;
+
+namespace {
+
+typedef chrono::steady_clock Clock;
+
+struct BenchResult
+{
+	string group;
+	string name;
+	string size;
+	int reps;
+	double mean;
+	double min;
+	double rate;		// optional throughput, 0 if not measured
+	string rate_unit;
+	string error;
+};
+
+string json_string(const string &s)
+{
+	string out = "\"";
+	for (size_t i = 0; i < s.size(); i++) {
+		char c = s[i];
+		if (c == '"' || c == '\\') { out += '\\'; out += c; }
+		else if (c == '\n') out += "\\n";
+		else if (c == '\t') out += "\\t";
+		else if ((unsigned char)c < 0x20) {
+			char buf[8];
+			sprintf(buf, "\\u%04x", (unsigned char)c);
+			out += buf;
+		}
+		else out += c;
+	}
+	return out + "\"";
+}
+
+string dims(int nx, int ny, int nz = 1)
+{
+	ostringstream ss;
+	ss << nx << "x" << ny;
+	if (nz > 1) ss << "x" << nz;
+	return ss.str();
+}
+
+class Bench
+{
+  public:
+	Bench() : quick(false) {}
+
+	bool quick;
+	string only;
+	string tmpdir;
+
+	bool wanted(const string &group, const string &name) const
+	{
+		return only.empty() || (group + "/" + name).find(only) != string::npos;
+	}
+
+	/** Times reps calls of f. setup is called before each repetition and teardown after it, outside
+	 * the timed region. One untimed warm-up call is made first. Returns the entry so the caller can
+	 * fill in a throughput.
+	 */
+	BenchResult &run(const string &group, const string &name, const string &size, int reps,
+					 const function<void()> &f,
+					 const function<void()> &setup = function<void()>(),
+					 const function<void()> &teardown = function<void()>())
+	{
+		BenchResult r;
+		r.group = group;
+		r.name = name;
+		r.size = size;
+		r.reps = 0;
+		r.mean = r.min = r.rate = 0;
+
+		fprintf(stderr, "%-12s %-32s %-12s", group.c_str(), name.c_str(), size.c_str());
+		try {
+			if (setup) setup();
+			f();
+			if (teardown) teardown();
+
+			double total = 0;
+			for (int i = 0; i < reps; i++) {
+				if (setup) setup();
+				Clock::time_point t0 = Clock::now();
+				f();
+				double dt = chrono::duration<double>(Clock::now() - t0).count();
+				if (teardown) teardown();
+				total += dt;
+				if (i == 0 || dt < r.min) r.min = dt;
+				r.reps++;
+			}
+			r.mean = total / r.reps;
+			fprintf(stderr, " %12.6f s\n", r.mean);
+		}
+		catch (E2Exception &e) {
+			r.error = e.what();
+			fprintf(stderr, " error\n");
+		}
+		catch (std::exception &e) {
+			r.error = e.what();
+			fprintf(stderr, " error\n");
+		}
+		results.push_back(r);
+		return results.back();
+	}
+
+	/** Records a measurement taken by the caller, for workloads that don't fit run() */
+	BenchResult &add(const string &group, const string &name, const string &size, int reps, double mean,
+					 double min)
+	{
+		BenchResult r;
+		r.group = group;
+		r.name = name;
+		r.size = size;
+		r.reps = reps;
+		r.mean = mean;
+		r.min = min;
+		r.rate = 0;
+		fprintf(stderr, "%-12s %-32s %-12s %12.6f s\n", group.c_str(), name.c_str(), size.c_str(), mean);
+		results.push_back(r);
+		return results.back();
+	}
+
+	void fail(const string &group, const string &name, const string &size, const string &error)
+	{
+		BenchResult r;
+		r.group = group;
+		r.name = name;
+		r.size = size;
+		r.reps = 0;
+		r.mean = r.min = r.rate = 0;
+		r.error = error;
+		fprintf(stderr, "%-12s %-32s %-12s error\n", group.c_str(), name.c_str(), size.c_str());
+		results.push_back(r);
+	}
+
+	void write_json(FILE *out) const
+	{
+		time_t now = time(0);
+		char stamp[64];
+		strftime(stamp, sizeof(stamp), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+
+		fprintf(out, "{\n");
+		fprintf(out, "  \"benchmark\": \"libEM_bench\",\n");
+		fprintf(out, "  \"format_version\": 1,\n");
+		fprintf(out, "  \"timestamp\": %s,\n", json_string(stamp).c_str());
+		fprintf(out, "  \"quick\": %s,\n", quick ? "true" : "false");
+		fprintf(out, "  \"hardware_threads\": %u,\n", std::thread::hardware_concurrency());
+		fprintf(out, "  \"array_kernels\": %s,\n", json_string(Util::array_kernel_isa()).c_str());
+		fprintf(out, "  \"results\": [");
+		for (size_t i = 0; i < results.size(); i++) {
+			const BenchResult &r = results[i];
+			fprintf(out, "%s\n    {\"group\": %s, \"name\": %s, \"size\": %s, \"reps\": %d",
+					i ? "," : "", json_string(r.group).c_str(), json_string(r.name).c_str(),
+					json_string(r.size).c_str(), r.reps);
+			if (r.error.empty()) {
+				fprintf(out, ", \"mean_s\": %.9g, \"min_s\": %.9g", r.mean, r.min);
+				if (r.rate > 0) fprintf(out, ", \"rate\": %.6g, \"rate_unit\": %s", r.rate,
+										json_string(r.rate_unit).c_str());
+			}
+			else fprintf(out, ", \"error\": %s", json_string(r.error).c_str());
+			fprintf(out, "}");
+		}
+		fprintf(out, "\n  ]\n}\n");
+	}
+
+  private:
+	vector<BenchResult> results;
+};
+
+/** A band-limited 2-D test image with some structure, the same for every run */
+EMData *make_image(int nx, int ny, int nz = 1, int seed = 1)
+{
+	EMData *img = new EMData(nx, ny, nz);
+	img->process_inplace("testimage.noise.gauss", Dict("sigma", 1.0f, "seed", seed));
+	img->process_inplace("filter.lowpass.gauss", Dict("cutoff_abs", 0.15f));
+	if (nz == 1) {
+		EMData curve(nx, ny);
+		curve.process_inplace("testimage.scurve");
+		curve.mult(4.0f);
+		img->add(curve);
+	}
+	img->process_inplace("normalize.edgemean");
+	return img;
+}
+
+void bench_fft(Bench &b)
+{
+	vector<int> sizes2d, sizes3d;
+	if (b.quick) { sizes2d = {64, 256}; sizes3d = {32, 64}; }
+	else { sizes2d = {64, 128, 256, 384, 512, 1024, 2048}; sizes3d = {32, 64, 128, 192, 256}; }
+
+	for (int n : sizes2d) {
+		if (!b.wanted("fft", "do_fft")) break;
+		EMData *img = make_image(n, n);
+		b.run("fft", "do_fft", dims(n, n), b.quick ? 5 : Util::get_max(5, (int)(2.0e7 / ((double)n*n))),
+			  [&]() { delete img->do_fft(); });
+		delete img;
+	}
+	for (int n : sizes3d) {
+		if (!b.wanted("fft", "do_fft")) break;
+		EMData *img = new EMData(n, n, n);
+		img->process_inplace("testimage.noise.gauss", Dict("sigma", 1.0f, "seed", 1));
+		b.run("fft", "do_fft", dims(n, n, n), b.quick ? 3 : Util::get_max(3, (int)(1.0e9 / ((double)n*n*n*32))),
+			  [&]() { delete img->do_fft(); });
+		delete img;
+	}
+}
+
+void bench_cmp(Bench &b)
+{
+	int n = b.quick ? 64 : 128;
+	EMData *a = make_image(n, n, 1, 1);
+	EMData *c = make_image(n, n, 1, 2);
+	c->add(*a);
+
+	vector<string> names = Factory<Cmp>::get_list();
+	for (size_t i = 0; i < names.size(); i++) {
+		if (!b.wanted("cmp", names[i])) continue;
+		b.run("cmp", names[i], dims(n, n), b.quick ? 5 : 200, [&]() { a->cmp(names[i], c); });
+	}
+	delete a;
+	delete c;
+}
+
+void bench_align(Bench &b)
+{
+	int n = b.quick ? 64 : 128;
+	EMData *ref = make_image(n, n, 1, 1);
+	EMData *mov = ref->copy();
+	Transform t(Dict("type", "2d", "alpha", 33.0f, "tx", 3.5f, "ty", -2.0f));
+	mov->transform(t);
+	EMData *noise = new EMData(n, n);
+	noise->process_inplace("testimage.noise.gauss", Dict("sigma", 0.5f, "seed", 7));
+	mov->add(*noise);
+	delete noise;
+
+	const char *names[] = {"rotate_translate_tree", "rotate_translate_flip"};
+	for (const char *name : names) {
+		if (!b.wanted("align", name)) continue;
+		b.run("align", name, dims(n, n), b.quick ? 2 : 20,
+			  [&]() { delete mov->align(name, ref, Dict(), "ccc"); });
+	}
+	delete ref;
+	delete mov;
+}
+
+void bench_reconstruct(Bench &b)
+{
+	if (!b.wanted("reconstruct", "fourier")) return;
+
+	int n = b.quick ? 32 : 96;
+	EMData *model = new EMData(n, n, n);
+	model->process_inplace("testimage.noise.gauss", Dict("sigma", 1.0f, "seed", 3));
+	model->process_inplace("filter.lowpass.gauss", Dict("cutoff_abs", 0.1f));
+	model->process_inplace("mask.soft", Dict("outer_radius", n/3));
+
+	vector<Transform> xforms;
+	float step = b.quick ? 30.0f : 9.0f;
+	for (float alt = 0; alt <= 90.0f; alt += step) {
+		for (float az = 0; az < 360.0f; az += step) {
+			xforms.push_back(Transform(Dict("type", "eman", "az", az, "alt", alt, "phi", 0.0f)));
+			if (alt == 0) break;
+		}
+	}
+	vector<EMData *> projs;
+	for (size_t i = 0; i < xforms.size(); i++) projs.push_back(model->project("standard", xforms[i]));
+	delete model;
+
+	const char *modes[] = {"gauss_2", "gauss_5", "nearest_neighbor"};
+	for (const char *mode : modes) {
+		string name = string("fourier/") + mode;
+		int reps = b.quick ? 1 : 3;
+		double insert_total = 0, insert_min = 0, finish_total = 0, finish_min = 0;
+		try {
+			for (int r = 0; r < reps; r++) {
+				Reconstructor *recon = Factory<Reconstructor>::get("fourier",
+					Dict("size", vector<int>{n, n, n}, "sym", "c1", "mode", mode, "quiet", true));
+				recon->setup();
+				vector<EMData *> prepped;
+				for (size_t i = 0; i < projs.size(); i++) prepped.push_back(recon->preprocess_slice(projs[i], xforms[i]));
+
+				Clock::time_point t0 = Clock::now();
+				for (size_t i = 0; i < prepped.size(); i++) recon->insert_slice(prepped[i], xforms[i], 1.0f);
+				double dt = chrono::duration<double>(Clock::now() - t0).count() / prepped.size();
+				insert_total += dt;
+				if (r == 0 || dt < insert_min) insert_min = dt;
+
+				t0 = Clock::now();
+				EMData *vol = recon->finish(true);
+				dt = chrono::duration<double>(Clock::now() - t0).count();
+				finish_total += dt;
+				if (r == 0 || dt < finish_min) finish_min = dt;
+
+				delete vol;
+				for (size_t i = 0; i < prepped.size(); i++) delete prepped[i];
+				delete recon;
+			}
+			b.add("reconstruct", name + "/insert_slice", dims(n, n, n), reps, insert_total / reps, insert_min);
+			b.add("reconstruct", name + "/finish", dims(n, n, n), reps, finish_total / reps, finish_min);
+		}
+		catch (E2Exception &e) {
+			b.fail("reconstruct", name, dims(n, n, n), e.what());
+		}
+	}
+	for (size_t i = 0; i < projs.size(); i++) delete projs[i];
+}
+
+/** The 20 processors most often called through process_inplace() in the EMAN2 programs */
+void bench_process(Bench &b)
+{
+	int n = b.quick ? 128 : 512;
+	EMData *base = make_image(n, n);
+	EMData *other = make_image(n, n, 1, 5);
+	Transform t(Dict("type", "2d", "alpha", 17.0f, "tx", 2.5f, "ty", -1.5f));
+
+	vector<pair<string, Dict> > procs = {
+		{"filter.lowpass.gauss", Dict("cutoff_abs", 0.25f)},
+		{"normalize.edgemean", Dict()},
+		{"normalize", Dict()},
+		{"xform", Dict("transform", &t)},
+		{"math.meanshrink", Dict("n", 2)},
+		{"math.fft.resample", Dict("n", 2.0f)},
+		{"filter.highpass.gauss", Dict("cutoff_abs", 0.02f)},
+		{"xform.centerofmass", Dict()},
+		{"threshold.binary", Dict("value", 0.0f)},
+		{"mask.gaussian", Dict("outer_radius", n/4)},
+		{"normalize.toimage", Dict("to", other)},
+		{"xform.phaseorigin.tocenter", Dict()},
+		{"threshold.belowtozero", Dict("minval", 0.0f)},
+		{"normalize.circlemean", Dict()},
+		{"xform.phaseorigin.tocorner", Dict()},
+		{"mask.soft", Dict("outer_radius", n/3, "width", 4.0f)},
+		{"xform.reverse", Dict("axis", "x")},
+		{"mask.decayedge2d", Dict("width", 8)},
+		{"xform.transpose", Dict()},
+		{"threshold.clampminmax.nsigma", Dict("nsigma", 3.0f)}
+	};
+
+	EMData *work = 0;
+	for (size_t i = 0; i < procs.size(); i++) {
+		if (!b.wanted("process", procs[i].first)) continue;
+		b.run("process", procs[i].first, dims(n, n), b.quick ? 5 : 50,
+			  [&]() { work->process_inplace(procs[i].first, procs[i].second); },
+			  [&]() { work = base->copy(); },
+			  [&]() { delete work; work = 0; });
+	}
+	delete base;
+	delete other;
+}
+
+void bench_io(Bench &b)
+{
+	int n = b.quick ? 64 : 256;
+	int nimg = b.quick ? 50 : 1000;
+	string dir = b.tmpdir.empty() ? string(".") : b.tmpdir;
+	string hdf = dir + "/libEM_bench_tmp.hdf";
+	string mrc = dir + "/libEM_bench_tmp.mrcs";
+	string lst = dir + "/libEM_bench_tmp.lst";
+	double mbytes = (double)n*n*sizeof(float)*nimg / 1.0e6;
+
+	EMData *img = make_image(n, n);
+	for (int i = 0; i < nimg; i++) {
+		img->set_attr("bench_index", i);
+		img->write_image(hdf, i);
+		img->write_image(mrc, i);
+	}
+	delete img;
+
+	FILE *out = fopen(lst.c_str(), "w");
+	if (out) {
+		fprintf(out, "#LST\n");
+		for (int i = 0; i < nimg; i++) fprintf(out, "%d\t%s\n", i, hdf.c_str());
+		fclose(out);
+	}
+
+	struct { const char *name; string file; } files[] = {{"hdf", hdf}, {"mrcs", mrc}, {"lst", lst}};
+	for (auto &f : files) {
+		if (b.wanted("imageio", string(f.name) + "/read")) {
+			BenchResult &r = b.run("imageio", string(f.name) + "/read", dims(n, n) + "x" + Util::int2str(nimg),
+								   b.quick ? 1 : 3, [&]() {
+				EMData e;
+				for (int i = 0; i < nimg; i++) e.read_image(f.file, i);
+			});
+			if (r.error.empty()) { r.rate = mbytes / r.mean; r.rate_unit = "MB/s"; }
+		}
+		if (b.wanted("imageio", string(f.name) + "/read_header")) {
+			BenchResult &r = b.run("imageio", string(f.name) + "/read_header", Util::int2str(nimg),
+								   b.quick ? 1 : 3, [&]() {
+				EMData e;
+				for (int i = 0; i < nimg; i++) e.read_image(f.file, i, true);
+			});
+			if (r.error.empty()) { r.rate = nimg / r.mean; r.rate_unit = "headers/s"; }
+		}
+	}
+
+	remove(lst.c_str());
+	remove(mrc.c_str());
+	remove(hdf.c_str());
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+	Bench b;
+	string output;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--quick") == 0) b.quick = true;
+		else if (strcmp(argv[i], "--only") == 0 && i + 1 < argc) b.only = argv[++i];
+		else if (strcmp(argv[i], "--tmpdir") == 0 && i + 1 < argc) b.tmpdir = argv[++i];
+		else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) output = argv[++i];
+		else {
+			fprintf(stderr, "usage: %s [--quick] [--only <substring>] [--tmpdir <dir>] [--output <file.json>]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	bench_fft(b);
+	bench_cmp(b);
+	bench_align(b);
+	bench_reconstruct(b);
+	bench_process(b);
+	bench_io(b);
+
+	FILE *out = stdout;
+	if (!output.empty()) {
+		out = fopen(output.c_str(), "w");
+		if (!out) {
+			fprintf(stderr, "cannot write %s\n", output.c_str());
+			return 1;
+		}
+	}
+	b.write_json(out);
+	if (out != stdout) fclose(out);
+
+	return 0;
+}
@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) 2000- Baylor College of Medicine
+ * 
+ * This software is issued under a joint BSD/GNU license. You may use the
+ * source code in this file under either license. However, note that the
+ * complete EMAN2 and SPARX software packages have some GPL dependencies,
+ * so you are responsible for compliance with the licenses of these packages
+ * if you opt to use BSD licensing. The warranty disclaimer below holds
+ * in either instance.
+ * 
+ * This complete copyright notice must be included in any revised version of the
+ * source code. Additional authorship citations may be added, but existing
+ * author citations must be preserved.
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ * 
+ * */
+
+// Compares the Util::array_* kernels against plain scalar loops on typical 2-D and 3-D image sizes.
+// Run with no arguments.
+
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <vector>
+#include "util.h"
+
+using namespace std;
+using namespace EMAN;
+
+typedef chrono::steady_clock Clock;
+
+static volatile double sink = 0;
+
+// f is called through std::function so the compiler can't fuse the repetitions into one pass
+static double time_op(const function<void()> &f, int reps)
+{
+	f();	// warm the caches and fault in the pages
+	Clock::time_point t0 = Clock::now();
+	for (int r = 0; r < reps; r++) f();
+	return chrono::duration<double>(Clock::now() - t0).count() / reps;
+}
+
+static void report(const char *name, size_t n, double tscalar, double tsimd)
+{
+	printf("%-14s %12lu  scalar %9.3f ms  kernel %9.3f ms  speedup %5.2fx\n",
+		   name, (unsigned long)n, tscalar*1000.0, tsimd*1000.0, tscalar/tsimd);
+}
+
+static void bench(size_t n, int reps)
+{
+	vector<float> a(n), b(n);
+	for (size_t i = 0; i < n; i++) {
+		a[i] = (float)((i*7919)%1000)/1000.0f;
+		b[i] = (float)((i*104729)%1000)/1000.0f + 0.5f;
+	}
+	float *pa = &a[0];
+	const float *pb = &b[0];
+
+	report("add", n,
+		   time_op([&]() { for (size_t i = 0; i < n; i++) pa[i] += pb[i]; }, reps),
+		   time_op([&]() { Util::array_add(pa, pb, n); }, reps));
+	report("mult", n,
+		   time_op([&]() { for (size_t i = 0; i < n; i++) pa[i] *= pb[i]; }, reps),
+		   time_op([&]() { Util::array_mult(pa, pb, n); }, reps));
+	report("addsquare", n,
+		   time_op([&]() { for (size_t i = 0; i < n; i++) pa[i] += pb[i]*pb[i]; }, reps),
+		   time_op([&]() { Util::array_addsquare(pa, pb, n); }, reps));
+	report("mult_scalar", n,
+		   time_op([&]() { for (size_t i = 0; i < n; i++) pa[i] *= 0.999f; }, reps),
+		   time_op([&]() { Util::array_mult(pa, 0.999f, n); }, reps));
+	report("mult_complex", n,
+		   time_op([&]() {
+				for (size_t i = 0; i < n; i += 2) {
+					float re = pa[i]*pb[i] + pa[i+1]*pb[i+1];
+					float im = pa[i+1]*pb[i] - pa[i]*pb[i+1];
+					pa[i] = re;
+					pa[i+1] = im;
+				}
+			}, reps),
+		   time_op([&]() { Util::array_mult_complex(pa, pb, n/2, true); }, reps));
+	report("div", n,
+		   time_op([&]() { for (size_t i = 0; i < n; i++) if (pb[i] != 0) pa[i] /= pb[i]; }, reps),
+		   time_op([&]() { Util::array_div(pa, pb, n); }, reps));
+	report("dot", n,
+		   time_op([&]() { double s = 0; for (size_t i = 0; i < n; i++) s += pa[i]*(double)pb[i]; sink = s; }, reps),
+		   time_op([&]() { sink = Util::array_dot(pa, pb, n); }, reps));
+
+	float mn, mx;
+	double sum, sq;
+	size_t nz;
+	report("stats", n,
+		   time_op([&]() {
+				float lmin = pb[0], lmax = pb[0];
+				double s = 0, s2 = 0;
+				size_t c = 0;
+				for (size_t i = 0; i < n; i++) {
+					float v = pb[i];
+					if (v < lmin) lmin = v;
+					if (v > lmax) lmax = v;
+					if (v != 0) c++;
+					s += v;
+					s2 += v*(double)v;
+				}
+				sink = s + s2 + lmin + lmax + c;
+			}, reps),
+		   time_op([&]() { Util::array_stats(pb, n, 1, mn, mx, sum, sq, nz); sink = sum; }, reps));
+}
+
+int main()
+{
+	printf("array kernels: %s\n\n", Util::array_kernel_isa().c_str());
+
+	printf("2-D 1024x1024\n");
+	bench((size_t)1024*1024, 50);
+
+	printf("\n3-D 256x256x256\n");
+	bench((size_t)256*256*256, 5);
+
+	return 0;
+}
@@ -396,6 +396,30 @@ class TestAligner(unittest.TestCase):
 		e.align('refine', e2)
 		t = Transform()
 		e.align('refine', e2, {'mode':1, "xform.align2d":t})
+
+	def test_RT3DTreeAligner_threads(self):
+		"""test RT3DTreeAligner threads ....................."""
+		e = EMData()
+		e.set_size(32,32,32)
+		e.process_inplace('testimage.noise.gauss')
+		e.process_inplace('filter.lowpass.gauss', {'cutoff_abs':0.2})
+		
+		e2 = e.process('xform', {'transform':Transform({'type':'eman','az':20,'alt':30,'phi':40,'tx':2,'ty':-1})})
+		
+		# the search is scored in parallel but merged in a fixed order, so the thread count must not change the answer
+		r1 = e2.align('rotate_translate_3d_tree', e, {'threads':1})
+		rn = e2.align('rotate_translate_3d_tree', e, {'threads':4})
+		self.assertEqual(r1.get_attr('score'), rn.get_attr('score'))
+		p1 = r1.get_attr('xform.align3d').get_params('eman')
+		pn = rn.get_attr('xform.align3d').get_params('eman')
+		for k in ('az','alt','phi','tx','ty','tz'):
+			self.assertEqual(p1[k], pn[k])
+		
+		# refinement around a given orientation goes through the same threaded path
+		xf = [r1.get_attr('xform.align3d')]
+		r1 = e2.align('rotate_translate_3d_tree', e, {'threads':1, 'initxform':xf, 'maxang':10})
+		rn = e2.align('rotate_translate_3d_tree', e, {'threads':4, 'initxform':xf, 'maxang':10})
+		self.assertEqual(r1.get_attr('score'), rn.get_attr('score'))
 		
 		
 		#for y in [32]:
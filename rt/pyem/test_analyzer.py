@@ -0,0 +1,94 @@
+#!/usr/bin/env python
+#
+# Copyright (c) 2000-2006 Baylor College of Medicine
+#
+# This software is issued under a joint BSD/GNU license. You may use the
+# source code in this file under either license. However, note that the
+# complete EMAN2 and SPARX software packages have some GPL dependencies,
+# so you are responsible for compliance with the licenses of these packages
+# if you opt to use BSD licensing. The warranty disclaimer below holds
+# in either instance.
+#
+# This complete copyright notice must be included in any revised version of the
+# source code. Additional authorship citations may be added, but existing
+# author citations must be preserved.
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 2 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  2111-1307 USA
+#
+#
+
+from builtins import range
+from EMAN2 import *
+import unittest,os,sys
+import testlib
+from optparse import OptionParser
+
+IS_TEST_EXCEPTION = False
+
+class TestAnalyzer(unittest.TestCase):
+	"""analyzer test"""
+
+	def run_kmeans(self, data, params):
+		imgs = [i.copy() for i in data]
+		Util.set_randnum_seed(11)
+		an = Analyzers.get("kmeans")
+		an.set_params(params)
+		an.insert_images_list(imgs)
+		centers = an.analyze()
+		return [i["class_id"] for i in imgs], centers
+
+	def test_KMeansAnalyzer_flat(self):
+		"""test KMeansAnalyzer flat mode ...................."""
+		# noisy copies of a few prototypes, plus exact duplicates so some distances tie
+		Util.set_randnum_seed(5)
+		protos = []
+		for i in range(6):
+			p = EMData(24,24)
+			p.process_inplace("testimage.noise.gauss")
+			protos.append(p)
+		data = []
+		for i in range(240):
+			e = protos[i%6].copy()
+			e.process_inplace("math.addnoise", {"noise":2.0})
+			data.append(e)
+		for i in range(20):
+			data.append(data[i*3].copy())
+
+		for params in ({"ncls":6, "seedmode":1}, {"ncls":8, "seedmode":0, "mininclass":3}, {"ncls":7, "outlierclass":1, "mininclass":4}):
+			cls, centers = self.run_kmeans(data, params)
+			for threads in (1, 4):
+				p = dict(params)
+				p["flat"] = 1
+				p["threads"] = threads
+				fcls, fcenters = self.run_kmeans(data, p)
+				# the flat path skips distances it can prove don't matter, but must land on the same classes
+				self.assertEqual(cls, fcls)
+				self.assertEqual(len(centers), len(fcenters))
+				for c, f in zip(centers, fcenters):
+					self.assertEqual(c.cmp("sqeuclidean", f), 0)
+
+def test_main():
+    p = OptionParser()
+    p.add_option('--t', action='store_true', help='test exception', default=False )
+    global IS_TEST_EXCEPTION
+    opt, args = p.parse_args()
+    if opt.t:
+        IS_TEST_EXCEPTION = True
+    Log.logger().set_level(-1)  #perfect solution for quenching the Log error information, thank Liwei
+    suite = unittest.TestLoader().loadTestsFromTestCase(TestAnalyzer)
+    unittest.TextTestRunner(verbosity=2).run(suite)
+
+if __name__ == '__main__':
+    test_main()
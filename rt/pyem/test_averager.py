@@ -79,6 +79,94 @@ class TestAverager(unittest.TestCase):
 
 	test_AbsMaxMinAverager.broken = True
 
+	def average(self, name, params, imgs):
+		avgr = Averagers.get(name, params)
+		for e in imgs:
+			avgr.add_image(e)
+		return avgr.finish()
+
+	def test_MedianAverager_approx(self):
+		"""test MedianAverager approx ......................."""
+		import numpy as np
+		# each pixel has its own offset and spread
+		base = EMData(16,16)
+		base.process_inplace("testimage.noise.gauss")
+		base.mult(50.0)
+		spread = EMData(16,16)
+		spread.process_inplace("testimage.noise.uniform.rand")
+		spread.add(0.5)
+		imgs = []
+		for i in range(301):
+			e = EMData(16,16)
+			e.process_inplace("testimage.noise.gauss")
+			e.mult(spread)
+			e.add(base)
+			imgs.append(e)
+		vals = np.array([e.get_data_as_vector() for e in imgs], np.float64)
+		sigma = vals.std(axis=0)
+
+		exact = self.average("median", {}, imgs)
+		self.assertTrue(np.array_equal(np.array(exact.get_data_as_vector()), np.median(vals, axis=0).astype(np.float32)))
+
+		# The error is within one bin, maxerr * sigma of the buffered values of each pixel, or twice
+		# that where a later value widened the histogram. Threads don't change the result. The
+		# buffer is at least one image per bin, 8/maxerr, so these leave most images to the histogram
+		for maxerr in (0.1, 0.05):
+			approx = self.average("median", {"approx":1, "maxerr":maxerr}, imgs)
+			err = abs(np.array(approx.get_data_as_vector()) - np.array(exact.get_data_as_vector()))
+			self.assertTrue(np.all(err <= 2.5 * maxerr * sigma))
+			self.assertTrue(err.mean() <= 0.5 * maxerr * sigma.mean())
+			approx4 = self.average("median", {"approx":1, "maxerr":maxerr, "threads":4}, imgs)
+			self.assertEqual(approx.cmp("sqeuclidean", approx4), 0)
+
+		# with no more images than the buffer the median is exact
+		approx = self.average("median", {"approx":1, "buffer":64}, imgs[:64])
+		exact = self.average("median", {}, imgs[:64])
+		self.assertEqual(approx.cmp("sqeuclidean", exact), 0)
+
+	def test_SigmaAverager_welford(self):
+		"""test SigmaAverager welford ......................."""
+		import numpy as np
+		# a small spread on a large mean, where the sum of squares loses most of its digits
+		imgs = []
+		for i in range(200):
+			e = EMData(16,16)
+			e.process_inplace("testimage.noise.gauss")
+			e.mult(0.01)
+			e.add(1000.0)
+			imgs.append(e)
+		vals = np.array([e.get_data_as_vector() for e in imgs], np.float64)
+		ref = vals.std(axis=0)
+
+		for threads in (1, 4):
+			sig = np.array(self.average("sigma", {"welford":1, "threads":threads}, imgs).get_data_as_vector())
+			self.assertTrue(np.allclose(sig, ref, rtol=1.0e-4))
+
+		# on well conditioned data both paths agree
+		imgs = []
+		for i in range(50):
+			e = EMData(16,16)
+			e.process_inplace("testimage.noise.gauss")
+			imgs.append(e)
+		plain = np.array(self.average("sigma", {}, imgs).get_data_as_vector())
+		welford = np.array(self.average("sigma", {"welford":1}, imgs).get_data_as_vector())
+		self.assertTrue(np.allclose(plain, welford, rtol=1.0e-4, atol=1.0e-5))
+
+		# ignore0 counts and averages only the nonzero values of each pixel
+		for i, e in enumerate(imgs):
+			for j in range(i % 7):
+				e.set_value_at(j, 0, 0.0)
+			e.update()
+		vals = np.array([e.get_data_as_vector() for e in imgs], np.float64)
+		ref = np.array([v[v != 0].std() for v in vals.T])
+		plainnorm = EMData(16,16)
+		plain = np.array(self.average("sigma", {"ignore0":1, "normimage":plainnorm}, imgs).get_data_as_vector())
+		norm = EMData(16,16)
+		welford = np.array(self.average("sigma", {"ignore0":1, "welford":1, "normimage":norm}, imgs).get_data_as_vector())
+		self.assertTrue(np.allclose(welford, ref, rtol=1.0e-5))
+		self.assertTrue(np.allclose(plain, welford, rtol=1.0e-3, atol=1.0e-4))
+		self.assertEqual(list(norm.get_data_as_vector()), [float((vals[:,j] != 0).sum()) for j in range(256)])
+
 def test_main():
     p = OptionParser()
     p.add_option('--t', action='store_true', help='test exception', default=False )
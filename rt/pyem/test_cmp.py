@@ -213,6 +213,30 @@ class TestCmp(unittest.TestCase):
                     self.assertAlmostEqual(neg_one,-1, places=6)
         
 
+    def test_cacheref(self):
+        """test cached reference in ccc, phase and frc ......"""
+        ref = EMData(64,64,1)
+        ref.process_inplace('testimage.noise.gauss')
+        ptcls = []
+        for i in range(4):
+            e = EMData(64,64,1)
+            e.process_inplace('testimage.noise.gauss')
+            e.add(ref)
+            ptcls.append(e)
+
+        for name in ('ccc', 'phase', 'frc'):
+            # the reference is cached by default, and must follow every change to it
+            for change in range(3):
+                if change == 1:
+                    ref.process_inplace('filter.lowpass.gauss', {'cutoff_abs':0.2})
+                elif change == 2:
+                    a = EMNumPy.em2numpy(ref)
+                    a[10:20,10:20] = 5.0
+                    ref.update()
+                for p in ptcls:
+                    self.assertAlmostEqual(p.cmp(name, ref, {}), p.cmp(name, ref, {'cacheref':0}), places=5)
+                    self.assertAlmostEqual(p.cmp(name, ref, {}), p.cmp(name, ref.copy(), {'cacheref':0}), places=5)
+
 def test_main():
     p = OptionParser()
     p.add_option('--t', action='store_true', help='test exception', default=False )
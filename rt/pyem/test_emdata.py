@@ -651,6 +651,149 @@ class TestEMData(unittest.TestCase):
             except RuntimeError as runtime_err:
                 self.assertEqual(exception_type(runtime_err), "ImageFormatException")
 
+    def test_do_fft_batch(self):
+        """test do_fft_batch()/do_ift_batch() function ......"""
+        import numpy as np
+        for size in ((32,32,1), (31,30,1), (16,16,16)):
+            imgs = []
+            for i in range(7):
+                e = EMData()
+                e.set_size(*size)
+                e.process_inplace("testimage.noise.uniform.rand")
+                imgs.append(e)
+
+            for threads in (1, 3):
+                ffts = EMData.do_fft_batch(imgs, threads)
+                self.assertEqual(len(ffts), len(imgs))
+                for e, f in zip(imgs, ffts):
+                    ref = e.do_fft()
+                    self.assertTrue(f.is_complex())
+                    self.assertTrue(np.allclose(EMNumPy.em2numpy(f), EMNumPy.em2numpy(ref), rtol=1.0e-4, atol=1.0e-4))
+
+                ifts = EMData.do_ift_batch(ffts, threads)
+                for e, f in zip(imgs, ifts):
+                    self.assertEqual((f.get_xsize(), f.get_ysize(), f.get_zsize()), size)
+                    self.assertTrue(np.allclose(EMNumPy.em2numpy(f), EMNumPy.em2numpy(e), atol=1.0e-4))
+
+        # the results are owned by python, so repeated batches don't accumulate memory
+        if platform.system() == "Linux":
+            import resource
+            imgs = []
+            for i in range(8):
+                e = EMData(128,128,64)
+                e.process_inplace("testimage.noise.uniform.rand")
+                imgs.append(e)
+            EMData.do_ift_batch(EMData.do_fft_batch(imgs))
+            before = resource.getrusage(resource.RUSAGE_SELF).ru_maxrss
+            for i in range(20):
+                EMData.do_ift_batch(EMData.do_fft_batch(imgs))
+            # each round makes 8 FFTs and 8 images of 4MB, about 1.3GB over 20 rounds if leaked
+            self.assertTrue(resource.getrusage(resource.RUSAGE_SELF).ru_maxrss - before < 300*1024)
+
+    def write_eer(self, filename, frames):
+        """write a minimal EER movie, frames is a list of sorted pixel indices on the 4k grid"""
+        import struct
+        npix = 4096*4096
+
+        # each frame is a run length bit stream of 7 bit skips, 127 meaning keep adding, each
+        # followed by a 4 bit sub pixel position. Bits are packed from the low end of each byte
+        strips = []
+        for f in frames:
+            out = bytearray()
+            acc = [0, 0]
+            def put(v, n):
+                acc[0] |= v << acc[1]
+                acc[1] += n
+                while acc[1] >= 8:
+                    out.append(acc[0] & 255)
+                    acc[0] >>= 8
+                    acc[1] -= 8
+            prev = -1
+            for p in list(f) + [npix]:
+                skip = p - prev - 1
+                prev = p
+                while skip >= 127:
+                    put(127, 7)
+                    skip -= 127
+                put(skip, 7)
+                put(p % 16 if p < npix else 0, 4)
+            out += bytes([acc[0]]) + bytes(16 - len(out) % 8)
+            strips.append(bytes(out))
+
+        # little endian TIFF, one directory and one strip per frame, metadata in the first
+        meta = b'<metadata><item name="numberOfFrames">%d</item></metadata>' % len(frames)
+        data = bytearray(b'II*\x00\x00\x00\x00\x00')
+        ifds = []
+        for i, s in enumerate(strips):
+            entries = [(256, 4, 1, 4096), (257, 4, 1, 4096), (258, 3, 1, 1), (259, 3, 1, 65001),
+                       (262, 3, 1, 1), (273, 4, 1, len(data)), (277, 3, 1, 1), (278, 4, 1, 4096), (279, 4, 1, len(s))]
+            data += s
+            if i == 0:
+                entries.append((65001, 7, len(meta), len(data)))
+                data += meta
+            if len(data) % 2: data += b'\x00'
+            ifds.append(entries)
+        offsets = []
+        for entries in ifds:
+            offsets.append(len(data))
+            data += struct.pack('<H', len(entries))
+            for tag, typ, cnt, val in entries:
+                data += struct.pack('<HHI', tag, typ, cnt) + (struct.pack('<HH', val, 0) if typ == 3 else struct.pack('<I', val))
+            data += struct.pack('<I', 0)
+        struct.pack_into('<I', data, 4, offsets[0])
+        for i in range(len(offsets) - 1):
+            struct.pack_into('<I', data, offsets[i] + 2 + 12*len(ifds[i]), offsets[i+1])
+        with open(filename, 'wb') as fh:
+            fh.write(data)
+
+    def test_read_eer_fractions(self):
+        """test read_eer_fractions() function ..............."""
+        import numpy as np
+        import random
+        filename = 'test_read_eer_fractions.eer'
+        rng = random.Random(17)
+        frames = [sorted(rng.sample(range(4096*4096), 300)) for i in range(7)]
+        frames[2] = []
+        self.write_eer(filename, frames)
+
+        # 7 frames in sums of 3 leave a last fraction of 1
+        sums = EMData.read_eer_fractions(filename, 3, 16, EMUtil.ImageType.IMAGE_EER, 1)
+        self.assertEqual(len(sums), 3)
+        for i, f in enumerate(sums):
+            self.assertEqual((f.get_xsize(), f.get_ysize()), (256, 256))
+            self.assertEqual(f.get_attr("EER.frames_summed"), (3, 3, 1)[i])
+            self.assertEqual(f.get_attr("source_n"), i*3)
+            expect = np.zeros((256, 256), np.float32)
+            for fr in frames[i*3:i*3+3]:
+                for p in fr:
+                    expect[(p >> 12) >> 4, (p & 4095) >> 4] += 1
+            self.assertTrue(np.array_equal(EMNumPy.em2numpy(f), expect))
+
+        # decoding the fractions in parallel, or on the 8k grid binned twice as much, gives the same sums
+        for f, g in zip(sums, EMData.read_eer_fractions(filename, 3, 16, EMUtil.ImageType.IMAGE_EER, 4)):
+            self.assertTrue(np.array_equal(EMNumPy.em2numpy(f), EMNumPy.em2numpy(g)))
+        for f, g in zip(sums, EMData.read_eer_fractions(filename, 3, 32, EMUtil.ImageType.IMAGE_EER2X, 4)):
+            self.assertTrue(np.array_equal(EMNumPy.em2numpy(f), EMNumPy.em2numpy(g)))
+
+        # and unbinned single frames match read_image
+        e = EMData()
+        e.read_image(filename, 1)
+        f = EMData.read_eer_fractions(filename, 1, 1)[1]
+        self.assertTrue(np.array_equal(EMNumPy.em2numpy(f), EMNumPy.em2numpy(e)))
+        self.assertAlmostEqual(f["mean"]*4096*4096, 300, delta=0.01)
+
+        # the fractions are owned by python, so repeated reads don't accumulate memory
+        if platform.system() == "Linux":
+            import resource
+            EMData.read_eer_fractions(filename, 1, 4)
+            before = resource.getrusage(resource.RUSAGE_SELF).ru_maxrss
+            for i in range(20):
+                EMData.read_eer_fractions(filename, 1, 4)
+            # each read makes 7 images of 4MB, about 560MB over 20 reads if leaked
+            self.assertTrue(resource.getrusage(resource.RUSAGE_SELF).ru_maxrss - before < 200*1024)
+
+        testlib.safe_unlink(filename)
+
     def test_do_fft_odd(self):
         """test odd size do_fft()/do_ift() function ........."""
         #test even size 3D image
@@ -2714,6 +2857,86 @@ class TestEMData(unittest.TestCase):
         
         testlib.safe_unlink(file1)
 
+    def test_array_kernels(self):
+        """test vectorized arithmetic and stats kernels ....."""
+        import numpy as np
+        def arr(e):
+            return np.array(e.get_data_as_vector(), np.float32)
+
+        # odd sizes leave a tail after the last full vector
+        for size in ((37,29,1), (64,64,1), (17,13,11)):
+            a = EMData(*size)
+            a.process_inplace("testimage.noise.gauss")
+            b = EMData(*size)
+            b.process_inplace("testimage.noise.uniform.rand")
+            b.add(0.5)
+            na = arr(a)
+            nb = arr(b)
+
+            # single operations round the same as a scalar loop
+            c = a.copy(); c.add(b)
+            self.assertTrue(np.array_equal(arr(c), na + nb))
+            c = a.copy(); c.sub(b)
+            self.assertTrue(np.array_equal(arr(c), na - nb))
+            c = a.copy(); c.mult(b)
+            self.assertTrue(np.array_equal(arr(c), na * nb))
+            c = a.copy(); c.add(2.5)
+            self.assertTrue(np.array_equal(arr(c), na + np.float32(2.5)))
+            c = a.copy(); c.mult(0.3)
+            self.assertTrue(np.array_equal(arr(c), na * np.float32(0.3)))
+
+            # these may be fused or use a reciprocal, so they get a rounding error of slack
+            c = a.copy(); c.addsquare(b)
+            self.assertTrue(np.allclose(arr(c), na + nb*nb, rtol=1.0e-6, atol=1.0e-6))
+            c = a.copy(); c.subsquare(b)
+            self.assertTrue(np.allclose(arr(c), na - nb*nb, rtol=1.0e-6, atol=1.0e-6))
+            c = a.copy(); c.div(b)
+            self.assertTrue(np.allclose(arr(c), na / nb, rtol=1.0e-6, atol=1.0e-6))
+            na64 = na.astype(np.float64)
+            nb64 = nb.astype(np.float64)
+            self.assertTrue(abs(a.dot(b) - np.dot(na64, nb64)) <= 1.0e-5 * np.dot(abs(na64), abs(nb64)))
+
+            # complex results are compared in double, with an error relative to the operands
+            fa = a.do_fft()
+            fb = b.do_fft()
+            nfa = arr(fa).view(np.complex64).astype(np.complex128)
+            nfb = arr(fb).view(np.complex64).astype(np.complex128)
+            c = fa.copy(); c.mult(fb)
+            err = abs(arr(c).view(np.complex64) - nfa * nfb)
+            self.assertTrue(np.all(err <= 1.0e-5 * abs(nfa) * abs(nfb) + 1.0e-6))
+            c = fa.copy(); c.div(fb)
+            err = abs(arr(c).view(np.complex64) - nfa / nfb)
+            self.assertTrue(np.all(err <= 1.0e-5 * abs(nfa) / abs(nfb) + 1.0e-6))
+
+            self.assertEqual(a["minimum"], na.min())
+            self.assertEqual(a["maximum"], na.max())
+            self.assertAlmostEqual(a["mean"], float(na.astype(np.float64).mean()), places=5)
+            self.assertAlmostEqual(a["sigma"], float(na.astype(np.float64).std(ddof=1)), places=5)
+
+        # 0/0 is left as 0, anything else over 0 raises
+        a = EMData(37,1)
+        a.to_one()
+        b = a.copy()
+        a.set_value_at(5, 0, 0.0)
+        b.set_value_at(5, 0, 0.0)
+        a.div(b)
+        self.assertEqual(a.get_value_at(5, 0), 0.0)
+        b.set_value_at(30, 0, 0.0)
+        try:
+            a.div(b)
+            self.fail("divide by zero not detected")
+        except RuntimeError as runtime_err:
+            self.assertEqual(exception_type(runtime_err), "InvalidValueException")
+
+        # NaNs are skipped by the minimum and maximum, wherever they are in the array
+        for pos in (0, 20, 36):
+            a = EMData(37,1)
+            for i in range(37): a.set_value_at(i, 0, float(i - 10))
+            a.set_value_at(pos, 0, float("nan"))
+            a.update()
+            self.assertEqual(a["minimum"], -10.0 if pos != 0 else -9.0)
+            self.assertEqual(a["maximum"], 26.0 if pos != 36 else 25.0)
+
     def test_image_overwrite(self):
         """test overwriting a image ........................."""
         file1 = "test_image_overwrite.mrc"
@@ -3505,6 +3728,70 @@ class TestEMData(unittest.TestCase):
     if platform.system() == "Windows":
         test_transform_pickling.broken = True
         
+    def test_calc_ccf_real(self):
+        """test calc_ccf of two real images ................."""
+        import numpy as np
+        # several sizes, alternating, so the per-thread workspaces are reused and replaced
+        sizes = [(32,32,1), (33,20,1), (16,16,16), (64,48,1), (15,9,7), (128,128,1)]
+        for rep in range(2):
+            for nx,ny,nz in sizes:
+                a = test_image_3d(0, (nx,ny,nz)) if nz>1 else test_image(0, (nx,ny))
+                b = a.copy()
+                b.process_inplace("math.addnoise", {"noise":1.0, "seed":nx+ny+nz})
+                na = EMNumPy.em2numpy(a).astype(np.float64)
+                nb = EMNumPy.em2numpy(b).astype(np.float64)
+                ref = np.real(np.fft.ifftn(np.fft.fftn(na)*np.conj(np.fft.fftn(nb))))
+                scale = np.abs(ref).max()
+
+                c = a.calc_ccf(b)
+                self.assertEqual((c.get_xsize(),c.get_ysize(),c.get_zsize()), (nx,ny,nz))
+                self.assertTrue(np.abs(EMNumPy.em2numpy(c)-ref).max() < 1.0e-4*scale)
+
+                c = a.calc_ccf(b, fp_flag.CIRCULANT, True)
+                shift = tuple(n//2 for n in na.shape)
+                self.assertTrue(np.abs(EMNumPy.em2numpy(c)-np.roll(ref,shift,tuple(range(na.ndim)))).max() < 1.0e-4*scale)
+        CCFWorkspace.clear_thread_cache()
+
+    def test_ccfworkspace_references(self):
+        """test CCFWorkspace batched correlations ..........."""
+        import numpy as np
+        nx,ny = 40,36
+        img = test_image(0, (nx,ny))
+        refs = []
+        for i in range(11):    # not a multiple of the batch size
+            r = test_image(i%10, (nx,ny))
+            r.process_inplace("math.addnoise", {"noise":0.5, "seed":i+1})
+            refs.append(r)
+
+        for batch in (1, 4, 8):
+            ws = CCFWorkspace(nx, ny, 1, batch)
+            ws.set_references(refs)
+            self.assertEqual(ws.get_nref(), len(refs))
+            for center in (False, True):
+                out = [EMData() for r in refs]
+                ws.ccf_references(img, out, center)
+                for r,o in zip(refs,out):
+                    c = img.calc_ccf(r, fp_flag.CIRCULANT, center)
+                    nc = EMNumPy.em2numpy(c)
+                    self.assertTrue(np.abs(EMNumPy.em2numpy(o)-nc).max() < 1.0e-5*np.abs(nc).max())
+
+            one = EMData()
+            ws.ccf(img, refs[3], one)
+            nc = EMNumPy.em2numpy(img.calc_ccf(refs[3]))
+            self.assertTrue(np.abs(EMNumPy.em2numpy(one)-nc).max() < 1.0e-5*np.abs(nc).max())
+
+        if(IS_TEST_EXCEPTION):
+            ws = CCFWorkspace(nx, ny)
+            try:
+                ws.ccf_references(img, [])
+            except RuntimeError as runtime_err:
+                self.assertEqual(exception_type(runtime_err), "InvalidCallException")
+
+            try:
+                ws.ccf(img, test_image(0, (nx+2,ny)), EMData())
+            except RuntimeError as runtime_err:
+                self.assertEqual(exception_type(runtime_err), "ImageDimensionException")
+
     def test_set_xyz_origin(self):
         """test set_xyz_origin function ....................."""
         img = test_image()
@@ -34,6 +34,7 @@ from past.utils import old_div
 from builtins import range
 from EMAN2 import *
 import unittest
+import math
 import os
 import sys
 import testlib
@@ -666,6 +667,168 @@ class TestHdfIO(ImageIOTester):
 		
 		os.unlink(testimage)
 		
+	def test_hdf_stack(self):
+		"""test hdf stack layout ............................"""
+		file = 'stack.hdf'
+		testlib.safe_unlink(file)
+		imgs = []
+		for i in range(10):
+			e = test_image(i%10, (24,20))
+			if i == 0: e.set_attr('hdf_stack', 1)
+			e.set_attr('idx', i)
+			e.set_attr('name', 'ptcl%d'%i)
+			t = Transform({"type":"eman","az":i*10.0,"alt":5.0})
+			e.set_attr('xform.projection', t)
+			if i%2: e.set_attr('odd', [i, i+1])
+			# a column whose values are of several types, or absent
+			if i == 1: e.set_attr('mix', 2.5)
+			elif i == 2: e.set_attr('mix', 16777217)
+			elif i == 4: e.set_attr('mix', float('nan'))
+			elif i != 3: e.set_attr('mix', i)
+			e.write_image(file, -1)
+			imgs.append(e)
+
+		self.assertEqual(EMUtil.get_image_count(file), 10)
+		for i in range(10):
+			e = EMData(file, i)
+			self.assertEqual(e.get_attr('idx'), i)
+			self.assertEqual(e.get_attr('name'), 'ptcl%d'%i)
+			self.assertAlmostEqual(e.get_attr('xform.projection').get_rotation("eman")["az"], imgs[i].get_attr('xform.projection').get_rotation("eman")["az"], 3)
+			self.assertEqual(e.has_attr('odd'), i%2 == 1)
+			if i%2: self.assertEqual(e.get_attr('odd'), [i, i+1])
+			self.assertEqual(e.get_data_as_vector(), imgs[i].get_data_as_vector())
+
+		self.assertAlmostEqual(EMData(file, 1).get_attr('mix'), 2.5)
+		self.assertEqual(EMData(file, 2).get_attr('mix'), 16777217)
+		self.assertTrue(isinstance(EMData(file, 2).get_attr('mix'), int))
+		self.assertFalse(EMData(file, 3).has_attr('mix'))
+		self.assertTrue(EMData(file, 4).has_attr('mix'))	# EMObject stores NaN as 0, but the value isn't lost
+		self.assertEqual(EMData(file, 4).get_attr('mix'), 0)
+		self.assertEqual(EMData(file, 5).get_attr('mix'), 5)
+
+		# read in runs of consecutive images
+		some = [7, 2, 3, 4, 9]
+		for i,e in zip(some, EMData.read_images(file, some)):
+			self.assertEqual(e.get_attr('idx'), i)
+			self.assertEqual(e.get_data_as_vector(), imgs[i].get_data_as_vector())
+		self.assertEqual(len(EMData.read_images(file)), 10)
+
+		# readers which don't know the stack layout see an empty file
+		try:
+			import h5py
+			f = h5py.File(file, 'r')
+			self.assertEqual(f['MDF/images'].attrs['imageid_max'], -1)
+			self.assertEqual(len(f['MDF/images']), 0)
+			self.assertEqual(f['MDF/stack/data'].shape, (10, 1, 20, 24))
+			f.close()
+
+			# a stack stored as doubles can't have its chunks decompressed directly
+			f = h5py.File(file, 'r+')
+			d = f['MDF/stack/data'][...]
+			del f['MDF/stack/data']
+			f.create_dataset('MDF/stack/data', data=d.astype('float64'), chunks=(4, 1, 20, 24), maxshape=(None, 1, 20, 24), shuffle=True, compression='gzip')
+			f.close()
+			for i,e in enumerate(EMData.read_images(file)):
+				self.assertEqual(e.get_data_as_vector(), imgs[i].get_data_as_vector())
+		except ImportError:
+			pass
+
+		testlib.safe_unlink(file)
+
+	def check_attribute_columns(self, file, keys, use_cache=False, first=0, n=-1):
+		"""compares get_attribute_columns with the headers from read_images and get_all_attributes"""
+		cols = EMUtil.get_attribute_columns(file, keys, first, n, use_cache)
+		hdrs = EMData.read_images(file, [], EMUtil.ImageType.IMAGE_UNKNOWN, True)
+		if n < 0: n = len(hdrs) - first
+		hdrs = hdrs[first:first+n]
+		for k in keys:
+			col = cols[k]
+			self.assertEqual(len(col), n)
+			allv = EMUtil.get_all_attributes(file, k)[first:first+n]
+			for i, h in enumerate(hdrs):
+				if not h.has_attr(k):
+					if isinstance(col[i], float): self.assertTrue(math.isnan(col[i]))
+					elif isinstance(col[i], Transform): self.assertEqual(col[i].get_matrix(), Transform().get_matrix())
+					else: self.assertEqual(col[i], "")
+					continue
+				v = h.get_attr(k)
+				if isinstance(v, Transform):
+					for a, b, c in zip(col[i].get_matrix(), v.get_matrix(), allv[i].get_matrix()):
+						self.assertAlmostEqual(a, b, 4)
+						self.assertAlmostEqual(a, c, 4)
+				elif isinstance(v, str):
+					self.assertEqual(col[i], v)
+					self.assertEqual(allv[i], v)
+				else:
+					self.assertAlmostEqual(col[i], v, 3)
+					self.assertAlmostEqual(allv[i], v, 3)
+		return cols
+
+	def test_hdf_attribute_columns(self):
+		"""test get_attribute_columns and its cache ........."""
+		keys = ['idx', 'name', 'defocus', 'xform.projection', 'datatype', 'nx']
+		group = 'colgroup.hdf'
+		stack = 'colstack.hdf'
+		lst = 'colgroup.lst'
+		sidecar = '.colgroup.hdf.hdrcol'
+		for f in (group, stack, lst, sidecar, '.colstack.hdf.hdrcol', '.colgroup.lst.hdrcol'):
+			testlib.safe_unlink(f)
+
+		for i in range(8):
+			e = test_image(i%10, (24,20))
+			e.set_attr('idx', i)
+			e.set_attr('name', 'ptcl%d'%i)
+			e.set_attr('xform.projection', Transform({"type":"eman","az":i*10.0,"alt":5.0}))
+			if i%3: e.set_attr('defocus', 1.0+i*0.1)
+			# the stored datatype attribute says float, read_header takes the type from the dataset
+			if i%2: e.write_image(group, i, EMUtil.ImageType.IMAGE_HDF, False, None, EMUtil.EMDataType.EM_USHORT)
+			else: e.write_image(group, i)
+			if i == 0: e.set_attr('hdf_stack', 1)
+			e.write_image(stack, i)
+
+		with open(lst, 'w') as out:
+			out.write("#LST\n")
+			for i in (5, 2, 7, 0, 1):
+				out.write("%d\t%s\n" % (i, group))
+
+		for f in (group, stack, lst):
+			self.check_attribute_columns(f, keys)
+			self.check_attribute_columns(f, keys, False, 2, 3)
+			self.check_attribute_columns(f, keys + ['source_path', 'source_n'], False, 1)
+
+		cols = EMUtil.get_attribute_columns(group, ['datatype'])
+		for i in range(8):
+			self.assertEqual(cols['datatype'][i], EMUtil.EMDataType.EM_USHORT if i%2 else EMUtil.EMDataType.EM_FLOAT)
+
+		# sidecar round trip, keys are added to an existing sidecar
+		self.check_attribute_columns(group, keys[:2], True)
+		self.assertTrue(os.path.isfile(sidecar))
+		self.check_attribute_columns(group, keys, True)
+		self.check_attribute_columns(group, keys, True, 3, 4)
+		self.check_attribute_columns(stack, keys, True)
+		self.check_attribute_columns(stack, keys, True, 5)
+
+		# a changed file makes the sidecar stale
+		e = EMData(group, 3)
+		e.set_attr('defocus', 9.5)
+		e.write_image(group, 3)
+		self.assertAlmostEqual(self.check_attribute_columns(group, keys, True)['defocus'][3], 9.5, 3)
+		e = EMData(stack, 4)
+		e.set_attr('name', 'changed')
+		e.write_image(stack, 4)
+		self.assertEqual(self.check_attribute_columns(stack, keys, True)['name'][4], 'changed')
+
+		# lists aren't cached, their values come from the referenced file
+		self.check_attribute_columns(lst, keys, True)
+		self.assertFalse(os.path.isfile('.colgroup.lst.hdrcol'))
+		e = EMData(group, 2)
+		e.set_attr('defocus', 7.25)
+		e.write_image(group, 2)
+		self.assertAlmostEqual(self.check_attribute_columns(lst, keys, True)['defocus'][1], 7.25, 3)
+
+		for f in (group, stack, lst, sidecar, '.colstack.hdf.hdrcol'):
+			testlib.safe_unlink(f)
+
 	def test_read_write_hdf(self):
 		"""test write-read hdf .............................."""
 		self.do_test_read_write("hdf")
@@ -701,6 +864,79 @@ class TestHdfIO(ImageIOTester):
 			self.assertEqual(1, f[i])
 		testlib.safe_unlink(file)
 
+	def test_hdf_imagestream_concurrent(self):
+		"""test HDF5 reads while an ImageStream reads ......."""
+		file1 = 'stream1.hdf'
+		file2 = 'stream2.hdf'
+		n = 64
+		for i in range(n):
+			e = EMData(16,16)
+			e.process_inplace('testimage.noise.uniform.rand')
+			e.write_image(file1, i)
+			e.process_inplace('math.addnoise', {'noise':1.0})
+			e.write_image(file2, i)
+		
+		# the stream's reader thread and this thread both call into HDF5, every call
+		# has to go through the HdfIO2 lock for this to work
+		stream = ImageStream(file1, [], False, 2, 2)
+		for i in range(n):
+			b = EMData(file2, i)
+			h = EMData()
+			h.read_image(file1, (i*7)%n, True)
+			self.assertEqual(h.get_xsize(), 16)
+			a = stream.next()
+			self.assertEqual(a.cmp('sqeuclidean', EMData(file1, i)), 0)
+			self.assertEqual(b.get_xsize(), 16)
+		self.assertEqual(stream.next(), None)
+		
+		testlib.safe_unlink(file1)
+		testlib.safe_unlink(file2)
+
+	def test_hdf_cache(self):
+		"""test reads and writes with the HDF5 file cache ..."""
+		file1 = 'cache1.hdf'
+		file2 = 'cache2.hdf'
+		for i in range(3):
+			e = EMData(8,8)
+			e.to_value(i)
+			e.write_image(file1, i)
+			e.write_image(file2, i)
+		cache = HDFCache.instance() if 'HDFCache' in globals() else None
+		if cache:
+			cache.clear()
+			cache.reset_stats()
+
+		for j in range(3):
+			for i in range(3):
+				self.assertEqual(EMData(file1, i)[0], i)
+		if cache:
+			self.assertEqual(cache.get_misses(), 1)
+			self.assertGreater(cache.get_hits(), 0)
+			self.assertEqual(cache.get_size(), 1)
+
+		# writes have to see past, and invalidate, the cached read only file
+		e = EMData(8,8)
+		e.to_value(10)
+		e.write_image(file1, 1)
+		EMUtil.write_hdf_attribute(file1, 'cachetest', 5, 2)
+		self.assertEqual(EMData(file1, 1)[0], 10)
+		self.assertEqual(EMData(file1, 2).get_attr('cachetest'), 5)
+		e.write_image(file1, 3)
+		self.assertEqual(EMUtil.get_image_count(file1), 4)
+
+		if cache:
+			capacity = cache.get_capacity()
+			cache.set_capacity(1)
+			self.assertEqual(EMData(file2, 0)[0], 0)
+			self.assertEqual(cache.get_size(), 1)
+			self.assertGreater(cache.get_evictions(), 0)
+			self.assertEqual(cache.close_file(file2), 0)
+			self.assertEqual(cache.get_size(), 0)
+			cache.set_capacity(capacity)
+
+		testlib.safe_unlink(file1)
+		testlib.safe_unlink(file2)
+
 class TestMrcIO(ImageIOTester):
 	"""mrc file IO test"""
 	def test_negative_image_index(self):
@@ -1109,6 +1345,83 @@ class TestImagicIO(ImageIOTester):
 
 #	def 
 
+class TestLstIO(unittest.TestCase):
+	"""LST/LSX list file tests"""
+
+	def make_images(self, filename, n, base):
+		imgs = []
+		for i in range(n):
+			e = EMData(16, 16)
+			e.process_inplace("testimage.noise.uniform.rand", {"seed":base+i})
+			e.write_image(filename, i)
+			imgs.append(e)
+		return imgs
+
+	def check_list(self, lstfile, refs, order, srckey):
+		for i in order:
+			e = EMData(lstfile, i)
+			fname, n, img = refs[i]
+			self.assertEqual(e.get_data_as_vector(), img.get_data_as_vector())
+			self.assertEqual(e[srckey], fname)
+
+	def test_lst_shuffled_reads(self):
+		"""test repeated random reads from lst/lsx files ....."""
+		fa = 'lsttest_a.hdf'
+		fb = 'lsttest_b.hdf'
+		imga = self.make_images(fa, 6, 10)
+		imgb = self.make_images(fb, 4, 100)
+
+		refs = [(fa, 3, imga[3]), (fb, 0, imgb[0]), (fa, 0, imga[0]), (fb, 2, imgb[2]),
+				(fa, 5, imga[5]), (fa, 1, imga[1]), (fb, 3, imgb[3])]
+		order = [4, 0, 6, 2, 2, 5, 1, 3, 0, 6, 4, 1]
+
+		lst = 'lsttest.lst'
+		with open(lst, 'w') as out:
+			out.write("#LST\n")
+			for fname, n, img in refs:
+				out.write("%d\t%s\n" % (n, fname))
+
+		lsx = 'lsttest.lsx'
+		testlib.safe_unlink(lsx)
+		lf = LSXFile(lsx)
+		for fname, n, img in refs:
+			lf.write(-1, n, fname)
+		lf.close()
+		lf = None
+
+		for i in range(2):
+			self.check_list(lst, refs, order, "source_path")
+			self.check_list(lsx, refs, order, "data_source")
+		self.assertEqual(EMUtil.get_image_count(lsx), len(refs))
+
+		# a changed list is parsed again
+		refs = refs[::-1] + [(fb, 1, imgb[1])]
+		with open(lst, 'w') as out:
+			out.write("#LST\n")
+			for fname, n, img in refs:
+				out.write("%d\t%s\n" % (n, fname))
+		lf = LSXFile(lsx)
+		for i, (fname, n, img) in enumerate(refs):
+			lf.write(i, n, fname)
+		lf.close()
+		lf = None
+		self.assertEqual(EMUtil.get_image_count(lst), len(refs))
+		self.assertEqual(EMUtil.get_image_count(lsx), len(refs))
+		self.check_list(lst, refs, order + [7], "source_path")
+		self.check_list(lsx, refs, order + [7], "data_source")
+
+		# an image written to a referenced file is seen by the next read
+		e = EMData(16, 16)
+		e.process_inplace("testimage.noise.uniform.rand", {"seed":999})
+		e.write_image(fa, 3)
+		refs = [(fname, n, e if (fname, n) == (fa, 3) else img) for fname, n, img in refs]
+		self.check_list(lst, refs, order, "source_path")
+		self.check_list(lsx, refs, order, "data_source")
+
+		for f in (fa, fb, lst, lsx):
+			testlib.safe_unlink(f)
+
+
 class TestImageIO(unittest.TestCase):
 	"""image data IO test"""
 		
@@ -1505,5 +1818,8 @@ def test_main():
 	suite14 = unittest.TestLoader().loadTestsFromTestCase(TestDF3IO)	
 	unittest.TextTestRunner(verbosity=2).run(suite14) 
 	
+	suite15 = unittest.TestLoader().loadTestsFromTestCase(TestLstIO)
+	unittest.TextTestRunner(verbosity=2).run(suite15)
+	
 if __name__ == '__main__':
 	test_main()
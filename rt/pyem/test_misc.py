@@ -32,6 +32,7 @@
 
 from EMAN2 import *
 import unittest
+import random
 import testlib
 import sys
 from optparse import OptionParser
@@ -153,6 +154,106 @@ class TestRegion(unittest.TestCase):
         self.assertEqual(e8.get_ndim(), 3)
         
 
+class TestPointArray(unittest.TestCase):
+    """tests for class PointArray"""
+
+    def make_points(self, n):
+        random.seed(n)
+        pts = []
+        for i in range(n):
+            pts += [random.uniform(-20, 20), random.uniform(-20, 20), random.uniform(-15, 15), random.uniform(0.5, 1.5)]
+        pa = PointArray()
+        pa.set_from(pts)
+        return pa, pts
+
+    def test_summation_threads(self):
+        """test threaded summation matches one thread ......"""
+        pa, pts = self.make_points(2500)   # sim_potential works in blocks of 1024 points
+        xforms = [Transform({"type":"eman", "az":a, "alt":a*0.7, "phi":a*1.3}) for a in (0, 17, 95, 170, 250)]
+
+        ref = None
+        for n in (1, 2, 4, 7):
+            pa.set_threads(n)
+            self.assertEqual(pa.get_threads(), n)
+            vol = pa.pdb2mrc_by_summation(48, 1.5, 4.0, 0)
+            proj = pa.projection_by_summation(48, 1.5, 4.0)
+            projs = pa.projections_by_summation(48, 1.5, 4.0, xforms)
+            self.assertEqual(len(projs), len(xforms))
+
+            pa.sim_set_pot_parms(3.8, 1.0, 1.0, 0.0, 0.0, 10.0, vol, 0.0, 0.0)
+            pot = pa.sim_potential()
+
+            if ref is None:
+                ref = (vol, proj, projs, pot)
+                continue
+            self.assertEqual(vol.get_data_as_vector(), ref[0].get_data_as_vector())
+            self.assertEqual(proj.get_data_as_vector(), ref[1].get_data_as_vector())
+            for p, r in zip(projs, ref[2]):
+                self.assertEqual(p.get_data_as_vector(), r.get_data_as_vector())
+            self.assertEqual(pot, ref[3])
+
+        # each projection is the projection of the transformed points
+        for t, p in zip(xforms, ref[2]):
+            moved = []
+            for i in range(0, len(pts), 4):
+                v = t.transform(Vec3f(pts[i], pts[i+1], pts[i+2]))
+                moved += [v[0], v[1], v[2], pts[i+3]]
+            pb = PointArray()
+            pb.set_from(moved)
+            expect = pb.projection_by_summation(48, 1.5, 4.0)
+            tol = 1e-4 * expect["maximum"]
+            for a, b in zip(p.get_data_as_vector(), expect.get_data_as_vector()):
+                self.assertTrue(abs(a - b) <= tol)
+
+@unittest.skipUnless("MarchingCubes" in globals(), "EMAN2 was built without OpenGL")
+class TestMarchingCubes(unittest.TestCase):
+    """tests for class MarchingCubes, using get_mesh so no GL context is needed"""
+
+    def check_mesh(self, mesh):
+        points = mesh["points"]
+        faces = mesh["faces"]
+        self.assertTrue(len(faces) > 0)
+        self.assertEqual(len(faces) % 3, 0)
+
+        # vertices on block boundaries are shared, never repeated
+        verts = [tuple(points[i:i+3]) for i in range(0, len(points), 3)]
+        self.assertEqual(len(set(verts)), len(verts))
+        self.assertTrue(max(faces) < len(verts))
+
+        tris = set(tuple(sorted(verts[v] for v in faces[i:i+3])) for i in range(0, len(faces), 3))
+        self.assertEqual(len(tris), len(faces)//3)
+
+    def test_threads(self):
+        """test threaded isosurface matches one thread ......"""
+        e = EMData(33, 31, 29)   # odd sizes, so the blocks at the upper edges are partial
+        e.process_inplace("testimage.noise.gauss", {"seed":11})
+        e.process_inplace("filter.lowpass.gauss", {"cutoff_abs":0.15})
+        thr = e["mean"] + 0.5*e["sigma"]
+
+        for level in (-1, 0, 1):
+            ref = None
+            for n in (1, 2, 4, 7):
+                mc = MarchingCubes(e)
+                mc.set_threads(n)
+                mc.set_surface_value(thr)
+                mc.set_sampling(level)
+                mesh = mc.get_mesh()
+                if ref is None:
+                    self.check_mesh(mesh)
+                    ref = mesh
+                else:
+                    self.assertEqual(mesh["points"], ref["points"])
+                    self.assertEqual(mesh["faces"], ref["faces"])
+                    self.assertEqual(mesh["normals"], ref["normals"])
+
+            # a new surface value on an existing object gives the same mesh as a new object
+            mc.set_surface_value(thr + 0.25*e["sigma"])
+            mc.get_mesh()
+            mc.set_surface_value(thr)
+            mesh = mc.get_mesh()
+            self.assertEqual(mesh["points"], ref["points"])
+            self.assertEqual(mesh["faces"], ref["faces"])
+
 def test_main():
     p = OptionParser()
     p.add_option('--t', action='store_true', help='test exception', default=False )
@@ -165,10 +266,14 @@ def test_main():
     suite2 = unittest.TestLoader().loadTestsFromTestCase(TestBoost)
     suite3 = unittest.TestLoader().loadTestsFromTestCase(TestException)
     suite4 = unittest.TestLoader().loadTestsFromTestCase(TestRegion)
+    suite5 = unittest.TestLoader().loadTestsFromTestCase(TestMarchingCubes)
+    suite6 = unittest.TestLoader().loadTestsFromTestCase(TestPointArray)
     unittest.TextTestRunner(verbosity=2).run(suite1)
     unittest.TextTestRunner(verbosity=2).run(suite2)
     unittest.TextTestRunner(verbosity=2).run(suite3)
     unittest.TextTestRunner(verbosity=2).run(suite4)
+    unittest.TextTestRunner(verbosity=2).run(suite5)
+    unittest.TextTestRunner(verbosity=2).run(suite6)
 
 if __name__ == '__main__':
     test_main()
@@ -1994,6 +1994,85 @@ class TestProcessor(unittest.TestCase):
                     self.assertAlmostEqual(d2[i][j][k], d4[i][j][k], 3)
                     self.assertAlmostEqual(d1[i][j][k], d5[i][j][k], 3)
         
+    def test_plugin_profiler(self):
+        """test PluginProfiler counts and allocations ......."""
+        import json
+        PluginProfiler.set_enabled(False)
+        PluginProfiler.reset()
+        e = EMData(64,64)
+        e.process_inplace('testimage.noise.uniform.rand')
+        self.assertEqual(json.loads(PluginProfiler.to_json()), {})
+
+        PluginProfiler.set_enabled(True)
+        try:
+            for i in range(3):
+                e.process_inplace('math.absvalue')
+            f = e.process('math.absvalue')
+            e.process_inplace('math.maxshrink', {'shrink':2})    # shrinks the data in place
+            g = EMData(64,64)
+            g.process_inplace('testimage.fourier.gaussianband', {'center':8})    # grows it by 2 columns
+            stats = json.loads(PluginProfiler.to_json())['processor']
+        finally:
+            PluginProfiler.set_enabled(False)
+            PluginProfiler.reset()
+
+        self.assertEqual(stats['math.absvalue']['count'], 4)
+        self.assertEqual(stats['math.absvalue']['sizes'], {'64x64x1': 4})
+        self.assertGreaterEqual(stats['math.absvalue']['bytes_allocated'], 64*64*4)
+        self.assertEqual(stats['math.maxshrink']['count'], 1)
+        self.assertEqual(stats['math.maxshrink']['bytes_allocated'], 0)
+        self.assertEqual(stats['testimage.fourier.gaussianband']['bytes_allocated'], 2*64*4)
+        self.assertEqual(e.get_xsize(), 32)
+        self.assertEqual(g.get_xsize(), 66)
+
+    def xform_reference(self, d, t):
+        """per pixel bilinear/trilinear transform of a (z,y,x) array, as xform did before threading"""
+        m = numpy.array(t.inverse().get_matrix(), dtype=numpy.float64).reshape(3,4)
+        nz, ny, nx = d.shape
+        if nz == 1:
+            m[2,:] = 0
+            m[:,2] = 0
+        k, j, i = numpy.mgrid[0:nz, 0:ny, 0:nx].astype(numpy.float64)
+        c = (i-nx//2, j-ny//2, k-nz//2)
+        x = m[0,0]*c[0]+m[0,1]*c[1]+m[0,2]*c[2]+m[0,3]+nx//2
+        y = m[1,0]*c[0]+m[1,1]*c[1]+m[1,2]*c[2]+m[1,3]+ny//2
+        z = m[2,0]*c[0]+m[2,1]*c[1]+m[2,2]*c[2]+m[2,3]+nz//2
+        inside = (x >= 0) & (x < nx) & (y >= 0) & (y < ny) & (z >= 0) & (z < nz)
+        xs, ys, zs = numpy.where(inside, x, 0), numpy.where(inside, y, 0), numpy.where(inside, z, 0)
+        ix, iy, iz = numpy.floor(xs).astype(int), numpy.floor(ys).astype(int), numpy.floor(zs).astype(int)
+        tx, ty, tz = xs-ix, ys-iy, zs-iz
+        ix1, iy1, iz1 = numpy.minimum(ix+1, nx-1), numpy.minimum(iy+1, ny-1), numpy.minimum(iz+1, nz-1)
+        r = 0
+        for zz, wz in ((iz, 1-tz), (iz1, tz)):
+            for yy, wy in ((iy, 1-ty), (iy1, ty)):
+                for xx, wx in ((ix, 1-tx), (ix1, tx)):
+                    r = r + wz*wy*wx*d[zz, yy, xx]
+        # pixels mapping right onto the image border may fall either side of it in float
+        edge = numpy.zeros(d.shape, dtype=bool)
+        for v, n in ((x, nx), (y, ny), (z, nz)):
+            if n > 1: edge |= (numpy.abs(v) < 1e-3) | (numpy.abs(v-n) < 1e-3)
+        return numpy.where(inside, r, 0), edge
+
+    def test_xform_real_oldpath(self):
+        """test xform real space path against per pixel ....."""
+        xforms = [Transform({"type":"2d", "alpha":23.5, "tx":3.25, "ty":-1.75}),
+            Transform({"type":"2d", "alpha":-90.0, "mirror":1, "scale":1.3}),
+            Transform({"type":"2d", "tx":2.5, "ty":-4.0}),
+            Transform({"type":"2d", "tx":-3.0, "ty":5.0})]
+        xforms3 = [Transform({"type":"eman", "az":31.0, "alt":67.0, "phi":-12.0, "tx":1.5, "ty":-2.25, "tz":0.75}),
+            Transform({"type":"eman", "alt":90.0, "tz":-2.0})]
+        for size, tlist in (((65,48,1), xforms), ((32,29,27), xforms3)):
+            e = test_image_3d(0, size) if size[2] > 1 else test_image(0, size[:2])
+            e.process_inplace("normalize.edgemean")
+            d = e.get_3dview().copy() if size[2] > 1 else e.get_2dview().copy().reshape(1, size[1], size[0])
+            for t in tlist:
+                ref, edge = self.xform_reference(d, t)
+                for threads in (1, 4):
+                    f = e.process("xform", {"transform":t, "threads":threads})
+                    r = f.get_3dview() if size[2] > 1 else f.get_2dview().reshape(ref.shape)
+                    err = numpy.abs(numpy.where(edge, 0, r-ref))
+                    self.assertLess(err.max(), 1e-4*numpy.abs(d).max())
+
     #this filter.integercyclicshift2d processor is removed by Phani at 5/18/2006    
     def no_test_IntegerCyclicShift2DProcessor(self):
         """test filter.integercyclicshift2d processor........"""
@@ -133,6 +133,29 @@ class TestReconstructor(unittest.TestCase):
 		r.insert_slice(e3, Transform({'type':'eman', 'alt':1.56, 'az':2.56, 'phi':3.56}))
 		result = r.finish()
 		
+	def test_FourierReconstructor_threads(self):
+		"""test FourierReconstructor threads ................"""
+		n = 32
+		imgs = []
+		for i in range(30):
+			e = EMData()
+			e.set_size(n,n,1)
+			e.process_inplace('testimage.noise.uniform.rand')
+			imgs.append((e, Transform({'type':'eman', 'alt':6.0*i, 'az':13.0*i, 'phi':7.0*i})))
+
+		for mode in ('gauss_2', 'gauss_var'):
+			for sym in ('c1', 'd2'):
+				vols = []
+				for threads in (1, 4):
+					r = Reconstructors.get('fourier', {'size':(n,n,n), 'mode':mode, 'sym':sym, 'quiet':True, 'threads':threads})
+					r.setup()
+					for e, t in imgs:
+						r.insert_slice(e, t)
+					vols.append(EMNumPy.em2numpy(r.finish(True)).copy())
+				# the threads accumulate into private volumes, so only the summation order differs
+				scale = numpy.abs(vols[0]).max()
+				self.assertTrue(numpy.abs(vols[0]-vols[1]).max() <= 1.0e-4*scale)
+
 	def test_BackProjectionReconstructor(self):
 		"""test BackProjectionReconstructor ................."""
 		e1 = EMData()
@@ -174,6 +197,59 @@ class TestReconstructor(unittest.TestCase):
 		r.insert_slice(e3, Transform({'type':'eman', 'az':0.0, 'alt':0.0, 'phi':0.0}))
 		result = r.finish()
 	
+	def test_nn4_threads(self):
+		"""test nn4Reconstructor threads ...................."""
+		n = 24
+		imgs = []
+		xforms = []
+		for i in range(40):
+			e = EMData()
+			e.set_size(n,n,1)
+			e.process_inplace('testimage.noise.uniform.rand')
+			imgs.append(e)
+			# half of the particles are close to 0 tilt, so they land in only a few z slabs
+			alt = 0.5*(i%3) if i%2 else 7.0*i
+			xforms.append(Transform({'type':'spider', 'phi':9.0*i, 'theta':alt, 'psi':5.0*i}))
+
+		for sym in ('c1', 'c4'):
+			vols = []
+			for threads in (1, 4):
+				fftvol = EMData()
+				weight = EMData()
+				r = Reconstructors.get('nn4', {'size':n, 'npad':2, 'symmetry':sym, 'fftvol':fftvol, 'weight':weight, 'threads':threads})
+				r.setup()
+				for e, t in zip(imgs, xforms):
+					r.insert_slice(e, t)
+				vol = r.finish(True)
+				vols.append((EMNumPy.em2numpy(vol).copy(), EMNumPy.em2numpy(weight).copy()))
+			# each voxel gets its contributions in the same order whatever the number of threads
+			self.assertTrue(numpy.array_equal(vols[0][0], vols[1][0]))
+			self.assertTrue(numpy.array_equal(vols[0][1], vols[1][1]))
+
+	def test_nn4_threads_sync(self):
+		"""test nn4Reconstructor sync before finish ........."""
+		n = 24
+		imgs = []
+		for i in range(21):
+			e = EMData()
+			e.set_size(n,n,1)
+			e.process_inplace('testimage.noise.uniform.rand')
+			imgs.append((e, Transform({'type':'spider', 'phi':11.0*i, 'theta':4.0*i, 'psi':3.0*i})))
+
+		vols = []
+		for threads in (1, 4):
+			fftvol = EMData()
+			weight = EMData()
+			r = Reconstructors.get('nn4', {'size':n, 'npad':2, 'symmetry':'c1', 'fftvol':fftvol, 'weight':weight, 'threads':threads})
+			r.setup()
+			for e, t in imgs:
+				r.insert_slice(e, t)
+			# fftvol and weight are read directly, as by reduce_EMData_to_root before finish()
+			r.sync()
+			vols.append((EMNumPy.em2numpy(fftvol).copy(), EMNumPy.em2numpy(weight).copy()))
+		self.assertTrue(numpy.array_equal(vols[0][0], vols[1][0]))
+		self.assertTrue(numpy.array_equal(vols[0][1], vols[1][1]))
+
 	def no_test_ReverseGriddingReconstructor(self):
 		"""test ReverseGriddingReconstructor ................"""
 		e1 = EMData()
@@ -907,6 +907,35 @@ class TestSymmetry(unittest.TestCase):
 				for i in range(1,n):
 					self.assert_reduction_works(i,az,alt,azmax,sym)
 					
+	def test_reduce_list_cached(self):
+		"""test cached orientations and reduce_list ........."""
+		import random
+		rnd = random.Random(7)
+		xforms = [Transform({"type":"eman", "az":rnd.uniform(0,360), "alt":rnd.uniform(0,180), "phi":rnd.uniform(0,360)}) for i in range(2000)]
+		for name,parms in (("c",{"nsym":4}), ("d",{"nsym":7}), ("tet",{}), ("oct",{}), ("icos",{})):
+			sym = Symmetries.get(name, parms)
+
+			# cached tables must be exactly what the generator makes
+			for gparms in ({"delta":5.0}, {"delta":7.5, "inc_mirror":1}):
+				ref = [t.get_matrix() for t in OrientGens.get("eman", gparms).gen_orientations(sym)]
+				for i in range(2):
+					self.assertEqual([t.get_matrix() for t in sym.gen_orientations("eman", gparms)], ref)
+				self.assertEqual([t.get_matrix() for t in Symmetries.get(name, parms).gen_orientations("eman", gparms)], ref)
+
+			# reduce has to give exactly what it did when it called get_sym every time
+			for n in (0, 2):
+				ref = []
+				for t in xforms:
+					nt = t*sym.get_sym(sym.in_which_asym_unit(t)).inverse()
+					if n: nt = nt*sym.get_sym(n)
+					ref.append(nt.get_matrix())
+				self.assertEqual([sym.reduce(t, n).get_matrix() for t in xforms], ref)
+				for threads in (1, 4):
+					fresh = Symmetries.get(name, parms)
+					self.assertEqual([t.get_matrix() for t in fresh.reduce_list(xforms, n, threads)], ref)
+			for t in sym.reduce_list(xforms[:200]):
+				self.assertEqual(sym.in_which_asym_unit(t), 0)
+
 	#this unit test fails on some platform, need to be fixed  --Grant
 	def no_test_symtet_reduce(self):
 		"""test tetsym reduce ..............................."""
@@ -653,7 +653,73 @@ class TestEMUtils(unittest.TestCase):
         self.assertEqual('count' in d, False)
         
         testlib.safe_unlink(file)
-        
+
+    def test_MultiRefPolarAligner(self):
+        """test MultiRefPolarAligner class .................."""
+        # ring layout as from Numrinit(1, 12) in sp_alignment, oversampled two times
+        numr = []
+        lcirc = 1
+        for k in range(1, 13):
+            jp = int(2*math.pi*k + 0.5)
+            ip = 2**jp.bit_length()
+            if k + 1 <= 12 and jp > ip + ip//2: ip = 2*ip
+            if k + 1 > 12 and jp > ip + ip//5: ip = 2*ip
+            numr += [k, lcirc, ip]
+            lcirc += ip
+
+        Util.set_randnum_seed(7)
+        refs = []
+        for i in range(9):
+            e = EMData(32,32)
+            e.process_inplace("testimage.noise.gauss")
+            e.process_inplace("filter.lowpass.gauss", {"cutoff_abs":0.15})
+            refs.append(e)
+        crefim = []
+        for e in refs:
+            c = Util.Polar2Dm(e, 17.0, 17.0, numr, "F")
+            Util.Frngs(c, numr)
+            crefim.append(c)
+
+        # rotated, shifted and sometimes mirrored copies of the references, with noise. Duplicated
+        # references make exact ties, which must be resolved as in the per image functions
+        crefim.append(crefim[3])
+        images = []
+        for i in range(14):
+            t = Transform({"type":"2d", "alpha":i*23.0, "tx":(i%5)-2, "ty":(i%3)-1, "mirror":i%4 == 1})
+            e = refs[i%9].process("xform", {"transform":t})
+            e.process_inplace("math.addnoise", {"noise":0.2})
+            images.append(e)
+
+        xrng = [[1.0 + i%2, 2.0] for i in range(14)]
+        yrng = [[2.0, 1.0 + i%3] for i in range(14)]
+        cnx = [17.0 + (i%3 - 1) for i in range(14)]
+        cny = [17.0] * 14
+        flat = lambda l: [v for x in l for v in x]
+
+        for threads in (1, 4):
+            al = Util.MultiRefPolarAligner(crefim, numr, "F", threads)
+            self.assertEqual(al.get_nref(), len(crefim))
+
+            # per image ranges and centers
+            got = al.align(images, flat(xrng), flat(yrng), 1.0, cnx, cny)
+            ref = []
+            for i, e in enumerate(images):
+                ref += Util.multiref_polar_ali_2d(e, crefim, xrng[i], yrng[i], 1.0, "F", numr, cnx[i], cny[i])
+            self.assertEqual(got, ref)
+
+            got = al.align_peaklist(images, flat(xrng), flat(yrng), 1.0, cnx, cny)
+            ref = []
+            for i, e in enumerate(images):
+                ref += Util.multiref_polar_ali_2d_peaklist(e, crefim, xrng[i], yrng[i], 1.0, "F", numr, cnx[i], cny[i])
+            self.assertEqual(got, ref)
+
+            # one set of ranges for all images
+            got = al.align(images, [2.0, 2.0], [1.0, 1.0], 0.5, [17.0], [17.0])
+            ref = []
+            for e in images:
+                ref += Util.multiref_polar_ali_2d(e, crefim, [2.0, 2.0], [1.0, 1.0], 0.5, "F", numr, 17.0, 17.0)
+            self.assertEqual(got, ref)
+
 def test_main():
     p = OptionParser()
     p.add_option('--t', action='store_true', help='test exception', default=False )